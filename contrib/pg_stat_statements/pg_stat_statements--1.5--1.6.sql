@@ -0,0 +1,55 @@
+/* contrib/pg_stat_statements/pg_stat_statements--1.5--1.6.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pg_stat_statements UPDATE TO '1.6'" to load this file. \quit
+
+/* Statistics of the other nodes of the cluster */
+CREATE FUNCTION pg_stat_statements_remote(
+    OUT node_name text,
+    OUT userid oid,
+    OUT dbid oid,
+    OUT queryid bigint,
+    OUT calls int8,
+    OUT total_time float8,
+    OUT rows int8,
+    OUT shared_blks_hit int8,
+    OUT shared_blks_read int8,
+    OUT shared_blks_dirtied int8,
+    OUT shared_blks_written int8
+)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT VOLATILE PARALLEL UNSAFE;
+
+-- Statistics of every node, one row per node and statement
+CREATE VIEW pg_stat_statements_nodes AS
+  SELECT pg_catalog.pgxc_node_str()::text AS node_name, userid, dbid, queryid,
+         calls, total_time, rows, shared_blks_hit, shared_blks_read,
+         shared_blks_dirtied, shared_blks_written
+    FROM pg_stat_statements(false)
+  UNION ALL
+  SELECT * FROM pg_stat_statements_remote();
+
+-- Statistics of the queries put together over all the nodes. The calls,
+-- time and rows are those of the Coordinators the queries were submitted
+-- to, the work done on their behalf by the Datanodes is shown apart
+CREATE VIEW pg_stat_statements_cluster AS
+  SELECT n.userid, n.dbid, n.queryid, l.query,
+         count(*) FILTER (WHERE x.node_type = 'D') AS datanodes,
+         coalesce(sum(n.calls) FILTER (WHERE x.node_type = 'C'), 0)::int8 AS calls,
+         coalesce(sum(n.total_time) FILTER (WHERE x.node_type = 'C'), 0) AS total_time,
+         coalesce(sum(n.rows) FILTER (WHERE x.node_type = 'C'), 0)::int8 AS rows,
+         coalesce(sum(n.total_time) FILTER (WHERE x.node_type = 'D'), 0) AS datanode_time,
+         coalesce(sum(n.rows) FILTER (WHERE x.node_type = 'D'), 0)::int8 AS datanode_rows,
+         sum(n.shared_blks_hit)::int8 AS shared_blks_hit,
+         sum(n.shared_blks_read)::int8 AS shared_blks_read,
+         sum(n.shared_blks_dirtied)::int8 AS shared_blks_dirtied,
+         sum(n.shared_blks_written)::int8 AS shared_blks_written
+    FROM pg_stat_statements_nodes n
+    JOIN pg_catalog.pgxc_node x ON x.node_name = n.node_name
+    LEFT JOIN pg_stat_statements l
+      ON l.userid = n.userid AND l.dbid = n.dbid AND l.queryid = n.queryid
+   GROUP BY n.userid, n.dbid, n.queryid, l.query;
+
+GRANT SELECT ON pg_stat_statements_nodes TO PUBLIC;
+GRANT SELECT ON pg_stat_statements_cluster TO PUBLIC;
@@ -78,6 +78,18 @@
 #include "tcop/utility.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
+#ifdef XCP
+#include "catalog/pg_type.h"
+#include "commands/dbcommands.h"
+#include "executor/executor.h"
+#include "nodes/makefuncs.h"
+#include "pgxc/execRemote.h"
+#include "pgxc/nodemgr.h"
+#include "pgxc/pgxc.h"
+#include "utils/acl.h"
+#include "utils/lsyscache.h"
+#include "utils/snapmgr.h"
+#endif
 
 PG_MODULE_MAGIC;
 
@@ -287,6 +299,9 @@ PG_FUNCTION_INFO_V1(pg_stat_statements_reset);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_2);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_3);
 PG_FUNCTION_INFO_V1(pg_stat_statements);
+#ifdef XCP
+PG_FUNCTION_INFO_V1(pg_stat_statements_remote);
+#endif
 
 static void pgss_shmem_startup(void);
 static void pgss_shmem_shutdown(int code, Datum arg);
@@ -805,6 +820,18 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query)
 		return;
 	}
 
+#ifdef XCP
+	/*
+	 * Statements run on behalf of a query of another node are accounted to
+	 * that query, so the statistics of all nodes can be put together.
+	 */
+	if (IsConnFromCoord() && PGXC_PARENT_QUERY_ID != 0)
+	{
+		query->queryId = PGXC_PARENT_QUERY_ID;
+		return;
+	}
+#endif
+
 	/* Set up workspace for query jumbling */
 	jstate.jumble = (unsigned char *) palloc(JUMBLE_SIZE);
 	jstate.jumble_len = 0;
@@ -1686,6 +1713,172 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	tuplestore_donestoring(tupstore);
 }
 
+#ifdef XCP
+#define PG_STAT_STATEMENTS_REMOTE_COLS	11
+
+/*
+ * Run the query on the given nodes, which must be all Datanodes or all
+ * Coordinators, and add the rows it returns to the tuplestore. The remote
+ * nodes report users and databases by name, which are mapped to the local
+ * oids, the entries of the objects not known here are skipped.
+ */
+static void
+pgss_remote_collect(Tuplestorestate *tupstore, TupleDesc tupdesc,
+					char *query, RemoteQueryExecType exec_type,
+					List *nodelist)
+{
+	EState	   *estate;
+	MemoryContext oldcontext;
+	RemoteQuery *plan;
+	RemoteQueryState *pstate;
+	TupleTableSlot *result;
+	Oid			coltypes[PG_STAT_STATEMENTS_REMOTE_COLS] = {
+		TEXTOID, TEXTOID, TEXTOID, INT8OID, INT8OID, FLOAT8OID,
+		INT8OID, INT8OID, INT8OID, INT8OID, INT8OID
+	};
+	int			i;
+
+	if (nodelist == NIL)
+		return;
+
+	plan = makeNode(RemoteQuery);
+	plan->combine_type = COMBINE_TYPE_NONE;
+	plan->exec_nodes = makeNode(ExecNodes);
+	plan->exec_nodes->nodeList = nodelist;
+	plan->exec_type = exec_type;
+	plan->sql_statement = query;
+	/* The target list only tells the types of the result */
+	for (i = 0; i < PG_STAT_STATEMENTS_REMOTE_COLS; i++)
+	{
+		Var		   *dummy = makeVar(1, i + 1, coltypes[i], -1, InvalidOid, 0);
+
+		plan->scan.plan.targetlist = lappend(plan->scan.plan.targetlist,
+											 makeTargetEntry((Expr *) dummy,
+															 i + 1, NULL,
+															 false));
+	}
+
+	estate = CreateExecutorState();
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+	estate->es_snapshot = GetActiveSnapshot();
+	pstate = ExecInitRemoteQuery(plan, estate, 0);
+	MemoryContextSwitchTo(oldcontext);
+
+	while ((result = ExecRemoteQuery((PlanState *) pstate)) != NULL &&
+		   !TupIsNull(result))
+	{
+		Datum		values[PG_STAT_STATEMENTS_REMOTE_COLS];
+		bool		nulls[PG_STAT_STATEMENTS_REMOTE_COLS];
+		Oid			userid;
+		Oid			dbid;
+
+		slot_getallattrs(result);
+		if (result->tts_isnull[1] || result->tts_isnull[2])
+			continue;
+		userid = get_role_oid(TextDatumGetCString(result->tts_values[1]),
+							  true);
+		dbid = get_database_oid(TextDatumGetCString(result->tts_values[2]),
+								true);
+		if (!OidIsValid(userid) || !OidIsValid(dbid))
+			continue;
+
+		memcpy(values, result->tts_values, sizeof(values));
+		memcpy(nulls, result->tts_isnull, sizeof(nulls));
+		values[1] = ObjectIdGetDatum(userid);
+		values[2] = ObjectIdGetDatum(dbid);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	ExecEndRemoteQuery(pstate);
+	FreeExecutorState(estate);
+}
+
+/*
+ * Statistics of the statements executed on the other nodes of the cluster:
+ * all the Datanodes and the Coordinators other than this one. Statements
+ * run on behalf of a query of a Coordinator have the identifier of that
+ * query, so the rows can be matched up with the local pg_stat_statements.
+ */
+Datum
+pg_stat_statements_remote(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	StringInfoData query;
+	char	   *nspname;
+	Oid		   *coOids;
+	Oid		   *dnOids;
+	int			numcoords;
+	int			numdns;
+	List	   *coords = NIL;
+	List	   *datanodes = NIL;
+	int			i;
+
+	if (!IS_PGXC_COORDINATOR)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("pg_stat_statements_remote can only be called on a Coordinator")));
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	if (tupdesc->natts != PG_STAT_STATEMENTS_REMOTE_COLS)
+		elog(ERROR, "incorrect number of output arguments");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* The extension lives in the same schema on every node */
+	nspname = get_namespace_name(get_func_namespace(fcinfo->flinfo->fn_oid));
+	initStringInfo(&query);
+	appendStringInfo(&query,
+					 "SELECT pg_catalog.pgxc_node_str()::text, r.rolname::text, "
+					 "d.datname::text, s.queryid, s.calls, s.total_time, "
+					 "s.rows, s.shared_blks_hit, s.shared_blks_read, "
+					 "s.shared_blks_dirtied, s.shared_blks_written "
+					 "FROM %s.pg_stat_statements(false) s "
+					 "JOIN pg_catalog.pg_roles r ON r.oid = s.userid "
+					 "JOIN pg_catalog.pg_database d ON d.oid = s.dbid",
+					 quote_identifier(nspname));
+
+	PgxcNodeGetOids(&coOids, &dnOids, &numcoords, &numdns, false);
+	for (i = 0; i < numcoords; i++)
+		if (i != PGXCNodeId - 1)
+			coords = lappend_int(coords, i);
+	for (i = 0; i < numdns; i++)
+		datanodes = lappend_int(datanodes, i);
+
+	pgss_remote_collect(tupstore, tupdesc, query.data, EXEC_ON_DATANODES,
+						datanodes);
+	pgss_remote_collect(tupstore, tupdesc, query.data, EXEC_ON_COORDS,
+						coords);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+#endif
+
 /*
  * Estimate shared memory space needed.
  */
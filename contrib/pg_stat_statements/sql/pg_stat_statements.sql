@@ -195,4 +195,30 @@ DROP FUNCTION PLUS_TWO(INTEGER);
 
 SELECT query, calls, rows FROM pg_stat_statements ORDER BY query COLLATE "C";
 
+--
+-- distributed statements, put together over the nodes
+--
+SET pg_stat_statements.track_utility = FALSE;
+CREATE TABLE pgss_dist (a int, b int) DISTRIBUTE BY HASH (a);
+INSERT INTO pgss_dist SELECT i, i FROM generate_series(1, 10) i;
+SELECT pg_stat_statements_reset();
+
+SELECT count(*) FROM pgss_dist WHERE b > 0;
+SELECT count(*) FROM pgss_dist WHERE b > 5;
+
+-- the Datanodes account their part to the statement of the Coordinator
+SELECT x.node_type, count(*) AS nodes, sum(n.calls) AS calls
+  FROM pg_stat_statements_nodes n
+  JOIN pgxc_node x ON x.node_name = n.node_name
+ WHERE n.queryid = (SELECT queryid FROM pg_stat_statements
+                     WHERE query LIKE 'SELECT count(*) FROM pgss_dist%')
+ GROUP BY x.node_type ORDER BY x.node_type;
+
+-- calls and rows are the Coordinator's, the Datanodes' are shown apart
+SELECT query, calls, rows, datanodes, datanode_rows
+  FROM pg_stat_statements_cluster
+ WHERE query LIKE 'SELECT count(*) FROM pgss_dist%';
+
+DROP TABLE pgss_dist;
+
 DROP EXTENSION pg_stat_statements;
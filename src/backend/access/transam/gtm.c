@@ -15,19 +15,26 @@
 #include "gtm/libpq-fe.h"
 #include "gtm/gtm_client.h"
 #include "access/gtm.h"
+#include "access/hash.h"
 #include "access/transam.h"
+#include "access/twophase_rmgr.h"
 #include "access/xact.h"
+#include "lib/stringinfo.h"
 #include "utils/elog.h"
 #include "miscadmin.h"
 #include "pgxc/pgxc.h"
+#include "pgxc/waitstats.h"
 #include "gtm/gtm_c.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/clustermon.h"
 #include "storage/backendid.h"
+#include "storage/proc.h"
 #include "tcop/tcopprot.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/varlena.h"
 
 /* To access sequences */
 #define GetMyCoordName \
@@ -38,10 +45,55 @@ int GtmPort = 6666;
 static int GtmConnectTimeout = 60;
 bool IsXidFromGTM = false;
 bool gtm_backup_barrier = false;
+char *GtmSequenceServers = "";
 extern bool FirstSnapshotSet;
 
 static GTM_Conn *conn;
 
+/*
+ * GTM instances owning the sequences, see gtm_sequence_servers. A sequence
+ * belongs to the server picked by the hash of its key, or to the main GTM
+ * when there is none.
+ */
+typedef struct GTMSequenceServer
+{
+	char	   *host;
+	int			port;
+	GTM_Conn   *conn;
+} GTMSequenceServer;
+
+static GTMSequenceServer *seq_servers = NULL;
+static int	num_seq_servers = -1;	/* -1 until gtm_sequence_servers is parsed */
+
+/*
+ * Sequence servers do not know the global transaction IDs, so what the main
+ * GTM does at the end of the transaction which created, dropped or renamed a
+ * sequence is done here instead: drops are deferred until commit, creations
+ * and renames are reverted on abort.
+ */
+typedef enum
+{
+	SEQ_ACTION_CREATE,
+	SEQ_ACTION_DROP,
+	SEQ_ACTION_DROP_DB,
+	SEQ_ACTION_RENAME
+} GTMSequenceActionType;
+
+typedef struct GTMSequenceAction
+{
+	GTMSequenceActionType type;
+	char	   *name;
+	char	   *newname;		/* SEQ_ACTION_RENAME only */
+	struct GTMSequenceAction *next;
+} GTMSequenceAction;
+
+/* Actions of the current transaction, most recent first */
+static GTMSequenceAction *seq_actions = NULL;
+static LocalTransactionId seq_actions_lxid = InvalidLocalTransactionId;
+
+/* Connection on which the cluster monitor receives GlobalXmin notifications */
+static GTM_Conn *xmin_conn;
+
 /* Used to check if needed to commit/abort at datanodes */
 GlobalTransactionId currentGxid = InvalidGlobalTransactionId;
 
@@ -149,9 +201,11 @@ BeginTranGTM(GTM_Timestamp *timestamp, const char *globalSession)
 	GlobalTransactionId  xid = InvalidGlobalTransactionId;
 	struct rusage start_r;
 	struct timeval start_t;
+	instr_time	wait_start;
 
 	if (log_gtm_stats)
 		ResetUsageCommon(&start_r, &start_t);
+	RemoteWaitStart(wait_start);
 
 	CheckConnection();
 	// TODO Isolation level
@@ -174,6 +228,7 @@ BeginTranGTM(GTM_Timestamp *timestamp, const char *globalSession)
 
 	elog(DEBUG2, "BeginTranGTM - session:%s, xid: %d", globalSession, xid);
 
+	RemoteWaitEnd(REMOTE_WAIT_GTM, wait_start);
 	if (log_gtm_stats)
 		ShowUsageCommon("BeginTranGTM", &start_r, &start_t);
 	return xid;
@@ -213,12 +268,14 @@ CommitTranGTM(GlobalTransactionId gxid, int waited_xid_count,
 	int ret;
 	struct rusage start_r;
 	struct timeval start_t;
+	instr_time	wait_start;
 
 	if (!GlobalTransactionIdIsValid(gxid))
 		return 0;
 
 	if (log_gtm_stats)
 		ResetUsageCommon(&start_r, &start_t);
+	RemoteWaitStart(wait_start);
 
 	elog(DEBUG3, "CommitTranGTM: %d", gxid);
 
@@ -245,7 +302,10 @@ CommitTranGTM(GlobalTransactionId gxid, int waited_xid_count,
 		CloseGTM();
 
 	currentGxid = InvalidGlobalTransactionId;
+	if (ret >= 0)
+		ClusterMonitorNoteSeqno(GTMPQlastSeqno(conn));
 
+	RemoteWaitEnd(REMOTE_WAIT_GTM, wait_start);
 	if (log_gtm_stats)
 		ShowUsageCommon("CommitTranGTM", &start_r, &start_t);
 	return ret;
@@ -263,12 +323,14 @@ CommitPreparedTranGTM(GlobalTransactionId gxid,
 	int ret = 0;
 	struct rusage start_r;
 	struct timeval start_t;
+	instr_time	wait_start;
 
 	if (!GlobalTransactionIdIsValid(gxid) || !GlobalTransactionIdIsValid(prepared_gxid))
 		return ret;
 
 	if (log_gtm_stats)
 		ResetUsageCommon(&start_r, &start_t);
+	RemoteWaitStart(wait_start);
 
 	elog(DEBUG3, "CommitPreparedTranGTM: %d:%d", gxid, prepared_gxid);
 
@@ -293,7 +355,10 @@ CommitPreparedTranGTM(GlobalTransactionId gxid,
 					waited_xid_count, waited_xids);
 	}
 	currentGxid = InvalidGlobalTransactionId;
+	if (ret >= 0)
+		ClusterMonitorNoteSeqno(GTMPQlastSeqno(conn));
 
+	RemoteWaitEnd(REMOTE_WAIT_GTM, wait_start);
 	if (log_gtm_stats)
 		ShowUsageCommon("CommitPreparedTranGTM", &start_r, &start_t);
 
@@ -304,9 +369,11 @@ int
 RollbackTranGTM(GlobalTransactionId gxid)
 {
 	int ret = -1;
+	instr_time	wait_start;
 
 	if (!GlobalTransactionIdIsValid(gxid))
 		return 0;
+	RemoteWaitStart(wait_start);
 	CheckConnection();
 
 	if (conn)
@@ -326,6 +393,7 @@ RollbackTranGTM(GlobalTransactionId gxid)
 	}
 
 	currentGxid = InvalidGlobalTransactionId;
+	RemoteWaitEnd(REMOTE_WAIT_GTM, wait_start);
 	return ret;
 }
 
@@ -335,9 +403,11 @@ StartPreparedTranGTM(GlobalTransactionId gxid,
 					 char *nodestring)
 {
 	int ret = 0;
+	instr_time	wait_start;
 
 	if (!GlobalTransactionIdIsValid(gxid))
 		return 0;
+	RemoteWaitStart(wait_start);
 	CheckConnection();
 
 	ret = -1;
@@ -357,6 +427,7 @@ StartPreparedTranGTM(GlobalTransactionId gxid,
 			ret = start_prepared_transaction(conn, gxid, gid, nodestring);
 	}
 
+	RemoteWaitEnd(REMOTE_WAIT_GTM, wait_start);
 	return ret;
 }
 
@@ -366,9 +437,11 @@ PrepareTranGTM(GlobalTransactionId gxid)
 	int ret;
 	struct rusage start_r;
 	struct timeval start_t;
+	instr_time	wait_start;
 
 	if (!GlobalTransactionIdIsValid(gxid))
 		return 0;
+	RemoteWaitStart(wait_start);
 	CheckConnection();
 
 	if (log_gtm_stats)
@@ -392,6 +465,7 @@ PrepareTranGTM(GlobalTransactionId gxid)
 	}
 	currentGxid = InvalidGlobalTransactionId;
 
+	RemoteWaitEnd(REMOTE_WAIT_GTM, wait_start);
 	if (log_gtm_stats)
 		ShowUsageCommon("PrepareTranGTM", &start_r, &start_t);
 
@@ -403,7 +477,8 @@ int
 GetGIDDataGTM(char *gid,
 			  GlobalTransactionId *gxid,
 			  GlobalTransactionId *prepared_gxid,
-			  char **nodestring)
+			  char **nodestring,
+			  bool *attached)
 {
 	int ret = 0;
 
@@ -411,7 +486,7 @@ GetGIDDataGTM(char *gid,
 	ret = -1;
 	if (conn)
 		ret = get_gid_data(conn, GTM_ISOLATION_RC, gid, gxid,
-					   prepared_gxid, nodestring);
+					   prepared_gxid, nodestring, attached);
 
 	/*
 	 * If something went wrong (timeout), try and reset GTM connection.
@@ -424,19 +499,72 @@ GetGIDDataGTM(char *gid,
 		InitGTM();
 		if (conn)
 			ret = get_gid_data(conn, GTM_ISOLATION_RC, gid, gxid,
-							   prepared_gxid, nodestring);
+							   prepared_gxid, nodestring, attached);
 	}
 
 	return ret;
 }
 
+/*
+ * GetGIDDataGTM for several GIDs in one round trip. For each of them, gxid
+ * and prepared_gxid are invalid if GTM does not know of it. Returns -1 if
+ * GTM could not be reached.
+ */
+int
+GetGIDDataGTMMulti(int count, char **gids,
+				   GlobalTransactionId *gxid,
+				   GlobalTransactionId *prepared_gxid,
+				   bool *attached)
+{
+	GTM_GIDData *data;
+	int			ret;
+	int			i;
+
+	Assert(count > 0 && count <= GTM_MAX_GLOBAL_TRANSACTIONS);
+
+	data = (GTM_GIDData *) palloc(count * sizeof(GTM_GIDData));
+
+	CheckConnection();
+	ret = -1;
+	if (conn)
+		ret = get_gid_data_multi(conn, GTM_ISOLATION_RC, count, gids, data);
+
+	/* Same as GetGIDDataGTM */
+	if (ret < 0)
+	{
+		CloseGTM();
+		InitGTM();
+		if (conn)
+			ret = get_gid_data_multi(conn, GTM_ISOLATION_RC, count, gids,
+									 data);
+	}
+
+	if (ret >= 0)
+	{
+		for (i = 0; i < count; i++)
+		{
+			bool		known = (data[i].status == STATUS_OK);
+
+			gxid[i] = known ? data[i].gxid : InvalidGlobalTransactionId;
+			prepared_gxid[i] = known ? data[i].prepared_gxid :
+				InvalidGlobalTransactionId;
+			attached[i] = known && data[i].attached;
+		}
+	}
+
+	pfree(data);
+	return ret;
+}
+
 GTM_Snapshot
 GetSnapshotGTM(GlobalTransactionId gxid, bool canbe_grouped)
 {
 	GTM_Snapshot ret_snapshot = NULL;
 	struct rusage start_r;
 	struct timeval start_t;
+	instr_time	wait_start;
 
+	RemoteWaitStart(wait_start);
 	CheckConnection();
 
 	if (log_gtm_stats)
@@ -451,13 +579,493 @@ GetSnapshotGTM(GlobalTransactionId gxid, bool canbe_grouped)
 		if (conn)
 			ret_snapshot = get_snapshot(conn, gxid, canbe_grouped);
 	}
+	if (ret_snapshot)
+		ClusterMonitorNoteSeqno(ret_snapshot->sn_seqno);
 
+	RemoteWaitEnd(REMOTE_WAIT_GTM, wait_start);
 	if (log_gtm_stats)
 		ShowUsageCommon("GetSnapshotGTM", &start_r, &start_t);
 
 	return ret_snapshot;
 }
 
+/*
+ * Get a timestamp for a timestamp based snapshot or commit. Returns 0 if GTM
+ * could not be reached.
+ */
+GTM_Timestamp
+GetTimestampGTM(void)
+{
+	GTM_Timestamp timestamp = 0;
+	int ret = -1;
+	instr_time	wait_start;
+
+	RemoteWaitStart(wait_start);
+	CheckConnection();
+	if (conn)
+		ret = get_timestamp(conn, &timestamp);
+	if (ret < 0)
+	{
+		CloseGTM();
+		InitGTM();
+		if (conn)
+			ret = get_timestamp(conn, &timestamp);
+	}
+
+	RemoteWaitEnd(REMOTE_WAIT_GTM, wait_start);
+	return ret < 0 ? 0 : timestamp;
+}
+
+
+/*
+ * Split gtm_sequence_servers into its host:port entries, the port defaults
+ * to gtm_port.
+ */
+static bool
+ParseSequenceServers(const char *value, GTMSequenceServer **servers,
+					 int *count)
+{
+	char	   *rawstring = pstrdup(value);
+	List	   *elemlist;
+	ListCell   *lc;
+	int			i = 0;
+
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	*count = list_length(elemlist);
+	*servers = (GTMSequenceServer *)
+		palloc0(Max(*count, 1) * sizeof(GTMSequenceServer));
+	foreach(lc, elemlist)
+	{
+		char	   *elem = (char *) lfirst(lc);
+		char	   *sep = strrchr(elem, ':');
+		GTMSequenceServer *server = &(*servers)[i++];
+
+		server->port = GtmPort;
+		if (sep)
+		{
+			char	   *endptr;
+			long		port = strtol(sep + 1, &endptr, 10);
+
+			if (*endptr != '\0' || port < 1 || port > 65535)
+			{
+				pfree(rawstring);
+				list_free(elemlist);
+				return false;
+			}
+			server->port = (int) port;
+			*sep = '\0';
+		}
+		if (*elem == '\0')
+		{
+			pfree(rawstring);
+			list_free(elemlist);
+			return false;
+		}
+		server->host = pstrdup(elem);
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+	return true;
+}
+
+bool
+check_gtm_sequence_servers(char **newval, void **extra, GucSource source)
+{
+	GTMSequenceServer *servers;
+	int			count;
+	int			i;
+
+	if (!ParseSequenceServers(*newval, &servers, &count))
+	{
+		GUC_check_errdetail("List syntax is invalid, expected a comma-separated list of host[:port].");
+		return false;
+	}
+
+	for (i = 0; i < count; i++)
+		pfree(servers[i].host);
+	pfree(servers);
+	return true;
+}
+
+/*
+ * Index of the sequence server owning the given sequence, -1 if sequences
+ * stay on the main GTM
+ */
+static int
+SequenceServerFor(const char *seqname)
+{
+	if (num_seq_servers < 0)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+		/* Validated by the check hook already */
+		if (!ParseSequenceServers(GtmSequenceServers, &seq_servers,
+								  &num_seq_servers))
+			num_seq_servers = 0;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	if (num_seq_servers == 0)
+		return -1;
+
+	return DatumGetUInt32(hash_any((const unsigned char *) seqname,
+								   strlen(seqname))) % num_seq_servers;
+}
+
+/*
+ * Get a connection to the given sequence server, NULL if it cannot be
+ * reached
+ */
+static GTM_Conn *
+SequenceConn(int server)
+{
+	GTMSequenceServer *seqserver;
+
+	if (server < 0)
+	{
+		CheckConnection();
+		return conn;
+	}
+
+	seqserver = &seq_servers[server];
+	if (seqserver->conn && GTMPQstatus(seqserver->conn) != CONNECTION_OK)
+	{
+		GTMPQfinish(seqserver->conn);
+		seqserver->conn = NULL;
+	}
+
+	if (seqserver->conn == NULL)
+	{
+		/* 256 bytes should be enough */
+		char		conn_str[256];
+
+		snprintf(conn_str, sizeof(conn_str),
+				 "host=%s port=%d node_name=%s connect_timeout=%d",
+				 seqserver->host, seqserver->port, PGXCNodeName,
+				 GtmConnectTimeout);
+
+		seqserver->conn = PQconnectGTM(conn_str);
+		if (GTMPQstatus(seqserver->conn) != CONNECTION_OK)
+		{
+			ereport(WARNING,
+					(errcode(ERRCODE_CONNECTION_EXCEPTION),
+					 errmsg("can not connect to GTM sequence server %s:%d",
+							seqserver->host, seqserver->port)));
+			GTMPQfinish(seqserver->conn);
+			seqserver->conn = NULL;
+		}
+		else
+			elog(DEBUG1, "connection established to GTM sequence server with string %s",
+				 conn_str);
+	}
+
+	return seqserver->conn;
+}
+
+static void
+CloseSequenceConn(int server)
+{
+	if (server < 0)
+	{
+		CloseGTM();
+		return;
+	}
+
+	GTMPQfinish(seq_servers[server].conn);
+	seq_servers[server].conn = NULL;
+}
+
+/*
+ * Rename a sequence on the sequence servers, moving it to the server owning
+ * the new name if that is another one. There is no message to fetch a single
+ * sequence, but renames are rare enough to afford getting the whole list.
+ */
+static int
+MoveSequence(char *seqname, int server, const char *newseqname, int newserver)
+{
+	GTM_SequenceKeyData seqkey, newseqkey;
+	GTM_Conn   *seqconn = SequenceConn(server);
+	GTM_Conn   *newconn;
+	GTM_SeqInfo *seq_list;
+	GTM_SeqInfo	seq;
+	int			count;
+	int			i;
+
+	if (seqconn == NULL)
+		return -1;
+
+	seqkey.gsk_keylen = strlen(seqname) + 1;
+	seqkey.gsk_key = seqname;
+	seqkey.gsk_type = GTM_SEQ_FULL_NAME;
+	newseqkey.gsk_keylen = strlen(newseqname) + 1;
+	newseqkey.gsk_key = (char *) newseqname;
+	newseqkey.gsk_type = GTM_SEQ_FULL_NAME;
+
+	if (server == newserver)
+		return rename_sequence(seqconn, &seqkey, &newseqkey,
+							   InvalidGlobalTransactionId);
+
+	count = get_sequence_list(seqconn, &seq_list);
+	for (i = 0; i < count; i++)
+		if (strcmp(seq_list[i].gs_key->gsk_key, seqname) == 0)
+			break;
+	if (i >= count)
+		return -1;
+	seq = seq_list[i];
+
+	newconn = SequenceConn(newserver);
+	if (newconn == NULL ||
+		open_sequence(newconn, &newseqkey, seq.gs_increment_by,
+					  seq.gs_min_value, seq.gs_max_value, seq.gs_init_value,
+					  seq.gs_cycle, InvalidGlobalTransactionId) < 0)
+		return -1;
+
+	if (set_val(newconn, &newseqkey,
+				IS_PGXC_COORDINATOR ? PGXCNodeName : GetMyCoordName,
+				IS_PGXC_COORDINATOR ? MyProcPid : MyCoordPid,
+				seq.gs_value, seq.gs_called) < 0)
+	{
+		close_sequence(newconn, &newseqkey, InvalidGlobalTransactionId);
+		return -1;
+	}
+
+	return close_sequence(seqconn, &seqkey, InvalidGlobalTransactionId);
+}
+
+/*
+ * Drop a sequence, or all the sequences of a database, on the sequence
+ * servers
+ */
+static int
+DropSequenceServers(char *name, GTM_SequenceKeyType type)
+{
+	GTM_SequenceKeyData seqkey;
+	GTM_Conn   *seqconn;
+	int			ret = 0;
+	int			i;
+
+	seqkey.gsk_keylen = strlen(name) + 1;
+	seqkey.gsk_key = name;
+	seqkey.gsk_type = type;
+
+	if (type == GTM_SEQ_FULL_NAME)
+	{
+		seqconn = SequenceConn(SequenceServerFor(name));
+		return seqconn ? close_sequence(seqconn, &seqkey,
+										InvalidGlobalTransactionId) : -1;
+	}
+
+	for (i = 0; i < num_seq_servers; i++)
+	{
+		seqconn = SequenceConn(i);
+		if (seqconn == NULL ||
+			close_sequence(seqconn, &seqkey, InvalidGlobalTransactionId) < 0)
+			ret = -1;
+	}
+	return ret;
+}
+
+/*
+ * Drops take effect at commit. The remote nodes may have committed already,
+ * so failures only leave orphaned sequences behind. The actions are listed
+ * most recent first.
+ */
+static void
+DropSequenceActions(GTMSequenceAction *action)
+{
+	GTMSequenceAction *drops = NULL;
+	GTMSequenceAction *next;
+
+	/* Drop in the order of the statements */
+	for (; action; action = next)
+	{
+		next = action->next;
+		action->next = drops;
+		drops = action;
+	}
+
+	for (action = drops; action; action = action->next)
+	{
+		if (action->type != SEQ_ACTION_DROP &&
+			action->type != SEQ_ACTION_DROP_DB)
+			continue;
+
+		if (DropSequenceServers(action->name,
+								action->type == SEQ_ACTION_DROP ?
+								GTM_SEQ_FULL_NAME : GTM_SEQ_DB_NAME) < 0)
+			ereport(WARNING,
+					(errcode(ERRCODE_CONNECTION_EXCEPTION),
+					 errmsg("could not drop sequence \"%s\" on GTM sequence server",
+							action->name)));
+	}
+}
+
+/*
+ * Revert creations and renames at abort, most recent first
+ */
+static void
+RevertSequenceActions(GTMSequenceAction *action)
+{
+	for (; action; action = action->next)
+	{
+		int			ret = 0;
+
+		if (action->type == SEQ_ACTION_CREATE)
+			ret = DropSequenceServers(action->name, GTM_SEQ_FULL_NAME);
+		else if (action->type == SEQ_ACTION_RENAME)
+			ret = MoveSequence(action->newname,
+							   SequenceServerFor(action->newname),
+							   action->name,
+							   SequenceServerFor(action->name));
+
+		if (ret < 0)
+			ereport(WARNING,
+					(errcode(ERRCODE_CONNECTION_EXCEPTION),
+					 errmsg("could not revert changes of sequence \"%s\" on GTM sequence server",
+							action->name)));
+	}
+}
+
+static void
+SequenceActionCallback(GTMEvent event, void *arg)
+{
+	GTMSequenceAction *action = seq_actions;
+
+	/*
+	 * COMMIT PREPARED or ROLLBACK PREPARED may be run by another session, or
+	 * after a restart. The actions are saved with the prepared transaction by
+	 * AtPrepare_SequenceActions, unless the prepare fails and we get here
+	 * again to abort.
+	 */
+	if (event == GTM_EVENT_PREPARE)
+		return;
+
+	/* Whatever happens, the actions are done with */
+	seq_actions = NULL;
+
+	if (event == GTM_EVENT_COMMIT)
+		DropSequenceActions(action);
+	else
+		RevertSequenceActions(action);
+}
+
+/*
+ * Save the sequence actions of the transaction being prepared in its
+ * two-phase state file. Each action is its type, followed by the sequence
+ * name and the new name of a rename, or an empty string.
+ */
+void
+AtPrepare_SequenceActions(void)
+{
+	GTMSequenceAction *action;
+	StringInfoData buf;
+
+	if (seq_actions == NULL || seq_actions_lxid != MyProc->lxid)
+		return;
+
+	initStringInfo(&buf);
+	for (action = seq_actions; action; action = action->next)
+	{
+		const char *newname = action->newname ? action->newname : "";
+
+		appendStringInfoChar(&buf, (char) action->type);
+		appendBinaryStringInfo(&buf, action->name, strlen(action->name) + 1);
+		appendBinaryStringInfo(&buf, newname, strlen(newname) + 1);
+	}
+
+	RegisterTwoPhaseRecord(TWOPHASE_RM_SEQUENCE_ID, 0, buf.data, buf.len);
+	pfree(buf.data);
+
+	/* COMMIT PREPARED or ROLLBACK PREPARED will take care of them */
+	seq_actions = NULL;
+}
+
+/*
+ * Rebuild the list of actions saved by AtPrepare_SequenceActions, most
+ * recent first. The names point into the record.
+ */
+static GTMSequenceAction *
+ReadSequenceActions(void *recdata, uint32 len)
+{
+	char	   *data = (char *) recdata;
+	char	   *end = data + len;
+	GTMSequenceAction *first = NULL;
+	GTMSequenceAction *last = NULL;
+
+	while (data < end)
+	{
+		GTMSequenceAction *action;
+
+		action = (GTMSequenceAction *) palloc(sizeof(GTMSequenceAction));
+		action->type = (GTMSequenceActionType) *data++;
+		action->name = data;
+		data += strlen(data) + 1;
+		action->newname = *data ? data : NULL;
+		data += strlen(data) + 1;
+		action->next = NULL;
+
+		if (last)
+			last->next = action;
+		else
+			first = action;
+		last = action;
+	}
+
+	return first;
+}
+
+/*
+ * 2PC processing routine for COMMIT PREPARED case.
+ */
+void
+sequence_twophase_postcommit(TransactionId xid, uint16 info,
+							 void *recdata, uint32 len)
+{
+	DropSequenceActions(ReadSequenceActions(recdata, len));
+}
+
+/*
+ * 2PC processing routine for ROLLBACK PREPARED case.
+ */
+void
+sequence_twophase_postabort(TransactionId xid, uint16 info,
+							void *recdata, uint32 len)
+{
+	RevertSequenceActions(ReadSequenceActions(recdata, len));
+}
+
+static void
+RememberSequenceAction(GTMSequenceActionType type, const char *name,
+					   const char *newname)
+{
+	GTMSequenceAction *action;
+
+	/* The list lives in TopTransactionContext, forget older transactions */
+	if (seq_actions_lxid != MyProc->lxid)
+	{
+		seq_actions = NULL;
+		seq_actions_lxid = MyProc->lxid;
+	}
+
+	if (seq_actions == NULL)
+		RegisterGTMCallback(SequenceActionCallback, NULL);
+
+	action = (GTMSequenceAction *)
+		MemoryContextAlloc(TopTransactionContext, sizeof(GTMSequenceAction));
+	action->type = type;
+	action->name = MemoryContextStrdup(TopTransactionContext, name);
+	action->newname = newname ?
+		MemoryContextStrdup(TopTransactionContext, newname) : NULL;
+	action->next = seq_actions;
+	seq_actions = action;
+}
 
 /*
  * Create a sequence on the GTM.
@@ -467,12 +1075,22 @@ CreateSequenceGTM(char *seqname, GTM_Sequence increment, GTM_Sequence minval,
 				  GTM_Sequence maxval, GTM_Sequence startval, bool cycle)
 {
 	GTM_SequenceKeyData seqkey;
-	CheckConnection();
+	int			server = SequenceServerFor(seqname);
+	GTM_Conn   *seqconn = SequenceConn(server);
+	int			ret;
+
 	seqkey.gsk_keylen = strlen(seqname) + 1;
 	seqkey.gsk_key = seqname;
 
-	return conn ? open_sequence(conn, &seqkey, increment, minval, maxval,
-			startval, cycle, GetTopTransactionId()) : 0;
+	if (server < 0)
+		return seqconn ? open_sequence(seqconn, &seqkey, increment, minval,
+				maxval, startval, cycle, GetTopTransactionId()) : 0;
+
+	ret = seqconn ? open_sequence(seqconn, &seqkey, increment, minval, maxval,
+			startval, cycle, InvalidGlobalTransactionId) : -1;
+	if (ret == 0)
+		RememberSequenceAction(SEQ_ACTION_CREATE, seqname, NULL);
+	return ret;
 }
 
 /*
@@ -483,11 +1101,12 @@ AlterSequenceGTM(char *seqname, GTM_Sequence increment, GTM_Sequence minval,
 				 GTM_Sequence maxval, GTM_Sequence startval, GTM_Sequence lastval, bool cycle, bool is_restart)
 {
 	GTM_SequenceKeyData seqkey;
-	CheckConnection();
+	GTM_Conn   *seqconn = SequenceConn(SequenceServerFor(seqname));
+
 	seqkey.gsk_keylen = strlen(seqname) + 1;
 	seqkey.gsk_key = seqname;
 
-	return conn ? alter_sequence(conn, &seqkey, increment, minval, maxval,
+	return seqconn ? alter_sequence(seqconn, &seqkey, increment, minval, maxval,
 			startval, lastval, cycle, is_restart) : 0;
 }
 
@@ -502,29 +1121,36 @@ GetCurrentValGTM(char *seqname)
 	GTM_SequenceKeyData seqkey;
 	char   *coordName = IS_PGXC_COORDINATOR ? PGXCNodeName : GetMyCoordName;
 	int		coordPid = IS_PGXC_COORDINATOR ? MyProcPid : MyCoordPid;
+	int		server;
+	GTM_Conn *seqconn;
 	int		status;
+	instr_time	wait_start;
+
+	RemoteWaitStart(wait_start);
+	server = SequenceServerFor(seqname);
+	seqconn = SequenceConn(server);
 
-	CheckConnection();
 	seqkey.gsk_keylen = strlen(seqname) + 1;
 	seqkey.gsk_key = seqname;
 
-	if (conn)
-		status = get_current(conn, &seqkey, coordName, coordPid, &ret);
+	if (seqconn)
+		status = get_current(seqconn, &seqkey, coordName, coordPid, &ret);
 	else
 		status = GTM_RESULT_COMM_ERROR;
 
 	/* retry once */
 	if (status == GTM_RESULT_COMM_ERROR)
 	{
-		CloseGTM();
-		InitGTM();
-		if (conn)
-			status = get_current(conn, &seqkey, coordName, coordPid, &ret);
+		CloseSequenceConn(server);
+		seqconn = SequenceConn(server);
+		if (seqconn)
+			status = get_current(seqconn, &seqkey, coordName, coordPid, &ret);
 	}
+	RemoteWaitEnd(REMOTE_WAIT_GTM, wait_start);
 	if (status != GTM_RESULT_OK)
 		ereport(ERROR,
 				(errcode(ERRCODE_INTERNAL_ERROR),
-				 errmsg("%s", GTMPQerrorMessage(conn))));
+				 errmsg("%s", GTMPQerrorMessage(seqconn))));
 	return ret;
 }
 
@@ -538,14 +1164,20 @@ GetNextValGTM(char *seqname, GTM_Sequence range, GTM_Sequence *rangemax)
 	GTM_SequenceKeyData seqkey;
 	char   *coordName = IS_PGXC_COORDINATOR ? PGXCNodeName : GetMyCoordName;
 	int		coordPid = IS_PGXC_COORDINATOR ? MyProcPid : MyCoordPid;
+	int		server;
+	GTM_Conn *seqconn;
 	int		status;
+	instr_time	wait_start;
+
+	RemoteWaitStart(wait_start);
+	server = SequenceServerFor(seqname);
+	seqconn = SequenceConn(server);
 
-	CheckConnection();
 	seqkey.gsk_keylen = strlen(seqname) + 1;
 	seqkey.gsk_key = seqname;
 
-	if (conn)
-		status = get_next(conn, &seqkey, coordName,
+	if (seqconn)
+		status = get_next(seqconn, &seqkey, coordName,
 						  coordPid, range, &ret, rangemax);
 	else
 		status = GTM_RESULT_COMM_ERROR;
@@ -553,16 +1185,17 @@ GetNextValGTM(char *seqname, GTM_Sequence range, GTM_Sequence *rangemax)
 	/* retry once */
 	if (status == GTM_RESULT_COMM_ERROR)
 	{
-		CloseGTM();
-		InitGTM();
-		if (conn)
-			status = get_next(conn, &seqkey, coordName, coordPid,
+		CloseSequenceConn(server);
+		seqconn = SequenceConn(server);
+		if (seqconn)
+			status = get_next(seqconn, &seqkey, coordName, coordPid,
 							  range, &ret, rangemax);
 	}
+	RemoteWaitEnd(REMOTE_WAIT_GTM, wait_start);
 	if (status != GTM_RESULT_OK)
 		ereport(ERROR,
 				(errcode(ERRCODE_INTERNAL_ERROR),
-				 errmsg("%s", GTMPQerrorMessage(conn))));
+				 errmsg("%s", GTMPQerrorMessage(seqconn))));
 	return ret;
 }
 
@@ -575,12 +1208,12 @@ SetValGTM(char *seqname, GTM_Sequence nextval, bool iscalled)
 	GTM_SequenceKeyData seqkey;
 	char   *coordName = IS_PGXC_COORDINATOR ? PGXCNodeName : GetMyCoordName;
 	int		coordPid = IS_PGXC_COORDINATOR ? MyProcPid : MyCoordPid;
+	GTM_Conn *seqconn = SequenceConn(SequenceServerFor(seqname));
 
-	CheckConnection();
 	seqkey.gsk_keylen = strlen(seqname) + 1;
 	seqkey.gsk_key = seqname;
 
-	return conn ? set_val(conn, &seqkey, coordName, coordPid, nextval, iscalled) : -1;
+	return seqconn ? set_val(seqconn, &seqkey, coordName, coordPid, nextval, iscalled) : -1;
 }
 
 /*
@@ -589,11 +1222,25 @@ SetValGTM(char *seqname, GTM_Sequence nextval, bool iscalled)
  * Type of Sequence name use in key;
  *		GTM_SEQ_FULL_NAME, full name of sequence
  *		GTM_SEQ_DB_NAME, DB name part of sequence key
+ *
+ * With sequence servers the drop happens at commit, the sequences of a
+ * database are dropped on all of them.
  */
 int
 DropSequenceGTM(char *name, GTM_SequenceKeyType type)
 {
 	GTM_SequenceKeyData seqkey;
+
+	if (SequenceServerFor(name) >= 0)
+	{
+		RememberSequenceAction(type == GTM_SEQ_DB_NAME ?
+							   SEQ_ACTION_DROP_DB : SEQ_ACTION_DROP,
+							   name, NULL);
+		if (type == GTM_SEQ_FULL_NAME)
+			return 0;
+	}
+
+	/* Sequences of a database may also have been left on the main GTM */
 	CheckConnection();
 	seqkey.gsk_keylen = strlen(name) + 1;
 	seqkey.gsk_key = name;
@@ -609,6 +1256,18 @@ int
 RenameSequenceGTM(char *seqname, const char *newseqname)
 {
 	GTM_SequenceKeyData seqkey, newseqkey;
+	int			server = SequenceServerFor(seqname);
+	int			ret;
+
+	if (server >= 0)
+	{
+		ret = MoveSequence(seqname, server, newseqname,
+						   SequenceServerFor(newseqname));
+		if (ret == 0)
+			RememberSequenceAction(SEQ_ACTION_RENAME, seqname, newseqname);
+		return ret;
+	}
+
 	CheckConnection();
 	seqkey.gsk_keylen = strlen(seqname) + 1;
 	seqkey.gsk_key = seqname;
@@ -713,3 +1372,61 @@ ReportGlobalXmin(GlobalTransactionId gxid, GlobalTransactionId *global_xmin,
 			gxid, global_xmin, latest_completed_xid, &errcode);
 	return errcode;
 }
+
+/*
+ * Open a second connection to GTM and subscribe to GlobalXmin notifications
+ * on it. Returns the socket to wait on, or PGINVALID_SOCKET on failure.
+ */
+pgsocket
+SubscribeGlobalXminGTM(void)
+{
+	char conn_str[256];
+
+	if (xmin_conn)
+		return GTMPQsocket(xmin_conn);
+
+	sprintf(conn_str, "host=%s port=%d node_name=%s connect_timeout=%d",
+			GtmHost, GtmPort, PGXCNodeName, GtmConnectTimeout);
+
+	xmin_conn = PQconnectGTM(conn_str);
+	if (GTMPQstatus(xmin_conn) != CONNECTION_OK ||
+		subscribe_global_xmin(xmin_conn, PGXCNodeName,
+			IS_PGXC_COORDINATOR ?  GTM_NODE_COORDINATOR : GTM_NODE_DATANODE))
+	{
+		elog(DEBUG1, "could not subscribe to GlobalXmin notifications");
+		UnsubscribeGlobalXminGTM();
+		return PGINVALID_SOCKET;
+	}
+
+	elog(DEBUG1, "subscribed to GlobalXmin notifications");
+	return GTMPQsocket(xmin_conn);
+}
+
+void
+UnsubscribeGlobalXminGTM(void)
+{
+	GTMPQfinish(xmin_conn);
+	xmin_conn = NULL;
+}
+
+/*
+ * Read the latest GlobalXmin notification. Returns the error code sent by
+ * GTM, or EOF if the connection broke, in which case it is closed.
+ */
+int
+ReceiveGlobalXminGTM(GlobalTransactionId *global_xmin,
+		GlobalTransactionId *latest_completed_xid)
+{
+	int errcode = GTM_ERRCODE_UNKNOWN;
+
+	if (!xmin_conn)
+		return EOF;
+
+	if (receive_global_xmin(xmin_conn, global_xmin, latest_completed_xid,
+				&errcode))
+	{
+		UnsubscribeGlobalXminGTM();
+		return EOF;
+	}
+	return errcode;
+}
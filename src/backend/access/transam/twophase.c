@@ -560,6 +560,38 @@ MarkAsPrepared(GlobalTransaction gxact, bool lock_held)
 	ProcArrayAdd(&ProcGlobal->allProcs[gxact->pgprocno]);
 }
 
+#ifdef XCP
+/*
+ * PreparedTransactionIsBusy
+ *		Is some backend committing or rolling back the given transaction?
+ *
+ * This includes the backend that prepared it as part of an implicit 2PC and
+ * has not finished it yet.
+ */
+bool
+PreparedTransactionIsBusy(const char *gid)
+{
+	bool		busy = false;
+	int			i;
+
+	LWLockAcquire(TwoPhaseStateLock, LW_SHARED);
+	for (i = 0; i < TwoPhaseState->numPrepXacts; i++)
+	{
+		GlobalTransaction gxact = TwoPhaseState->prepXacts[i];
+
+		if (strcmp(gxact->gid, gid) == 0)
+		{
+			busy = !gxact->valid ||
+				gxact->locking_backend != InvalidBackendId;
+			break;
+		}
+	}
+	LWLockRelease(TwoPhaseStateLock);
+
+	return busy;
+}
+#endif
+
 /*
  * LockGXact
  *		Locate the prepared transaction and mark it busy for COMMIT or PREPARE.
@@ -589,8 +621,16 @@ LockGXact(const char *gid, Oid user)
 		if (strcmp(gxact->gid, gid) != 0)
 			continue;
 
-		/* Found it, but has someone else got it locked? */
-		if (gxact->locking_backend != InvalidBackendId)
+		/*
+		 * Found it, but has someone else got it locked?  The backend running
+		 * an implicit 2PC keeps it locked from PREPARE on, see
+		 * PrepareTransaction.
+		 */
+		if (gxact->locking_backend != InvalidBackendId
+#ifdef XCP
+			&& gxact != MyLockedGxact
+#endif
+			)
 			ereport(ERROR,
 					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 					 errmsg("prepared transaction with identifier \"%s\" is busy",
@@ -2204,6 +2244,16 @@ RecordTransactionCommitPrepared(TransactionId xid,
 	XLogRecPtr	recptr;
 	TimestampTz committs = GetCurrentTimestamp();
 	bool		replorigin;
+#ifdef XCP
+	TimestampTz commit_ts = AssignXactCommitTimestamp();
+
+	/* Same on all the nodes involved, see GetSnapshotTimestamp */
+	if (commit_ts != 0)
+	{
+		committs = commit_ts;
+		ProcArrayNoteTimestampCommit(xid, commit_ts);
+	}
+#endif
 
 	/*
 	 * Are we using the replication origins feature?  Or, in other words, are
@@ -14,6 +14,9 @@
  */
 #include "postgres.h"
 
+#ifdef XCP
+#include "access/gtm.h"
+#endif
 #include "access/multixact.h"
 #include "access/twophase_rmgr.h"
 #include "pgstat.h"
@@ -27,7 +30,10 @@ const TwoPhaseCallback twophase_recover_callbacks[TWOPHASE_RM_MAX_ID + 1] =
 	lock_twophase_recover,		/* Lock */
 	NULL,						/* pgstat */
 	multixact_twophase_recover, /* MultiXact */
-	predicatelock_twophase_recover	/* PredicateLock */
+	predicatelock_twophase_recover,	/* PredicateLock */
+#ifdef XCP
+	NULL						/* GTM sequence servers */
+#endif
 };
 
 const TwoPhaseCallback twophase_postcommit_callbacks[TWOPHASE_RM_MAX_ID + 1] =
@@ -36,7 +42,10 @@ const TwoPhaseCallback twophase_postcommit_callbacks[TWOPHASE_RM_MAX_ID + 1] =
 	lock_twophase_postcommit,	/* Lock */
 	pgstat_twophase_postcommit, /* pgstat */
 	multixact_twophase_postcommit,	/* MultiXact */
-	NULL						/* PredicateLock */
+	NULL,						/* PredicateLock */
+#ifdef XCP
+	sequence_twophase_postcommit	/* GTM sequence servers */
+#endif
 };
 
 const TwoPhaseCallback twophase_postabort_callbacks[TWOPHASE_RM_MAX_ID + 1] =
@@ -45,7 +54,10 @@ const TwoPhaseCallback twophase_postabort_callbacks[TWOPHASE_RM_MAX_ID + 1] =
 	lock_twophase_postabort,	/* Lock */
 	pgstat_twophase_postabort,	/* pgstat */
 	multixact_twophase_postabort,	/* MultiXact */
-	NULL						/* PredicateLock */
+	NULL,						/* PredicateLock */
+#ifdef XCP
+	sequence_twophase_postabort	/* GTM sequence servers */
+#endif
 };
 
 const TwoPhaseCallback twophase_standby_recover_callbacks[TWOPHASE_RM_MAX_ID + 1] =
@@ -54,5 +66,8 @@ const TwoPhaseCallback twophase_standby_recover_callbacks[TWOPHASE_RM_MAX_ID + 1
 	lock_twophase_standby_recover,	/* Lock */
 	NULL,						/* pgstat */
 	NULL,						/* MultiXact */
-	NULL						/* PredicateLock */
+	NULL,						/* PredicateLock */
+#ifdef XCP
+	NULL						/* GTM sequence servers */
+#endif
 };
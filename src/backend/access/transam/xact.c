@@ -326,6 +326,20 @@ static TimestampTz GTMxactStartTimestamp = 0;
 static TimestampTz GTMdeltaTimestamp = 0;
 #endif
 
+/*
+ * A transaction which used timestamp based snapshots records the commit
+ * timestamp it gets from GTM, or which the Coordinator got for the COMMIT
+ * PREPARED it sends us, so that the same transactions are visible on all
+ * nodes (see GetSnapshotTimestamp). All the snapshots of a transaction use
+ * the same timestamp, except under READ COMMITTED where every statement gets
+ * a new one.
+ */
+#ifdef XCP
+static TimestampTz XactSnapshotTimestamp = 0;
+static bool XactSnapshotTimestampStale = false;
+static TimestampTz XactCommitTimestamp = 0;
+#endif
+
 /*
  * GID to be used for preparing the current transaction.  This is also
  * global to a whole transaction, so we don't keep it in the state stack.
@@ -694,6 +708,15 @@ AssignTransactionId(TransactionState s)
 			if (GTMxactStartTimestamp == 0)
 				GTMxactStartTimestamp = (TimestampTz) gtm_timestamp;
 			GTMdeltaTimestamp = GTMxactStartTimestamp - stmtStartTimestamp;
+#ifdef XCP
+			/*
+			 * GTM takes it from the sequence of snapshot timestamps, so the
+			 * first snapshot need not ask for another one.
+			 */
+			if (XactSnapshotTimestamp == 0 &&
+				GlobalSnapshotSource == GLOBAL_SNAPSHOT_SOURCE_TIMESTAMP)
+				XactSnapshotTimestamp = (TimestampTz) gtm_timestamp;
+#endif
 		}
 	}
 #else
@@ -1022,6 +1045,105 @@ SetCurrentGTMDeltaTimestamp(TimestampTz timestamp)
 }
 #endif
 
+#ifdef XCP
+/*
+ *  SetXactSnapshotTimestamp
+ *
+ *  Note: the current transaction took a timestamp based snapshot, so it must
+ *  commit with a timestamp from GTM
+ */
+void
+SetXactSnapshotTimestamp(TimestampTz timestamp)
+{
+	if (XactSnapshotTimestamp == 0 || XactSnapshotTimestampStale)
+	{
+		XactSnapshotTimestamp = timestamp;
+		XactSnapshotTimestampStale = false;
+	}
+}
+
+/*
+ *	NextXactSnapshotTimestamp
+ *
+ * Called when a READ COMMITTED statement takes its snapshot: it must see the
+ * transactions committed before it started, so the next snapshot gets a new
+ * timestamp. The old one is kept until then, the transaction still has to
+ * commit with a timestamp from GTM.
+ */
+void
+NextXactSnapshotTimestamp(void)
+{
+	if (XactSnapshotTimestamp != 0)
+		XactSnapshotTimestampStale = true;
+}
+
+/*
+ *	AssignXactSnapshotTimestamp
+ *
+ * Returns the timestamp of the snapshots of the current transaction or
+ * statement, getting one from GTM for the first one. A read-only transaction
+ * makes only this trip to GTM, one per statement under READ COMMITTED.
+ */
+TimestampTz
+AssignXactSnapshotTimestamp(void)
+{
+	if (XactSnapshotTimestamp == 0 || XactSnapshotTimestampStale)
+	{
+		XactSnapshotTimestamp = GetTimestampGTM();
+		XactSnapshotTimestampStale = false;
+		if (XactSnapshotTimestamp == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_FAILURE),
+					 errmsg("could not obtain a snapshot timestamp from GTM")));
+	}
+
+	return XactSnapshotTimestamp;
+}
+
+/*
+ *  SetXactCommitTimestamp
+ *
+ *  Note: sets the commit timestamp the Coordinator got from GTM
+ */
+void
+SetXactCommitTimestamp(TimestampTz timestamp)
+{
+	XactCommitTimestamp = timestamp;
+}
+
+/*
+ *	AssignXactCommitTimestamp
+ *
+ * Returns the commit timestamp of the current transaction, getting one from
+ * GTM if it has none yet and uses timestamp based snapshots. Returns 0 if
+ * the transaction commits with the local clock as usual.
+ */
+TimestampTz
+AssignXactCommitTimestamp(void)
+{
+	if (XactCommitTimestamp == 0 &&
+		(XactSnapshotTimestamp != 0 ||
+		 GlobalSnapshotSource == GLOBAL_SNAPSHOT_SOURCE_TIMESTAMP))
+	{
+		/*
+		 * Snapshots whose timestamp is handed out before ours could miss
+		 * our commit without this: make them wait for us until our XID is
+		 * cleared from the procarray.
+		 */
+		MyProc->tsCommitting = true;
+		pg_memory_barrier();
+
+		XactCommitTimestamp = GetTimestampGTM();
+		if (XactCommitTimestamp == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_FAILURE),
+					 errmsg("could not obtain a commit timestamp from GTM")));
+	}
+
+	return XactCommitTimestamp;
+}
+#endif
+
 /*
  *	GetCurrentTransactionNestLevel
  *
@@ -1484,6 +1606,10 @@ RecordTransactionCommit(void)
 	else
 	{
 		bool		replorigin;
+		TimestampTz xact_time;
+#ifdef XCP
+		TimestampTz commit_ts;
+#endif
 
 		/*
 		 * Are we using the replication origins feature?  Or, in other words,
@@ -1492,6 +1618,13 @@ RecordTransactionCommit(void)
 		replorigin = (replorigin_session_origin != InvalidRepOriginId &&
 					  replorigin_session_origin != DoNotReplicateId);
 
+#ifdef XCP
+		/* Get it from GTM before entering the critical section */
+		commit_ts = AssignXactCommitTimestamp();
+		if (commit_ts != 0)
+			ProcArrayNoteTimestampCommit(xid, commit_ts);
+#endif
+
 		/*
 		 * Begin commit critical section and insert the commit XLOG record.
 		 */
@@ -1519,8 +1652,17 @@ RecordTransactionCommit(void)
 		MyPgXact->delayChkpt = true;
 
 		SetCurrentTransactionStopTimestamp();
+		xact_time = xactStopTimestamp + GTMdeltaTimestamp;
+#ifdef XCP
+		/*
+		 * With timestamp based snapshots, both the commit record and the
+		 * commit timestamp data must have the one from GTM.
+		 */
+		if (commit_ts != 0)
+			xact_time = xactStopTimestamp = commit_ts;
+#endif
 
-		XactLogCommitRecord(xactStopTimestamp + GTMdeltaTimestamp,
+		XactLogCommitRecord(xact_time,
 							nchildren, children, nrels, rels,
 							nmsgs, invalMessages,
 							RelcacheInitFileInval, forceSyncCommit,
@@ -2693,6 +2835,11 @@ CommitTransaction(void)
 	AtEOXact_Remote();
 	GTMxactStartTimestamp = 0;
 #endif
+#ifdef XCP
+	XactSnapshotTimestamp = 0;
+	XactSnapshotTimestampStale = false;
+	XactCommitTimestamp = 0;
+#endif
 }
 
 /*
@@ -2975,6 +3122,7 @@ PrepareTransaction(void)
 	AtPrepare_RelationMap();
 
 #ifdef XCP
+	AtPrepare_SequenceActions();
 	AtEOXact_WaitedXids();
 #endif
 
@@ -3048,6 +3196,15 @@ PrepareTransaction(void)
 	 * PostPrepare_Twophase(), the transaction is completely detached from our
 	 * backend.  The rest is just non-critical cleanup of backend-local state.
 	 */
+#ifdef XCP
+	/*
+	 * Not during an implicit 2PC though: we commit the transaction ourselves
+	 * as soon as the remote nodes are done, and until then it must look busy
+	 * to the 2PC resolver.  FinishPreparedTransaction or AtAbort_Twophase
+	 * release it.
+	 */
+	if (!isImplicit)
+#endif
 	PostPrepare_Twophase();
 
 	/* PREPARE acts the same as COMMIT as far as GUC is concerned */
@@ -3076,6 +3233,9 @@ PrepareTransaction(void)
 #ifdef XCP	
 	AtEOXact_Remote();	
 	GTMxactStartTimestamp = 0;
+	XactSnapshotTimestamp = 0;
+	XactSnapshotTimestampStale = false;
+	XactCommitTimestamp = 0;
 #endif	
 #endif
 
@@ -3385,6 +3545,11 @@ AbortTransaction(void)
 	AtEOXact_Remote();
 	GTMxactStartTimestamp = 0;
 #endif
+#ifdef XCP
+	XactSnapshotTimestamp = 0;
+	XactSnapshotTimestampStale = false;
+	XactCommitTimestamp = 0;
+#endif
 
 }
 
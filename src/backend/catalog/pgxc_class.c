@@ -18,7 +18,9 @@
 #include "catalog/namespace.h"
 #include "catalog/pg_type.h"
 #include "catalog/pgxc_class.h"
+#include "catalog/pgxc_class_stats.h"
 #include "utils/builtins.h"
+#include "utils/catcache.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
 #include "pgxc/locator.h"
@@ -177,6 +179,9 @@ PgxcClassAlter(Oid pcrelid,
 	CatalogTupleUpdate(rel, &oldtup->t_self, newtup);
 
 	heap_close(rel, RowExclusiveLock);
+
+	/* Rows are moved around, what the nodes used to hold is no longer true */
+	RemovePgxcClassStats(pcrelid);
 }
 
 /*
@@ -205,4 +210,120 @@ RemovePgxcClass(Oid pcrelid)
 	ReleaseSysCache(tup);
 
 	heap_close(relation, RowExclusiveLock);
+
+	RemovePgxcClassStats(pcrelid);
+}
+
+/*
+ * PgxcClassStatsStore
+ *		Create or replace the pgxc_class_stats entry of a table on a node
+ */
+void
+PgxcClassStatsStore(Oid pcsrelid, Oid pcsnode,
+					float4 reltuples, int32 relpages,
+					Datum mcvvalues, Datum mcvfreqs)
+{
+	Relation	rel;
+	HeapTuple	oldtup;
+	HeapTuple	htup;
+	Datum		values[Natts_pgxc_class_stats];
+	bool		nulls[Natts_pgxc_class_stats];
+
+	MemSet(nulls, false, sizeof(nulls));
+	values[Anum_pgxc_class_stats_pcsrelid - 1] = ObjectIdGetDatum(pcsrelid);
+	values[Anum_pgxc_class_stats_pcsnode - 1] = ObjectIdGetDatum(pcsnode);
+	values[Anum_pgxc_class_stats_pcsreltuples - 1] = Float4GetDatum(reltuples);
+	values[Anum_pgxc_class_stats_pcsrelpages - 1] = Int32GetDatum(relpages);
+	values[Anum_pgxc_class_stats_pcsmcvvalues - 1] = mcvvalues;
+	nulls[Anum_pgxc_class_stats_pcsmcvvalues - 1] = (mcvvalues == (Datum) 0);
+	values[Anum_pgxc_class_stats_pcsmcvfreqs - 1] = mcvfreqs;
+	nulls[Anum_pgxc_class_stats_pcsmcvfreqs - 1] = (mcvfreqs == (Datum) 0);
+
+	rel = heap_open(PgxcClassStatsRelationId, RowExclusiveLock);
+
+	oldtup = SearchSysCache2(PGXCCLASSSTATS,
+							 ObjectIdGetDatum(pcsrelid),
+							 ObjectIdGetDatum(pcsnode));
+	if (HeapTupleIsValid(oldtup))
+	{
+		bool		replaces[Natts_pgxc_class_stats];
+
+		MemSet(replaces, true, sizeof(replaces));
+		htup = heap_modify_tuple(oldtup, RelationGetDescr(rel),
+								 values, nulls, replaces);
+		ReleaseSysCache(oldtup);
+		CatalogTupleUpdate(rel, &htup->t_self, htup);
+	}
+	else
+	{
+		htup = heap_form_tuple(RelationGetDescr(rel), values, nulls);
+		CatalogTupleInsert(rel, htup);
+	}
+
+	heap_freetuple(htup);
+	heap_close(rel, RowExclusiveLock);
+}
+
+/*
+ * RemovePgxcClassStats
+ *		Remove the pgxc_class_stats entries of a table
+ */
+void
+RemovePgxcClassStats(Oid pcsrelid)
+{
+	Relation	rel;
+	CatCList   *catlist;
+	int			i;
+
+	rel = heap_open(PgxcClassStatsRelationId, RowExclusiveLock);
+
+	catlist = SearchSysCacheList1(PGXCCLASSSTATS,
+								  ObjectIdGetDatum(pcsrelid));
+	for (i = 0; i < catlist->n_members; i++)
+	{
+		HeapTuple	tup = &catlist->members[i]->tuple;
+
+		CatalogTupleDelete(rel, &tup->t_self);
+	}
+	ReleaseSysCacheList(catlist);
+
+	heap_close(rel, RowExclusiveLock);
+}
+
+/*
+ * GetPgxcClassSkew
+ *		How many times its share of rows the busiest node of a table holds
+ *
+ * Returns 1 if the table is evenly spread, or if it has not been analyzed.
+ * Entries of nodes dropped since the last ANALYZE are not counted.
+ */
+double
+GetPgxcClassSkew(Oid pcsrelid)
+{
+	CatCList   *catlist;
+	double		total = 0;
+	double		max = 0;
+	double		skew = 1.0;
+	int			numnodes = 0;
+	int			i;
+
+	catlist = SearchSysCacheList1(PGXCCLASSSTATS,
+								  ObjectIdGetDatum(pcsrelid));
+	for (i = 0; i < catlist->n_members; i++)
+	{
+		Form_pgxc_class_stats stats;
+
+		stats = (Form_pgxc_class_stats) GETSTRUCT(&catlist->members[i]->tuple);
+		if (!SearchSysCacheExists1(PGXCNODEOID,
+								   ObjectIdGetDatum(stats->pcsnode)))
+			continue;
+		numnodes++;
+		total += stats->pcsreltuples;
+		max = Max(max, stats->pcsreltuples);
+	}
+	if (total > 0)
+		skew = Max(max * numnodes / total, 1.0);
+	ReleaseSysCacheList(catlist);
+
+	return skew;
 }
@@ -253,6 +253,27 @@ CREATE VIEW pg_stats WITH (security_barrier) AS
 
 REVOKE ALL on pg_statistic FROM public;
 
+CREATE VIEW pgxc_stat_distribution AS
+    SELECT
+            N.nspname AS schemaname,
+            C.relname AS tablename,
+            X.node_name,
+            S.pcsreltuples AS n_tuples,
+            S.pcsrelpages::bigint * current_setting('block_size')::bigint AS size,
+            S.pcsreltuples::float8 / nullif(sum(S.pcsreltuples)
+                OVER (PARTITION BY S.pcsrelid), 0) AS share,
+            S.pcsreltuples / nullif(avg(S.pcsreltuples)
+                OVER (PARTITION BY S.pcsrelid), 0) AS skew,
+            S.pcsmcvvalues AS most_common_vals,
+            S.pcsmcvfreqs AS most_common_freqs
+    FROM pgxc_class_stats S JOIN pg_class C ON (C.oid = S.pcsrelid)
+         JOIN pgxc_node X ON (X.oid = S.pcsnode)
+         LEFT JOIN pg_namespace N ON (N.oid = C.relnamespace)
+    WHERE NOT pg_is_other_temp_schema(N.oid) AND
+          has_table_privilege(C.oid, 'select');
+
+REVOKE ALL on pgxc_class_stats FROM public;
+
 CREATE VIEW pg_publication_tables AS
     SELECT
         P.pubname AS pubname,
@@ -899,6 +920,72 @@ CREATE VIEW pg_stat_progress_vacuum AS
     FROM pg_stat_get_progress_info('VACUUM') AS S
 		LEFT JOIN pg_database D ON S.datid = D.oid;
 
+CREATE VIEW pgxc_stat_remote_query_waits AS
+    SELECT
+            S.dbid AS datid,
+            D.datname,
+            S.queryid,
+            S.query,
+            S.calls,
+            S.gtm_time,
+            S.receive_time,
+            S.squeue_read_time,
+            S.squeue_write_time,
+            S.prepare_time,
+            S.commit_time,
+            S.pooler_time
+    FROM pgxc_stat_get_remote_query_waits() S
+            LEFT JOIN pg_database D ON (S.dbid = D.oid);
+
+CREATE VIEW pgxc_stat_remote_node_waits AS
+    SELECT
+            S.node_name,
+            S.wait_class,
+            S.waits,
+            S.wait_time
+    FROM pgxc_stat_get_remote_node_waits() S;
+
+CREATE VIEW pgxc_stat_cluster_query_waits AS
+    SELECT
+            S.node_name,
+            S.dbid AS datid,
+            D.datname,
+            S.queryid,
+            S.query,
+            S.calls,
+            S.gtm_time,
+            S.receive_time,
+            S.squeue_read_time,
+            S.squeue_write_time,
+            S.prepare_time,
+            S.commit_time,
+            S.pooler_time
+    FROM pgxc_stat_get_cluster_query_waits() S
+            LEFT JOIN pg_database D ON (S.dbid = D.oid);
+
+CREATE VIEW pgxc_stat_cluster_node_waits AS
+    SELECT
+            S.waiting_node,
+            S.node_name,
+            S.wait_class,
+            S.waits,
+            S.wait_time
+    FROM pgxc_stat_get_cluster_node_waits() S;
+
+CREATE VIEW pgxc_stat_pool_nodes AS
+    SELECT
+            S.node_name,
+            S.node_type,
+            S.healthy,
+            S.unhealthy_since,
+            S.connect_failures,
+            S.connect_timeouts,
+            S.fast_failures,
+            S.probes,
+            S.failed_probes,
+            S.wait_time
+    FROM pgxc_stat_get_pool_nodes() S;
+
 CREATE VIEW pg_user_mappings AS
     SELECT
         U.oid       AS umid,
@@ -1137,6 +1224,7 @@ REVOKE EXECUTE ON FUNCTION pg_stat_reset() FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_shared(text) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_table_counters(oid) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_function_counters(oid) FROM public;
+REVOKE EXECUTE ON FUNCTION pgxc_stat_reset_remote_waits() FROM public;
 
 REVOKE EXECUTE ON FUNCTION pg_ls_logdir() FROM public;
 REVOKE EXECUTE ON FUNCTION pg_ls_waldir() FROM public;
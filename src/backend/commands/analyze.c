@@ -66,6 +66,7 @@
 
 #ifdef XCP
 #include "catalog/pg_operator.h"
+#include "catalog/pgxc_class_stats.h"
 #include "nodes/makefuncs.h"
 #include "pgxc/execRemote.h"
 #include "pgxc/pgxc.h"
@@ -86,6 +87,11 @@ typedef struct AnlIndexData
 /* Default statistics target (GUC parameter) */
 int			default_statistics_target = 100;
 
+#ifdef XCP
+/* Share of rows of a Datanode making ANALYZE warn about skew (GUC parameter) */
+double		distribution_skew_threshold = 2.0;
+#endif
+
 /* A few variables that don't seem worth passing around as parameters */
 static MemoryContext anl_context = NULL;
 static BufferAccessStrategy vac_strategy;
@@ -114,6 +120,7 @@ static Datum std_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
 static Datum ind_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
 
 #ifdef XCP
+static void coord_collect_node_stats(Relation onerel);
 static void analyze_rel_coordinator(Relation onerel, bool inh, int attr_cnt,
 						VacAttrStats **vacattrstats, int nindexes,
 						Relation *indexes, AnlIndexData *indexdata);
@@ -3577,15 +3584,174 @@ coord_collect_extended_stats(Relation onerel, int attr_cnt)
 	ExecEndRemoteQuery(node);
 }
 
+/*
+ * coord_collect_node_stats
+ *		Collect per-node statistics of a distributed table (pgxc_class_stats).
+ *
+ * Records the number of rows and pages each Datanode holds, and the most
+ * common values of the distribution column there, and warns if a node
+ * holds much more than its share of the rows.
+ */
+static void
+coord_collect_node_stats(Relation onerel)
+{
+	RelationLocInfo *locinfo = onerel->rd_locator_info;
+	Oid			relid = RelationGetRelid(onerel);
+	StringInfoData query;
+	EState	   *estate;
+	MemoryContext oldcontext;
+	RemoteQuery *step;
+	RemoteQueryState *node;
+	TupleTableSlot *result;
+	Oid			coltypes[] = {TEXTOID, INT4OID, FLOAT4OID, TEXTARRAYOID,
+							  FLOAT4ARRAYOID};
+	int			i;
+	int			numnodes = 0;
+	double		total = 0;
+	double		maxtuples = -1;
+	char	   *maxnode = NULL;
+	char	   *maxvalue = NULL;
+	float4		maxfreq = 0;
+
+	initStringInfo(&query);
+	appendStringInfoString(&query,
+						   "SELECT pg_catalog.pgxc_node_str()::text, "
+						   "c.relpages, c.reltuples, (CASE");
+	/* The most common values are in the slot of kind 1, if any */
+	for (i = 1; i <= STATISTIC_NUM_SLOTS; i++)
+		appendStringInfo(&query, " WHEN s.stakind%d = %d THEN s.stavalues%d::text",
+						 i, STATISTIC_KIND_MCV, i);
+	appendStringInfo(&query, " END::text[])[1:%d], (CASE",
+					 PGXC_CLASS_STATS_MCV_COUNT);
+	for (i = 1; i <= STATISTIC_NUM_SLOTS; i++)
+		appendStringInfo(&query, " WHEN s.stakind%d = %d THEN s.stanumbers%d",
+						 i, STATISTIC_KIND_MCV, i);
+	appendStringInfo(&query, " END)[1:%d] "
+					 "FROM pg_class c "
+					 "LEFT JOIN pg_attribute a "
+					 "    ON a.attrelid = c.oid AND a.attname = %s "
+					 "LEFT JOIN pg_statistic s "
+					 "    ON s.starelid = c.oid AND s.staattnum = a.attnum "
+					 "    AND NOT s.stainherit ",
+					 PGXC_CLASS_STATS_MCV_COUNT,
+					 locinfo->partAttrName ?
+						quote_literal_cstr(locinfo->partAttrName) : "NULL");
+
+	/* Temporary tables may be in different namespaces on the nodes */
+	if (onerel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+		appendStringInfo(&query, "WHERE c.relnamespace = pg_my_temp_schema() "
+						 "AND c.relname = %s",
+						 quote_literal_cstr(RelationGetRelationName(onerel)));
+	else
+		appendStringInfo(&query, "WHERE c.relnamespace = "
+						 "(SELECT oid FROM pg_namespace WHERE nspname = %s) "
+						 "AND c.relname = %s",
+						 quote_literal_cstr(get_namespace_name(RelationGetNamespace(onerel))),
+						 quote_literal_cstr(RelationGetRelationName(onerel)));
+
+	step = makeNode(RemoteQuery);
+	step->combine_type = COMBINE_TYPE_NONE;
+	step->exec_nodes = NULL;
+	step->sql_statement = query.data;
+	step->exec_type = EXEC_ON_DATANODES;
+	for (i = 0; i < lengthof(coltypes); i++)
+		step->scan.plan.targetlist = lappend(step->scan.plan.targetlist,
+											 makeTargetEntry((Expr *) makeVar(1, i + 1, coltypes[i], -1, InvalidOid, 0),
+															 i + 1, NULL, false));
+
+	/* The entries of nodes the table is no longer on go away */
+	RemovePgxcClassStats(relid);
+	CommandCounterIncrement();
+
+	estate = CreateExecutorState();
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+	/* See the effects of ANALYZE on the datanodes */
+	PushActiveSnapshot(GetTransactionSnapshot());
+	estate->es_snapshot = GetActiveSnapshot();
+	node = ExecInitRemoteQuery(step, estate, 0);
+	MemoryContextSwitchTo(oldcontext);
+
+	while ((result = ExecRemoteQuery((PlanState *) node)) != NULL &&
+		   !TupIsNull(result))
+	{
+		char	   *nodename;
+		Oid			nodeoid;
+		int32		relpages;
+		float4		reltuples;
+
+		slot_getallattrs(result);
+		if (result->tts_isnull[0] || result->tts_isnull[1] ||
+			result->tts_isnull[2])
+			continue;
+
+		nodename = TextDatumGetCString(result->tts_values[0]);
+		nodeoid = get_pgxc_nodeoid(nodename);
+		if (!OidIsValid(nodeoid))
+			continue;
+		relpages = DatumGetInt32(result->tts_values[1]);
+		reltuples = DatumGetFloat4(result->tts_values[2]);
+
+		PgxcClassStatsStore(relid, nodeoid, reltuples, relpages,
+							result->tts_isnull[3] ? (Datum) 0 : result->tts_values[3],
+							result->tts_isnull[4] ? (Datum) 0 : result->tts_values[4]);
+
+		numnodes++;
+		total += reltuples;
+		if (reltuples > maxtuples)
+		{
+			maxtuples = reltuples;
+			maxnode = nodename;
+			maxvalue = NULL;
+			maxfreq = 0;
+			/* The most common value of the node, to point at the culprit */
+			if (!result->tts_isnull[3] && !result->tts_isnull[4])
+			{
+				ArrayType  *values = DatumGetArrayTypeP(result->tts_values[3]);
+				ArrayType  *freqs = DatumGetArrayTypeP(result->tts_values[4]);
+				Datum	   *elems;
+				int			nelems;
+
+				deconstruct_array(values, TEXTOID, -1, false, 'i',
+								  &elems, NULL, &nelems);
+				if (nelems > 0 && ArrayGetNItems(ARR_NDIM(freqs), ARR_DIMS(freqs)) > 0)
+				{
+					maxvalue = TextDatumGetCString(elems[0]);
+					maxfreq = ((float4 *) ARR_DATA_PTR(freqs))[0];
+				}
+			}
+		}
+	}
+	PopActiveSnapshot();
+	ExecEndRemoteQuery(node);
+
+	/* Is there a node with too much? */
+	if (distribution_skew_threshold > 0 && numnodes > 1 && total > 0 &&
+		maxtuples > distribution_skew_threshold * total / numnodes)
+	{
+		double		valueshare = maxfreq * maxtuples / total;
+
+		ereport(WARNING,
+				(errmsg("table \"%s\" is unevenly distributed",
+						RelationGetRelationName(onerel)),
+				 errdetail("Datanode \"%s\" holds %.0f%% of the rows, %.1f times its share.",
+						   maxnode, 100.0 * maxtuples / total,
+						   maxtuples * numnodes / total),
+				 (maxvalue && valueshare > 1.0 / numnodes) ?
+				 errhint("Value %s of the distribution column alone accounts for %.0f%% of the rows.",
+						 maxvalue, 100.0 * valueshare) : 0));
+	}
+}
+
 /*
  * analyze_rel_coordinator
  *		Collect all statistics for a particular relation.
  *
- * We collect three types of statistics for each table:
+ * We collect four types of statistics for each table:
  *
  * - simple statistics (pg_statistic)
  * - extended statistics (pg_statistic_ext)
  * - index statistics (including expression indexes)
+ * - per-node statistics of distributed tables (pgxc_class_stats)
  */
 static void
 analyze_rel_coordinator(Relation onerel, bool inh, int attr_cnt,
@@ -3605,5 +3771,9 @@ analyze_rel_coordinator(Relation onerel, bool inh, int attr_cnt,
 
 	/* extended statistics (pg_statistic) for the relation */
 	coord_collect_extended_stats(onerel, attr_cnt);
+
+	/* how the rows are spread over the nodes */
+	if (!inh && !IsRelationReplicated(onerel->rd_locator_info))
+		coord_collect_node_stats(onerel);
 }
 #endif
@@ -25,6 +25,7 @@
 #include "nodes/extensible.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
+#include "optimizer/cost.h"
 #include "optimizer/planmain.h"
 #include "parser/parsetree.h"
 #include "rewrite/rewriteHandler.h"
@@ -89,6 +90,9 @@ static void show_sort_keys(SortState *sortstate, List *ancestors,
 			   ExplainState *es);
 static void show_simple_sort_keys(RemoteSubplanState *remotestate,
 			   List *ancestors, ExplainState *es);
+static void show_network_transfer(RemoteSubplan *plan, ExplainState *es);
+static void show_remote_instrumentation(PlanState *planstate,
+							ExplainState *es);
 static void show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 					   ExplainState *es);
 static void show_agg_keys(AggState *astate, List *ancestors,
@@ -859,6 +863,13 @@ ExplainPreScanNode(PlanState *planstate, Bitmapset **rels_used)
 				*rels_used = bms_add_member(*rels_used,
 											((ModifyTable *) plan)->exclRelRTI);
 			break;
+#ifdef XCP
+		case T_RemoteSubplan:
+			if (((RemoteSubplanState *) planstate)->remote_planstate)
+				ExplainPreScanNode(((RemoteSubplanState *) planstate)->remote_planstate,
+								   rels_used);
+			break;
+#endif
 		default:
 			break;
 	}
@@ -1554,6 +1565,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 				if (es->verbose)
 					show_simple_sort_keys((RemoteSubplanState *)planstate,
 										  ancestors, es);
+
+				/* add estimated network transfer, as costed by the planner */
+				if (es->verbose && es->costs)
+					show_network_transfer(rsubplan, es);
 			}
 			break;
 #endif
@@ -1771,6 +1786,15 @@ ExplainNode(PlanState *planstate, List *ancestors,
 								  es);
 			break;
 		case T_Hash:
+#ifdef XCP
+			/* The filter size follows the row estimate, so it is a cost */
+			if (((Hash *) plan)->runtimeFilterKey >= 0)
+				ExplainPropertyText("Runtime Filter",
+									es->costs ?
+									psprintf("%d bytes",
+											 ((Hash *) plan)->runtimeFilterSize) :
+									"on", es);
+#endif
 			show_hash_info(castNode(HashState, planstate), es);
 			break;
 		default:
@@ -1848,6 +1872,12 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			ExplainCloseGroup("Workers", "Workers", false, es);
 	}
 
+#ifdef XCP
+	/* Show detail of the remote nodes */
+	if (es->analyze && es->verbose && planstate->remote_instrument)
+		show_remote_instrumentation(planstate, es);
+#endif
+
 	/* Get ready to display the child plans */
 	haschildren = planstate->initPlan ||
 		outerPlanState(planstate) ||
@@ -1861,6 +1891,11 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		(IsA(planstate, CustomScanState) &&
 		 ((CustomScanState *) planstate)->custom_ps != NIL) ||
 		planstate->subPlan;
+#ifdef XCP
+	if (IsA(planstate, RemoteSubplanState) &&
+		((RemoteSubplanState *) planstate)->remote_planstate)
+		haschildren = true;
+#endif
 	if (haschildren)
 	{
 		ExplainOpenGroup("Plans", "Plans", false, es);
@@ -1918,6 +1953,14 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			ExplainCustomChildren((CustomScanState *) planstate,
 								  ancestors, es);
 			break;
+#ifdef XCP
+		case T_RemoteSubplan:
+			/* local copy of the subplan executed on the remote nodes */
+			if (((RemoteSubplanState *) planstate)->remote_planstate)
+				ExplainNode(((RemoteSubplanState *) planstate)->remote_planstate,
+							ancestors, "Outer", NULL, es);
+			break;
+#endif
 		default:
 			break;
 	}
@@ -2114,6 +2157,151 @@ show_simple_sort_keys(RemoteSubplanState *planstate, List *ancestors, ExplainSta
 						 ancestors, es);
 }
 
+/*
+ * Show the amount of data a RemoteSubplan node is expected to send over the
+ * network, as estimated by the planner. Replicated results are sent to every
+ * target node, so the volume is multiplied by the number of the nodes. The
+ * cost is the one the planner charged, including the skew of the input.
+ */
+static void
+show_network_transfer(RemoteSubplan *plan, ExplainState *es)
+{
+	int			fanout = 1;
+	double		messages;
+	double		bytes;
+	Cost		cost;
+
+	if (plan->distributionType == LOCATOR_TYPE_REPLICATED &&
+			list_length(plan->distributionNodes) > 0)
+		fanout = list_length(plan->distributionNodes);
+
+	messages = plan->scan.plan.plan_rows * fanout;
+	bytes = messages * plan->scan.plan.plan_width;
+	cost = cost_network_transfer(plan->scan.plan.plan_rows,
+								 plan->scan.plan.plan_width, fanout,
+								 plan->distributionSkew);
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Network Transfer: messages=%.0f bytes=%.0f cost=%.2f\n",
+						 messages, bytes, cost);
+	}
+	else
+	{
+		ExplainPropertyFloat("Network Messages", messages, 0, es);
+		ExplainPropertyFloat("Network Bytes", bytes, 0, es);
+		ExplainPropertyFloat("Network Cost", cost, 2, es);
+	}
+}
+
+/*
+ * Show the instrumentation reported by the remote nodes which have executed
+ * the plan node, and the rows the producers of a RemoteSubplan have sent to
+ * each of the consumers.
+ */
+static void
+show_remote_instrumentation(PlanState *planstate, ExplainState *es)
+{
+	bool		opened_group = false;
+	ListCell   *lc;
+
+	foreach(lc, planstate->remote_instrument)
+	{
+		RemoteInstrumentation *ri = (RemoteInstrumentation *) lfirst(lc);
+		Instrumentation *instrument = &ri->instrument;
+		double		nloops = instrument->nloops;
+		double		startup_sec;
+		double		total_sec;
+		double		rows;
+
+		if (NameStr(ri->consumer)[0] != '\0' || nloops <= 0)
+			continue;
+		startup_sec = 1000.0 * instrument->startup / nloops;
+		total_sec = 1000.0 * instrument->total / nloops;
+		rows = instrument->ntuples / nloops;
+
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "Node %s: ", NameStr(ri->nodename));
+			if (es->timing)
+				appendStringInfo(es->str,
+								 "actual time=%.3f..%.3f rows=%.0f loops=%.0f\n",
+								 startup_sec, total_sec, rows, nloops);
+			else
+				appendStringInfo(es->str,
+								 "actual rows=%.0f loops=%.0f\n",
+								 rows, nloops);
+			es->indent++;
+			if (es->buffers)
+				show_buffer_usage(es, &instrument->bufusage);
+			es->indent--;
+		}
+		else
+		{
+			if (!opened_group)
+			{
+				ExplainOpenGroup("Remote Nodes", "Remote Nodes", false, es);
+				opened_group = true;
+			}
+			ExplainOpenGroup("Remote Node", NULL, true, es);
+			ExplainPropertyText("Node Name", NameStr(ri->nodename), es);
+
+			if (es->timing)
+			{
+				ExplainPropertyFloat("Actual Startup Time", startup_sec, 3, es);
+				ExplainPropertyFloat("Actual Total Time", total_sec, 3, es);
+			}
+			ExplainPropertyFloat("Actual Rows", rows, 0, es);
+			ExplainPropertyFloat("Actual Loops", nloops, 0, es);
+
+			if (es->buffers)
+				show_buffer_usage(es, &instrument->bufusage);
+
+			ExplainCloseGroup("Remote Node", NULL, true, es);
+		}
+	}
+
+	if (opened_group)
+		ExplainCloseGroup("Remote Nodes", "Remote Nodes", false, es);
+	opened_group = false;
+
+	/* Rows sent by the producers, the consumer is set for these entries */
+	foreach(lc, planstate->remote_instrument)
+	{
+		RemoteInstrumentation *ri = (RemoteInstrumentation *) lfirst(lc);
+
+		if (NameStr(ri->consumer)[0] == '\0')
+			continue;
+
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "Sent from %s to %s: rows=%.0f\n",
+							 NameStr(ri->nodename), NameStr(ri->consumer),
+							 ri->instrument.ntuples);
+		}
+		else
+		{
+			if (!opened_group)
+			{
+				ExplainOpenGroup("Rows Sent", "Rows Sent", false, es);
+				opened_group = true;
+			}
+			ExplainOpenGroup("Transfer", NULL, true, es);
+			ExplainPropertyText("Producer", NameStr(ri->nodename), es);
+			ExplainPropertyText("Consumer", NameStr(ri->consumer), es);
+			ExplainPropertyFloat("Rows", ri->instrument.ntuples, 0, es);
+			ExplainCloseGroup("Transfer", NULL, true, es);
+		}
+	}
+
+	if (opened_group)
+		ExplainCloseGroup("Rows Sent", "Rows Sent", false, es);
+}
+
 /*
  * Likewise, for a MergeAppend node.
  */
@@ -1048,6 +1048,28 @@ HaveActiveDatanodeStatements(void)
 }
 
 
+/*
+ * Mark all Datanode statements as not active on any node, once they have
+ * been deallocated on the nodes so that the connections can be released.
+ * They are prepared again on the nodes they are next executed on.
+ */
+void
+ForgetDatanodeStatements(void)
+{
+	HASH_SEQ_STATUS seq;
+	DatanodeStatement *entry;
+
+	/* nothing cached */
+	if (!datanode_queries)
+		return;
+
+	/* walk over cache */
+	hash_seq_init(&seq, datanode_queries);
+	while ((entry = hash_seq_search(&seq)) != NULL)
+		entry->number_of_nodes = 0;
+}
+
+
 /*
  * Mark Datanode statement as active on specified node
  * Return true if statement has already been active on the node and can be used
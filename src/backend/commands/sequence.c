@@ -40,7 +40,9 @@
 #include "parser/parse_type.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -75,6 +77,7 @@
 #ifdef XCP
 
 int			SequenceRangeVal = 1;
+int			SharedSequenceCacheSize = 0;
 #endif
 
 typedef struct sequence_magic
@@ -102,6 +105,8 @@ typedef struct SeqTableData
 #ifdef XCP
 	TimestampTz last_call_time; /* the time when the last call as made */
 	int64		range_multiplier; /* multiply this value with 2 next time */
+	bool		last_shared;	/* "last" not known to GTM, answer currval
+								 * from it */
 #endif
 } SeqTableData;
 
@@ -109,6 +114,40 @@ typedef SeqTableData *SeqTable;
 
 static HTAB *seqhashtab = NULL; /* hash table for SeqTable items */
 
+#ifdef XCP
+/*
+ * Coordinator-wide cache of sequence values.
+ *
+ * When GTM grants a range of values to a session the values the session does
+ * not need right away are left here, and every session on the Coordinator
+ * draws from the shared range before it asks GTM for more.  Together with
+ * the adaptive ranges granted by GTM this makes the number of GTM round trips
+ * depend on the rate the whole Coordinator consumes the sequence at rather
+ * than on the number of sessions.  The hash table is protected by
+ * SequenceCacheLock, the range of an entry by its spinlock.  The table has a
+ * fixed size; when it is full, entries with no values left are removed, or
+ * the entry stored longest ago if all of them still have values.
+ */
+typedef struct SeqSharedCacheKey
+{
+	Oid			dbid;
+	Oid			relid;
+} SeqSharedCacheKey;
+
+typedef struct SeqSharedCacheEnt
+{
+	SeqSharedCacheKey key;		/* hash key, must be first */
+	slock_t		mutex;
+	bool		valid;			/* are there values left in the range? */
+	int64		next;			/* next value to hand out */
+	int64		last;			/* last value of the range */
+	int64		increment;		/* sequence's increment */
+	TimestampTz stored;			/* when the range was stored */
+} SeqSharedCacheEnt;
+
+static HTAB *SeqSharedCache = NULL;
+#endif
+
 #ifdef PGXC
 /*
  * Arguments for callback of sequence drop on GTM
@@ -151,6 +190,14 @@ static void init_params(ParseState *pstate, List *options, bool for_identity,
 			bool *is_restart);
 static void do_setval(Oid relid, int64 next, bool iscalled);
 static void process_owned_by(Relation seqrel, List *owned_by, bool for_identity);
+#ifdef XCP
+static bool seq_shared_cache_usable(Relation seqrel);
+static bool seq_shared_cache_get(Oid relid, int64 *result, int64 *increment);
+static bool seq_shared_cache_put(Oid relid, int64 next, int64 last,
+					 int64 increment);
+static void seq_shared_cache_forget(Oid relid);
+static void seq_shared_cache_evict(void);
+#endif
 
 
 /*
@@ -411,6 +458,9 @@ ResetSequence(Oid seq_relid)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+#ifdef XCP
+	seq_shared_cache_forget(seq_relid);
+#endif
 
 	relation_close(seq_rel, NoLock);
 }
@@ -567,6 +617,9 @@ AlterSequence(ParseState *pstate, AlterSeqStmt *stmt)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+#ifdef XCP
+	seq_shared_cache_forget(relid);
+#endif
 
 	/* Now okay to update the on-disk tuple */
 #ifdef PGXC
@@ -657,6 +710,10 @@ DeleteSequenceTuple(Oid relid)
 
 	ReleaseSysCache(tuple);
 	heap_close(rel, RowExclusiveLock);
+
+#ifdef XCP
+	seq_shared_cache_forget(relid);
+#endif
 }
 
 /*
@@ -750,6 +807,21 @@ nextval_internal(Oid relid, bool check_permissions)
 		return elm->last;
 	}
 
+#ifdef XCP
+	/* Try values other sessions on this Coordinator left over */
+	if (seq_shared_cache_usable(seqrel) &&
+		seq_shared_cache_get(relid, &result, &incby))
+	{
+		elm->last = elm->cached = result;
+		elm->increment = incby;
+		elm->last_valid = true;
+		elm->last_shared = true;
+		relation_close(seqrel, NoLock);
+		last_used_seq = elm;
+		return result;
+	}
+#endif
+
 	pgstuple = SearchSysCache1(SEQRELID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(pgstuple))
 		elog(ERROR, "cache lookup failed for sequence %u", relid);
@@ -842,6 +914,17 @@ nextval_internal(Oid relid, bool check_permissions)
 		elm->cached = rangemax;		/* last fetched range max limit */
 		elm->last_valid = true;
 
+		/*
+		 * GTM remembers the end of the range as the last value of the
+		 * session, so once ranges are shared currval() has to be answered
+		 * locally.  Leave the rest of the range to all sessions of the
+		 * Coordinator if there is room for it.
+		 */
+		elm->last_shared = seq_shared_cache_usable(seqrel);
+		if (elm->last_shared && rangemax != result &&
+			seq_shared_cache_put(relid, result + incby, rangemax, incby))
+			elm->cached = result;
+
 		last_used_seq = elm;
 	}
 
@@ -1037,6 +1120,9 @@ currval_oid(PG_FUNCTION_ARGS)
 				 errmsg("currval of sequence \"%s\" is not yet defined in this session",
 						RelationGetRelationName(seqrel))));
 #ifdef XCP
+	if (elm->last_shared)
+		result = elm->last;
+	else
 	{
 		/*
  		 * Always contact GTM for currval
@@ -1183,6 +1269,9 @@ do_setval(Oid relid, int64 next, bool iscalled)
 	}
 	/* In any case, forget any future cached numbers */
 	elm->cached = elm->last;
+#ifdef XCP
+	seq_shared_cache_forget(relid);
+#endif
 
 	/* check the comment above nextval_internal()'s equivalent call. */
 	if (RelationNeedsWAL(seqrel))
@@ -1347,6 +1436,7 @@ init_sequence(Oid relid, SeqTable *p_elm, Relation *p_rel)
 #ifdef XCP
 		elm->last_call_time = 0;
 		elm->range_multiplier = DEFAULT_CACHEVAL;
+		elm->last_shared = false;
 #endif
 		elm->last = elm->cached = 0;
 	}
@@ -2255,6 +2345,202 @@ ResetSequenceCaches(void)
 	last_used_seq = NULL;
 }
 
+#ifdef XCP
+/*
+ * Report shared memory space needed by SequenceShmemInit
+ */
+Size
+SequenceShmemSize(void)
+{
+	if (SharedSequenceCacheSize <= 0)
+		return 0;
+
+	return hash_estimate_size(SharedSequenceCacheSize,
+							  sizeof(SeqSharedCacheEnt));
+}
+
+/*
+ * Allocate and initialize the Coordinator-wide sequence cache
+ */
+void
+SequenceShmemInit(void)
+{
+	HASHCTL		info;
+
+	if (SharedSequenceCacheSize <= 0)
+		return;
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(SeqSharedCacheKey);
+	info.entrysize = sizeof(SeqSharedCacheEnt);
+
+	SeqSharedCache = ShmemInitHash("Shared Sequence Cache",
+								   SharedSequenceCacheSize,
+								   SharedSequenceCacheSize,
+								   &info,
+								   HASH_ELEM | HASH_BLOBS | HASH_FIXED_SIZE);
+}
+
+/*
+ * Can values of the sequence be shared with other sessions?  Temporary
+ * sequences are private to the session and do not go through GTM.
+ */
+static bool
+seq_shared_cache_usable(Relation seqrel)
+{
+	return SeqSharedCache != NULL && IS_PGXC_LOCAL_COORDINATOR &&
+		seqrel->rd_backend != MyBackendId;
+}
+
+/*
+ * Take the next value of the sequence from the shared cache.  Returns false
+ * if there is no value left and GTM has to be asked.
+ */
+static bool
+seq_shared_cache_get(Oid relid, int64 *result, int64 *increment)
+{
+	SeqSharedCacheKey key;
+	SeqSharedCacheEnt *entry;
+	bool		found = false;
+
+	key.dbid = MyDatabaseId;
+	key.relid = relid;
+
+	LWLockAcquire(SequenceCacheLock, LW_SHARED);
+	entry = (SeqSharedCacheEnt *) hash_search(SeqSharedCache, &key,
+											  HASH_FIND, NULL);
+	if (entry)
+	{
+		SpinLockAcquire(&entry->mutex);
+		if (entry->valid)
+		{
+			*result = entry->next;
+			*increment = entry->increment;
+			/* The range holds whole increments up to the last value */
+			if (entry->next == entry->last)
+				entry->valid = false;
+			else
+				entry->next += entry->increment;
+			found = true;
+		}
+		SpinLockRelease(&entry->mutex);
+	}
+	LWLockRelease(SequenceCacheLock);
+
+	return found;
+}
+
+/*
+ * Leave values from next to last of the sequence to other sessions.  Returns
+ * false if the values could not be stored, either because another session
+ * has already left a range which is not used up yet or because the cache is
+ * full; the caller keeps the values for itself then.
+ */
+static bool
+seq_shared_cache_put(Oid relid, int64 next, int64 last, int64 increment)
+{
+	SeqSharedCacheKey key;
+	SeqSharedCacheEnt *entry;
+	bool		found;
+	bool		stored = false;
+	TimestampTz now;
+
+	key.dbid = MyDatabaseId;
+	key.relid = relid;
+
+	/* No system call while holding the locks */
+	now = GetCurrentTimestamp();
+
+	LWLockAcquire(SequenceCacheLock, LW_EXCLUSIVE);
+	entry = (SeqSharedCacheEnt *) hash_search(SeqSharedCache, &key,
+											  HASH_ENTER_NULL, &found);
+	if (entry == NULL)
+	{
+		seq_shared_cache_evict();
+		entry = (SeqSharedCacheEnt *) hash_search(SeqSharedCache, &key,
+												  HASH_ENTER_NULL, &found);
+	}
+	if (entry)
+	{
+		if (!found)
+		{
+			SpinLockInit(&entry->mutex);
+			entry->valid = false;
+		}
+
+		SpinLockAcquire(&entry->mutex);
+		if (!entry->valid)
+		{
+			entry->next = next;
+			entry->last = last;
+			entry->increment = increment;
+			entry->stored = now;
+			entry->valid = true;
+			stored = true;
+		}
+		SpinLockRelease(&entry->mutex);
+	}
+	LWLockRelease(SequenceCacheLock);
+
+	return stored;
+}
+
+/*
+ * Discard values of the sequence left in the shared cache, the sequence was
+ * reset, altered or dropped.  Other Coordinators are not notified, their
+ * sessions may still use the values they have been granted before, like
+ * sessions using a CACHE clause.
+ */
+static void
+seq_shared_cache_forget(Oid relid)
+{
+	SeqSharedCacheKey key;
+
+	if (SeqSharedCache == NULL)
+		return;
+
+	key.dbid = MyDatabaseId;
+	key.relid = relid;
+
+	LWLockAcquire(SequenceCacheLock, LW_EXCLUSIVE);
+	hash_search(SeqSharedCache, &key, HASH_REMOVE, NULL);
+	LWLockRelease(SequenceCacheLock);
+}
+
+/*
+ * Make room in the full shared cache.  Entries whose range is used up, and
+ * entries of sequences dropped on another Coordinator or in another
+ * database, stay in the table until they are replaced.  Remove all entries
+ * with no values left; if every entry still has values, remove the one
+ * stored longest ago, its values are lost like those of a session exiting
+ * with a cached range.  The caller holds SequenceCacheLock exclusively, so
+ * no session is using an entry.
+ */
+static void
+seq_shared_cache_evict(void)
+{
+	HASH_SEQ_STATUS status;
+	SeqSharedCacheEnt *entry;
+	SeqSharedCacheEnt *oldest = NULL;
+	bool		removed = false;
+
+	hash_seq_init(&status, SeqSharedCache);
+	while ((entry = (SeqSharedCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (!entry->valid)
+		{
+			hash_search(SeqSharedCache, &entry->key, HASH_REMOVE, NULL);
+			removed = true;
+		}
+		else if (oldest == NULL || entry->stored < oldest->stored)
+			oldest = entry;
+	}
+
+	if (!removed && oldest != NULL)
+		hash_search(SeqSharedCache, &oldest->key, HASH_REMOVE, NULL);
+}
+#endif
+
 /*
  * Mask a Sequence page before performing consistency checks on it.
  */
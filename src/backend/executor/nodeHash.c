@@ -36,6 +36,12 @@
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
+#ifdef XCP
+#include "access/hash.h"
+#include "nodes/nodeFuncs.h"
+#include "pgxc/locator.h"
+#include "pgxc/squeue.h"
+#endif
 
 
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
@@ -79,6 +85,11 @@ MultiExecHash(HashState *node)
 	TupleTableSlot *slot;
 	ExprContext *econtext;
 	uint32		hashvalue;
+#ifdef XCP
+	ExprState  *filterkey = NULL;
+	Oid			filtertype = InvalidOid;
+	int			filtersize = 0;
+#endif
 
 	/* must provide our own instrumentation support */
 	if (node->ps.instrument)
@@ -96,6 +107,27 @@ MultiExecHash(HashState *node)
 	hashkeys = node->hashkeys;
 	econtext = node->ps.ps_ExprContext;
 
+#ifdef XCP
+	/*
+	 * If requested, collect the inner values of the filter key into a runtime
+	 * filter, the parent Hashjoin passes it on to the producers of the outer
+	 * side.  Values are hashed the same way as the producer hashes them.
+	 */
+	if (((Hash *) node->ps.plan)->runtimeFilterKey >= 0)
+	{
+		filterkey = (ExprState *) list_nth(hashkeys,
+								((Hash *) node->ps.plan)->runtimeFilterKey);
+		filtertype = exprType((Node *) filterkey->expr);
+		filtersize = ((Hash *) node->ps.plan)->runtimeFilterSize;
+		if (node->runtime_filter)
+			memset(node->runtime_filter, 0, filtersize);
+		else
+			node->runtime_filter = (uint32 *)
+				MemoryContextAllocZero(node->ps.state->es_query_cxt,
+									   filtersize);
+	}
+#endif
+
 	/*
 	 * get all inner tuples and insert into the hash table (or temp files)
 	 */
@@ -126,6 +158,26 @@ MultiExecHash(HashState *node)
 				ExecHashTableInsert(hashtable, slot, hashvalue);
 			}
 			hashtable->totalTuples += 1;
+#ifdef XCP
+			if (filterkey)
+			{
+				MemoryContext oldContext;
+				Datum		keyval;
+				bool		isNull;
+
+				oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+				keyval = ExecEvalExpr(filterkey, econtext, &isNull);
+				if (!isNull)
+				{
+					uint32		keyhash;
+
+					keyhash = DatumGetUInt32(compute_hash(filtertype, keyval,
+														  LOCATOR_TYPE_HASH));
+					SQueueFilterAdd(node->runtime_filter, filtersize, keyhash);
+				}
+				MemoryContextSwitchTo(oldContext);
+			}
+#endif
 		}
 	}
 
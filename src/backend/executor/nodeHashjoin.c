@@ -22,6 +22,9 @@
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
+#ifdef XCP
+#include "pgxc/execRemote.h"
+#endif
 
 
 /*
@@ -132,12 +135,19 @@ ExecHashJoin(PlanState *pstate)
 				 * The only way to make the check is to try to fetch a tuple
 				 * from the outer plan node.  If we succeed, we have to stash
 				 * it away for later consumption by ExecHashJoinOuterGetTuple.
+				 *
+				 * In XL, if the hash node builds a runtime filter for the
+				 * outer side, the outer side has to wait for the filter.
 				 */
 				if (HJ_FILL_INNER(node))
 				{
 					/* no chance to not build the hash table */
 					node->hj_FirstOuterTupleSlot = NULL;
 				}
+#ifdef XCP
+				else if (((Hash *) hashNode->ps.plan)->runtimeFilterKey >= 0)
+					node->hj_FirstOuterTupleSlot = NULL;
+#endif
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
 						  !node->hj_OuterNotEmpty))
@@ -168,6 +178,17 @@ ExecHashJoin(PlanState *pstate)
 				hashNode->hashtable = hashtable;
 				(void) MultiExecProcNode((PlanState *) hashNode);
 
+#ifdef XCP
+				/*
+				 * Hand the runtime filter over to the outer RemoteSubplan, it
+				 * is sent to the producers along with the Bind.
+				 */
+				if (hashNode->runtime_filter &&
+						IsA(outerNode, RemoteSubplanState))
+					ExecRemoteSubplanSetFilter((RemoteSubplanState *) outerNode,
+											   hashNode->runtime_filter);
+#endif
+
 				/*
 				 * If the inner relation is completely empty, and we're not
 				 * doing a left outer join, we can quit without scanning the
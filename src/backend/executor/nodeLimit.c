@@ -25,6 +25,9 @@
 #include "executor/nodeLimit.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#ifdef XCP
+#include "pgxc/execRemote.h"
+#endif
 
 static void recompute_limits(LimitState *node);
 static void pass_down_bound(LimitState *node, PlanState *child_node);
@@ -355,6 +358,23 @@ pass_down_bound(LimitState *node, PlanState *child_node)
 		if (outerPlanState(child_node))
 			pass_down_bound(node, outerPlanState(child_node));
 	}
+#ifdef XCP
+	else if (IsA(child_node, RemoteSubplanState))
+	{
+		/*
+		 * Let the RemoteSubplan limit the fetch size requested from the
+		 * nodes and stop fetching once we have got enough rows.
+		 */
+		ResponseCombiner *combiner = (ResponseCombiner *) child_node;
+		int64		tuples_needed = node->count + node->offset;
+
+		/* negative test checks for overflow in sum */
+		if (node->noCount || tuples_needed < 0)
+			combiner->tuples_needed = -1;
+		else
+			combiner->tuples_needed = tuples_needed;
+	}
+#endif
 }
 
 /* ----------------------------------------------------------------
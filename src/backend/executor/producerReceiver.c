@@ -16,6 +16,7 @@
 #include "postgres.h"
 #include "miscadmin.h"
 
+#include "access/hash.h"
 #include "executor/producerReceiver.h"
 #include "pgxc/nodemgr.h"
 #include "tcop/pquery.h"
@@ -35,13 +36,45 @@ typedef struct
 	MemoryContext tmpcxt;       /* holds temporary data */
 	Tuplestorestate **tstores;	/* storage to buffer data if destination queue
 								 * is full */
+	long *sentcounts;			/* number of tuples sent to each consumer */
 	TupleDesc typeinfo;			/* description of received tuples */
 	long tcount;
 	long selfcount;
 	long othercount;
+	long filteredcount;
 } ProducerState;
 
 
+/*
+ * Check the distribution key of the tuple against the runtime filter the
+ * consumer may have installed. Returns false if the consumer is known not to
+ * need the tuple. The key is hashed once per tuple, on demand.
+ */
+static bool
+producerFilterMatch(ProducerState *myState, int consumerIdx, Datum value,
+					uint32 *hashvalue, bool *hashed)
+{
+	const uint32 *filter;
+	int			size;
+
+	filter = SharedQueueGetFilter(myState->squeue, consumerIdx, &size);
+	if (filter == NULL)
+		return true;
+
+	if (!*hashed)
+	{
+		Oid		keytype;
+
+		keytype = myState->typeinfo->attrs[myState->distKey - 1]->atttypid;
+		*hashvalue = DatumGetUInt32(compute_hash(keytype, value,
+												 LOCATOR_TYPE_HASH));
+		*hashed = true;
+	}
+
+	return SQueueFilterMatch(filter, size, *hashvalue);
+}
+
+
 /*
  * Prepare to receive tuples from executor.
  */
@@ -80,6 +113,8 @@ producerReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 	Datum		value;
 	bool		isnull;
 	int 		ncount, i;
+	uint32		hashvalue = 0;
+	bool		hashed = false;
 
 	if (myState->distKey == InvalidAttrNumber)
 	{
@@ -100,7 +135,17 @@ producerReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 		{
 			continue;
 		}
-		else if (consumerIdx == SQ_CONS_SELF)
+
+		/* Do not send the tuple if the consumer does not need it */
+		if (myState->squeue && !isnull &&
+				!producerFilterMatch(myState, consumerIdx, value,
+									 &hashvalue, &hashed))
+		{
+			myState->filteredcount++;
+			continue;
+		}
+
+		if (consumerIdx == SQ_CONS_SELF)
 		{
 			Assert(myState->consumer);
 			(*myState->consumer->receiveSlot) (slot, myState->consumer);
@@ -121,6 +166,7 @@ producerReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 							 &myState->tstores[consumerIdx], myState->tmpcxt);
 			MemoryContextSwitchTo(savecontext);
 			myState->othercount++;
+			myState->sentcounts[consumerIdx]++;
 		}
 	}
 
@@ -149,8 +195,9 @@ producerDestroyReceiver(DestReceiver *self)
 {
 	ProducerState *myState = (ProducerState *) self;
 
-	elog(DEBUG2, "Producer stats: total %ld tuples, %ld tuples to self, %ld to other nodes",
-		 myState->tcount, myState->selfcount, myState->othercount);
+	elog(DEBUG2, "Producer stats: total %ld tuples, %ld tuples to self, %ld to other nodes, %ld filtered out",
+		 myState->tcount, myState->selfcount, myState->othercount,
+		 myState->filteredcount);
 
 	if (myState->consumer)
 		(*myState->consumer->rDestroy) (myState->consumer);
@@ -211,6 +258,7 @@ CreateProducerDestReceiver(void)
 	self->tcount = 0;
 	self->selfcount = 0;
 	self->othercount = 0;
+	self->filteredcount = 0;
 
 	return (DestReceiver *) self;
 }
@@ -236,8 +284,11 @@ SetProducerDestReceiverParams(DestReceiver *self,
 	/* Create workspace */
 	myState->distNodes = (int *) getLocatorResults(locator);
 	if (squeue)
+	{
 		myState->tstores = (Tuplestorestate **)
 			palloc0(NumDataNodes * sizeof(Tuplestorestate *));
+		myState->sentcounts = (long *) palloc0(NumDataNodes * sizeof(long));
+	}
 }
 
 
@@ -300,3 +351,41 @@ ProducerReceiverPushBuffers(DestReceiver *self)
 	}
 	return true;
 }
+
+
+/*
+ * Return the number of tuples sent so far to each consumer of the SharedQueue,
+ * including the producer itself. Consumers are identified by the node id of
+ * their parent. The arrays are allocated in the current memory context.
+ */
+int
+ProducerGetSentRows(DestReceiver *self, int **nodes, long **rows)
+{
+	ProducerState *myState = (ProducerState *) self;
+	int			count = 0;
+	int			i;
+
+	Assert(myState->pub.mydest == DestProducer);
+	if (myState->squeue == NULL)
+		return 0;
+
+	*nodes = (int *) palloc((NumDataNodes + 1) * sizeof(int));
+	*rows = (long *) palloc((NumDataNodes + 1) * sizeof(long));
+
+	if (myState->selfcount > 0)
+	{
+		(*nodes)[count] = SharedQueueGetConsumerNode(myState->squeue,
+													 SQ_CONS_SELF);
+		(*rows)[count++] = myState->selfcount;
+	}
+	for (i = 0; i < NumDataNodes; i++)
+	{
+		int			nodeid = SharedQueueGetConsumerNode(myState->squeue, i);
+
+		if (nodeid < 0)
+			continue;
+		(*nodes)[count] = nodeid;
+		(*rows)[count++] = myState->sentcounts[i];
+	}
+	return count;
+}
@@ -116,6 +116,7 @@ _copyPlannedStmt(const PlannedStmt *from)
 	COPY_SCALAR_FIELD(distributionKey);
 	COPY_NODE_FIELD(distributionNodes);
 	COPY_NODE_FIELD(distributionRestrict);
+	COPY_SCALAR_FIELD(instrument_options);
 #endif
 	COPY_NODE_FIELD(utilityStmt);
 	COPY_LOCATION_FIELD(stmt_location);
@@ -1071,6 +1072,10 @@ _copyHash(const Hash *from)
 	COPY_SCALAR_FIELD(skewTable);
 	COPY_SCALAR_FIELD(skewColumn);
 	COPY_SCALAR_FIELD(skewInherit);
+#ifdef XCP
+	COPY_SCALAR_FIELD(runtimeFilterKey);
+	COPY_SCALAR_FIELD(runtimeFilterSize);
+#endif
 
 	return newnode;
 }
@@ -1273,6 +1278,7 @@ _copyExecNodes(const ExecNodes *from)
 	COPY_NODE_FIELD(en_expr);
 	COPY_SCALAR_FIELD(en_relid);
 	COPY_SCALAR_FIELD(accesstype);
+	COPY_NODE_FIELD(replicanodelist);
 
 	return newnode;
 }
@@ -1325,6 +1331,9 @@ _copyRemoteSubplan(const RemoteSubplan *from)
 	COPY_NODE_FIELD(sort);
 	COPY_STRING_FIELD(cursor);
 	COPY_SCALAR_FIELD(unique);
+	COPY_NODE_FIELD(replicaNodes);
+	COPY_SCALAR_FIELD(distributionSkew);
+	COPY_SCALAR_FIELD(runtimeFilterSize);
 
 	return newnode;
 }
@@ -897,6 +897,7 @@ _outExecNodes(StringInfo str, const ExecNodes *node)
 	WRITE_NODE_FIELD(en_expr);
 	WRITE_OID_FIELD(en_relid);
 	WRITE_ENUM_FIELD(accesstype, RelationAccessType);
+	WRITE_NODE_FIELD(replicanodelist);
 }
 #endif
 
@@ -1466,6 +1467,10 @@ _outHash(StringInfo str, const Hash *node)
 	WRITE_OID_FIELD(skewTable);
 	WRITE_INT_FIELD(skewColumn);
 	WRITE_BOOL_FIELD(skewInherit);
+#ifdef XCP
+	WRITE_INT_FIELD(runtimeFilterKey);
+	WRITE_INT_FIELD(runtimeFilterSize);
+#endif
 }
 
 static void
@@ -1558,6 +1563,9 @@ _outRemoteSubplan(StringInfo str, const RemoteSubplan *node)
 	WRITE_NODE_FIELD(sort);
 	WRITE_STRING_FIELD(cursor);
 	WRITE_INT_FIELD(unique);
+	WRITE_NODE_FIELD(replicaNodes);
+	WRITE_FLOAT_FIELD(distributionSkew, "%.2f");
+	WRITE_INT_FIELD(runtimeFilterSize);
 }
 
 static void
@@ -1606,6 +1614,9 @@ _outRemoteStmt(StringInfo str, const RemoteStmt *node)
 	WRITE_INT_FIELD(distributionKey);
 	WRITE_NODE_FIELD(distributionNodes);
 	WRITE_NODE_FIELD(distributionRestrict);
+	WRITE_INT_FIELD(instrument_options);
+	WRITE_UINT_FIELD(queryId);
+	WRITE_INT_FIELD(runtimeFilterSize);
 }
 
 static void
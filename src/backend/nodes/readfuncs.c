@@ -3363,6 +3363,10 @@ _readHash(void)
 		READ_OID_FIELD(skewTable);
 	READ_INT_FIELD(skewColumn);
 	READ_BOOL_FIELD(skewInherit);
+#ifdef XCP
+	READ_INT_FIELD(runtimeFilterKey);
+	READ_INT_FIELD(runtimeFilterSize);
+#endif
 
 	READ_DONE();
 }
@@ -3631,6 +3635,9 @@ _readRemoteSubplan(void)
 	READ_NODE_FIELD(sort);
 	READ_STRING_FIELD(cursor);
 	READ_INT_FIELD(unique);
+	READ_NODE_FIELD(replicaNodes);
+	READ_FLOAT_FIELD(distributionSkew);
+	READ_INT_FIELD(runtimeFilterSize);
 
 	READ_DONE();
 }
@@ -3702,6 +3709,9 @@ _readRemoteStmt(void)
 	READ_INT_FIELD(distributionKey);
 	READ_NODE_FIELD(distributionNodes);
 	READ_NODE_FIELD(distributionRestrict);
+	READ_INT_FIELD(instrument_options);
+	READ_UINT_FIELD(queryId);
+	READ_INT_FIELD(runtimeFilterSize);
 
 	READ_DONE();
 }
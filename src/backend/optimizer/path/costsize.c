@@ -110,6 +110,7 @@ double		cpu_operator_cost = DEFAULT_CPU_OPERATOR_COST;
 #ifdef XCP
 double		network_byte_cost = DEFAULT_NETWORK_BYTE_COST;
 double		remote_query_cost = DEFAULT_REMOTE_QUERY_COST;
+double		network_message_cost = DEFAULT_NETWORK_MESSAGE_COST;
 #endif
 double		parallel_tuple_cost = DEFAULT_PARALLEL_TUPLE_COST;
 double		parallel_setup_cost = DEFAULT_PARALLEL_SETUP_COST;
@@ -132,6 +133,11 @@ bool		enable_material = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
 bool		enable_fast_query_shipping = true;
+#ifdef XCP
+bool		enable_broadcast_join = false;
+bool		enable_redistributed_grouping = false;
+bool		enable_runtime_filter = false;
+#endif
 bool		enable_gathermerge = true;
 
 typedef struct
@@ -5084,7 +5090,7 @@ page_size(double tuples, int width)
 void
 cost_remote_subplan(Path *path,
 			  Cost input_startup_cost, Cost input_total_cost,
-			  double tuples, int width, int replication)
+			  double tuples, int width, int replication, double skew)
 {
 	Cost		startup_cost = input_startup_cost + remote_query_cost;
 	Cost		run_cost = input_total_cost - input_startup_cost;
@@ -5096,14 +5102,32 @@ cost_remote_subplan(Path *path,
 	 */
 	run_cost += 2 * cpu_operator_cost * tuples;
 
-	/*
-	 * Estimate cost of sending data over network
-	 */
-	run_cost += network_byte_cost * tuples * width * replication;
+	run_cost += cost_network_transfer(tuples, width, replication, skew);
 
 	path->startup_cost = startup_cost;
 	path->total_cost = startup_cost + run_cost;
 }
+
+/*
+ * cost_network_transfer
+ *	  Estimate the cost of sending tuples over the network.
+ *
+ * Every tuple is sent as a separate message to each of the target nodes, so
+ * both the volume and the number of messages grow with the replication factor.
+ *
+ * The transfer is over when the busiest producer is done, so if the rows are
+ * unevenly spread over the nodes, charge it as if every node sent as much as
+ * that one.
+ */
+Cost
+cost_network_transfer(double tuples, int width, int replication, double skew)
+{
+	if (skew < 1.0)
+		skew = 1.0;
+
+	return network_byte_cost * tuples * width * replication * skew +
+		network_message_cost * tuples * replication * skew;
+}
 #endif
 
 /*
@@ -62,8 +62,10 @@
 #include "parser/parse_coerce.h"
 #include "commands/prepare.h"
 #include "commands/tablecmds.h"
+#include "pgxc/squeue.h"
 #endif /* PGXC */
 #include "utils/lsyscache.h"
+#include "utils/typcache.h"
 
 
 /*
@@ -317,6 +319,9 @@ static GatherMerge *create_gather_merge_plan(PlannerInfo *root,
 static int add_sort_column(AttrNumber colIdx, Oid sortOp, Oid coll,
 				bool nulls_first,int numCols, AttrNumber *sortColIdx,
 				Oid *sortOperators, Oid *collations, bool *nullsFirst);
+static void push_limit_below_remote_subplan(PlannerInfo *root, Limit *limit);
+static int find_runtime_filter_key(Plan *outer_plan, List *hashclauses,
+						JoinType jointype);
 #endif
 
 static RemoteSubplan *find_push_down_plan(Plan *plan, bool force);
@@ -2480,10 +2485,140 @@ create_limit_plan(PlannerInfo *root, LimitPath *best_path, int flags,
 
 	copy_generic_path_info(&plan->plan, (Path *) best_path);
 
+#ifdef XCP
+	push_limit_below_remote_subplan(root, plan);
+#endif
+
 	return plan;
 }
 
 
+#ifdef XCP
+/*
+ * push_limit_below_remote_subplan
+ *	  Add a copy of the LIMIT below the RemoteSubplan the Limit node is
+ *	  reading from, so every node returns at most (limit + offset) rows.
+ *
+ * grouping_planner() does that when LIMIT is applied on top of a distributed
+ * path, but the rows may already be gathered at that point, for example when
+ * the final projection or a SubqueryScan ends up above the RemoteSubplan, or
+ * the ORDER BY is evaluated on the coordinator. So walk down through the
+ * nodes which do not change the number of rows and if we get to the
+ * RemoteSubplan gathering the rows put the bounded Limit under it. If the
+ * ordering the LIMIT depends on is established by a Sort right above the
+ * RemoteSubplan the Sort is pushed down as well, and the RemoteSubplan
+ * merges the sorted streams, so nodes run a top-N sort.
+ *
+ * Only constant LIMIT and OFFSET are pushed down, the executor takes care
+ * of the other cases, see pass_down_bound().
+ */
+static void
+push_limit_below_remote_subplan(PlannerInfo *root, Limit *limit)
+{
+	Plan	   *plan = limit->plan.lefttree;
+	Sort	   *sort = NULL;
+	RemoteSubplan *rsplan;
+	Plan	   *subplan;
+	Limit	   *remote_limit;
+	int64		count;
+	int64		offset = 0;
+	int64		tuples_needed;
+
+	if (limit->limitCount == NULL || !IsA(limit->limitCount, Const) ||
+			((Const *) limit->limitCount)->constisnull)
+		return;
+	count = DatumGetInt64(((Const *) limit->limitCount)->constvalue);
+
+	if (limit->limitOffset)
+	{
+		if (!IsA(limit->limitOffset, Const))
+			return;
+		if (!((Const *) limit->limitOffset)->constisnull)
+			offset = DatumGetInt64(((Const *) limit->limitOffset)->constvalue);
+	}
+
+	/* executor complains about negative values, nothing to gain for zero */
+	if (count <= 0 || offset < 0)
+		return;
+	tuples_needed = count + offset;
+	/* negative test checks for overflow in sum */
+	if (tuples_needed < 0)
+		return;
+
+	for (;;)
+	{
+		if (IsA(plan, Result) && plan->qual == NIL && plan->lefttree)
+			plan = plan->lefttree;
+		else if (IsA(plan, SubqueryScan) && plan->qual == NIL)
+			plan = ((SubqueryScan *) plan)->subplan;
+		else if (IsA(plan, Sort) && IsA(plan->lefttree, RemoteSubplan))
+		{
+			sort = (Sort *) plan;
+			plan = plan->lefttree;
+		}
+		else
+			break;
+	}
+
+	/* The RemoteSubplan must be collecting rows from the nodes */
+	if (!IsA(plan, RemoteSubplan))
+		return;
+	rsplan = (RemoteSubplan *) plan;
+	subplan = plan->lefttree;
+	if (rsplan->distributionType != LOCATOR_TYPE_NONE ||
+			subplan == NULL || IsA(subplan, Limit))
+		return;
+
+	if (sort)
+	{
+		Sort	   *remote_sort;
+		SimpleSort *simple_sort;
+
+		/*
+		 * The sort columns refer to the RemoteSubplan target list, so it
+		 * should be the same as the subplan's one.
+		 */
+		if (rsplan->sort || !equal(plan->targetlist, subplan->targetlist))
+			return;
+
+		remote_sort = make_sort(subplan, sort->numCols, sort->sortColIdx,
+								sort->sortOperators, sort->collations,
+								sort->nullsFirst);
+		label_sort_with_costsize(root, remote_sort, (double) tuples_needed);
+		subplan = (Plan *) remote_sort;
+
+		simple_sort = makeNode(SimpleSort);
+		simple_sort->numCols = sort->numCols;
+		simple_sort->sortColIdx = sort->sortColIdx;
+		simple_sort->sortOperators = sort->sortOperators;
+		simple_sort->sortCollations = sort->collations;
+		simple_sort->nullsFirst = sort->nullsFirst;
+		rsplan->sort = simple_sort;
+	}
+
+	remote_limit = make_limit(subplan,
+							  NULL,
+							  (Node *) makeConst(INT8OID, -1, InvalidOid,
+												 sizeof(int64),
+												 Int64GetDatum(tuples_needed),
+												 false, FLOAT8PASSBYVAL),
+							  0, tuples_needed);
+	copy_plan_costsize(&remote_limit->plan, subplan);
+	if (remote_limit->plan.plan_rows > (double) tuples_needed)
+	{
+		Plan	   *lplan = &remote_limit->plan;
+
+		lplan->total_cost = lplan->startup_cost +
+			(lplan->total_cost - lplan->startup_cost) *
+			(double) tuples_needed / lplan->plan_rows;
+		lplan->plan_rows = (double) tuples_needed;
+	}
+
+	plan->lefttree = (Plan *) remote_limit;
+}
+#endif
+
+
 #ifdef XCP
 /*
  * adjust_subplan_distribution
@@ -2553,6 +2688,58 @@ adjust_subplan_distribution(PlannerInfo *root, Distribution *pathd,
 	}
 }
 
+/*
+ * plan_has_remote_subplan
+ *	  Does the plan tree contain a RemoteSubplan, or a node we do not look
+ *	  into?
+ */
+static bool
+plan_has_remote_subplan(Plan *plan)
+{
+	ListCell   *lc;
+	List	   *children = NIL;
+
+	if (plan == NULL)
+		return false;
+
+	if (plan->initPlan)
+		return true;
+
+	switch (nodeTag(plan))
+	{
+		case T_RemoteSubplan:
+		case T_ModifyTable:
+		case T_CustomScan:
+		case T_ForeignScan:
+			return true;
+		case T_Append:
+			children = ((Append *) plan)->appendplans;
+			break;
+		case T_MergeAppend:
+			children = ((MergeAppend *) plan)->mergeplans;
+			break;
+		case T_BitmapAnd:
+			children = ((BitmapAnd *) plan)->bitmapplans;
+			break;
+		case T_BitmapOr:
+			children = ((BitmapOr *) plan)->bitmapplans;
+			break;
+		case T_SubqueryScan:
+			return plan_has_remote_subplan(((SubqueryScan *) plan)->subplan);
+		default:
+			break;
+	}
+
+	foreach(lc, children)
+	{
+		if (plan_has_remote_subplan((Plan *) lfirst(lc)))
+			return true;
+	}
+
+	return plan_has_remote_subplan(plan->lefttree) ||
+		plan_has_remote_subplan(plan->righttree);
+}
+
 /*
  * create_remotescan_plan
  *	  Create a RemoteSubquery plan for 'best_path' and (recursively) plans
@@ -2576,6 +2763,7 @@ create_remotescan_plan(PlannerInfo *root,
 	Oid			   *sortOperators;
 	Oid			   *collations;
 	bool		   *nullsFirst;
+	Bitmapset	   *replicas = NULL;
 
 	/*
 	 * Subsequent code will modify current restriction, it needs to be restored
@@ -2583,6 +2771,18 @@ create_remotescan_plan(PlannerInfo *root,
 	 */
 	saverestrict = root->curOuterRestrict;
 
+	/*
+	 * A replicated subpath read by the Coordinator is restricted to one of
+	 * its nodes below. Remember the candidates, so that the node may be chosen
+	 * again at executor startup, by the load of the nodes at that time.
+	 */
+	if (best_path->path.distribution == NULL && subpath->distribution &&
+		IsLocatorReplicated(subpath->distribution->distributionType) &&
+		bms_num_members(subpath->distribution->restrictNodes) != 1)
+		replicas = bms_copy(bms_is_empty(subpath->distribution->restrictNodes) ?
+							subpath->distribution->nodes :
+							subpath->distribution->restrictNodes);
+
 	adjust_subplan_distribution(root,
 								best_path->path.distribution,
 								subpath->distribution);
@@ -2618,6 +2818,21 @@ create_remotescan_plan(PlannerInfo *root,
 							  best_path->path.pathkeys);
 
 	copy_generic_path_info(&plan->scan.plan, (Path *) best_path);
+	plan->distributionSkew = best_path->path.parent->distribution_skew;
+
+	/*
+	 * Nothing else must depend on the node chosen, no other RemoteSubplan
+	 * below may send its results there, and no subplan either.
+	 */
+	if (bms_num_members(replicas) > 1 && list_length(plan->nodeList) == 1 &&
+		root->glob->subplans == NIL && !plan_has_remote_subplan(subplan))
+	{
+		int			nodenum;
+
+		while ((nodenum = bms_first_member(replicas)) >= 0)
+			plan->replicaNodes = lappend_int(plan->replicaNodes, nodenum);
+	}
+	bms_free(replicas);
 
 	/* restore current restrict */
 	bms_free(root->curOuterRestrict);
@@ -4471,6 +4686,31 @@ create_hashjoin_plan(PlannerInfo *root,
 	copy_plan_costsize(&hash_plan->plan, inner_plan);
 	hash_plan->plan.startup_cost = hash_plan->plan.total_cost;
 
+#ifdef XCP
+	hash_plan->runtimeFilterKey = find_runtime_filter_key(outer_plan,
+														  hashclauses,
+												best_path->jpath.jointype);
+	if (hash_plan->runtimeFilterKey >= 0)
+	{
+		RemoteSubplan *rsplan = (RemoteSubplan *) outer_plan;
+		int			size;
+
+		/*
+		 * Size the filter after the expected number of inner rows.  Give up
+		 * on it if the shared queue has no room for a filter per consumer.
+		 */
+		size = SharedQueueFilterSize(inner_plan->plan_rows,
+									 list_length(rsplan->distributionRestrict) - 1);
+		if (size > 0)
+		{
+			hash_plan->runtimeFilterSize = size;
+			rsplan->runtimeFilterSize = size;
+		}
+		else
+			hash_plan->runtimeFilterKey = -1;
+	}
+#endif
+
 	join_plan = make_hashjoin(tlist,
 							  joinclauses,
 							  otherclauses,
@@ -4485,6 +4725,80 @@ create_hashjoin_plan(PlannerInfo *root,
 	return join_plan;
 }
 
+#ifdef XCP
+/*
+ * find_runtime_filter_key
+ *	  Find a hash clause the inner side of a hash join could build a runtime
+ *	  filter on, to be pushed down to the producers of the outer side.
+ *
+ * The outer side must be a RemoteSubplan redistributing rows by hash, and
+ * the clause must compare the redistribution key.  Producers then drop the
+ * rows whose key has no match on the consumer before they are sent over the
+ * network.  The filter is built from the inner key values hashed the same
+ * way the producer hashes the distribution key, so the key types have to
+ * be the same and the operator has to be the default equality of the type.
+ *
+ * Only join types that discard unmatched outer rows qualify.  Returns the
+ * index of the clause in hashclauses, or -1 if there is no suitable one.
+ */
+static int
+find_runtime_filter_key(Plan *outer_plan, List *hashclauses, JoinType jointype)
+{
+	RemoteSubplan *rsplan;
+	TargetEntry *tle;
+	ListCell   *lc;
+	int			idx;
+
+	if (!enable_runtime_filter)
+		return -1;
+
+	if (jointype != JOIN_INNER && jointype != JOIN_SEMI &&
+			jointype != JOIN_RIGHT)
+		return -1;
+
+	if (!IsA(outer_plan, RemoteSubplan))
+		return -1;
+
+	rsplan = (RemoteSubplan *) outer_plan;
+	if (rsplan->distributionType != LOCATOR_TYPE_HASH &&
+			rsplan->distributionType != LOCATOR_TYPE_MODULO)
+		return -1;
+	if (rsplan->distributionKey == InvalidAttrNumber ||
+			rsplan->distributionKey > list_length(outer_plan->targetlist))
+		return -1;
+
+	tle = (TargetEntry *) list_nth(outer_plan->targetlist,
+								   rsplan->distributionKey - 1);
+
+	idx = 0;
+	foreach(lc, hashclauses)
+	{
+		OpExpr	   *clause = (OpExpr *) lfirst(lc);
+		Node	   *outer_key;
+		Node	   *inner_key;
+		Oid			keytype;
+		TypeCacheEntry *typentry;
+
+		Assert(is_opclause(clause));
+		outer_key = (Node *) linitial(clause->args);
+		inner_key = (Node *) lsecond(clause->args);
+		if (IsA(outer_key, RelabelType))
+			outer_key = (Node *) ((RelabelType *) outer_key)->arg;
+
+		keytype = exprType((Node *) tle->expr);
+		if (equal(outer_key, tle->expr) && exprType(inner_key) == keytype)
+		{
+			typentry = lookup_type_cache(keytype, TYPECACHE_EQ_OPR);
+			if (clause->opno == typentry->eq_opr)
+				return idx;
+		}
+		idx++;
+	}
+
+	return -1;
+}
+#endif
+
 
 /*****************************************************************************
  *
@@ -6092,6 +6406,10 @@ make_hash(Plan *lefttree,
 	node->skewTable = skewTable;
 	node->skewColumn = skewColumn;
 	node->skewInherit = skewInherit;
+#ifdef XCP
+	node->runtimeFilterKey = -1;
+	node->runtimeFilterSize = 0;
+#endif
 
 	return node;
 }
@@ -56,6 +56,7 @@
 #include "utils/rel.h"
 #ifdef PGXC
 #include "commands/prepare.h"
+#include "optimizer/pgxcship.h"
 #include "pgxc/pgxc.h"
 #include "pgxc/planner.h"
 #endif
@@ -197,6 +198,15 @@ static bool groupingsets_distribution_match(PlannerInfo *root, Query *parse,
 static Path *adjust_path_distribution(PlannerInfo *root, Query *parse,
 					  Path *path);
 static bool can_push_down_grouping(PlannerInfo *root, Query *parse, Path *path);
+static void add_redistributed_grouping_paths(PlannerInfo *root,
+					  RelOptInfo *grouped_rel, Path *cheapest_path,
+					  PathTarget *target, const AggClauseCosts *agg_costs,
+					  grouping_sets_data *gd, double dNumGroups,
+					  bool can_sort, bool can_hash);
+static void add_redistributed_distinct_agg_paths(PlannerInfo *root,
+					  RelOptInfo *grouped_rel, Path *cheapest_path,
+					  PathTarget *target, const AggClauseCosts *agg_costs);
+static void cost_grouping_per_node(Path *path, Path *input, double divisor);
 static bool can_push_down_window(PlannerInfo *root, Path *path);
 static void adjust_paths_for_srfs(PlannerInfo *root, RelOptInfo *rel,
 					  List *targets, List *targets_contain_srfs);
@@ -4744,6 +4754,28 @@ create_grouping_paths(PlannerInfo *root,
 		}
 	}
 
+	/*
+	 * Generate XL paths aggregating on the datanodes, after redistributing
+	 * the rows by a grouping key. Unlike the 2-phase paths above, this also
+	 * works for aggregates without partial mode, e.g. count(DISTINCT x).
+	 * Without GROUP BY, the arguments of DISTINCT aggregates may still be
+	 * deduplicated on the datanodes.
+	 */
+	if (enable_redistributed_grouping && !parse->groupingSets)
+	{
+		if (parse->groupClause &&
+			!can_push_down_grouping(root, parse, cheapest_path) &&
+			pgxc_is_group_expr_shippable((Expr *) target->exprs) &&
+			pgxc_is_group_expr_shippable((Expr *) parse->havingQual))
+			add_redistributed_grouping_paths(root, grouped_rel, cheapest_path,
+											 target, agg_costs, gd, dNumGroups,
+											 can_sort, can_hash);
+		else if (!parse->groupClause && parse->hasAggs)
+			add_redistributed_distinct_agg_paths(root, grouped_rel,
+												 cheapest_path, target,
+												 agg_costs);
+	}
+
 	/* Give a helpful error if we failed to find any implementation */
 	if (grouped_rel->pathlist == NIL)
 		ereport(ERROR,
@@ -7057,6 +7089,398 @@ can_push_down_grouping(PlannerInfo *root, Query *parse, Path *path)
 	return grouping_distribution_match(root, parse, path, parse->groupClause);
 }
 
+/*
+ * add_redistributed_grouping_paths
+ *	Add grouping paths redistributing the rows by one of the grouping keys.
+ *
+ * After the redistribution the groups on different datanodes do not overlap,
+ * so each datanode computes final aggregates for its share of the groups, in
+ * parallel with other datanodes, and only the resulting groups are sent to
+ * the coordinator. The resulting paths look like this:
+ *
+ *	RemoteSubplan (gather)
+ *	  -> Agg (AGGSPLIT_SIMPLE)
+ *		-> RemoteSubplan (distribute by a grouping key)
+ *		  -> input path
+ *
+ * When all aggregates support partial mode, we also generate a variant with
+ * rows partially aggregated before the redistribution:
+ *
+ *	RemoteSubplan (gather)
+ *	  -> Agg (AGGSPLIT_FINAL_DESERIAL)
+ *		-> RemoteSubplan (distribute by a grouping key)
+ *		  -> Agg (AGGSPLIT_INITIAL_SERIAL)
+ *			-> input path
+ *
+ * The first variant is what makes DISTINCT aggregates scale, as those can't
+ * be split into partial and final phase at all.
+ */
+static void
+add_redistributed_grouping_paths(PlannerInfo *root, RelOptInfo *grouped_rel,
+								 Path *cheapest_path, PathTarget *target,
+								 const AggClauseCosts *agg_costs,
+								 grouping_sets_data *gd, double dNumGroups,
+								 bool can_sort, bool can_hash)
+{
+	Query		   *parse = root->parse;
+	Distribution   *distribution;
+	Expr		   *groupexpr = NULL;
+	char			distType = LOCATOR_TYPE_NONE;
+	int				numnodes;
+	double			divisor;
+	double			keyGroups = 0;
+	int				numGroupCols = list_length(parse->groupClause);
+	AttrNumber	   *groupColIdx;
+	int				i;
+	Path		   *path;
+	Path		   *input_path;
+
+	/*
+	 * Only redistribute data distributed among multiple nodes, otherwise
+	 * there's no parallelism to gain.
+	 */
+	if (cheapest_path->distribution == NULL ||
+		IsLocatorReplicated(cheapest_path->distribution->distributionType))
+		return;
+
+	numnodes = bms_num_members(cheapest_path->distribution->nodes);
+	if (numnodes < 2)
+		return;
+
+	/*
+	 * Pick the grouping key we can distribute by with the most distinct
+	 * values, it spreads the groups over the nodes most evenly.
+	 */
+	groupColIdx = extract_grouping_cols(parse->groupClause, parse->targetList);
+	for (i = 0; i < numGroupCols; i++)
+	{
+		TargetEntry *te = (TargetEntry *) list_nth(parse->targetList,
+												   groupColIdx[i] - 1);
+		Oid			 type = exprType((Node *) te->expr);
+		char		 keyType;
+		double		 ndistinct;
+
+		if (IsTypeHashDistributable(type))
+			keyType = LOCATOR_TYPE_HASH;
+		else if (IsTypeModuloDistributable(type))
+			keyType = LOCATOR_TYPE_MODULO;
+		else
+			continue;
+
+		ndistinct = estimate_num_groups(root, list_make1(te->expr),
+										cheapest_path->rows, NULL);
+		if (groupexpr == NULL || ndistinct > keyGroups)
+		{
+			groupexpr = te->expr;
+			distType = keyType;
+			keyGroups = ndistinct;
+		}
+	}
+
+	if (groupexpr == NULL)
+		return;
+
+	/* No more nodes can work in parallel than there are values of the key */
+	divisor = Min(numnodes, keyGroups);
+
+	distribution = makeNode(Distribution);
+	distribution->distributionType = distType;
+	distribution->nodes = bms_copy(cheapest_path->distribution->nodes);
+	distribution->restrictNodes = NULL;
+	distribution->distributionExpr = (Node *) groupexpr;
+
+	/* Aggregate the redistributed rows on datanodes (single phase) */
+	input_path = create_remotesubplan_path(root, cheapest_path, distribution);
+	/* Rows arrive from multiple producers, so the order is not preserved */
+	input_path->pathkeys = NIL;
+
+	if (can_hash)
+	{
+		path = (Path *) create_agg_path(root,
+										grouped_rel,
+										input_path,
+										target,
+										AGG_HASHED,
+										AGGSPLIT_SIMPLE,
+										parse->groupClause,
+										(List *) parse->havingQual,
+										agg_costs,
+										dNumGroups);
+		cost_grouping_per_node(path, input_path, divisor);
+		add_path(grouped_rel, create_remotesubplan_path(root, path, NULL));
+	}
+
+	if (can_sort)
+	{
+		path = (Path *) create_sort_path(root,
+										 grouped_rel,
+										 input_path,
+										 root->group_pathkeys,
+										 -1.0);
+
+		if (parse->hasAggs)
+			path = (Path *) create_agg_path(root,
+											grouped_rel,
+											path,
+											target,
+											AGG_SORTED,
+											AGGSPLIT_SIMPLE,
+											parse->groupClause,
+											(List *) parse->havingQual,
+											agg_costs,
+											dNumGroups);
+		else
+			path = (Path *) create_group_path(root,
+											  grouped_rel,
+											  path,
+											  target,
+											  parse->groupClause,
+											  (List *) parse->havingQual,
+											  dNumGroups);
+		cost_grouping_per_node(path, input_path, divisor);
+		add_path(grouped_rel, create_remotesubplan_path(root, path, NULL));
+	}
+
+	/*
+	 * Partially aggregate the rows before redistribution, when possible. We
+	 * only do that with hashing, sorted partial aggregation would need sorting
+	 * on both sides of the redistribution.
+	 */
+	if (can_hash && parse->hasAggs &&
+		!agg_costs->hasNonPartial && !agg_costs->hasNonSerial)
+	{
+		PathTarget	   *partial_grouping_target;
+		AggClauseCosts	agg_partial_costs;
+		AggClauseCosts	agg_final_costs;
+		double			dNumPartialGroups;
+
+		partial_grouping_target = make_partial_grouping_target(root, target);
+
+		/* Each node may see every group in the worst case */
+		dNumPartialGroups = get_number_of_groups(root,
+												 cheapest_path->rows,
+												 gd);
+
+		MemSet(&agg_partial_costs, 0, sizeof(AggClauseCosts));
+		MemSet(&agg_final_costs, 0, sizeof(AggClauseCosts));
+		get_agg_clause_costs(root, (Node *) partial_grouping_target->exprs,
+							 AGGSPLIT_INITIAL_SERIAL,
+							 &agg_partial_costs);
+		get_agg_clause_costs(root, (Node *) target->exprs,
+							 AGGSPLIT_FINAL_DESERIAL,
+							 &agg_final_costs);
+		get_agg_clause_costs(root, parse->havingQual,
+							 AGGSPLIT_FINAL_DESERIAL,
+							 &agg_final_costs);
+
+		path = (Path *) create_agg_path(root,
+										grouped_rel,
+										cheapest_path,
+										partial_grouping_target,
+										AGG_HASHED,
+										AGGSPLIT_INITIAL_SERIAL,
+										parse->groupClause,
+										NIL,
+										&agg_partial_costs,
+										dNumPartialGroups);
+
+		input_path = create_remotesubplan_path(root, path, distribution);
+
+		path = (Path *) create_agg_path(root,
+										grouped_rel,
+										input_path,
+										target,
+										AGG_HASHED,
+										AGGSPLIT_FINAL_DESERIAL,
+										parse->groupClause,
+										(List *) parse->havingQual,
+										&agg_final_costs,
+										dNumGroups);
+		cost_grouping_per_node(path, input_path, divisor);
+		add_path(grouped_rel, create_remotesubplan_path(root, path, NULL));
+	}
+}
+
+/*
+ * add_redistributed_distinct_agg_paths
+ *	Add paths deduplicating the arguments of DISTINCT aggregates on datanodes.
+ *
+ * Without GROUP BY the aggregates have to be computed on the coordinator, and
+ * DISTINCT aggregates can't be split into partial and final phase. But when
+ * all the aggregates are DISTINCT over the same arguments, the coordinator
+ * only needs to see every distinct value once. So the rows are redistributed
+ * by the arguments, deduplicated on the datanodes in parallel, and only the
+ * distinct values are sent to the coordinator:
+ *
+ *	Agg (AGG_PLAIN)
+ *	  -> RemoteSubplan (gather)
+ *		-> HashAgg (arguments of the aggregates)
+ *		  -> RemoteSubplan (distribute by the first argument)
+ *			-> input path
+ *
+ * We also generate a variant deduplicating the rows on each node before the
+ * redistribution, which pays off when there are few distinct values.
+ */
+static void
+add_redistributed_distinct_agg_paths(PlannerInfo *root, RelOptInfo *grouped_rel,
+									 Path *cheapest_path, PathTarget *target,
+									 const AggClauseCosts *agg_costs)
+{
+	Query		   *parse = root->parse;
+	List		   *aggrefs;
+	Aggref		   *first = NULL;
+	ListCell	   *lc;
+	List		   *exprs = NIL;
+	PathTarget	   *distinct_target;
+	Distribution   *distribution;
+	Expr		   *distexpr;
+	char			distType;
+	AggClauseCosts	dummy_costs;
+	int				numnodes;
+	double			numDistinct;
+	double			divisor;
+	Path		   *path;
+	Path		   *input_path;
+
+	if (cheapest_path->distribution == NULL ||
+		IsLocatorReplicated(cheapest_path->distribution->distributionType))
+		return;
+
+	numnodes = bms_num_members(cheapest_path->distribution->nodes);
+	if (numnodes < 2)
+		return;
+
+	/* All the aggregates must be DISTINCT over the same arguments */
+	aggrefs = pull_var_clause((Node *) target->exprs,
+							  PVC_INCLUDE_AGGREGATES |
+							  PVC_RECURSE_WINDOWFUNCS |
+							  PVC_RECURSE_PLACEHOLDERS);
+	aggrefs = list_concat(aggrefs,
+						  pull_var_clause(parse->havingQual,
+										  PVC_INCLUDE_AGGREGATES |
+										  PVC_RECURSE_WINDOWFUNCS |
+										  PVC_RECURSE_PLACEHOLDERS));
+	foreach(lc, aggrefs)
+	{
+		Aggref	   *aggref = (Aggref *) lfirst(lc);
+
+		if (!IsA(aggref, Aggref))
+			continue;
+
+		if (aggref->aggdistinct == NIL || aggref->aggorder != NIL ||
+			aggref->aggfilter != NULL || aggref->aggdirectargs != NIL)
+			return;
+
+		if (first == NULL)
+			first = aggref;
+		else if (!equal(first->args, aggref->args) ||
+				 !equal(first->aggdistinct, aggref->aggdistinct))
+			return;
+	}
+
+	if (first == NULL || !grouping_is_hashable(first->aggdistinct))
+		return;
+
+	/*
+	 * Deduplicate by the arguments, keeping the sortgroupref labels the
+	 * aggregate uses for its DISTINCT clause.
+	 */
+	distinct_target = create_empty_pathtarget();
+	foreach(lc, first->args)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+		add_column_to_pathtarget(distinct_target, tle->expr,
+								 tle->ressortgroupref);
+		exprs = lappend(exprs, tle->expr);
+	}
+	distinct_target = set_pathtarget_cost_width(root, distinct_target);
+
+	if (!pgxc_is_expr_shippable((Expr *) exprs, NULL))
+		return;
+
+	distexpr = (Expr *) linitial(exprs);
+	if (IsTypeHashDistributable(exprType((Node *) distexpr)))
+		distType = LOCATOR_TYPE_HASH;
+	else if (IsTypeModuloDistributable(exprType((Node *) distexpr)))
+		distType = LOCATOR_TYPE_MODULO;
+	else
+		return;
+
+	numDistinct = estimate_num_groups(root, exprs, cheapest_path->rows, NULL);
+	divisor = Min(numnodes,
+				  estimate_num_groups(root, list_make1(distexpr),
+									  cheapest_path->rows, NULL));
+
+	distribution = makeNode(Distribution);
+	distribution->distributionType = distType;
+	distribution->nodes = bms_copy(cheapest_path->distribution->nodes);
+	distribution->restrictNodes = NULL;
+	distribution->distributionExpr = (Node *) distexpr;
+
+	MemSet(&dummy_costs, 0, sizeof(AggClauseCosts));
+
+	input_path = (Path *) create_projection_path(root, grouped_rel,
+												 cheapest_path,
+												 distinct_target);
+
+	/* Redistribute all the rows and deduplicate them */
+	path = create_remotesubplan_path(root, input_path, distribution);
+	path->pathkeys = NIL;
+	path = (Path *) create_agg_path(root, grouped_rel, path, distinct_target,
+									AGG_HASHED, AGGSPLIT_SIMPLE,
+									first->aggdistinct, NIL, &dummy_costs,
+									numDistinct);
+	cost_grouping_per_node(path, ((AggPath *) path)->subpath, divisor);
+	path = create_remotesubplan_path(root, path, NULL);
+	add_path(grouped_rel, (Path *)
+			 create_agg_path(root, grouped_rel, path, target,
+							 AGG_PLAIN, AGGSPLIT_SIMPLE, NIL,
+							 (List *) parse->havingQual, agg_costs, 1));
+
+	/* Deduplicate on every node first */
+	path = (Path *) create_agg_path(root, grouped_rel, input_path,
+									distinct_target, AGG_HASHED,
+									AGGSPLIT_SIMPLE, first->aggdistinct, NIL,
+									&dummy_costs,
+									Min(numDistinct * numnodes,
+										cheapest_path->rows));
+	path = create_remotesubplan_path(root, path, distribution);
+	path->pathkeys = NIL;
+	path = (Path *) create_agg_path(root, grouped_rel, path, distinct_target,
+									AGG_HASHED, AGGSPLIT_SIMPLE,
+									first->aggdistinct, NIL, &dummy_costs,
+									numDistinct);
+	cost_grouping_per_node(path, ((AggPath *) path)->subpath, divisor);
+	path = create_remotesubplan_path(root, path, NULL);
+	add_path(grouped_rel, (Path *)
+			 create_agg_path(root, grouped_rel, path, target,
+							 AGG_PLAIN, AGGSPLIT_SIMPLE, NIL,
+							 (List *) parse->havingQual, agg_costs, 1));
+}
+
+/*
+ * cost_grouping_per_node
+ *	Adjust cost of a grouping path running on multiple datanodes in parallel.
+ *
+ * The path costs were estimated as if all the input was processed at once,
+ * but each of the nodes only processes its share of the input, so only the
+ * cost of the input is charged in full. The divisor is the number of nodes
+ * actually sharing the work, which may be less than the number of nodes the
+ * input is redistributed to, when the key has fewer distinct values.
+ */
+static void
+cost_grouping_per_node(Path *path, Path *input, double divisor)
+{
+	if (divisor <= 1.0)
+		return;
+
+	path->startup_cost = input->startup_cost +
+		(path->startup_cost - input->startup_cost) / divisor;
+	path->total_cost = input->total_cost +
+		(path->total_cost - input->total_cost) / divisor;
+}
+
 static bool
 can_push_down_window(PlannerInfo *root, Path *path)
 {
@@ -63,6 +63,9 @@ static Path *redistribute_path(PlannerInfo *root, Path *subpath, List *pathkeys,
 				  Bitmapset *nodes, Bitmapset *restrictNodes);
 static void set_scanpath_distribution(PlannerInfo *root, RelOptInfo *rel, Path *pathnode);
 static List *set_joinpath_distribution(PlannerInfo *root, JoinPath *pathnode);
+static JoinPath *flatCopyJoinPath(JoinPath *pathnode);
+static void cost_join_distribution(JoinPath *pathnode, Path *outer_path,
+					   Path *inner_path);
 extern void PoolPingNodes(void);
 #endif
 
@@ -1241,7 +1244,8 @@ create_remotesubplan_path(PlannerInfo *root, Path *subpath,
 	cost_remote_subplan((Path *) pathnode, subpath->startup_cost,
 						subpath->total_cost, subpath->rows, rel->reltarget->width,
 						(subdistribution && IsLocatorReplicated(subdistribution->distributionType)) ?
-						bms_num_members(subdistribution->nodes) : 1);
+						bms_num_members(subdistribution->nodes) : 1,
+						rel->distribution_skew);
 
 	return (Path *) pathnode;
 }
@@ -1308,7 +1312,8 @@ redistribute_path(PlannerInfo *root, Path *subpath, List *pathkeys,
 		cost_remote_subplan((Path *) pathnode, subpath->startup_cost,
 							subpath->total_cost, subpath->rows, rel->reltarget->width,
 							IsLocatorReplicated(distributionType) ?
-									bms_num_members(nodes) : 1);
+									bms_num_members(nodes) : 1,
+							rel->distribution_skew);
 		mpath->subpath = (Path *) pathnode;
 		cost_material(&mpath->path,
 					  pathnode->path.startup_cost,
@@ -1373,7 +1378,8 @@ redistribute_path(PlannerInfo *root, Path *subpath, List *pathkeys,
 							input_startup_cost, input_total_cost,
 							subpath->rows, rel->reltarget->width,
 							IsLocatorReplicated(distributionType) ?
-									bms_num_members(nodes) : 1);
+									bms_num_members(nodes) : 1,
+							rel->distribution_skew);
 		return (Path *) pathnode;
 	}
 }
@@ -1667,65 +1673,81 @@ not_allowed_join:
 	 * by has as main variant.
 	 */
 
-#ifdef NOT_USED	
-	/* These join types allow replicated inner */
-	if (outerd &&
-			(pathnode->jointype == JOIN_INNER ||
-			 pathnode->jointype == JOIN_LEFT ||
-			 pathnode->jointype == JOIN_SEMI ||
-			 pathnode->jointype == JOIN_ANTI))
+	/*
+	 * Broadcasting is not attempted if the subpath is a MaterialPath, because
+	 * redistribute_path() modifies it in place, and it is shared with the main
+	 * path.
+	 */
+	if (enable_broadcast_join)
 	{
-		/*
-		 * Since we discard all alternate pathes except one it is OK if all they
-		 * reference the same objects
-		 */
-		JoinPath *altpath = flatCopyJoinPath(pathnode);
-		/* Redistribute inner subquery */
-		altpath->innerjoinpath = redistribute_path(
-				root,
-				altpath->innerjoinpath,
-				innerpathkeys,
-				LOCATOR_TYPE_REPLICATED,
-				NULL,
-				bms_copy(outerd->nodes),
-				bms_copy(outerd->restrictNodes));
-		targetd = makeNode(Distribution);
-		targetd->distributionType = outerd->distributionType;
-		targetd->nodes = bms_copy(outerd->nodes);
-		targetd->restrictNodes = bms_copy(outerd->restrictNodes);
-		targetd->distributionExpr = outerd->distributionExpr;
-		altpath->path.distribution = targetd;
-		alternate = lappend(alternate, altpath);
-	}
+		/* These join types allow replicated inner */
+		if (outerd && innerd &&
+				!IsA(pathnode->innerjoinpath, MaterialPath) &&
+				(pathnode->jointype == JOIN_INNER ||
+				 pathnode->jointype == JOIN_LEFT ||
+				 pathnode->jointype == JOIN_SEMI ||
+				 pathnode->jointype == JOIN_ANTI))
+		{
+			/*
+			 * Since we discard all alternate pathes except one it is OK if all
+			 * they reference the same objects
+			 */
+			JoinPath *altpath = flatCopyJoinPath(pathnode);
+			/* Replicate inner subquery to the nodes of outer */
+			altpath->innerjoinpath = redistribute_path(
+					root,
+					altpath->innerjoinpath,
+					innerpathkeys,
+					LOCATOR_TYPE_REPLICATED,
+					NULL,
+					bms_copy(outerd->nodes),
+					bms_copy(outerd->restrictNodes));
+
+			if (IsA(altpath, MergePath))
+				((MergePath*)altpath)->innersortkeys = NIL;
 
-	/* These join types allow replicated outer */
-	if (innerd &&
-			(pathnode->jointype == JOIN_INNER ||
-			 pathnode->jointype == JOIN_RIGHT))
-	{
-		/*
-		 * Since we discard all alternate pathes except one it is OK if all they
-		 * reference the same objects
-		 */
-		JoinPath *altpath = flatCopyJoinPath(pathnode);
-		/* Redistribute inner subquery */
-		altpath->outerjoinpath = redistribute_path(
-				root,
-				altpath->outerjoinpath,
-				outerpathkeys,
-				LOCATOR_TYPE_REPLICATED,
-				NULL,
-				bms_copy(innerd->nodes),
-				bms_copy(innerd->restrictNodes));
-		targetd = makeNode(Distribution);
-		targetd->distributionType = innerd->distributionType;
-		targetd->nodes = bms_copy(innerd->nodes);
-		targetd->restrictNodes = bms_copy(innerd->restrictNodes);
-		targetd->distributionExpr = innerd->distributionExpr;
-		altpath->path.distribution = targetd;
-		alternate = lappend(alternate, altpath);
+			targetd = makeNode(Distribution);
+			targetd->distributionType = outerd->distributionType;
+			targetd->nodes = bms_copy(outerd->nodes);
+			targetd->restrictNodes = bms_copy(outerd->restrictNodes);
+			targetd->distributionExpr = outerd->distributionExpr;
+			altpath->path.distribution = targetd;
+			alternate = lappend(alternate, altpath);
+		}
+
+		/* These join types allow replicated outer */
+		if (innerd && outerd &&
+				!IsA(pathnode->outerjoinpath, MaterialPath) &&
+				(pathnode->jointype == JOIN_INNER ||
+				 pathnode->jointype == JOIN_RIGHT))
+		{
+			/*
+			 * Since we discard all alternate pathes except one it is OK if all
+			 * they reference the same objects
+			 */
+			JoinPath *altpath = flatCopyJoinPath(pathnode);
+			/* Replicate outer subquery to the nodes of inner */
+			altpath->outerjoinpath = redistribute_path(
+					root,
+					altpath->outerjoinpath,
+					outerpathkeys,
+					LOCATOR_TYPE_REPLICATED,
+					NULL,
+					bms_copy(innerd->nodes),
+					bms_copy(innerd->restrictNodes));
+
+			if (IsA(altpath, MergePath))
+				((MergePath*)altpath)->outersortkeys = NIL;
+
+			targetd = makeNode(Distribution);
+			targetd->distributionType = innerd->distributionType;
+			targetd->nodes = bms_copy(innerd->nodes);
+			targetd->restrictNodes = bms_copy(innerd->restrictNodes);
+			targetd->distributionExpr = innerd->distributionExpr;
+			altpath->path.distribution = targetd;
+			alternate = lappend(alternate, altpath);
+		}
 	}
-#endif
 
 	/*
 	 * Redistribute subplans to make them compatible.
@@ -2071,6 +2093,84 @@ not_allowed_join:
 
 	return alternate;
 }
+
+/*
+ * flatCopyJoinPath
+ *	Make a shallow copy of the join path, subpaths and other members are
+ *	shared with the original.
+ */
+static JoinPath *
+flatCopyJoinPath(JoinPath *pathnode)
+{
+	JoinPath   *newnode;
+	Size		size;
+
+	switch (nodeTag(pathnode))
+	{
+		case T_NestPath:
+			size = sizeof(NestPath);
+			break;
+		case T_MergePath:
+			size = sizeof(MergePath);
+			break;
+		case T_HashPath:
+			size = sizeof(HashPath);
+			break;
+		default:
+			elog(ERROR, "unrecognized join path type: %d",
+				 (int) nodeTag(pathnode));
+			size = 0;			/* keep compiler quiet */
+	}
+
+	newnode = (JoinPath *) palloc(size);
+	memcpy(newnode, pathnode, size);
+
+	return newnode;
+}
+
+/*
+ * cost_join_distribution
+ *	Charge the join path for moving its subpaths between nodes.
+ *
+ * The join cost is calculated from the original subpaths, before
+ * set_joinpath_distribution() puts a RemoteSubPath on top of them, so the
+ * network transfer is added here. This is what makes redistribution of both
+ * sides comparable with replication of one side. Only the transfer itself is
+ * charged: the fixed overhead of a remote subplan is the same whichever side
+ * is moved, and would penalize joins that move data against those that don't.
+ */
+static void
+cost_join_distribution(JoinPath *pathnode, Path *outer_path, Path *inner_path)
+{
+	Path	   *subpaths[2];
+	Path	   *origpaths[2];
+	int			i;
+
+	if (!enable_broadcast_join)
+		return;
+
+	subpaths[0] = pathnode->outerjoinpath;
+	subpaths[1] = pathnode->innerjoinpath;
+	origpaths[0] = outer_path;
+	origpaths[1] = inner_path;
+
+	for (i = 0; i < 2; i++)
+	{
+		Path		   *subpath = subpaths[i];
+		Distribution   *distribution = subpath->distribution;
+
+		/* Subpath is joined where it is */
+		if (subpath == origpaths[i] || !IsA(subpath, RemoteSubPath))
+			continue;
+
+		pathnode->path.total_cost +=
+			cost_network_transfer(subpath->rows, subpath->pathtarget->width,
+								  (distribution &&
+								   IsLocatorReplicated(distribution->distributionType)) ?
+										bms_num_members(distribution->nodes) : 1,
+								  subpath->parent->distribution_skew);
+	}
+}
 #endif
 
 
@@ -3541,6 +3641,8 @@ create_nestloop_path(PlannerInfo *root,
 	final_cost_nestloop(root, pathnode, workspace, extra);
 
 #ifdef XCP
+	cost_join_distribution(pathnode, outer_path, inner_path);
+
 	/*
 	 * Also calculate costs of all alternates and return cheapest path
 	 */
@@ -3548,6 +3650,7 @@ create_nestloop_path(PlannerInfo *root,
 	{
 		NestPath *altpath = (NestPath *) lfirst(lc);
 		final_cost_nestloop(root, altpath, workspace, extra);
+		cost_join_distribution(altpath, outer_path, inner_path);
 		if (altpath->path.total_cost < pathnode->path.total_cost)
 			pathnode = altpath;
 	}
@@ -3630,6 +3733,8 @@ create_mergejoin_path(PlannerInfo *root,
 	final_cost_mergejoin(root, pathnode, workspace, extra);
 
 #ifdef XCP
+	cost_join_distribution((JoinPath *) pathnode, outer_path, inner_path);
+
 	/*
 	 * Also calculate costs of all alternates and return cheapest path
 	 */
@@ -3637,6 +3742,7 @@ create_mergejoin_path(PlannerInfo *root,
 	{
 		MergePath *altpath = (MergePath *) lfirst(lc);
 		final_cost_mergejoin(root, altpath, workspace, extra);
+		cost_join_distribution((JoinPath *) altpath, outer_path, inner_path);
 		if (altpath->jpath.path.total_cost < pathnode->jpath.path.total_cost)
 			pathnode = altpath;
 	}
@@ -3721,6 +3827,8 @@ create_hashjoin_path(PlannerInfo *root,
 	final_cost_hashjoin(root, pathnode, workspace, extra);
 
 #ifdef XCP
+	cost_join_distribution((JoinPath *) pathnode, outer_path, inner_path);
+
 	/*
 	 * Calculate costs of all alternates and return cheapest path
 	 */
@@ -3728,6 +3836,7 @@ create_hashjoin_path(PlannerInfo *root,
 	{
 		HashPath *altpath = (HashPath *) lfirst(lc);
 		final_cost_hashjoin(root, altpath, workspace, extra);
+		cost_join_distribution((JoinPath *) altpath, outer_path, inner_path);
 		if (altpath->jpath.path.total_cost < pathnode->jpath.path.total_cost)
 			pathnode = altpath;
 	}
@@ -417,15 +417,16 @@ pgxc_FQS_find_datanodes(Query *query)
 		/*
 		 * If relations involved in the query are such that ultimate JOIN is
 		 * replicated JOIN, choose only one of them. If one of them is a
-		 * preferred node choose that one, otherwise choose the first one.
+		 * preferred node choose that one, otherwise choose the least loaded
+		 * one. The choice is made again when the query is executed, as the
+		 * plan may be cached, so keep the whole list.
 		 */
 		if (IsLocatorReplicated(exec_nodes->baselocatortype) &&
 			(exec_nodes->accesstype == RELATION_ACCESS_READ ||
 			exec_nodes->accesstype == RELATION_ACCESS_READ_FQS))
 		{
-			List *tmp_list = exec_nodes->nodeList;
+			exec_nodes->replicanodelist = exec_nodes->nodeList;
 			exec_nodes->nodeList = GetPreferredReplicationNode(exec_nodes->nodeList);
-			list_free(tmp_list);
 		}
 		return exec_nodes;
 	}
@@ -1466,6 +1467,31 @@ pgxc_is_expr_shippable(Expr *node, bool *has_aggs)
 	return true;
 }
 
+/*
+ * pgxc_is_group_expr_shippable
+ * Determine if an expression computed over groups of rows can be evaluated on
+ * the Datanodes, when the caller makes sure that all the rows of each group
+ * reside on a single Datanode. Aggregates are acceptable then, even those
+ * which need to see all the rows of the group, such as DISTINCT aggregates.
+ */
+bool
+pgxc_is_group_expr_shippable(Expr *node)
+{
+	Shippability_context sc_context;
+
+	memset(&sc_context, 0, sizeof(sc_context));
+	sc_context.sc_query = NULL;
+	sc_context.sc_query_level = 0;
+	sc_context.sc_for_expr = true;
+
+	pgxc_shippability_walker((Node *)node, &sc_context);
+
+	/* Whole groups are evaluated on a single node */
+	pgxc_reset_shippability_reason(&sc_context, SS_HAS_AGG_EXPR);
+	pgxc_reset_shippability_reason(&sc_context, SS_NEED_SINGLENODE);
+
+	return bms_is_empty(sc_context.sc_shippability);
+}
 
 /*
  * pgxc_is_func_shippable
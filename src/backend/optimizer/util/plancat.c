@@ -50,6 +50,8 @@
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 #ifdef PGXC
+#include "catalog/pgxc_class_stats.h"
+#include "pgxc/locator.h"
 #include "pgxc/pgxc.h"
 #endif
 
@@ -142,6 +144,13 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 		estimate_rel_size(relation, rel->attr_widths - rel->min_attr,
 						  &rel->pages, &rel->tuples, &rel->allvisfrac);
 
+#ifdef XCP
+	/* How unevenly the rows are spread over the Datanodes */
+	if (IS_PGXC_COORDINATOR && relation->rd_locator_info &&
+		!IsRelationReplicated(relation->rd_locator_info))
+		rel->distribution_skew = GetPgxcClassSkew(RelationGetRelid(relation));
+#endif
+
 	/* Retrieve the parallel_workers reloption, or -1 if not set. */
 	rel->rel_parallel_workers = RelationGetParallelWorkers(relation, -1);
 
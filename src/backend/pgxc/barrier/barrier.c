@@ -24,14 +24,21 @@
 #include "pgxc/locator.h"
 #include "pgxc/pgxc.h"
 #include "nodes/nodes.h"
+#include "portability/instr_time.h"
 #include "pgxc/pgxcnode.h"
 #include "storage/lwlock.h"
 #include "tcop/dest.h"
 
 static const char *generate_barrier_id(const char *id);
-static PGXCNodeAllHandles *PrepareBarrier(const char *id);
-static void ExecuteBarrier(const char *id);
-static void EndBarrier(PGXCNodeAllHandles *handles, const char *id);
+static void PrepareBarrier(PGXCNodeHandle **coord_handles, int co_count,
+			   const char *id);
+static void ExecuteBarrier(PGXCNodeHandle **handles, int count,
+			   const char *id);
+static double EndBarrier(PGXCNodeHandle **coord_handles, int co_count,
+		   const char *id);
+
+/* When commits started to be blocked for the barrier in progress */
+static instr_time barrier_prepared_at;
 
 /*
  * Prepare ourselves for an incoming BARRIER. We must disable all new 2PC
@@ -62,6 +69,7 @@ ProcessCreateBarrierPrepare(const char *id)
 						"arrive at a Coordinator from another Coordinator")));
 
 	LWLockAcquire(BarrierLock, LW_EXCLUSIVE);
+	INSTR_TIME_SET_CURRENT(barrier_prepared_at);
 
 	pq_beginmessage(&buf, 'b');
 	pq_sendstring(&buf, id);
@@ -82,6 +90,7 @@ void
 ProcessCreateBarrierEnd(const char *id)
 {
 	StringInfoData buf;
+	instr_time	stall;
 
 	if (!IS_PGXC_REMOTE_COORDINATOR)
 		ereport(ERROR,
@@ -91,6 +100,11 @@ ProcessCreateBarrierEnd(const char *id)
 
 	LWLockRelease(BarrierLock);
 
+	INSTR_TIME_SET_CURRENT(stall);
+	INSTR_TIME_SUBTRACT(stall, barrier_prepared_at);
+	elog(DEBUG1, "CREATE BARRIER <%s> blocked commits for %.3f ms",
+		 id, INSTR_TIME_GET_MILLISEC(stall));
+
 	pq_beginmessage(&buf, 'b');
 	pq_sendstring(&buf, id);
 	pq_endmessage(&buf);
@@ -155,28 +169,28 @@ generate_barrier_id(const char *id)
 	return pstrdup(genid);
 }
 
-static PGXCNodeAllHandles *
-SendBarrierPrepareRequest(List *coords, const char *id)
+/*
+ * Queue a barrier message of the given kind on each of the handles and flush
+ * them, without waiting for any response.
+ */
+static void
+SendBarrierRequest(PGXCNodeHandle **handles, int count, char command,
+				   const char *id)
 {
-	PGXCNodeAllHandles *coord_handles;
 	int conn;
 	int msglen;
-	int barrier_idlen;
-
-	coord_handles = get_handles(NIL, coords, true, true);
+	int barrier_idlen = strlen(id) + 1;
 
-	for (conn = 0; conn < coord_handles->co_conn_count; conn++)
+	for (conn = 0; conn < count; conn++)
 	{
-		PGXCNodeHandle *handle = coord_handles->coord_handles[conn];
+		PGXCNodeHandle *handle = handles[conn];
 
 		/* Invalid connection state, return error */
 		if (handle->state != DN_CONNECTION_STATE_IDLE)
 			ereport(ERROR,
 					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("Failed to send CREATE BARRIER PREPARE request "
-						 	"to the node")));
-
-		barrier_idlen = strlen(id) + 1;
+					 errmsg("Failed to send CREATE BARRIER request "
+						 	"to the node %s", handle->nodename)));
 
 		msglen = 4; /* for the length itself */
 		msglen += barrier_idlen;
@@ -195,101 +209,70 @@ SendBarrierPrepareRequest(List *coords, const char *id)
 		memcpy(handle->outBuffer + handle->outEnd, &msglen, 4);
 		handle->outEnd += 4;
 
-		handle->outBuffer[handle->outEnd++] = CREATE_BARRIER_PREPARE;
+		handle->outBuffer[handle->outEnd++] = command;
 
 		memcpy(handle->outBuffer + handle->outEnd, id, barrier_idlen);
 		handle->outEnd += barrier_idlen;
 
 		PGXCNodeSetConnectionState(handle, DN_CONNECTION_STATE_QUERY);
-
 		pgxc_node_flush(handle);
 	}
-
-	return coord_handles;
 }
 
+/*
+ * Wait until all the handles have acknowledged the barrier command. The
+ * responses are consumed in whatever order the nodes send them, so the wait
+ * is as long as the slowest node rather than the sum over all the nodes.
+ */
 static void
-CheckBarrierCommandStatus(PGXCNodeAllHandles *conn_handles, const char *id,
+CheckBarrierCommandStatus(PGXCNodeHandle **handles, int count, const char *id,
 						  const char *command)
 {
-	int conn;
-	int count = conn_handles->co_conn_count + conn_handles->dn_conn_count;
+	PGXCNodeHandle **pending;
+	int			pending_count = count;
 
 	elog(DEBUG2, "Check CREATE BARRIER <%s> %s command status", id, command);
 
-	for (conn = 0; conn < count; conn++)
-	{
-		PGXCNodeHandle *handle;
-
-		if (conn < conn_handles->co_conn_count)
-			handle = conn_handles->coord_handles[conn];
-		else
-			handle = conn_handles->datanode_handles[conn - conn_handles->co_conn_count];
-
-		if (pgxc_node_receive(1, &handle, NULL))
-			ereport(ERROR,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("Failed to receive response from the remote side")));
-
-		if (handle_response(handle, NULL) != RESPONSE_BARRIER_OK)
-			ereport(ERROR,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("CREATE BARRIER PREPARE command failed "
-						 	"with error %s", handle->error)));
-	}
-
-	elog(DEBUG2, "Successfully completed CREATE BARRIER <%s> %s command on "
-				 "all nodes", id, command);
-}
-
-static void
-SendBarrierEndRequest(PGXCNodeAllHandles *coord_handles, const char *id)
-{
-	int conn;
-	int msglen;
-	int barrier_idlen;
-
-	elog(DEBUG2, "Sending CREATE BARRIER <%s> END command to all Coordinators", id);
+	pending = (PGXCNodeHandle **) palloc(count * sizeof(PGXCNodeHandle *));
+	memcpy(pending, handles, count * sizeof(PGXCNodeHandle *));
 
-	for (conn = 0; conn < coord_handles->co_conn_count; conn++)
+	while (pending_count > 0)
 	{
-		PGXCNodeHandle *handle = coord_handles->coord_handles[conn];
+		int			i = 0;
 
-		/* Invalid connection state, return error */
-		if (handle->state != DN_CONNECTION_STATE_IDLE)
+		if (pgxc_node_receive(pending_count, pending, NULL))
 			ereport(ERROR,
 					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("Failed to send CREATE BARRIER PREPARE request "
-						 	"to the node")));
-
-		barrier_idlen = strlen(id) + 1;
-
-		msglen = 4; /* for the length itself */
-		msglen += barrier_idlen;
-		msglen += 1; /* for barrier command itself */
+					 errmsg("Failed to receive response from the remote side")));
 
-		/* msgType + msgLen */
-		if (ensure_out_buffer_capacity(handle->outEnd + 1 + msglen, handle) != 0)
+		while (i < pending_count)
 		{
-			ereport(ERROR,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("Out of memory")));
+			PGXCNodeHandle *handle = pending[i];
+			int			res = handle_response(handle, NULL);
+
+			if (res == RESPONSE_EOF)
+			{
+				/* Not there yet, check again after next receive */
+				i++;
+				continue;
+			}
+
+			if (res != RESPONSE_BARRIER_OK)
+				ereport(ERROR,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+						 errmsg("CREATE BARRIER %s command failed on node %s "
+								"with error %s", command, handle->nodename,
+								handle->error ? handle->error : "")));
+
+			/* Done with this one, fill in the gap with the last one */
+			pending[i] = pending[--pending_count];
 		}
-
-		handle->outBuffer[handle->outEnd++] = 'b';
-		msglen = htonl(msglen);
-		memcpy(handle->outBuffer + handle->outEnd, &msglen, 4);
-		handle->outEnd += 4;
-
-		handle->outBuffer[handle->outEnd++] = CREATE_BARRIER_END;
-
-		memcpy(handle->outBuffer + handle->outEnd, id, barrier_idlen);
-		handle->outEnd += barrier_idlen;
-
-		PGXCNodeSetConnectionState(handle, DN_CONNECTION_STATE_QUERY);
-		pgxc_node_flush(handle);
 	}
 
+	pfree(pending);
+
+	elog(DEBUG2, "Successfully completed CREATE BARRIER <%s> %s command on "
+				 "all nodes", id, command);
 }
 
 /*
@@ -303,11 +286,9 @@ SendBarrierEndRequest(PGXCNodeAllHandles *coord_handles, const char *id)
  *
  * Any errors will be reported via ereport.
  */
-static PGXCNodeAllHandles *
-PrepareBarrier(const char *id)
+static void
+PrepareBarrier(PGXCNodeHandle **coord_handles, int co_count, const char *id)
 {
-	PGXCNodeAllHandles *coord_handles;
-
 	elog(DEBUG2, "Preparing Coordinators for BARRIER");
 
 	/*
@@ -315,12 +296,13 @@ PrepareBarrier(const char *id)
 	 * send an asynchronous request so that we can disable local commits and
 	 * then wait for the remote Coordinators to finish the work
 	 */
-	coord_handles = SendBarrierPrepareRequest(GetAllCoordNodes(), id);
+	SendBarrierRequest(coord_handles, co_count, CREATE_BARRIER_PREPARE, id);
 
 	/*
 	 * Disable local commits
 	 */
 	LWLockAcquire(BarrierLock, LW_EXCLUSIVE);
+	INSTR_TIME_SET_CURRENT(barrier_prepared_at);
 
 	elog(DEBUG2, "Disabled 2PC commits originating at the driving Coordinator");
 
@@ -332,9 +314,7 @@ PrepareBarrier(const char *id)
 	 * Local in-flight commits are now over. Check status of the remote
 	 * Coordinators
 	 */
-	CheckBarrierCommandStatus(coord_handles, id, "PREPARE");
-
-	return coord_handles;
+	CheckBarrierCommandStatus(coord_handles, co_count, id, "PREPARE");
 }
 
 /*
@@ -342,72 +322,18 @@ PrepareBarrier(const char *id)
  * Coordinators.
  */
 static void
-ExecuteBarrier(const char *id)
+ExecuteBarrier(PGXCNodeHandle **handles, int count, const char *id)
 {
-	List *barrierDataNodeList = GetAllDataNodes();
-	List *barrierCoordList = GetAllCoordNodes();
-	PGXCNodeAllHandles *conn_handles;
-	int conn;
-	int msglen;
-	int barrier_idlen;
-
-	conn_handles = get_handles(barrierDataNodeList, barrierCoordList, false, true);
-
 	elog(DEBUG2, "Sending CREATE BARRIER <%s> EXECUTE message to "
 				 "Datanodes and Coordinator", id);
 	/*
 	 * Send a CREATE BARRIER request to all the Datanodes and the Coordinators
 	 */
-	for (conn = 0; conn < conn_handles->co_conn_count + conn_handles->dn_conn_count; conn++)
-	{
-		PGXCNodeHandle *handle;
-
-		if (conn < conn_handles->co_conn_count)
-			handle = conn_handles->coord_handles[conn];
-		else
-			handle = conn_handles->datanode_handles[conn - conn_handles->co_conn_count];
-
-		/* Invalid connection state, return error */
-		if (handle->state != DN_CONNECTION_STATE_IDLE)
-			ereport(ERROR,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("Failed to send CREATE BARRIER EXECUTE request "
-						 	"to the node")));
-
-		barrier_idlen = strlen(id) + 1;
-
-		msglen = 4; /* for the length itself */
-		msglen += barrier_idlen;
-		msglen += 1; /* for barrier command itself */
-
-		/* msgType + msgLen */
-		if (ensure_out_buffer_capacity(handle->outEnd + 1 + msglen, handle) != 0)
-		{
-			ereport(ERROR,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("Out of memory")));
-		}
-
-		handle->outBuffer[handle->outEnd++] = 'b';
-		msglen = htonl(msglen);
-		memcpy(handle->outBuffer + handle->outEnd, &msglen, 4);
-		handle->outEnd += 4;
-
-		handle->outBuffer[handle->outEnd++] = CREATE_BARRIER_EXECUTE;
-
-		memcpy(handle->outBuffer + handle->outEnd, id, barrier_idlen);
-		handle->outEnd += barrier_idlen;
-
-		PGXCNodeSetConnectionState(handle, DN_CONNECTION_STATE_QUERY);
-		pgxc_node_flush(handle);
-	}
-
-	CheckBarrierCommandStatus(conn_handles, id, "EXECUTE");
-
-	pfree_pgxc_all_handles(conn_handles);
+	SendBarrierRequest(handles, count, CREATE_BARRIER_EXECUTE, id);
 
 	/*
-	 * Also WAL log the BARRIER locally and flush the WAL buffers to disk
+	 * Also WAL log the BARRIER locally and flush the WAL buffers to disk,
+	 * while the other nodes are doing the same
 	 */
 	{
 		XLogRecPtr recptr;
@@ -418,27 +344,47 @@ ExecuteBarrier(const char *id)
 		recptr = XLogInsert(RM_BARRIER_ID, XLOG_BARRIER_CREATE);
 		XLogFlush(recptr);
 	}
+
+	CheckBarrierCommandStatus(handles, count, id, "EXECUTE");
 }
 
 /*
- * Resume 2PC commits on the local as well as remote Coordinators.
+ * Resume 2PC commits on the local as well as remote Coordinators. The
+ * responses of the remote Coordinators are not waited for here, the caller
+ * is expected to collect them. Returns for how long the local commits have
+ * been blocked, in milliseconds.
  */
-static void
-EndBarrier(PGXCNodeAllHandles *prepared_handles, const char *id)
+static double
+EndBarrier(PGXCNodeHandle **coord_handles, int co_count, const char *id)
 {
+	instr_time	stall;
+
 	/* Resume 2PC locally */
 	LWLockRelease(BarrierLock);
 
-	SendBarrierEndRequest(prepared_handles, id);
+	INSTR_TIME_SET_CURRENT(stall);
+	INSTR_TIME_SUBTRACT(stall, barrier_prepared_at);
+
+	elog(DEBUG2, "Sending CREATE BARRIER <%s> END command to all Coordinators", id);
+
+	SendBarrierRequest(coord_handles, co_count, CREATE_BARRIER_END, id);
 
-	CheckBarrierCommandStatus(prepared_handles, id, "END");
+	return INSTR_TIME_GET_MILLISEC(stall);
 }
 
 void
 RequestBarrier(const char *id, char *completionTag)
 {
-	PGXCNodeAllHandles *prepared_handles;
+	PGXCNodeAllHandles *conn_handles;
+	PGXCNodeHandle **handles;
+	int			co_count;
+	int			count;
 	const char *barrier_id;
+	instr_time	start;
+	instr_time	prepared;
+	instr_time	executed;
+	instr_time	ended;
+	double		stall;
 
 	elog(DEBUG2, "CREATE BARRIER request received");
 	/*
@@ -462,26 +408,62 @@ RequestBarrier(const char *id, char *completionTag)
 
 	elog(DEBUG2, "CREATE BARRIER <%s>", barrier_id);
 
+	/*
+	 * Get the connections to all the nodes up front, so that the pooler is
+	 * not consulted while commits are blocked. The Coordinators go first in
+	 * the array, they are the only ones involved in the prepare and end
+	 * steps.
+	 */
+	conn_handles = get_handles(GetAllDataNodes(), GetAllCoordNodes(), false, true);
+	co_count = conn_handles->co_conn_count;
+	count = co_count + conn_handles->dn_conn_count;
+	handles = (PGXCNodeHandle **) palloc(count * sizeof(PGXCNodeHandle *));
+	memcpy(handles, conn_handles->coord_handles,
+		   co_count * sizeof(PGXCNodeHandle *));
+	memcpy(handles + co_count, conn_handles->datanode_handles,
+		   conn_handles->dn_conn_count * sizeof(PGXCNodeHandle *));
+
+	INSTR_TIME_SET_CURRENT(start);
+
 	/*
 	 * Step One. Prepare all Coordinators for upcoming barrier request
 	 */
-	prepared_handles = PrepareBarrier(barrier_id);
+	PrepareBarrier(handles, co_count, barrier_id);
+	INSTR_TIME_SET_CURRENT(prepared);
 
 	/*
 	 * Step two. Issue BARRIER command to all involved components, including
 	 * Coordinators and Datanodes
 	 */
-	ExecuteBarrier(barrier_id);
+	ExecuteBarrier(handles, count, barrier_id);
+	INSTR_TIME_SET_CURRENT(executed);
 
 	/*
-	 * Step three. Inform Coordinators about a successfully completed barrier
+	 * Step three. Inform Coordinators about a successfully completed barrier.
+	 * Commits may proceed from now on, so report the barrier to GTM to backup
+	 * its restart point while the Coordinators acknowledge.
 	 */
-	EndBarrier(prepared_handles, barrier_id);
-	/* Finally report the barrier to GTM to backup its restart point */
+	stall = EndBarrier(handles, co_count, barrier_id);
 	ReportBarrierGTM(barrier_id);
+	CheckBarrierCommandStatus(handles, co_count, barrier_id, "END");
+	INSTR_TIME_SET_CURRENT(ended);
 
 	/* Free the handles */
-	pfree_pgxc_all_handles(prepared_handles);
+	pfree(handles);
+	pfree_pgxc_all_handles(conn_handles);
+
+	INSTR_TIME_SUBTRACT(ended, executed);
+	INSTR_TIME_SUBTRACT(executed, prepared);
+	INSTR_TIME_SUBTRACT(prepared, start);
+
+	ereport(LOG,
+			(errmsg("barrier \"%s\" created", barrier_id),
+			 errdetail("Commits were blocked for %.3f ms: "
+					   "prepare=%.3f ms, execute=%.3f ms, end=%.3f ms.",
+					   stall,
+					   INSTR_TIME_GET_MILLISEC(prepared),
+					   INSTR_TIME_GET_MILLISEC(executed),
+					   INSTR_TIME_GET_MILLISEC(ended))));
 
 	if (completionTag)
 		snprintf(completionTag, COMPLETION_TAG_BUFSIZE, "BARRIER %s", barrier_id);
@@ -0,0 +1,1136 @@
+/*-------------------------------------------------------------------------
+ *
+ * resolver.c
+ *
+ *	  Resolution of in-doubt two-phase transactions by the Coordinators
+ *
+ * A transaction committed with implicit two-phase commit stays prepared on
+ * the nodes if its Coordinator fails between PREPARE and COMMIT PREPARED.
+ * It keeps its locks and holds back the global xmin until somebody finishes
+ * it.  The 2PC resolver of a Coordinator finishes the transactions the
+ * Coordinator originated, so after a crash they go away once the
+ * Coordinator is back, without running pgxc_clean.
+ *
+ * A prepared transaction can only be finished from its database, so a
+ * launcher, connected to no database, starts a worker for each database in
+ * turn.  A worker lists the in-doubt transactions and the outcome of their
+ * participants with two queries sent to all the nodes at once, decides the
+ * way pgxc_clean does, and finishes the transactions in batches: every node
+ * is sent the commands for all the transactions of a batch it takes part in
+ * at once, before the answers are read.  A transaction is finished with a
+ * GXID from the GID data GTM keeps for it, fetched for the whole batch in
+ * one message.
+ *
+ * A transaction is left alone while its Coordinator may still be committing
+ * it: the backend running the implicit 2PC still holds the GXID, or keeps
+ * the local prepared transaction locked, or is still connected to GTM.
+ *
+ * Portions Copyright (c) 2012-2014, TransLattice, Inc.
+ *
+ * IDENTIFICATION
+ *	  src/backend/pgxc/cluster/resolver.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <signal.h>
+
+#include "access/gtm.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/twophase.h"
+#include "access/xact.h"
+#include "catalog/pg_database.h"
+#include "catalog/pg_type.h"
+#include "catalog/pgxc_node.h"
+#include "commands/dbcommands.h"
+#include "executor/executor.h"
+#include "executor/spi.h"
+#include "funcapi.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "pgstat.h"
+#include "pgxc/execRemote.h"
+#include "pgxc/nodemgr.h"
+#include "pgxc/pgxc.h"
+#include "pgxc/pgxcnode.h"
+#include "pgxc/planner.h"
+#include "pgxc/resolver.h"
+#include "postmaster/bgworker.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/procarray.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
+
+/* GUC variables, in seconds */
+int			twophase_resolver_naptime = 60;
+int			twophase_resolver_min_age = 60;
+
+/*
+ * Transactions finished at once.  Their commands and answers must fit in
+ * the socket buffers of a connection, we only read once all are sent.
+ */
+#define RESOLVER_BATCH_SIZE	1000
+
+/* The GIDs of implicit 2PC, see GetImplicit2PCGID() */
+#define IMPLICIT_2PC_HEAD	"_$XC$"
+
+/* What a participant did with an in-doubt transaction */
+#define PART_UNKNOWN		'\0'
+#define PART_PREPARED		'p'
+#define PART_COMMITTED		'c'
+#define PART_ABORTED		'a'
+#define PART_INPROGRESS		'i'
+
+typedef struct InDoubtTxn
+{
+	GlobalTransactionId gxid;	/* hash key, from the GID */
+	char	   *gid;
+	bool		old_enough;		/* prepared at least min_age ago */
+	int			nparts;			/* number of participants */
+	int32	   *parts;			/* their node identifiers, from the GID */
+	char	   *partstates;		/* what each of them did */
+	bool		local;			/* prepared on this Coordinator */
+	List	   *dnlist;			/* indexes of the Datanodes it is prepared on */
+	List	   *colist;			/* and of the other Coordinators */
+	bool		commit;			/* decision */
+	bool		skipped;		/* still attached on GTM */
+	bool		failed;			/* could not be finished on some node */
+	GlobalTransactionId finish_gxid;	/* from the GID data of GTM */
+	GlobalTransactionId prepare_gxid;
+} InDoubtTxn;
+
+/* What the resolver does with an in-doubt transaction */
+typedef enum ResolverAction
+{
+	RESOLVER_COMMIT,
+	RESOLVER_ROLLBACK,
+	RESOLVER_TOO_RECENT,		/* prepared less than min_age ago */
+	RESOLVER_IN_PROGRESS,		/* still being finished by somebody */
+	RESOLVER_ATTACHED,			/* its session is still connected to GTM */
+	RESOLVER_UNKNOWN,			/* prepared on none of its participants */
+	RESOLVER_INCONSISTENT		/* committed on some nodes, aborted on others */
+} ResolverAction;
+
+/* As reported by pgxc_in_doubt_xacts() */
+static const char *const resolver_action_names[] = {
+	"commit",
+	"rollback",
+	"too recent",
+	"in progress",
+	"attached",
+	"unknown",
+	"inconsistent"
+};
+
+static volatile sig_atomic_t got_SIGHUP = false;
+
+static void resolver_sighup(SIGNAL_ARGS);
+static void resolver_init_node(void);
+static List *resolver_query_all_nodes(const char *sql, int natts);
+static bool resolver_parse_gid(const char *gid, InDoubtTxn *txn);
+static int32 resolver_node_identifier(const char *nodename);
+static void resolver_set_state(InDoubtTxn *txn, int32 nodeid, char state);
+static HTAB *resolver_collect(int min_age);
+static bool resolver_in_progress(InDoubtTxn *txn);
+static ResolverAction resolver_decide(InDoubtTxn *txn);
+static void resolver_get_gid_data(List *txns);
+static void resolver_finish_batch(List *batch, int *committed, int *aborted,
+					  int *failed, int *skipped);
+static List *resolver_databases(void);
+
+/*
+ * Register the launcher of the 2PC resolver, on Coordinators only
+ */
+void
+TwoPhaseResolverRegister(void)
+{
+	BackgroundWorker bgw;
+
+	if (!IS_PGXC_COORDINATOR)
+		return;
+
+	memset(&bgw, 0, sizeof(bgw));
+	/* Connected to no database, it only reads pg_database */
+	bgw.bgw_flags = BGWORKER_SHMEM_ACCESS |
+		BGWORKER_BACKEND_DATABASE_CONNECTION;
+	bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "TwoPhaseResolverLauncherMain");
+	snprintf(bgw.bgw_name, BGW_MAXLEN, "2PC resolver launcher");
+	bgw.bgw_restart_time = 10;
+	bgw.bgw_notify_pid = 0;
+	bgw.bgw_main_arg = (Datum) 0;
+
+	RegisterBackgroundWorker(&bgw);
+}
+
+static void
+resolver_sighup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/*
+ * Get ready to run queries on the other nodes
+ */
+static void
+resolver_init_node(void)
+{
+	StartTransactionCommand();
+	InitMultinodeExecutor(false);
+	CommitTransactionCommand();
+
+	/* If we exit, first try and clean connections and send to pool */
+	on_proc_exit(PGXCNodeCleanAndRelease, 0);
+}
+
+/*
+ * Run a query returning text columns on all the nodes of the cluster, this
+ * Coordinator included, and return the rows as arrays of strings, NULL for
+ * the null values.  The first column is expected to be the node name.  The
+ * caller must be in a transaction with an active snapshot.
+ */
+static List *
+resolver_query_all_nodes(const char *sql, int natts)
+{
+	MemoryContext callercxt = CurrentMemoryContext;
+	MemoryContext oldcxt;
+	List	   *rows = NIL;
+	RemoteQuery *step;
+	RemoteQueryState *node;
+	EState	   *estate;
+	TupleTableSlot *result;
+	uint64		r;
+	int			i;
+
+	/* This Coordinator */
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+	if (SPI_execute(sql, true, 0) != SPI_OK_SELECT)
+		elog(ERROR, "could not run query of the 2PC resolver: %s", sql);
+	for (r = 0; r < SPI_processed; r++)
+	{
+		char	  **row = MemoryContextAlloc(callercxt, natts * sizeof(char *));
+
+		for (i = 0; i < natts; i++)
+		{
+			char	   *value = SPI_getvalue(SPI_tuptable->vals[r],
+											 SPI_tuptable->tupdesc, i + 1);
+
+			row[i] = value ? MemoryContextStrdup(callercxt, value) : NULL;
+		}
+		oldcxt = MemoryContextSwitchTo(callercxt);
+		rows = lappend(rows, row);
+		MemoryContextSwitchTo(oldcxt);
+	}
+	SPI_finish();
+
+	/* All the other nodes at once */
+	step = makeNode(RemoteQuery);
+	step->combine_type = COMBINE_TYPE_NONE;
+	step->exec_nodes = NULL;
+	step->sql_statement = (char *) sql;
+	step->exec_type = EXEC_ON_ALL_NODES;
+	for (i = 0; i < natts; i++)
+		step->scan.plan.targetlist = lappend(step->scan.plan.targetlist,
+											 makeTargetEntry((Expr *) makeVar(1, i + 1, TEXTOID, -1, InvalidOid, 0),
+															 i + 1, NULL, false));
+
+	estate = CreateExecutorState();
+	MemoryContextSwitchTo(estate->es_query_cxt);
+	estate->es_snapshot = GetActiveSnapshot();
+	node = ExecInitRemoteQuery(step, estate, 0);
+	MemoryContextSwitchTo(callercxt);
+
+	while ((result = ExecRemoteQuery((PlanState *) node)) != NULL &&
+		   !TupIsNull(result))
+	{
+		char	  **row = palloc(natts * sizeof(char *));
+
+		slot_getallattrs(result);
+		for (i = 0; i < natts; i++)
+			row[i] = result->tts_isnull[i] ? NULL :
+				TextDatumGetCString(result->tts_values[i]);
+		rows = lappend(rows, row);
+	}
+	ExecEndRemoteQuery(node);
+	FreeExecutorState(estate);
+
+	return rows;
+}
+
+/*
+ * Read the GXID and the participants out of the GID of an implicit 2PC,
+ * "_$XC$gxid:coordinator:T|F:ndatanodes:ncoordinators:nodeid:...". Returns
+ * false if the transaction was not started by this Coordinator.
+ */
+static bool
+resolver_parse_gid(const char *gid, InDoubtTxn *txn)
+{
+	char	   *fields;
+	char	   *field;
+	int			ndn;
+	int			nco;
+	int			i;
+
+	if (strncmp(gid, IMPLICIT_2PC_HEAD, strlen(IMPLICIT_2PC_HEAD)) != 0)
+		return false;
+
+	fields = pstrdup(gid + strlen(IMPLICIT_2PC_HEAD));
+	if ((field = strtok(fields, ":")) == NULL)
+		return false;
+	txn->gxid = (GlobalTransactionId) strtoul(field, NULL, 10);
+
+	if ((field = strtok(NULL, ":")) == NULL ||
+		strcmp(field, PGXCNodeName) != 0)
+		return false;
+
+	/* Whether this Coordinator took part, it is in the list anyway */
+	if (strtok(NULL, ":") == NULL)
+		return false;
+	if ((field = strtok(NULL, ":")) == NULL)
+		return false;
+	ndn = atoi(field);
+	if ((field = strtok(NULL, ":")) == NULL)
+		return false;
+	nco = atoi(field);
+	if (ndn < 0 || nco < 0)
+		return false;
+
+	txn->nparts = ndn + nco;
+	txn->parts = (int32 *) palloc(txn->nparts * sizeof(int32));
+	txn->partstates = (char *) palloc0(txn->nparts * sizeof(char));
+	for (i = 0; i < txn->nparts; i++)
+	{
+		if ((field = strtok(NULL, ":")) == NULL)
+			return false;
+		txn->parts[i] = atoi(field);
+	}
+
+	pfree(fields);
+	return true;
+}
+
+/*
+ * Identifier of a node, as found in the GIDs
+ */
+static int32
+resolver_node_identifier(const char *nodename)
+{
+	Oid			nodeoid;
+
+	if (strcmp(nodename, PGXCNodeName) == 0)
+		return (int32) PGXCNodeIdentifier;
+
+	nodeoid = get_pgxc_nodeoid(nodename);
+	if (!OidIsValid(nodeoid))
+		return 0;
+	return (int32) get_pgxc_node_id(nodeoid);
+}
+
+static void
+resolver_set_state(InDoubtTxn *txn, int32 nodeid, char state)
+{
+	int			i;
+
+	for (i = 0; i < txn->nparts; i++)
+	{
+		if (txn->parts[i] == nodeid && txn->partstates[i] != PART_PREPARED)
+			txn->partstates[i] = state;
+	}
+}
+
+/*
+ * Find the in-doubt transactions this Coordinator started in the current
+ * database, and what their participants did with them.  Those prepared less
+ * than min_age seconds ago are not old enough to be finished.
+ */
+static HTAB *
+resolver_collect(int min_age)
+{
+	HASHCTL		ctl;
+	HTAB	   *txns;
+	HASH_SEQ_STATUS status;
+	InDoubtTxn *txn;
+	StringInfoData query;
+	List	   *rows;
+	ListCell   *lc;
+	bool		found;
+	bool		first = true;
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(GlobalTransactionId);
+	ctl.entrysize = sizeof(InDoubtTxn);
+	ctl.hcxt = CurrentMemoryContext;
+	txns = hash_create("In-doubt transactions", 256, &ctl,
+					   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	initStringInfo(&query);
+	appendStringInfo(&query,
+					 "SELECT pg_catalog.pgxc_node_str()::text, gid, "
+					 "(prepared <= now() - interval '%d s')::text "
+					 "FROM pg_catalog.pg_prepared_xacts "
+					 "WHERE database = current_database() "
+					 "AND gid LIKE '!_$XC$%%' ESCAPE '!'",
+					 min_age);
+	rows = resolver_query_all_nodes(query.data, 3);
+
+	foreach(lc, rows)
+	{
+		char	  **row = (char **) lfirst(lc);
+		InDoubtTxn	parsed;
+		int32		nodeid;
+
+		if (row[0] == NULL || row[1] == NULL)
+			continue;
+
+		memset(&parsed, 0, sizeof(parsed));
+		if (!resolver_parse_gid(row[1], &parsed))
+			continue;
+
+		txn = (InDoubtTxn *) hash_search(txns, &parsed.gxid, HASH_ENTER,
+										 &found);
+		if (!found)
+		{
+			txn->gid = pstrdup(row[1]);
+			txn->old_enough = false;
+			txn->nparts = parsed.nparts;
+			txn->parts = parsed.parts;
+			txn->partstates = parsed.partstates;
+			txn->local = false;
+			txn->dnlist = NIL;
+			txn->colist = NIL;
+			txn->commit = false;
+			txn->skipped = false;
+			txn->failed = false;
+			txn->finish_gxid = InvalidGlobalTransactionId;
+			txn->prepare_gxid = InvalidGlobalTransactionId;
+		}
+
+		if (row[2] && strcmp(row[2], "true") == 0)
+			txn->old_enough = true;
+
+		/* Where to finish it */
+		if (strcmp(row[0], PGXCNodeName) == 0)
+			txn->local = true;
+		else
+		{
+			char		nodetype = PGXC_NODE_NONE;
+			int			nodeidx = PGXCNodeGetNodeIdFromName(row[0], &nodetype);
+
+			if (nodetype == PGXC_NODE_COORDINATOR)
+				txn->colist = lappend_int(txn->colist, nodeidx);
+			else if (nodetype == PGXC_NODE_DATANODE)
+				txn->dnlist = lappend_int(txn->dnlist, nodeidx);
+		}
+
+		nodeid = resolver_node_identifier(row[0]);
+		resolver_set_state(txn, nodeid, PART_PREPARED);
+	}
+
+	/*
+	 * Ask all the nodes at once about the participants the transactions
+	 * are not prepared on: they may have committed or aborted it already, or
+	 * never heard about it.
+	 */
+	resetStringInfo(&query);
+	appendStringInfoString(&query,
+						   "SELECT pg_catalog.pgxc_node_str()::text, x::text, "
+						   "pg_catalog.pgxc_is_committed(x)::text, "
+						   "pg_catalog.pgxc_is_inprogress(x)::text "
+						   "FROM unnest('{");
+	hash_seq_init(&status, txns);
+	while ((txn = (InDoubtTxn *) hash_seq_search(&status)) != NULL)
+	{
+		if (!txn->old_enough ||
+			memchr(txn->partstates, PART_UNKNOWN, txn->nparts) == NULL)
+			continue;
+		appendStringInfo(&query, "%s%u", first ? "" : ",", txn->gxid);
+		first = false;
+	}
+	appendStringInfoString(&query, "}'::xid[]) x");
+
+	if (first)
+		return txns;
+
+	rows = resolver_query_all_nodes(query.data, 4);
+	foreach(lc, rows)
+	{
+		char	  **row = (char **) lfirst(lc);
+		GlobalTransactionId gxid;
+		char		state;
+
+		if (row[0] == NULL || row[1] == NULL)
+			continue;
+
+		gxid = (GlobalTransactionId) strtoul(row[1], NULL, 10);
+		txn = (InDoubtTxn *) hash_search(txns, &gxid, HASH_FIND, NULL);
+		if (txn == NULL)
+			continue;
+
+		if (row[2])
+			state = strcmp(row[2], "true") == 0 ? PART_COMMITTED : PART_ABORTED;
+		else if (row[3] && strcmp(row[3], "true") == 0)
+			state = PART_INPROGRESS;
+		else
+			continue;
+
+		resolver_set_state(txn, resolver_node_identifier(row[0]), state);
+	}
+
+	return txns;
+}
+
+/*
+ * Is the backend that started the transaction still committing it?
+ *
+ * Once the transaction is prepared here, that backend keeps it locked until
+ * it finishes it, see PrepareTransaction.  Otherwise the backend still runs
+ * the GXID while the remote nodes commit.
+ */
+static bool
+resolver_in_progress(InDoubtTxn *txn)
+{
+	if (txn->local)
+		return PreparedTransactionIsBusy(txn->gid);
+	return TransactionIdIsInProgress(txn->gxid);
+}
+
+/*
+ * Decide what to do with an in-doubt transaction, as pgxc_clean does.
+ * Anything but RESOLVER_COMMIT and RESOLVER_ROLLBACK leaves it alone.
+ */
+static ResolverAction
+resolver_decide(InDoubtTxn *txn)
+{
+	bool		prepared = false;
+	bool		committed = false;
+	bool		aborted = false;
+	int			i;
+
+	if (!txn->old_enough)
+		return RESOLVER_TOO_RECENT;
+	if (resolver_in_progress(txn))
+		return RESOLVER_IN_PROGRESS;
+
+	for (i = 0; i < txn->nparts; i++)
+	{
+		switch (txn->partstates[i])
+		{
+			case PART_PREPARED:
+				prepared = true;
+				break;
+			case PART_COMMITTED:
+				committed = true;
+				break;
+			case PART_INPROGRESS:
+				/* Somebody is still working on it */
+				return RESOLVER_IN_PROGRESS;
+			default:
+				/* Aborted, or the PREPARE never made it there */
+				aborted = true;
+				break;
+		}
+	}
+
+	if (!prepared)
+		return RESOLVER_UNKNOWN;
+
+	if (committed && aborted)
+	{
+		ereport(WARNING,
+				(errmsg("prepared transaction \"%s\" is committed on some "
+						"nodes and aborted on others", txn->gid),
+				 errhint("Resolve it by hand with xc_maintenance_mode.")));
+		return RESOLVER_INCONSISTENT;
+	}
+
+	/* Prepared everywhere: the Coordinator was about to commit it */
+	txn->commit = !aborted;
+	return txn->commit ? RESOLVER_COMMIT : RESOLVER_ROLLBACK;
+}
+
+/*
+ * Get from GTM the GXIDs to finish the transactions with, for all of them in
+ * as few round trips as possible.  The transactions whose session is still
+ * connected to GTM are marked skipped, they are left alone.
+ *
+ * GTM hands out a GXID to finish a transaction with, unless it lost track of
+ * it, in which case it is finished without one.
+ */
+static void
+resolver_get_gid_data(List *txns)
+{
+	int			count = list_length(txns);
+	char	  **gids;
+	GlobalTransactionId *gxids;
+	GlobalTransactionId *prepared_gxids;
+	bool	   *attached;
+	ListCell   *lc;
+	int			i;
+
+	if (count == 0)
+		return;
+
+	gids = (char **) palloc(count * sizeof(char *));
+	gxids = (GlobalTransactionId *) palloc(count * sizeof(GlobalTransactionId));
+	prepared_gxids = (GlobalTransactionId *)
+		palloc(count * sizeof(GlobalTransactionId));
+	attached = (bool *) palloc(count * sizeof(bool));
+
+	i = 0;
+	foreach(lc, txns)
+		gids[i++] = ((InDoubtTxn *) lfirst(lc))->gid;
+
+	for (i = 0; i < count; i += GTM_MAX_GLOBAL_TRANSACTIONS)
+	{
+		int			n = Min(count - i, GTM_MAX_GLOBAL_TRANSACTIONS);
+
+		if (GetGIDDataGTMMulti(n, gids + i, gxids + i, prepared_gxids + i,
+							   attached + i) < 0)
+		{
+			memset(gxids + i, 0, n * sizeof(GlobalTransactionId));
+			memset(prepared_gxids + i, 0, n * sizeof(GlobalTransactionId));
+			memset(attached + i, 0, n * sizeof(bool));
+		}
+	}
+
+	i = 0;
+	foreach(lc, txns)
+	{
+		InDoubtTxn *txn = (InDoubtTxn *) lfirst(lc);
+
+		txn->finish_gxid = gxids[i];
+		txn->prepare_gxid = prepared_gxids[i];
+		if (attached[i])
+		{
+			RollbackTranGTM(txn->finish_gxid);
+			txn->finish_gxid = InvalidGlobalTransactionId;
+			txn->prepare_gxid = InvalidGlobalTransactionId;
+			txn->skipped = true;
+		}
+		i++;
+	}
+
+	pfree(gids);
+	pfree(gxids);
+	pfree(prepared_gxids);
+	pfree(attached);
+}
+
+/*
+ * Finish a batch of transactions on all their nodes.  Every node is sent the
+ * COMMIT PREPARED or ROLLBACK PREPARED of all the transactions of the batch
+ * it takes part in at once, on its connection, then the answers are read in
+ * the same order.
+ */
+static void
+resolver_finish_batch(List *batch, int *committed, int *aborted, int *failed,
+					  int *skipped)
+{
+	PGXCNodeHandle **connections;
+	List	  **owners;
+	int			conn_count = 0;
+	TimestampTz commit_ts = 0;
+	ResponseCombiner combiner;
+	ListCell   *lc;
+	int			i;
+
+	StartTransactionCommand();
+
+	connections = (PGXCNodeHandle **)
+		palloc((NumDataNodes + NumCoords) * sizeof(PGXCNodeHandle *));
+	owners = (List **) palloc((NumDataNodes + NumCoords) * sizeof(List *));
+
+	resolver_get_gid_data(batch);
+
+	foreach(lc, batch)
+	{
+		InDoubtTxn *txn = (InDoubtTxn *) lfirst(lc);
+		PGXCNodeAllHandles *handles;
+		char	   *finish_cmd;
+
+		if (txn->skipped)
+			continue;
+
+#ifdef XCP
+		/* All the transactions of the batch commit at the same time */
+		if (txn->commit && commit_ts == 0)
+			commit_ts = AssignXactCommitTimestamp();
+#endif
+
+		if (txn->dnlist == NIL && txn->colist == NIL)
+			continue;
+
+		handles = get_handles(txn->dnlist, txn->colist, false, true);
+		finish_cmd = psprintf("%s PREPARED '%s'",
+							  txn->commit ? "COMMIT" : "ROLLBACK", txn->gid);
+
+		for (i = 0; i < handles->dn_conn_count + handles->co_conn_count; i++)
+		{
+			PGXCNodeHandle *conn;
+			int			j;
+
+			if (i < handles->dn_conn_count)
+				conn = handles->datanode_handles[i];
+			else
+				conn = handles->coord_handles[i - handles->dn_conn_count];
+
+			if ((GlobalTransactionIdIsValid(txn->finish_gxid) &&
+				 pgxc_node_send_gxid(conn, txn->finish_gxid)) ||
+#ifdef XCP
+				(txn->commit && commit_ts != 0 &&
+				 pgxc_node_send_commit_timestamp(conn, commit_ts)) ||
+#endif
+				pgxc_node_send_query(conn, finish_cmd))
+				ereport(ERROR,
+						(errcode(ERRCODE_INTERNAL_ERROR),
+						 errmsg("failed to send %s PREPARED command to the node %s",
+								txn->commit ? "COMMIT" : "ROLLBACK",
+								conn->nodename)));
+
+			/*
+			 * More commands may follow before the answers are read, keep
+			 * the connection ready to send. The answers of a node come in
+			 * the order of the commands.
+			 */
+			PGXCNodeSetConnectionState(conn, DN_CONNECTION_STATE_IDLE);
+			for (j = 0; j < conn_count; j++)
+				if (connections[j] == conn)
+					break;
+			if (j == conn_count)
+			{
+				connections[conn_count] = conn;
+				owners[conn_count++] = NIL;
+			}
+			owners[j] = lappend(owners[j], txn);
+		}
+		pfree(finish_cmd);
+		pfree_pgxc_all_handles(handles);
+	}
+
+	/* Wait for all the nodes, in the order they answer */
+	for (i = 0; i < conn_count; i++)
+		PGXCNodeSetConnectionState(connections[i], DN_CONNECTION_STATE_QUERY);
+	InitResponseCombiner(&combiner, conn_count, COMBINE_TYPE_NONE);
+	while (conn_count > 0)
+	{
+		i = 0;
+
+		if (pgxc_node_receive(conn_count, connections, NULL))
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("Failed to receive response from the remote side")));
+
+		while (i < conn_count)
+		{
+			PGXCNodeHandle *conn = connections[i];
+			InDoubtTxn *owner = (InDoubtTxn *) linitial(owners[i]);
+			int			res = handle_response(conn, &combiner);
+
+			if (res == RESPONSE_EOF)
+			{
+				i++;
+				continue;
+			}
+
+			if (res == RESPONSE_ERROR)
+			{
+				ereport(WARNING,
+						(errmsg("could not finish prepared transaction \"%s\" "
+								"on node %s", owner->gid, conn->nodename),
+						 conn->error ? errdetail("%s", conn->error) : 0));
+				owner->failed = true;
+				/* Keep reading until ReadyForQuery */
+				continue;
+			}
+
+			if (conn->state == DN_CONNECTION_STATE_ERROR_FATAL)
+			{
+				/* None of the commands left got through */
+				foreach(lc, owners[i])
+					((InDoubtTxn *) lfirst(lc))->failed = true;
+				owners[i] = NIL;
+			}
+			else if (res == RESPONSE_READY)
+			{
+				owners[i] = list_delete_first(owners[i]);
+				/* Still waiting for the answers to the next commands */
+				if (owners[i] != NIL)
+				{
+					PGXCNodeSetConnectionState(conn,
+											   DN_CONNECTION_STATE_QUERY);
+					continue;
+				}
+			}
+			else
+				continue;
+
+			/* Done with this one, fill in the gap with the last one */
+			conn_count--;
+			connections[i] = connections[conn_count];
+			owners[i] = owners[conn_count];
+		}
+	}
+	CloseCombiner(&combiner);
+
+	/* Then locally, and tell GTM */
+	foreach(lc, batch)
+	{
+		InDoubtTxn *txn = (InDoubtTxn *) lfirst(lc);
+
+		if (txn->skipped)
+		{
+			(*skipped)++;
+			continue;
+		}
+
+		if (txn->failed)
+		{
+			/* Try again next time */
+			if (GlobalTransactionIdIsValid(txn->finish_gxid))
+				RollbackTranGTM(txn->finish_gxid);
+			(*failed)++;
+			continue;
+		}
+
+		if (txn->local)
+			FinishPreparedTransaction(txn->gid, txn->commit);
+
+		if (GlobalTransactionIdIsValid(txn->finish_gxid))
+		{
+			if (txn->commit)
+				CommitPreparedTranGTM(txn->prepare_gxid, txn->finish_gxid,
+									  0, NULL);
+			else
+			{
+				RollbackTranGTM(txn->prepare_gxid);
+				RollbackTranGTM(txn->finish_gxid);
+			}
+		}
+
+		if (txn->commit)
+			(*committed)++;
+		else
+			(*aborted)++;
+	}
+
+	CommitTransactionCommand();
+}
+
+/*
+ * Main of the workers, resolving the in-doubt transactions of a database
+ */
+void
+TwoPhaseResolverMain(Datum main_arg)
+{
+	Oid			dboid = DatumGetObjectId(main_arg);
+	MemoryContext resolvercxt;
+	HTAB	   *txns;
+	HASH_SEQ_STATUS status;
+	InDoubtTxn *txn;
+	List	   *pending = NIL;
+	int			committed = 0;
+	int			aborted = 0;
+	int			failed = 0;
+	int			skipped = 0;
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnectionByOid(dboid, InvalidOid);
+	resolver_init_node();
+
+	resolvercxt = AllocSetContextCreate(TopMemoryContext,
+										"2PC resolver",
+										ALLOCSET_DEFAULT_SIZES);
+
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	MemoryContextSwitchTo(resolvercxt);
+	txns = resolver_collect(twophase_resolver_min_age);
+
+	hash_seq_init(&status, txns);
+	while ((txn = (InDoubtTxn *) hash_seq_search(&status)) != NULL)
+	{
+		ResolverAction action = resolver_decide(txn);
+
+		if (action == RESOLVER_COMMIT || action == RESOLVER_ROLLBACK)
+			pending = lappend(pending, txn);
+		else if (action != RESOLVER_TOO_RECENT)
+			skipped++;
+	}
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+	MemoryContextSwitchTo(resolvercxt);
+
+	/* Batches of transactions, until they are all done */
+	while (pending != NIL)
+	{
+		List	   *batch = NIL;
+
+		CHECK_FOR_INTERRUPTS();
+
+		while (pending != NIL && list_length(batch) < RESOLVER_BATCH_SIZE)
+		{
+			batch = lappend(batch, linitial(pending));
+			pending = list_delete_first(pending);
+		}
+
+		resolver_finish_batch(batch, &committed, &aborted, &failed,
+							  &skipped);
+		MemoryContextSwitchTo(resolvercxt);
+		list_free(batch);
+	}
+
+	if (committed + aborted + failed + skipped > 0)
+		ereport(LOG,
+				(errmsg("2PC resolver finished %d in-doubt transactions in database \"%s\"",
+						committed + aborted, get_database_name(dboid)),
+				 errdetail("%d committed, %d rolled back, %d failed, %d left alone.",
+						   committed, aborted, failed, skipped)));
+
+	proc_exit(0);
+}
+
+/*
+ * The databases a worker can connect to.  The launcher is connected to no
+ * database, but it can still scan pg_database, like the autovacuum launcher.
+ */
+static List *
+resolver_databases(void)
+{
+	MemoryContext resultcxt = CurrentMemoryContext;
+	List	   *dboids = NIL;
+	Relation	rel;
+	HeapScanDesc scan;
+	HeapTuple	tup;
+
+	StartTransactionCommand();
+	(void) GetTransactionSnapshot();
+
+	rel = heap_open(DatabaseRelationId, AccessShareLock);
+	scan = heap_beginscan_catalog(rel, 0, NULL);
+
+	while (HeapTupleIsValid(tup = heap_getnext(scan, ForwardScanDirection)))
+	{
+		Form_pg_database pgdatabase = (Form_pg_database) GETSTRUCT(tup);
+		MemoryContext oldcxt;
+
+		if (!pgdatabase->datallowconn)
+			continue;
+
+		oldcxt = MemoryContextSwitchTo(resultcxt);
+		dboids = lappend_oid(dboids, HeapTupleGetOid(tup));
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	heap_endscan(scan);
+	heap_close(rel, AccessShareLock);
+
+	CommitTransactionCommand();
+
+	return dboids;
+}
+
+/*
+ * Main of the launcher: every twophase_resolver_naptime seconds, run a
+ * worker for each database, one after the other.
+ */
+void
+TwoPhaseResolverLauncherMain(Datum main_arg)
+{
+	MemoryContext launchercxt;
+
+	pqsignal(SIGHUP, resolver_sighup);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnection(NULL, NULL);
+
+	launchercxt = AllocSetContextCreate(TopMemoryContext,
+										"2PC resolver launcher",
+										ALLOCSET_DEFAULT_SIZES);
+
+	for (;;)
+	{
+		int			rc;
+		long		timeout = twophase_resolver_naptime * 1000L;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (twophase_resolver_naptime > 0)
+		{
+			List	   *dboids;
+			ListCell   *lc;
+
+			MemoryContextSwitchTo(launchercxt);
+			dboids = resolver_databases();
+			MemoryContextSwitchTo(launchercxt);
+
+			/*
+			 * One database at a time: most of them have nothing in doubt and
+			 * their worker is gone after a query, and that way the workers
+			 * never take more than one background worker slot.
+			 */
+			foreach(lc, dboids)
+			{
+				BackgroundWorker bgw;
+				BackgroundWorkerHandle *handle;
+
+				CHECK_FOR_INTERRUPTS();
+
+				memset(&bgw, 0, sizeof(bgw));
+				bgw.bgw_flags = BGWORKER_SHMEM_ACCESS |
+					BGWORKER_BACKEND_DATABASE_CONNECTION;
+				bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
+				snprintf(bgw.bgw_library_name, BGW_MAXLEN, "postgres");
+				snprintf(bgw.bgw_function_name, BGW_MAXLEN, "TwoPhaseResolverMain");
+				snprintf(bgw.bgw_name, BGW_MAXLEN,
+						 "2PC resolver for database %u", lfirst_oid(lc));
+				bgw.bgw_restart_time = BGW_NEVER_RESTART;
+				bgw.bgw_notify_pid = MyProcPid;
+				bgw.bgw_main_arg = ObjectIdGetDatum(lfirst_oid(lc));
+
+				if (RegisterDynamicBackgroundWorker(&bgw, &handle))
+					WaitForBackgroundWorkerShutdown(handle);
+				else
+					ereport(LOG,
+							(errmsg("could not start 2PC resolver for database %u, "
+									"will try again later", lfirst_oid(lc)),
+							 errhint("You might need to increase max_worker_processes.")));
+			}
+
+			MemoryContextReset(launchercxt);
+		}
+
+		rc = WaitLatch(MyLatch,
+					   WL_LATCH_SET | WL_POSTMASTER_DEATH |
+					   (timeout > 0 ? WL_TIMEOUT : 0),
+					   timeout,
+					   WAIT_EVENT_TWOPHASE_RESOLVER_MAIN);
+
+		/* emergency bailout if postmaster has died */
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+
+		if (rc & WL_LATCH_SET)
+		{
+			ResetLatch(MyLatch);
+			CHECK_FOR_INTERRUPTS();
+		}
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+	}
+}
+
+/*
+ * pgxc_in_doubt_xacts
+ *		What the 2PC resolver would do now with the in-doubt transactions this
+ *		Coordinator started in the current database, taking the transactions
+ *		prepared at least min_age seconds ago into account.
+ */
+Datum
+pgxc_in_doubt_xacts(PG_FUNCTION_ARGS)
+{
+#define IN_DOUBT_XACTS_COLS	2
+	int32		min_age = PG_GETARG_INT32(0);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+	HTAB	   *txns;
+	HASH_SEQ_STATUS status;
+	InDoubtTxn *txn;
+	List	   *all = NIL;
+	List	   *actions = NIL;
+	List	   *decided = NIL;
+	ListCell   *lc;
+	ListCell   *lc2;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to look at in-doubt transactions")));
+
+	if (!IS_PGXC_LOCAL_COORDINATOR)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("in-doubt transactions can only be looked at on a Coordinator")));
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+	MemoryContextSwitchTo(oldcontext);
+
+	txns = resolver_collect(min_age);
+
+	hash_seq_init(&status, txns);
+	while ((txn = (InDoubtTxn *) hash_seq_search(&status)) != NULL)
+	{
+		ResolverAction action = resolver_decide(txn);
+
+		if (action == RESOLVER_COMMIT || action == RESOLVER_ROLLBACK)
+			decided = lappend(decided, txn);
+		actions = lappend_int(actions, action);
+		all = lappend(all, txn);
+	}
+
+	/* Ask GTM too, and give back the GXIDs it hands out */
+	resolver_get_gid_data(decided);
+
+	forboth(lc, all, lc2, actions)
+	{
+		ResolverAction action = (ResolverAction) lfirst_int(lc2);
+		Datum		values[IN_DOUBT_XACTS_COLS];
+		bool		nulls[IN_DOUBT_XACTS_COLS];
+
+		txn = (InDoubtTxn *) lfirst(lc);
+		if (txn->skipped)
+			action = RESOLVER_ATTACHED;
+		else if ((action == RESOLVER_COMMIT || action == RESOLVER_ROLLBACK) &&
+				 GlobalTransactionIdIsValid(txn->finish_gxid))
+			RollbackTranGTM(txn->finish_gxid);
+
+		memset(nulls, 0, sizeof(nulls));
+		values[0] = CStringGetTextDatum(txn->gid);
+		values[1] = CStringGetTextDatum(resolver_action_names[action]);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+	PG_RETURN_VOID();
+}
@@ -0,0 +1,874 @@
+/*-------------------------------------------------------------------------
+ *
+ * waitstats.c
+ *
+ *	  Time spent waiting on the other components of the cluster
+ *
+ * A backend times its waits for GTM, for remote nodes, on shared queues, in
+ * the phases of 2PC and for the pooler, and accumulates them locally for the
+ * statement being run.  Before it is ready for the next command it adds them
+ * to two shared-memory tables: one per statement and one per remote node.
+ * Statements are identified by the queryId of their plan, which is the one
+ * of the Coordinator's query on the nodes running it on its behalf, or else
+ * by a hash of their text.  When the statement table is full the least used
+ * entries are evicted.  The pgxc_stat_remote_query_waits and
+ * pgxc_stat_remote_node_waits views show the tables of the node they are
+ * queried on, pgxc_stat_cluster_query_waits and pgxc_stat_cluster_node_waits
+ * those of every node, fetched by the Coordinator they are queried on.
+ *
+ * The tables are protected by RemoteWaitStatsLock: it is taken in shared
+ * mode to update existing entries, each having a spinlock of its own, and in
+ * exclusive mode to add or remove entries.
+ *
+ * Portions Copyright (c) 2012-2014, TransLattice, Inc.
+ *
+ * IDENTIFICATION
+ *	  src/backend/pgxc/cluster/waitstats.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "catalog/pg_type.h"
+#include "commands/dbcommands.h"
+#include "executor/executor.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/plannodes.h"
+#include "pgxc/execRemote.h"
+#include "pgxc/nodemgr.h"
+#include "pgxc/pgxc.h"
+#include "pgxc/pgxcnode.h"
+#include "pgxc/waitstats.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tcop/pquery.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
+#include "utils/tuplestore.h"
+
+/* GUC variables */
+bool		track_remote_waits = false;
+int			remote_wait_stats_max = 1000;
+
+/* Length of the statement text kept, longer ones are truncated */
+#define REMOTE_WAIT_QUERY_LEN	256
+
+/* Percentage of the statements evicted at once when the table is full */
+#define REMOTE_WAIT_DEALLOC_PERCENT	5
+
+static const char *const RemoteWaitClassNames[NUM_REMOTE_WAIT_CLASSES] = {
+	"gtm",
+	"receive",
+	"squeue_read",
+	"squeue_write",
+	"2pc_prepare",
+	"2pc_commit",
+	"pooler"
+};
+
+typedef struct RemoteWaitCounters
+{
+	int64		waits[NUM_REMOTE_WAIT_CLASSES];
+	double		time[NUM_REMOTE_WAIT_CLASSES];	/* in milliseconds */
+} RemoteWaitCounters;
+
+typedef struct RemoteWaitQueryKey
+{
+	Oid			dbid;
+	uint32		queryid;		/* queryId, or hash of the statement text */
+} RemoteWaitQueryKey;
+
+typedef struct RemoteWaitQueryEnt
+{
+	RemoteWaitQueryKey key;		/* hash key, must be first */
+	slock_t		mutex;
+	int64		calls;			/* statements which waited */
+	RemoteWaitCounters counters;
+	char		query[REMOTE_WAIT_QUERY_LEN];
+} RemoteWaitQueryEnt;
+
+typedef struct RemoteWaitNodeEnt
+{
+	Oid			nodeoid;		/* hash key, must be first */
+	slock_t		mutex;
+	RemoteWaitCounters counters;
+} RemoteWaitNodeEnt;
+
+static HTAB *RemoteWaitQueries = NULL;
+static HTAB *RemoteWaitNodes = NULL;
+
+/* Waits of the current statement not flushed yet */
+static bool pendingQueryValid = false;
+static const char *pendingQueryString = NULL;
+static uint32 pendingQueryId = 0;
+static char pendingQueryText[REMOTE_WAIT_QUERY_LEN];
+static RemoteWaitCounters pendingQuery;
+static RemoteWaitNodeEnt *pendingNodes = NULL;
+static int	pendingNodeCount = 0;
+static int	pendingNodeMax = 0;
+
+/* Node whose answer ended the last wait for remote nodes, and its start */
+static Oid	lastAnsweredNode = InvalidOid;
+static instr_time lastAnsweredStart;
+
+static void
+AddRemoteWaitCounters(RemoteWaitCounters *to, RemoteWaitCounters *from)
+{
+	int			i;
+
+	for (i = 0; i < NUM_REMOTE_WAIT_CLASSES; i++)
+	{
+		to->waits[i] += from->waits[i];
+		to->time[i] += from->time[i];
+	}
+}
+
+/*
+ * The queryId of the statement being run, if any. It is set by extensions
+ * like pg_stat_statements, and on the nodes running a statement on behalf of
+ * a Coordinator it is the one of the Coordinator's query.
+ */
+static uint32
+RemoteWaitQueryId(void)
+{
+	ListCell   *lc;
+
+	if (IsConnFromCoord() && PGXC_PARENT_QUERY_ID != 0)
+		return PGXC_PARENT_QUERY_ID;
+
+	if (ActivePortal == NULL)
+		return 0;
+
+	foreach(lc, ActivePortal->stmts)
+	{
+		PlannedStmt *stmt = (PlannedStmt *) lfirst(lc);
+
+		if (IsA(stmt, PlannedStmt) && stmt->queryId != 0)
+			return stmt->queryId;
+	}
+	return 0;
+}
+
+/*
+ * Find the pending counters of the given node, adding them if needed
+ */
+static RemoteWaitNodeEnt *
+PendingRemoteWaitNode(Oid nodeoid)
+{
+	RemoteWaitNodeEnt *node;
+	int			i;
+
+	for (i = 0; i < pendingNodeCount; i++)
+	{
+		if (pendingNodes[i].nodeoid == nodeoid)
+			return &pendingNodes[i];
+	}
+
+	if (pendingNodeCount == pendingNodeMax)
+	{
+		pendingNodeMax = Max(pendingNodeMax * 2, 16);
+		if (pendingNodes)
+			pendingNodes = (RemoteWaitNodeEnt *)
+				repalloc(pendingNodes,
+						 pendingNodeMax * sizeof(RemoteWaitNodeEnt));
+		else
+			pendingNodes = (RemoteWaitNodeEnt *)
+				MemoryContextAlloc(TopMemoryContext,
+								   pendingNodeMax * sizeof(RemoteWaitNodeEnt));
+	}
+	node = &pendingNodes[pendingNodeCount++];
+	memset(node, 0, sizeof(RemoteWaitNodeEnt));
+	node->nodeoid = nodeoid;
+
+	return node;
+}
+
+/*
+ * Finish timing a wait started with RemoteWaitStart and add it to the
+ * current statement. Returns the time waited in milliseconds, or -1 if the
+ * wait was not timed.
+ */
+double
+RemoteWaitEnd(RemoteWaitClass waitclass, instr_time start)
+{
+	instr_time	duration;
+	double		elapsed;
+
+	if (INSTR_TIME_IS_ZERO(start))
+		return -1;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	elapsed = INSTR_TIME_GET_MILLISEC(duration);
+
+	/*
+	 * Waits outside of a statement, like the commit of an extended protocol
+	 * transaction, belong to the last statement. Those of processes that do
+	 * not run statements are not tracked.
+	 */
+	if (debug_query_string && debug_query_string != pendingQueryString)
+	{
+		FlushRemoteWaits();
+		pendingQueryString = debug_query_string;
+		strlcpy(pendingQueryText, debug_query_string, REMOTE_WAIT_QUERY_LEN);
+	}
+	if (pendingQueryString == NULL)
+		return elapsed;
+
+	/* The queryId may only be known once the statement is executed */
+	if (pendingQueryId == 0)
+		pendingQueryId = RemoteWaitQueryId();
+	pendingQuery.waits[waitclass]++;
+	pendingQuery.time[waitclass] += elapsed;
+	pendingQueryValid = true;
+
+	return elapsed;
+}
+
+/*
+ * Finish timing a wait which was ended by the answers of the given
+ * connections. The time is split evenly between their nodes, so the time of
+ * the nodes adds up to the time waited.
+ */
+void
+RemoteWaitEndNodes(RemoteWaitClass waitclass, instr_time start,
+				   PGXCNodeHandle **answered, int nanswered)
+{
+	double		elapsed = RemoteWaitEnd(waitclass, start);
+	int			i;
+
+	if (elapsed < 0 || nanswered == 0)
+		return;
+
+	for (i = 0; i < nanswered; i++)
+	{
+		RemoteWaitNodeEnt *node = PendingRemoteWaitNode(answered[i]->nodeoid);
+
+		node->counters.waits[waitclass]++;
+		node->counters.time[waitclass] += elapsed / nanswered;
+	}
+	lastAnsweredNode = answered[nanswered - 1]->nodeoid;
+	lastAnsweredStart = start;
+}
+
+/*
+ * Finish timing a wait for the responses of several nodes, which is accounted
+ * to the node that answered last: the others were done before it.
+ */
+void
+RemoteWaitEndLastNode(RemoteWaitClass waitclass, instr_time start)
+{
+	double		elapsed = RemoteWaitEnd(waitclass, start);
+	RemoteWaitNodeEnt *node;
+	instr_time	since;
+
+	if (elapsed < 0 || !OidIsValid(lastAnsweredNode))
+		return;
+
+	/* The answers may have been read without waiting */
+	since = lastAnsweredStart;
+	INSTR_TIME_SUBTRACT(since, start);
+	if (INSTR_TIME_GET_DOUBLE(since) < 0)
+		return;
+
+	node = PendingRemoteWaitNode(lastAnsweredNode);
+	node->counters.waits[waitclass]++;
+	node->counters.time[waitclass] += elapsed;
+}
+
+static int
+remote_wait_query_cmp(const void *lhs, const void *rhs)
+{
+	int64		l_calls = (*(RemoteWaitQueryEnt *const *) lhs)->calls;
+	int64		r_calls = (*(RemoteWaitQueryEnt *const *) rhs)->calls;
+
+	if (l_calls < r_calls)
+		return -1;
+	else if (l_calls > r_calls)
+		return 1;
+	else
+		return 0;
+}
+
+/*
+ * Make room in the statement table by evicting the statements run the
+ * fewest times. The caller holds RemoteWaitStatsLock exclusively.
+ */
+static void
+RemoteWaitQueryDealloc(void)
+{
+	HASH_SEQ_STATUS hash_seq;
+	RemoteWaitQueryEnt **entries;
+	RemoteWaitQueryEnt *entry;
+	int			nentries = 0;
+	int			nvictims;
+	int			i;
+
+	entries = palloc(hash_get_num_entries(RemoteWaitQueries) *
+					 sizeof(RemoteWaitQueryEnt *));
+
+	hash_seq_init(&hash_seq, RemoteWaitQueries);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		entries[nentries++] = entry;
+
+	qsort(entries, nentries, sizeof(RemoteWaitQueryEnt *),
+		  remote_wait_query_cmp);
+
+	nvictims = Max(10, nentries * REMOTE_WAIT_DEALLOC_PERCENT / 100);
+	nvictims = Min(nvictims, nentries);
+
+	for (i = 0; i < nvictims; i++)
+		hash_search(RemoteWaitQueries, &entries[i]->key, HASH_REMOVE, NULL);
+
+	pfree(entries);
+}
+
+/*
+ * Find the entry for the given key, adding it if there is room. The caller
+ * holds RemoteWaitStatsLock in shared mode, it is held in shared mode on
+ * return as well. Both kinds of entries have their key first and their
+ * spinlock right after. The statement table is made room in if it is full.
+ */
+static void *
+RemoteWaitEntry(HTAB *htab, void *key, Size keysize, Size entrysize,
+				long max_entries, bool *added)
+{
+	void	   *entry;
+	bool		found;
+
+	*added = false;
+	entry = hash_search(htab, key, HASH_FIND, NULL);
+	if (entry)
+		return entry;
+
+	LWLockRelease(RemoteWaitStatsLock);
+	LWLockAcquire(RemoteWaitStatsLock, LW_EXCLUSIVE);
+
+	entry = hash_search(htab, key, HASH_FIND, &found);
+	if (entry == NULL && htab == RemoteWaitQueries &&
+		hash_get_num_entries(htab) >= max_entries)
+		RemoteWaitQueryDealloc();
+	if (entry == NULL && hash_get_num_entries(htab) < max_entries)
+	{
+		entry = hash_search(htab, key, HASH_ENTER_NULL, &found);
+		if (entry && !found)
+		{
+			memset((char *) entry + keysize, 0, entrysize - keysize);
+			SpinLockInit((slock_t *) ((char *) entry + keysize));
+			*added = true;
+		}
+	}
+
+	LWLockRelease(RemoteWaitStatsLock);
+	LWLockAcquire(RemoteWaitStatsLock, LW_SHARED);
+
+	/* Entries are removed only by a reset, which may just have happened */
+	if (entry)
+		entry = hash_search(htab, key, HASH_FIND, NULL);
+	return entry;
+}
+
+/*
+ * Add the waits of the last statement to the shared tables.
+ */
+void
+FlushRemoteWaits(void)
+{
+	bool		added;
+	int			i;
+
+	if (!pendingQueryValid && pendingNodeCount == 0)
+		return;
+
+	if (RemoteWaitQueries == NULL || RemoteWaitNodes == NULL)
+		goto done;
+
+	LWLockAcquire(RemoteWaitStatsLock, LW_SHARED);
+
+	if (pendingQueryValid)
+	{
+		RemoteWaitQueryKey key;
+		RemoteWaitQueryEnt *entry;
+
+		memset(&key, 0, sizeof(key));
+		key.dbid = MyDatabaseId;
+		if (pendingQueryId != 0)
+			key.queryid = pendingQueryId;
+		else
+			key.queryid = DatumGetUInt32(hash_any((const unsigned char *) pendingQueryText,
+												  strlen(pendingQueryText)));
+
+		entry = (RemoteWaitQueryEnt *)
+			RemoteWaitEntry(RemoteWaitQueries, &key, sizeof(RemoteWaitQueryKey),
+							sizeof(RemoteWaitQueryEnt), remote_wait_stats_max,
+							&added);
+		if (entry)
+		{
+			SpinLockAcquire(&entry->mutex);
+			if (added)
+				strlcpy(entry->query, pendingQueryText, REMOTE_WAIT_QUERY_LEN);
+			entry->calls++;
+			AddRemoteWaitCounters(&entry->counters, &pendingQuery);
+			SpinLockRelease(&entry->mutex);
+		}
+	}
+
+	for (i = 0; i < pendingNodeCount; i++)
+	{
+		RemoteWaitNodeEnt *entry;
+
+		entry = (RemoteWaitNodeEnt *)
+			RemoteWaitEntry(RemoteWaitNodes, &pendingNodes[i].nodeoid,
+							sizeof(Oid), sizeof(RemoteWaitNodeEnt),
+							MaxCoords + MaxDataNodes, &added);
+		if (entry)
+		{
+			SpinLockAcquire(&entry->mutex);
+			AddRemoteWaitCounters(&entry->counters, &pendingNodes[i].counters);
+			SpinLockRelease(&entry->mutex);
+		}
+	}
+
+	LWLockRelease(RemoteWaitStatsLock);
+
+done:
+	pendingQueryValid = false;
+	pendingQueryString = NULL;
+	pendingQueryId = 0;
+	memset(&pendingQuery, 0, sizeof(pendingQuery));
+	pendingNodeCount = 0;
+}
+
+Size
+RemoteWaitStatsShmemSize(void)
+{
+	Size		size;
+
+	size = hash_estimate_size(remote_wait_stats_max,
+							  sizeof(RemoteWaitQueryEnt));
+	size = add_size(size, hash_estimate_size(MaxCoords + MaxDataNodes,
+											 sizeof(RemoteWaitNodeEnt)));
+	return size;
+}
+
+void
+RemoteWaitStatsShmemInit(void)
+{
+	HASHCTL		info;
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(RemoteWaitQueryKey);
+	info.entrysize = sizeof(RemoteWaitQueryEnt);
+	RemoteWaitQueries = ShmemInitHash("Remote Wait Statements",
+									  remote_wait_stats_max,
+									  remote_wait_stats_max,
+									  &info,
+									  HASH_ELEM | HASH_BLOBS);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(Oid);
+	info.entrysize = sizeof(RemoteWaitNodeEnt);
+	RemoteWaitNodes = ShmemInitHash("Remote Wait Nodes",
+									MaxCoords + MaxDataNodes,
+									MaxCoords + MaxDataNodes,
+									&info,
+									HASH_ELEM | HASH_BLOBS);
+}
+
+/*
+ * Check the caller can take a tuplestore and set it up
+ */
+static Tuplestorestate *
+RemoteWaitTuplestore(FunctionCallInfo fcinfo, TupleDesc *tupdesc)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = *tupdesc;
+	MemoryContextSwitchTo(oldcontext);
+
+	return tupstore;
+}
+
+#define REMOTE_QUERY_WAITS_COLS	(4 + NUM_REMOTE_WAIT_CLASSES)
+#define REMOTE_NODE_WAITS_COLS	4
+
+/*
+ * Add the statements of the node to the tuplestore, after the name of the
+ * node if with_node is set
+ */
+static void
+RemoteWaitPutQueries(Tuplestorestate *tupstore, TupleDesc tupdesc,
+					 bool with_node)
+{
+	HASH_SEQ_STATUS hash_seq;
+	RemoteWaitQueryEnt *entry;
+	NameData	localname;
+	int			off = with_node ? 1 : 0;
+
+	if (RemoteWaitQueries == NULL)
+		return;
+
+	if (with_node)
+		namestrcpy(&localname, PGXCNodeName);
+
+	LWLockAcquire(RemoteWaitStatsLock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, RemoteWaitQueries);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum		values[1 + REMOTE_QUERY_WAITS_COLS];
+		bool		nulls[1 + REMOTE_QUERY_WAITS_COLS];
+		RemoteWaitCounters counters;
+		int64		calls;
+		int			i;
+
+		SpinLockAcquire(&entry->mutex);
+		calls = entry->calls;
+		counters = entry->counters;
+		SpinLockRelease(&entry->mutex);
+
+		memset(nulls, 0, sizeof(nulls));
+		if (with_node)
+			values[0] = NameGetDatum(&localname);
+		values[off] = ObjectIdGetDatum(entry->key.dbid);
+		values[off + 1] = Int64GetDatum((int64) entry->key.queryid);
+		values[off + 2] = CStringGetTextDatum(entry->query);
+		values[off + 3] = Int64GetDatum(calls);
+		for (i = 0; i < NUM_REMOTE_WAIT_CLASSES; i++)
+			values[off + 4 + i] = Float8GetDatum(counters.time[i]);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	LWLockRelease(RemoteWaitStatsLock);
+}
+
+/*
+ * Add the waits on each remote node to the tuplestore, after the name of
+ * the node if with_node is set
+ */
+static void
+RemoteWaitPutNodes(Tuplestorestate *tupstore, TupleDesc tupdesc,
+				   bool with_node)
+{
+	HASH_SEQ_STATUS hash_seq;
+	RemoteWaitNodeEnt *entry;
+	RemoteWaitNodeEnt *nodes;
+	NameData	localname;
+	int			off = with_node ? 1 : 0;
+	int			nnodes = 0;
+	int			i;
+
+	if (RemoteWaitNodes == NULL)
+		return;
+
+	if (with_node)
+		namestrcpy(&localname, PGXCNodeName);
+
+	/* Copy the entries, node names are looked up without the lock */
+	nodes = (RemoteWaitNodeEnt *)
+		palloc((MaxCoords + MaxDataNodes) * sizeof(RemoteWaitNodeEnt));
+
+	LWLockAcquire(RemoteWaitStatsLock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, RemoteWaitNodes);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		if (nnodes >= MaxCoords + MaxDataNodes)
+		{
+			hash_seq_term(&hash_seq);
+			break;
+		}
+		nodes[nnodes].nodeoid = entry->nodeoid;
+		SpinLockAcquire(&entry->mutex);
+		nodes[nnodes].counters = entry->counters;
+		SpinLockRelease(&entry->mutex);
+		nnodes++;
+	}
+
+	LWLockRelease(RemoteWaitStatsLock);
+
+	for (i = 0; i < nnodes; i++)
+	{
+		char	   *nodename = get_pgxc_nodename(nodes[i].nodeoid);
+		NameData	name;
+		int			j;
+
+		if (nodename)
+			namestrcpy(&name, nodename);
+
+		for (j = 0; j < NUM_REMOTE_WAIT_CLASSES; j++)
+		{
+			Datum		values[1 + REMOTE_NODE_WAITS_COLS];
+			bool		nulls[1 + REMOTE_NODE_WAITS_COLS];
+
+			if (nodes[i].counters.waits[j] == 0)
+				continue;
+
+			memset(nulls, 0, sizeof(nulls));
+			if (with_node)
+				values[0] = NameGetDatum(&localname);
+			if (nodename)
+				values[off] = NameGetDatum(&name);
+			else
+				nulls[off] = true;
+			values[off + 1] = CStringGetTextDatum(RemoteWaitClassNames[j]);
+			values[off + 2] = Int64GetDatum(nodes[i].counters.waits[j]);
+			values[off + 3] = Float8GetDatum(nodes[i].counters.time[j]);
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	pfree(nodes);
+}
+
+/*
+ * Run the query on the given nodes, which must be all Datanodes or all
+ * Coordinators, and add the rows it returns to the tuplestore.  The query
+ * returns the columns of the tuplestore, except that the database is
+ * reported by name in column dbcol, if not negative, and is mapped to the
+ * local oid; the rows of the databases not known here are skipped.
+ */
+static void
+RemoteWaitCollect(Tuplestorestate *tupstore, TupleDesc tupdesc,
+				  char *query, RemoteQueryExecType exec_type,
+				  List *nodelist, int dbcol)
+{
+	EState	   *estate;
+	MemoryContext oldcontext;
+	RemoteQuery *plan;
+	RemoteQueryState *pstate;
+	TupleTableSlot *result;
+	int			i;
+
+	if (nodelist == NIL)
+		return;
+
+	plan = makeNode(RemoteQuery);
+	plan->combine_type = COMBINE_TYPE_NONE;
+	plan->exec_nodes = makeNode(ExecNodes);
+	plan->exec_nodes->nodeList = nodelist;
+	plan->exec_type = exec_type;
+	plan->sql_statement = query;
+	/* The target list only tells the types of the result */
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Oid			coltype = (i == dbcol) ? TEXTOID : tupdesc->attrs[i]->atttypid;
+		Var		   *dummy = makeVar(1, i + 1, coltype, -1, InvalidOid, 0);
+
+		plan->scan.plan.targetlist = lappend(plan->scan.plan.targetlist,
+											 makeTargetEntry((Expr *) dummy,
+															 i + 1, NULL,
+															 false));
+	}
+
+	estate = CreateExecutorState();
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+	estate->es_snapshot = GetActiveSnapshot();
+	pstate = ExecInitRemoteQuery(plan, estate, 0);
+	MemoryContextSwitchTo(oldcontext);
+
+	while ((result = ExecRemoteQuery((PlanState *) pstate)) != NULL &&
+		   !TupIsNull(result))
+	{
+		Datum		values[1 + REMOTE_QUERY_WAITS_COLS];
+		bool		nulls[1 + REMOTE_QUERY_WAITS_COLS];
+
+		slot_getallattrs(result);
+		memcpy(values, result->tts_values, tupdesc->natts * sizeof(Datum));
+		memcpy(nulls, result->tts_isnull, tupdesc->natts * sizeof(bool));
+		if (dbcol >= 0)
+		{
+			Oid			dbid;
+
+			if (nulls[dbcol])
+				continue;
+			dbid = get_database_oid(TextDatumGetCString(values[dbcol]), true);
+			if (!OidIsValid(dbid))
+				continue;
+			values[dbcol] = ObjectIdGetDatum(dbid);
+		}
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	ExecEndRemoteQuery(pstate);
+	FreeExecutorState(estate);
+}
+
+/*
+ * Run the query on all the Datanodes and the Coordinators other than this
+ * one
+ */
+static void
+RemoteWaitCollectAll(Tuplestorestate *tupstore, TupleDesc tupdesc,
+					 char *query, int dbcol)
+{
+	Oid		   *coOids;
+	Oid		   *dnOids;
+	int			numcoords;
+	int			numdns;
+	List	   *coords = NIL;
+	List	   *datanodes = NIL;
+	int			i;
+
+	PgxcNodeGetOids(&coOids, &dnOids, &numcoords, &numdns, false);
+	for (i = 0; i < numcoords; i++)
+		if (i != PGXCNodeId - 1)
+			coords = lappend_int(coords, i);
+	for (i = 0; i < numdns; i++)
+		datanodes = lappend_int(datanodes, i);
+
+	RemoteWaitCollect(tupstore, tupdesc, query, EXEC_ON_DATANODES,
+					  datanodes, dbcol);
+	RemoteWaitCollect(tupstore, tupdesc, query, EXEC_ON_COORDS,
+					  coords, dbcol);
+}
+
+/*
+ * pgxc_stat_get_remote_query_waits
+ *		Time each statement waited, by wait class
+ */
+Datum
+pgxc_stat_get_remote_query_waits(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore = RemoteWaitTuplestore(fcinfo, &tupdesc);
+
+	RemoteWaitPutQueries(tupstore, tupdesc, false);
+
+	tuplestore_donestoring(tupstore);
+	PG_RETURN_VOID();
+}
+
+/*
+ * pgxc_stat_get_remote_node_waits
+ *		Time spent waiting on each remote node, by wait class
+ */
+Datum
+pgxc_stat_get_remote_node_waits(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore = RemoteWaitTuplestore(fcinfo, &tupdesc);
+
+	RemoteWaitPutNodes(tupstore, tupdesc, false);
+
+	tuplestore_donestoring(tupstore);
+	PG_RETURN_VOID();
+}
+
+/*
+ * pgxc_stat_get_cluster_query_waits
+ *		Time each statement waited on every node of the cluster
+ */
+Datum
+pgxc_stat_get_cluster_query_waits(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+
+	if (!IS_PGXC_COORDINATOR)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("pgxc_stat_get_cluster_query_waits can only be called on a Coordinator")));
+
+	tupstore = RemoteWaitTuplestore(fcinfo, &tupdesc);
+
+	RemoteWaitPutQueries(tupstore, tupdesc, true);
+	RemoteWaitCollectAll(tupstore, tupdesc,
+						 "SELECT pg_catalog.pgxc_node_str(), d.datname::text, "
+						 "s.queryid, s.query, s.calls, s.gtm_time, "
+						 "s.receive_time, s.squeue_read_time, "
+						 "s.squeue_write_time, s.prepare_time, "
+						 "s.commit_time, s.pooler_time "
+						 "FROM pg_catalog.pgxc_stat_get_remote_query_waits() s "
+						 "JOIN pg_catalog.pg_database d ON d.oid = s.dbid",
+						 1);
+
+	tuplestore_donestoring(tupstore);
+	PG_RETURN_VOID();
+}
+
+/*
+ * pgxc_stat_get_cluster_node_waits
+ *		Time every node of the cluster spent waiting on each of the others
+ */
+Datum
+pgxc_stat_get_cluster_node_waits(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+
+	if (!IS_PGXC_COORDINATOR)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("pgxc_stat_get_cluster_node_waits can only be called on a Coordinator")));
+
+	tupstore = RemoteWaitTuplestore(fcinfo, &tupdesc);
+
+	RemoteWaitPutNodes(tupstore, tupdesc, true);
+	RemoteWaitCollectAll(tupstore, tupdesc,
+						 "SELECT pg_catalog.pgxc_node_str(), s.node_name, "
+						 "s.wait_class, s.waits, s.wait_time "
+						 "FROM pg_catalog.pgxc_stat_get_remote_node_waits() s",
+						 -1);
+
+	tuplestore_donestoring(tupstore);
+	PG_RETURN_VOID();
+}
+
+/*
+ * pgxc_stat_reset_remote_waits
+ *		Discard the statistics of remote waits of the node
+ */
+Datum
+pgxc_stat_reset_remote_waits(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	void	   *entry;
+
+	if (RemoteWaitQueries == NULL || RemoteWaitNodes == NULL)
+		PG_RETURN_VOID();
+
+	LWLockAcquire(RemoteWaitStatsLock, LW_EXCLUSIVE);
+
+	hash_seq_init(&hash_seq, RemoteWaitQueries);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(RemoteWaitQueries, entry, HASH_REMOVE, NULL);
+
+	hash_seq_init(&hash_seq, RemoteWaitNodes);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(RemoteWaitNodes, entry, HASH_REMOVE, NULL);
+
+	LWLockRelease(RemoteWaitStatsLock);
+
+	PG_RETURN_VOID();
+}
@@ -85,6 +85,9 @@ Oid		primary_data_node = InvalidOid;
 int		num_preferred_data_nodes = 0;
 Oid		preferred_data_node[MAX_PREFERRED_NODES];
 
+/* GUC parameter */
+bool	load_balance_replicated_reads = true;
+
 #ifdef XCP
 static int modulo_value_len(Oid dataType);
 static LocatorHashFunc hash_func_ptr(Oid dataType);
@@ -102,21 +105,109 @@ static int locate_modulo_insert(Locator *self, Datum value, bool isnull,
 			  bool *hasprimary);
 static int locate_modulo_select(Locator *self, Datum value, bool isnull,
 			  bool *hasprimary);
+static int pick_least_loaded_node(int *members, int nmembers);
 static Expr * pgxc_find_distcol_expr(Index varno,
 					   AttrNumber attrNum,
 					   Node *quals);
 #endif
 
 
+/*
+ * pick_least_loaded_node
+ * Pick a node from the array of candidate Datanode indexes, taking into
+ * account the health and the current load of the nodes.
+ *
+ * Healthy nodes are preferred over unhealthy ones, then nodes with fewer
+ * requests in flight. If several nodes are equally loaded a node the session
+ * is already connected to is taken, to avoid acquiring an extra connection.
+ * Remaining ties are broken randomly to keep the distribution flat.
+ */
+static int
+pick_least_loaded_node(int *members, int nmembers)
+{
+	bool	   *healthmap;
+	uint32	   *loadmap;
+	int			num_dns;
+	int		   *best;
+	int			nbest = 0;
+	bool		best_healthy = false;
+	uint32		best_load = 0;
+	bool		best_connected = false;
+	int			result;
+	int			i;
+
+	if (nmembers == 1)
+		return members[0];
+
+	if (!load_balance_replicated_reads)
+		return members[((unsigned int) random()) % nmembers];
+
+	healthmap = (bool *) palloc(MaxDataNodes * sizeof(bool));
+	loadmap = (uint32 *) palloc(MaxDataNodes * sizeof(uint32));
+	best = (int *) palloc(nmembers * sizeof(int));
+
+	PgxcNodeGetLoadMap(&num_dns, healthmap, loadmap);
+
+	for (i = 0; i < nmembers; i++)
+	{
+		int			nodeid = members[i];
+		bool		healthy = true;
+		uint32		load = 0;
+		bool		connected;
+		int			cmp;
+
+		/* Node table may be out of sync with the handles, do not trust it */
+		if (nodeid < num_dns)
+		{
+			healthy = healthmap[nodeid];
+			load = loadmap[nodeid];
+		}
+		connected = PGXCNodeIsConnected(nodeid);
+
+		if (nbest == 0)
+			cmp = -1;
+		else if (healthy != best_healthy)
+			cmp = healthy ? -1 : 1;
+		else if (load != best_load)
+			cmp = load < best_load ? -1 : 1;
+		else if (connected != best_connected)
+			cmp = connected ? -1 : 1;
+		else
+			cmp = 0;
+
+		if (cmp < 0)
+		{
+			nbest = 0;
+			best_healthy = healthy;
+			best_load = load;
+			best_connected = connected;
+		}
+		if (cmp <= 0)
+			best[nbest++] = nodeid;
+	}
+
+	result = best[((unsigned int) random()) % nbest];
+
+	pfree(healthmap);
+	pfree(loadmap);
+	pfree(best);
+
+	return result;
+}
+
 /*
  * GetPreferredReplicationNode
  * Pick any Datanode from given list, however fetch a preferred node first.
+ * If there are no preferred nodes in the list the least loaded node is
+ * picked.
  */
 List *
 GetPreferredReplicationNode(List *relNodes)
 {
 	ListCell	*item;
 	int			nodeid = -1;
+	int			nmembers = 0;
+	int		   *members;
 
 	if (list_length(relNodes) <= 0)
 		elog(ERROR, "a list of nodes should have at least one node");
@@ -137,8 +228,13 @@ GetPreferredReplicationNode(List *relNodes)
 			break;
 	}
 	if (nodeid < 0)
-		return list_make1_int(list_nth_int(relNodes,
-					((unsigned int) random()) % list_length(relNodes)));
+	{
+		members = (int *) palloc(list_length(relNodes) * sizeof(int));
+		foreach(item, relNodes)
+			members[nmembers++] = lfirst_int(item);
+		nodeid = pick_least_loaded_node(members, nmembers);
+		pfree(members);
+	}
 
 	return list_make1_int(nodeid);
 }
@@ -180,18 +276,14 @@ GetAnyDataNode(Bitmapset *nodes)
 		members[nmembers++] = nodeid;
 	bms_free(preferred);
 
-	/* If there is a single member nothing to balance */
-	if (nmembers == 1)
-		return members[0];
-
 	/*
 	 * In general, the set may contain any number of nodes, and if we save
 	 * previous returned index for load balancing the distribution won't be
 	 * flat, because small set will probably reset saved value, and lower
-	 * indexes will be picked up more often.
-	 * So we just get a random value from 0..nmembers-1.
+	 * indexes will be picked up more often. So the node is chosen by the
+	 * current load, and randomly among equally loaded nodes.
 	 */
-	return members[((unsigned int) random()) % nmembers];
+	return pick_least_loaded_node(members, nmembers);
 }
 
 /*
@@ -24,6 +24,7 @@
 #include "utils/rel.h"
 #include "utils/syscache.h"
 #include "utils/lsyscache.h"
+#include "utils/timestamp.h"
 #include "utils/tqual.h"
 #include "pgxc/locator.h"
 #include "pgxc/nodemgr.h"
@@ -92,7 +93,11 @@ NodeTablesShmemInit(void)
 		*shmemNumCoords = 0;
 		/* Mark nodeishealthy true at init time for all */
 		for (i = 0; i < MaxCoords; i++)
+		{
 			coDefs[i].nodeishealthy = true;
+			pg_atomic_init_u32(&coDefs[i].nodeload, 0);
+			memset(&coDefs[i].nodehealthstats, 0, sizeof(NodeHealthStats));
+		}
 	}
 
 	/* Same for Datanodes */
@@ -110,7 +115,11 @@ NodeTablesShmemInit(void)
 		*shmemNumDataNodes = 0;
 		/* Mark nodeishealthy true at init time for all */
 		for (i = 0; i < MaxDataNodes; i++)
+		{
 			dnDefs[i].nodeishealthy = true;
+			pg_atomic_init_u32(&dnDefs[i].nodeload, 0);
+			memset(&dnDefs[i].nodehealthstats, 0, sizeof(NodeHealthStats));
+		}
 	}
 }
 
@@ -428,16 +437,22 @@ PgxcNodeListAndCount(void)
 		node->nodeisprimary = nodeForm->nodeis_primary;
 		node->nodeispreferred = nodeForm->nodeis_preferred;
 		/*
-		 * Copy over the health status from above for nodes that
-		 * existed before and after the refresh. If we do not find
-		 * entry for a nodeoid, we mark it as healthy
+		 * Copy over the health status, the load and the health statistics
+		 * from above for nodes
+		 * that existed before and after the refresh. If we do not find
+		 * entry for a nodeoid, we mark it as healthy and idle
 		 */
 		node->nodeishealthy = true;
+		pg_atomic_init_u32(&node->nodeload, 0);
+		memset(&node->nodehealthstats, 0, sizeof(NodeHealthStats));
 		for (i = 0; i < numNodes; i++)
 		{
 			if (nodes[i].nodeoid == node->nodeoid)
 			{
 				node->nodeishealthy = nodes[i].nodeishealthy;
+				pg_atomic_init_u32(&node->nodeload,
+								   pg_atomic_read_u32(&nodes[i].nodeload));
+				node->nodehealthstats = nodes[i].nodehealthstats;
 				break;
 			}
 		}
@@ -672,39 +687,139 @@ PgxcNodeGetDefinition(Oid node)
 bool
 PgxcNodeUpdateHealth(Oid node, bool status)
 {
+	NodeDefinition *def = NULL;
 	int				i;
 
 	LWLockAcquire(NodeTableLock, LW_EXCLUSIVE);
 
 	/* search through the Datanodes first */
-	for (i = 0; i < *shmemNumDataNodes; i++)
+	for (i = 0; i < *shmemNumDataNodes && def == NULL; i++)
 	{
 		if (dnDefs[i].nodeoid == node)
-		{
-			dnDefs[i].nodeishealthy = status;
-
-			LWLockRelease(NodeTableLock);
-
-			return true;
-		}
+			def = &dnDefs[i];
 	}
 
 	/* if not found, search through the Coordinators */
-	for (i = 0; i < *shmemNumCoords; i++)
+	for (i = 0; i < *shmemNumCoords && def == NULL; i++)
 	{
 		if (coDefs[i].nodeoid == node)
-		{
-			coDefs[i].nodeishealthy = status;
+			def = &coDefs[i];
+	}
 
-			LWLockRelease(NodeTableLock);
+	/* not found, return false */
+	if (def == NULL)
+	{
+		LWLockRelease(NodeTableLock);
+		return false;
+	}
 
-			return true;
-		}
+	/* Remember since when the node is down */
+	if (!status)
+	{
+		if (def->nodeishealthy)
+			def->nodehealthstats.unhealthy_since = GetCurrentTimestamp();
 	}
+	else
+		def->nodehealthstats.unhealthy_since = 0;
+	def->nodeishealthy = status;
 
-	/* not found, return false */
 	LWLockRelease(NodeTableLock);
-	return false;
+	return true;
+}
+
+/*
+ * Add to the health statistics of a node what the pool manager went through
+ * with it since it last reported. Unknown nodes are silently ignored.
+ */
+void
+PgxcNodeAddHealthStats(Oid node, NodeHealthStats *stats)
+{
+	NodeHealthStats *target = NULL;
+	int				i;
+
+	LWLockAcquire(NodeTableLock, LW_EXCLUSIVE);
+
+	for (i = 0; i < *shmemNumDataNodes && target == NULL; i++)
+	{
+		if (dnDefs[i].nodeoid == node)
+			target = &dnDefs[i].nodehealthstats;
+	}
+	for (i = 0; i < *shmemNumCoords && target == NULL; i++)
+	{
+		if (coDefs[i].nodeoid == node)
+			target = &coDefs[i].nodehealthstats;
+	}
+
+	if (target)
+	{
+		target->connect_failures += stats->connect_failures;
+		target->connect_timeouts += stats->connect_timeouts;
+		target->fast_failures += stats->fast_failures;
+		target->probes += stats->probes;
+		target->failed_probes += stats->failed_probes;
+		target->wait_time += stats->wait_time;
+	}
+
+	LWLockRelease(NodeTableLock);
+}
+
+/*
+ * Adjust the number of requests in flight to a Datanode.
+ *
+ * Backends call this when a connection to the node becomes busy or idle, so
+ * the counter reflects the load this node currently puts on the Datanode.
+ * This is done for every request, so the counter is found by the position of
+ * the node in the node table, which is also the position of its handle, and
+ * updated without taking NodeTableLock. If the node table was refreshed since
+ * the handle was set up and the node moved, the update is skipped: the load
+ * is only a hint.
+ */
+void
+PgxcNodeUpdateLoad(int nodeidx, Oid node, bool busy)
+{
+	NodeDefinition *nodeDef;
+
+	if (nodeidx < 0 || nodeidx >= MaxDataNodes)
+		return;
+
+	nodeDef = &dnDefs[nodeidx];
+	if (nodeDef->nodeoid != node)
+		return;
+
+	if (busy)
+		pg_atomic_fetch_add_u32(&nodeDef->nodeload, 1);
+	else
+	{
+		uint32		load = pg_atomic_read_u32(&nodeDef->nodeload);
+
+		/* Never wrap around, the counter may have been reset */
+		while (load > 0 &&
+			   !pg_atomic_compare_exchange_u32(&nodeDef->nodeload,
+											   &load, load - 1))
+			;
+	}
+}
+
+/*
+ * Get health status and current load of the Datanodes in the shared memory
+ * node table. The maps are indexed in the node table order, which is the same
+ * as the order of the Datanode handles, and must have room for MaxDataNodes
+ * entries.
+ *
+ * Like the updates, this does not take NodeTableLock, a concurrent refresh of
+ * the node table may only make the choice of a node less balanced.
+ */
+void
+PgxcNodeGetLoadMap(int *num_dns, bool *dnHealthMap, uint32 *dnLoadMap)
+{
+	int				i;
+
+	*num_dns = Min(*shmemNumDataNodes, MaxDataNodes);
+	for (i = 0; i < *num_dns; i++)
+	{
+		dnHealthMap[i] = dnDefs[i].nodeishealthy;
+		dnLoadMap[i] = pg_atomic_read_u32(&dnDefs[i].nodeload);
+	}
 }
 
 /*
@@ -29,8 +29,10 @@
 #include "catalog/pgxc_node.h"
 #include "commands/prepare.h"
 #include "executor/executor.h"
+#include "executor/producerReceiver.h"
 #include "gtm/gtm_c.h"
 #include "libpq/libpq.h"
+#include "libpq/pqformat.h"
 #include "miscadmin.h"
 #include "pgxc/execRemote.h"
 #include "tcop/tcopprot.h"
@@ -43,6 +45,8 @@
 #include "pgxc/copyops.h"
 #include "pgxc/nodemgr.h"
 #include "pgxc/poolmgr.h"
+#include "pgxc/squeue.h"
+#include "pgxc/waitstats.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "utils/builtins.h"
@@ -86,6 +90,12 @@ struct find_params_context
 	List *subplans;
 };
 
+struct find_planstate_context
+{
+	int			plan_node_id;
+	PlanState  *result;
+};
+
 /*
  * Buffer size does not affect performance significantly, just do not allow
  * connection buffer grows infinitely
@@ -125,6 +135,10 @@ static void pgxc_connections_cleanup(ResponseCombiner *combiner);
 static void pgxc_node_report_error(ResponseCombiner *combiner);
 
 static bool determine_param_types(Plan *plan,  struct find_params_context *context);
+static bool find_planstate_walker(PlanState *planstate,
+					  struct find_planstate_context *context);
+static bool collect_remote_instrumentation(PlanState *planstate,
+							   StringInfo buf);
 
 #define REMOVE_CURR_CONN(combiner) \
 	if ((combiner)->current_conn < --((combiner)->conn_count)) \
@@ -252,6 +266,8 @@ InitResponseCombiner(ResponseCombiner *combiner, int node_count,
 	combiner->extended_query = false;
 	combiner->tapemarks = NULL;
 	combiner->tuplesortstate = NULL;
+	combiner->tuples_needed = -1;
+	combiner->bounded_fetch = false;
 	combiner->cursor = NULL;
 	combiner->update_cursor = NULL;
 	combiner->cursor_count = 0;
@@ -885,6 +901,142 @@ HandleGlobalTransactionId(char *msg_body, size_t len)
 	SetTopTransactionId(xid);
 }
 
+/*
+ * Read the counters of an instrumentation entry, written by
+ * append_remote_instrumentation
+ */
+static void
+get_remote_instrumentation(StringInfo buf, Instrumentation *instrument)
+{
+	BufferUsage *bufusage = &instrument->bufusage;
+	uint64		usec;
+
+	memset(instrument, 0, sizeof(Instrumentation));
+	instrument->need_timer = (bool) pq_getmsgbyte(buf);
+	instrument->need_bufusage = (bool) pq_getmsgbyte(buf);
+	instrument->startup = pq_getmsgfloat8(buf);
+	instrument->total = pq_getmsgfloat8(buf);
+	instrument->ntuples = pq_getmsgfloat8(buf);
+	instrument->nloops = pq_getmsgfloat8(buf);
+	instrument->nfiltered1 = pq_getmsgfloat8(buf);
+	instrument->nfiltered2 = pq_getmsgfloat8(buf);
+	bufusage->shared_blks_hit = (long) pq_getmsgint64(buf);
+	bufusage->shared_blks_read = (long) pq_getmsgint64(buf);
+	bufusage->shared_blks_dirtied = (long) pq_getmsgint64(buf);
+	bufusage->shared_blks_written = (long) pq_getmsgint64(buf);
+	bufusage->local_blks_hit = (long) pq_getmsgint64(buf);
+	bufusage->local_blks_read = (long) pq_getmsgint64(buf);
+	bufusage->local_blks_dirtied = (long) pq_getmsgint64(buf);
+	bufusage->local_blks_written = (long) pq_getmsgint64(buf);
+	bufusage->temp_blks_read = (long) pq_getmsgint64(buf);
+	bufusage->temp_blks_written = (long) pq_getmsgint64(buf);
+	usec = (uint64) pq_getmsgint64(buf);
+	INSTR_TIME_SET_MICROSEC(bufusage->blk_read_time, usec);
+	usec = (uint64) pq_getmsgint64(buf);
+	INSTR_TIME_SET_MICROSEC(bufusage->blk_write_time, usec);
+}
+
+/*
+ * Store instrumentation reported by a remote node executing the subplan of a
+ * RemoteSubplan node. Reports of the same plan node from the same remote node
+ * are summed up. The Coordinator keeps the entries on the local copy of the
+ * subplan, to be shown by EXPLAIN ANALYZE, intermediate Datanodes keep them on
+ * the RemoteSubplan node to report them up along with their own.
+ */
+static void
+HandleRemoteInstrumentation(ResponseCombiner *combiner, char *msg_body,
+							size_t len)
+{
+	RemoteSubplanState *node;
+	PlanState  *planstate;
+	StringInfoData buf;
+	MemoryContext oldcontext;
+
+	/* Only RemoteSubplan requests the instrumentation */
+	if (combiner == NULL || !IsA(combiner, RemoteSubplanState))
+		return;
+	node = (RemoteSubplanState *) combiner;
+	planstate = &combiner->ss.ps;
+
+	buf.data = msg_body;
+	buf.len = len;
+	buf.maxlen = len;
+	buf.cursor = 0;
+
+	oldcontext = MemoryContextSwitchTo(planstate->state->es_query_cxt);
+	while (buf.cursor < buf.len)
+	{
+		RemoteInstrumentation ri;
+		PlanState  *target = planstate;
+		ListCell   *lc;
+		bool		found = false;
+
+		namestrcpy(&ri.nodename, pq_getmsgstring(&buf));
+		namestrcpy(&ri.consumer, pq_getmsgstring(&buf));
+		ri.plan_node_id = (int) pq_getmsgint(&buf, 4);
+		get_remote_instrumentation(&buf, &ri.instrument);
+
+		/* Rows sent by the producers of our own subplan */
+		if (ri.plan_node_id < 0)
+			ri.plan_node_id = planstate->plan->plan_node_id;
+
+		if (node->remote_planstate &&
+				ri.plan_node_id != planstate->plan->plan_node_id)
+		{
+			struct find_planstate_context context;
+
+			context.plan_node_id = ri.plan_node_id;
+			context.result = NULL;
+			if (!find_planstate_walker(node->remote_planstate, &context))
+				continue;
+			target = context.result;
+
+			/* The node line of EXPLAIN shows the totals */
+			if (NameStr(ri.consumer)[0] == '\0' && target->instrument)
+				InstrAggNode(target->instrument, &ri.instrument);
+		}
+
+		foreach(lc, target->remote_instrument)
+		{
+			RemoteInstrumentation *entry = (RemoteInstrumentation *) lfirst(lc);
+
+			if (entry->plan_node_id == ri.plan_node_id &&
+					namestrcmp(&entry->nodename, NameStr(ri.nodename)) == 0 &&
+					namestrcmp(&entry->consumer, NameStr(ri.consumer)) == 0)
+			{
+				InstrAggNode(&entry->instrument, &ri.instrument);
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+		{
+			RemoteInstrumentation *entry;
+
+			entry = (RemoteInstrumentation *) palloc(sizeof(RemoteInstrumentation));
+			memcpy(entry, &ri, sizeof(RemoteInstrumentation));
+			target->remote_instrument = lappend(target->remote_instrument,
+												entry);
+		}
+	}
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Find the plan node state the instrumentation entry is about
+ */
+static bool
+find_planstate_walker(PlanState *planstate,
+					  struct find_planstate_context *context)
+{
+	if (planstate->plan->plan_node_id == context->plan_node_id)
+	{
+		context->result = planstate;
+		return true;
+	}
+	return planstate_tree_walker(planstate, find_planstate_walker, context);
+}
+
 /*
  * Examine the specified combiner state and determine if command was completed
  * successfully
@@ -1426,6 +1578,30 @@ FetchTuple(ResponseCombiner *combiner)
 		}
 		else if (res == RESPONSE_SUSPENDED)
 		{
+			/*
+			 * The fetch was capped to the number of rows the consumer needs,
+			 * so the node has sent all we may want from it. Do not resume the
+			 * portal, consider the node exhausted instead; the portal is
+			 * closed along with the subplan.
+			 */
+			if (combiner->bounded_fetch && !combiner->probing_primary)
+			{
+				if (combiner->merge_sort)
+				{
+					combiner->connections[combiner->current_conn] = NULL;
+					return NULL;
+				}
+				REMOVE_CURR_CONN(combiner);
+				if (combiner->conn_count > 0)
+				{
+					conn = combiner->connections[combiner->current_conn];
+					combiner->current_conn_rows_consumed = 0;
+				}
+				else
+					return NULL;
+				continue;
+			}
+
 			/*
 			 * If we are doing merge sort or probing primary node we should
 			 * remain on the same node, so query next portion immediately.
@@ -1806,6 +1982,9 @@ handle_response(PGXCNodeHandle *conn, ResponseCombiner *combiner)
 			case 'x':
 				HandleGlobalTransactionId(msg, msg_len);
 				return RESPONSE_ASSIGN_GXID;
+			case 'i':			/* Instrumentation */
+				HandleRemoteInstrumentation(combiner, msg, msg_len);
+				break;
 			default:
 				/* sync lost? */
 				elog(WARNING, "Received unsupported message type: %c", msg_type);
@@ -1989,6 +2168,7 @@ pgxc_node_remote_cleanup_all(void)
 							   "RESET SESSION AUTHORIZATION;"
 							   "RESET transaction_isolation;"
 							   "RESET global_session";
+	bool			forget_statements;
 
 	elog(DEBUG5, "pgxc_node_remote_cleanup_all - handles->co_conn_count %d,"
 			"handles->dn_conn_count %d", handles->co_conn_count,
@@ -2000,6 +2180,21 @@ pgxc_node_remote_cleanup_all(void)
 	if (handles->co_conn_count + handles->dn_conn_count == 0)
 		return;
 
+	/*
+	 * Prepared statements keep the session on its connections, see
+	 * release_handles(). With pool_multiplexing, drop them from the nodes
+	 * when the pooler asks for the connections, they are prepared again on
+	 * the connections of the next transaction using them.
+	 */
+	forget_statements = PoolMultiplexing && PoolManagerReclaimPending() &&
+		HaveActiveDatanodeStatements();
+	if (forget_statements)
+		resetcmd = "RESET ALL;"
+				   "RESET SESSION AUTHORIZATION;"
+				   "RESET transaction_isolation;"
+				   "RESET global_session;"
+				   "DEALLOCATE ALL";
+
 	/*
 	 * Send down snapshot followed by DISCARD ALL command.
 	 */
@@ -2064,6 +2259,14 @@ pgxc_node_remote_cleanup_all(void)
 		pgxc_node_receive_responses(new_conn_count, new_connections, NULL, &combiner);
 		CloseCombiner(&combiner);
 	}
+
+	/*
+	 * The connections which failed to deallocate are in error state, and
+	 * will be closed rather than returned to the pool.
+	 */
+	if (forget_statements)
+		ForgetDatanodeStatements();
+
 	pfree_pgxc_all_handles(handles);
 }
 
@@ -2335,6 +2538,7 @@ pgxc_node_remote_prepare(char *prepareGID, bool localNode)
 	if (conn_count > 0)
 	{
 		int result;
+		instr_time	wait_start;
 		/*
 		 * Receive and check for any errors. In case of errors, we don't bail out
 		 * just yet. We first go through the list of connections and look for
@@ -2350,7 +2554,9 @@ pgxc_node_remote_prepare(char *prepareGID, bool localNode)
 		 */
 		InitResponseCombiner(&combiner, conn_count, COMBINE_TYPE_NONE);
 		/* Receive responses */
+		RemoteWaitStart(wait_start);
 		result = pgxc_node_receive_responses(conn_count, connections, NULL, &combiner);
+		RemoteWaitEndLastNode(REMOTE_WAIT_PREPARE, wait_start);
 		if (result || !validate_combiner(&combiner))
 			goto prepare_err;
 		else
@@ -2361,7 +2567,7 @@ pgxc_node_remote_prepare(char *prepareGID, bool localNode)
 			connections[i]->ck_resp_rollback = false;
 
 		pfree_pgxc_all_handles(handles);
-		if (!temp_object_included && !PersistentConnections)
+		if (!temp_object_included && !PoolManagerKeepConnections())
 		{
 			/* Clean up remote sessions */
 			pgxc_node_remote_cleanup_all();
@@ -2493,7 +2699,7 @@ prepare_err:
 		CloseCombiner(&combiner2);
 	}
 
-	if (!temp_object_included && !PersistentConnections)
+	if (!temp_object_included && !PoolManagerKeepConnections())
 	{
 		/* Clean up remote sessions */
 		pgxc_node_remote_cleanup_all();
@@ -2621,9 +2827,13 @@ pgxc_node_remote_commit(void)
 
 	if (conn_count)
 	{
+		instr_time	wait_start;
+
 		InitResponseCombiner(&combiner, conn_count, COMBINE_TYPE_NONE);
 		/* Receive responses */
+		RemoteWaitStart(wait_start);
 		result = pgxc_node_receive_responses(conn_count, connections, NULL, &combiner);
+		RemoteWaitEndLastNode(REMOTE_WAIT_COMMIT, wait_start);
 		if (result || !validate_combiner(&combiner))
 			result = EOF;
 		else
@@ -2642,7 +2852,7 @@ pgxc_node_remote_commit(void)
 					 errmsg("Failed to COMMIT the transaction on one or more nodes")));
 	}
 
-	if (!temp_object_included && !PersistentConnections)
+	if (!temp_object_included && !PoolManagerKeepConnections())
 	{
 		/* Clean up remote sessions */
 		pgxc_node_remote_cleanup_all();
@@ -3249,7 +3459,13 @@ get_exec_connections(RemoteQueryState *planstate,
 		else
 		{
 			if (exec_type == EXEC_ON_DATANODES || exec_type == EXEC_ON_ALL_NODES)
+			{
 				nodelist = exec_nodes->nodeList;
+
+				/* Read the replica which is the least loaded now */
+				if (list_length(exec_nodes->replicanodelist) > 1)
+					nodelist = GetPreferredReplicationNode(exec_nodes->replicanodelist);
+			}
 			else if (exec_type == EXEC_ON_COORDS)
 				coordlist = exec_nodes->nodeList;
 
@@ -3335,6 +3551,8 @@ pgxc_start_command_on_connection(PGXCNodeHandle *connection,
 	CommandId	cid;
 	ResponseCombiner *combiner = (ResponseCombiner *) remotestate;
 	RemoteQuery	*step = (RemoteQuery *) combiner->ss.ps.plan;
+	PlannedStmt *pstmt = combiner->ss.ps.state->es_plannedstmt;
+	char		conntype = PGXC_NODE_NONE;
 	CHECK_OWNERSHIP(connection, combiner);
 
 	elog(DEBUG5, "pgxc_start_command_on_connection - node %s, state %d",
@@ -3352,6 +3570,18 @@ pgxc_start_command_on_connection(PGXCNodeHandle *connection,
 
 	if (snapshot && pgxc_node_send_snapshot(connection, snapshot))
 		return false;
+
+	/*
+	 * Let the remote node account the work to the query. Utility statements
+	 * forwarded to the Coordinators are their own statements there, they are
+	 * accounted under their own identifiers.
+	 */
+	if (pstmt && pstmt->queryId != 0 && pstmt->commandType != CMD_UTILITY &&
+		PGXCNodeGetNodeId(connection->nodeoid, &conntype) >= 0 &&
+		conntype == PGXC_NODE_DATANODE &&
+		pgxc_node_send_query_id(connection, pstmt->queryId))
+		return false;
+
 	if (step->statement || step->cursor || remotestate->rqs_num_params)
 	{
 		/* need to use Extended Query Protocol */
@@ -3656,6 +3886,8 @@ ExecRemoteUtility(RemoteQuery *node)
 void
 PGXCNodeCleanAndRelease(int code, Datum arg)
 {
+	/* Requests of this backend are not in flight anymore */
+	PGXCNodeReleaseLoad();
 
 	/* Disconnect from Pooler, if any connection is still held Pooler close it */
 	PoolManagerDisconnect();
@@ -3941,6 +4173,26 @@ AtEOXact_Remote(void)
 	PGXCNodeResetParams(true);
 }
 
+/*
+ * Return the connections a session kept after its last transaction, see
+ * pool_sticky_connections, when the pooler asks for them.
+ *
+ * Called between transactions. Interrupts are held while the remote sessions
+ * are cleaned up, so that this is not entered again from the wait for their
+ * answers.
+ */
+void
+ReleaseIdleRemoteConnections(void)
+{
+	if (temp_object_included || PersistentConnections)
+		return;
+
+	HOLD_INTERRUPTS();
+	pgxc_node_remote_cleanup_all();
+	release_handles();
+	RESUME_INTERRUPTS();
+}
+
 /*
  * Invoked when local transaction is about to be committed.
  * If nodestring is specified commit specified prepared transaction on remote
@@ -4313,7 +4565,8 @@ FinishRemotePreparedTransaction(char *prepareGID, bool commit)
 	 * such situations. So it seems alright to not be too strict about the
 	 * state
 	 */
-	if ((GetGIDDataGTM(prepareGID, &gxid, &prepare_gxid, &nodestring) < 0) &&
+	if ((GetGIDDataGTM(prepareGID, &gxid, &prepare_gxid, &nodestring,
+					   NULL) < 0) &&
 		!xc_maintenance_mode)
 		ereport(ERROR,
 				(errcode(ERRCODE_INTERNAL_ERROR),
@@ -4381,6 +4634,9 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
 	List			   *nodelist = NIL;
 	List			   *coordlist = NIL;
 	int					i;
+#ifdef XCP
+	TimestampTz			commit_ts = 0;
+#endif
 	/*
 	 * Now based on the nodestring, run COMMIT/ROLLBACK PREPARED command on the
 	 * remote nodes and also finish the transaction locally is required
@@ -4419,6 +4675,16 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
 
 	pgxc_handles = get_handles(nodelist, coordlist, false, true);
 
+#ifdef XCP
+	/*
+	 * All the nodes must commit with the same timestamp for timestamp based
+	 * snapshots to see the transaction either everywhere or nowhere. It is
+	 * taken now that the transaction is prepared everywhere.
+	 */
+	if (commit)
+		commit_ts = AssignXactCommitTimestamp();
+#endif
+
 	finish_cmd = (char *) palloc(64 + strlen(prepareGID));
 
 	if (commit)
@@ -4438,6 +4704,15 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
 							commit ? "COMMIT" : "ROLLBACK")));
 		}
 
+#ifdef XCP
+		if (commit_ts != 0 && pgxc_node_send_commit_timestamp(conn, commit_ts))
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("failed to send commit timestamp for COMMIT PREPARED command")));
+		}
+#endif
+
 		if (pgxc_node_send_query(conn, finish_cmd))
 		{
 			/*
@@ -4468,6 +4743,15 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
 							commit ? "COMMIT" : "ROLLBACK")));
 		}
 
+#ifdef XCP
+		if (commit_ts != 0 && pgxc_node_send_commit_timestamp(conn, commit_ts))
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("failed to send commit timestamp for COMMIT PREPARED command")));
+		}
+#endif
+
 		if (pgxc_node_send_query(conn, finish_cmd))
 		{
 			/*
@@ -4488,10 +4772,17 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
 
 	if (conn_count)
 	{
+		instr_time	wait_start;
+		int			result;
+
 		InitResponseCombiner(&combiner, conn_count, COMBINE_TYPE_NONE);
 		/* Receive responses */
-		if (pgxc_node_receive_responses(conn_count, connections, NULL, &combiner) ||
-				!validate_combiner(&combiner))
+		RemoteWaitStart(wait_start);
+		result = pgxc_node_receive_responses(conn_count, connections, NULL,
+											 &combiner);
+		if (commit)
+			RemoteWaitEndLastNode(REMOTE_WAIT_COMMIT, wait_start);
+		if (result || !validate_combiner(&combiner))
 		{
 			if (combiner.errorMessage)
 				pgxc_node_report_error(&combiner);
@@ -4504,7 +4795,7 @@ pgxc_node_remote_finish(char *prepareGID, bool commit,
 			CloseCombiner(&combiner);
 	}
 
-	if (!temp_object_included && !PersistentConnections)
+	if (!temp_object_included && !PoolManagerKeepConnections())
 	{
 		/* Clean up remote sessions */
 		pgxc_node_remote_cleanup_all();
@@ -5344,7 +5635,19 @@ ExecInitRemoteSubplan(RemoteSubplan *node, EState *estate, int eflags)
 		 */
 		remotestate->execOnAll = true;
 	}
-	remotestate->execNodes = list_copy(node->nodeList);
+	if (node->replicaNodes)
+	{
+		Bitmapset  *replicas = NULL;
+		ListCell   *lc;
+
+		/* Read the replica which is the least loaded now */
+		foreach(lc, node->replicaNodes)
+			replicas = bms_add_member(replicas, lfirst_int(lc));
+		remotestate->execNodes = list_make1_int(GetAnyDataNode(replicas));
+		bms_free(replicas);
+	}
+	else
+		remotestate->execNodes = list_copy(node->nodeList);
 	InitResponseCombiner(combiner, 0, combineType);
 	combiner->ss.ps.plan = (Plan *) node;
 	combiner->ss.ps.state = estate;
@@ -5447,6 +5750,18 @@ ExecInitRemoteSubplan(RemoteSubplan *node, EState *estate, int eflags)
 		else
 			remotestate->locator = NULL;
 	}
+	else if (estate->es_instrument && IS_PGXC_COORDINATOR)
+	{
+		/*
+		 * The remote nodes are going to report the instrumentation of the
+		 * subplan back. Initialize a local copy of the subplan to accumulate
+		 * it and to let EXPLAIN ANALYZE show the plan nodes below. The copy is
+		 * never executed. The Datanodes do not need it, they just pass the
+		 * reports up, see SendRemoteInstrumentation.
+		 */
+		remotestate->remote_planstate = ExecInitNode(outerPlan(node), estate,
+											eflags | EXEC_FLAG_EXPLAIN_ONLY);
+	}
 
 	/*
 	 * Encode subplan if it will be sent to remote nodes
@@ -5617,6 +5932,9 @@ ExecInitRemoteSubplan(RemoteSubplan *node, EState *estate, int eflags)
 		rstmt.distributionType = node->distributionType;
 		rstmt.distributionNodes = node->distributionNodes;
 		rstmt.distributionRestrict = node->distributionRestrict;
+		rstmt.instrument_options = estate->es_instrument;
+		rstmt.queryId = estate->es_plannedstmt->queryId;
+		rstmt.runtimeFilterSize = node->runtimeFilterSize;
 
 		/*
 		 * A try-catch block to ensure that we don't leave behind a stale state
@@ -5950,6 +6268,20 @@ primary_mode_phase_two:
 		if (plan->cursor)
 		{
 			fetch = PGXLRemoteFetchSize;
+
+			/*
+			 * If a Limit above us told how many rows it needs, do not let the
+			 * nodes produce more than that in one go. If it fits into a
+			 * single fetch no node will ever be asked for more rows.
+			 */
+			combiner->bounded_fetch = false;
+			if (combiner->tuples_needed > 0 &&
+					combiner->tuples_needed <= fetch)
+			{
+				fetch = (int) combiner->tuples_needed;
+				combiner->bounded_fetch = true;
+			}
+
 			if (plan->unique)
 				snprintf(cursor, NAMEDATALEN, "%s_%d", plan->cursor, plan->unique);
 			else
@@ -6008,6 +6340,18 @@ primary_mode_phase_two:
 				/* rebind */
 				pgxc_node_send_bind(conn, combiner->cursor, combiner->cursor,
 									paramlen, paramdata);
+				/* runtime filter, after we are bound to the shared queue */
+				if (node->runtime_filter &&
+						pgxc_node_send_runtime_filter(conn, combiner->cursor,
+													  node->runtime_filter,
+													  plan->runtimeFilterSize))
+				{
+					combiner->conn_count = 0;
+					pfree(combiner->connections);
+					ereport(ERROR,
+							(errcode(ERRCODE_INTERNAL_ERROR),
+							 errmsg("Failed to send runtime filter to data nodes")));
+				}
 				/* execute */
 				pgxc_node_send_execute(conn, combiner->cursor, fetch);
 				/* submit */
@@ -6087,6 +6431,18 @@ primary_mode_phase_two:
 
 				/* bind */
 				pgxc_node_send_bind(conn, cursor, cursor, paramlen, paramdata);
+				/* runtime filter, after we are bound to the shared queue */
+				if (node->runtime_filter &&
+						pgxc_node_send_runtime_filter(conn, cursor,
+													  node->runtime_filter,
+													  plan->runtimeFilterSize))
+				{
+					combiner->conn_count = 0;
+					pfree(combiner->connections);
+					ereport(ERROR,
+							(errcode(ERRCODE_INTERNAL_ERROR),
+							 errmsg("Failed to send runtime filter to data nodes")));
+				}
 				/* execute */
 				pgxc_node_send_execute(conn, cursor, fetch);
 				/* submit */
@@ -6170,6 +6526,20 @@ primary_mode_phase_two:
 		}
 		else
 			node->bound = true;
+		node->tuples_returned = 0;
+	}
+
+	/*
+	 * Stop fetching from the nodes once the consumer got all the rows it
+	 * needs. Whatever they have sent in excess is discarded when the subplan
+	 * is rescanned or ended.
+	 */
+	if (combiner->tuples_needed >= 0 &&
+			node->tuples_returned >= combiner->tuples_needed)
+	{
+		if (log_remotesubplan_stats)
+			ShowUsageCommon("ExecRemoteSubplan", &start_r, &start_t);
+		return NULL;
 	}
 
 	if (combiner->tuplesortstate)
@@ -6177,6 +6547,7 @@ primary_mode_phase_two:
 		if (tuplesort_gettupleslot((Tuplesortstate *) combiner->tuplesortstate,
 								   true, true, resultslot, NULL))
 		{
+			node->tuples_returned++;
 			if (log_remotesubplan_stats)
 				ShowUsageCommon("ExecRemoteSubplan", &start_r, &start_t);
 			return resultslot;
@@ -6187,6 +6558,7 @@ primary_mode_phase_two:
 		TupleTableSlot *slot = FetchTuple(combiner);
 		if (!TupIsNull(slot))
 		{
+			node->tuples_returned++;
 			if (log_remotesubplan_stats)
 				ShowUsageCommon("ExecRemoteSubplan", &start_r, &start_t);
 			return slot;
@@ -6240,6 +6612,136 @@ ExecReScanRemoteSubplan(RemoteSubplanState *node)
 }
 
 
+/*
+ * Append an instrumentation entry to the message. Only the options and the
+ * counters accumulated over the completed cycles of the plan node are sent.
+ */
+static void
+append_remote_instrumentation(StringInfo buf, const char *nodename,
+							  const char *consumer, int plan_node_id,
+							  Instrumentation *instrument)
+{
+	BufferUsage *bufusage = &instrument->bufusage;
+
+	pq_sendstring(buf, nodename);
+	pq_sendstring(buf, consumer);
+	pq_sendint(buf, plan_node_id, 4);
+	pq_sendbyte(buf, instrument->need_timer);
+	pq_sendbyte(buf, instrument->need_bufusage);
+	pq_sendfloat8(buf, instrument->startup);
+	pq_sendfloat8(buf, instrument->total);
+	pq_sendfloat8(buf, instrument->ntuples);
+	pq_sendfloat8(buf, instrument->nloops);
+	pq_sendfloat8(buf, instrument->nfiltered1);
+	pq_sendfloat8(buf, instrument->nfiltered2);
+	pq_sendint64(buf, bufusage->shared_blks_hit);
+	pq_sendint64(buf, bufusage->shared_blks_read);
+	pq_sendint64(buf, bufusage->shared_blks_dirtied);
+	pq_sendint64(buf, bufusage->shared_blks_written);
+	pq_sendint64(buf, bufusage->local_blks_hit);
+	pq_sendint64(buf, bufusage->local_blks_read);
+	pq_sendint64(buf, bufusage->local_blks_dirtied);
+	pq_sendint64(buf, bufusage->local_blks_written);
+	pq_sendint64(buf, bufusage->temp_blks_read);
+	pq_sendint64(buf, bufusage->temp_blks_written);
+	pq_sendint64(buf, INSTR_TIME_GET_MICROSEC(bufusage->blk_read_time));
+	pq_sendint64(buf, INSTR_TIME_GET_MICROSEC(bufusage->blk_write_time));
+}
+
+/*
+ * Add instrumentation of the plan nodes executed locally and the entries
+ * reported by the nodes executing the RemoteSubplans of the plan.
+ */
+static bool
+collect_remote_instrumentation(PlanState *planstate, StringInfo buf)
+{
+	ListCell   *lc;
+
+	if (planstate->instrument)
+	{
+		InstrEndLoop(planstate->instrument);
+		append_remote_instrumentation(buf, PGXCNodeName, "",
+									  planstate->plan->plan_node_id,
+									  planstate->instrument);
+	}
+	foreach(lc, planstate->remote_instrument)
+	{
+		RemoteInstrumentation *ri = (RemoteInstrumentation *) lfirst(lc);
+
+		append_remote_instrumentation(buf, NameStr(ri->nodename),
+									  NameStr(ri->consumer), ri->plan_node_id,
+									  &ri->instrument);
+	}
+	return planstate_tree_walker(planstate, collect_remote_instrumentation,
+								 buf);
+}
+
+/*
+ * SendRemoteInstrumentation
+ *	  Report instrumentation of the plan sent down by a RemoteSubplan node
+ *	  back to the requesting node. Invoked when the plan is completed, before
+ *	  CommandComplete is sent. The producer of a distributed plan also reports
+ *	  how many rows it has sent to each of the consumers.
+ */
+void
+SendRemoteInstrumentation(QueryDesc *queryDesc)
+{
+	StringInfoData buf;
+
+	/* Consumers do not execute the plan */
+	if (queryDesc == NULL || queryDesc->planstate == NULL ||
+			queryDesc->myindex != -1 ||
+			queryDesc->plannedstmt->instrument_options == 0)
+		return;
+
+	pq_beginmessage(&buf, 'i');
+	collect_remote_instrumentation(queryDesc->planstate, &buf);
+
+	if (queryDesc->dest && queryDesc->dest->mydest == DestProducer)
+	{
+		int		   *nodes;
+		long	   *rows;
+		int			count;
+		int			i;
+
+		count = ProducerGetSentRows(queryDesc->dest, &nodes, &rows);
+		for (i = 0; i < count; i++)
+		{
+			Instrumentation instrument;
+
+			memset(&instrument, 0, sizeof(Instrumentation));
+			instrument.ntuples = rows[i];
+			instrument.nloops = 1;
+			/* Plan node id is assigned by the receiving RemoteSubplan */
+			append_remote_instrumentation(&buf, PGXCNodeName,
+					get_pgxc_nodename(PGXCNodeGetNodeOid(nodes[i],
+														 PGXC_NODE_DATANODE)),
+					-1, &instrument);
+		}
+	}
+	pq_endmessage(&buf);
+}
+
+
+/*
+ * ExecRemoteSubplanSetFilter
+ *	  Remember the runtime filter built by the parent hash join. It is sent to
+ *	  the producers next time the subplan is bound, they use it to discard
+ *	  rows for us before putting them into the shared queue.
+ */
+void
+ExecRemoteSubplanSetFilter(RemoteSubplanState *node, const uint32 *filter)
+{
+	int			size = ((RemoteSubplan *) node->combiner.ss.ps.plan)->runtimeFilterSize;
+
+	Assert(size > 0);
+	if (node->runtime_filter == NULL)
+		node->runtime_filter = (uint32 *)
+			MemoryContextAlloc(node->combiner.ss.ps.state->es_query_cxt, size);
+	memcpy(node->runtime_filter, filter, size);
+}
+
+
 void
 ExecEndRemoteSubplan(RemoteSubplanState *node)
 {
@@ -6254,6 +6756,8 @@ ExecEndRemoteSubplan(RemoteSubplanState *node)
 
 	if (outerPlanState(node))
 		ExecEndNode(outerPlanState(node));
+	if (node->remote_planstate)
+		ExecEndNode(node->remote_planstate);
 	if (node->locator)
 		freeLocator(node->locator);
 
@@ -68,6 +68,8 @@
  * pgxc_node_send_cmd_id     - sends CommandId to remote node (M)
  * pgxc_node_send_snapshot   - sends snapshot to remote node (s)
  * pgxc_node_send_timestamp  - sends timestamp to remote node (t)
+ * pgxc_node_send_commit_timestamp - sends commit timestamp to remote node (T)
+ * pgxc_node_send_query_id   - sends query identifier to remote node (q)
  *
  *
  * misc functions
@@ -134,6 +136,8 @@
 #include "pgxc/pgxc.h"
 #include "pgxc/pgxcnode.h"
 #include "pgxc/poolmgr.h"
+#include "pgxc/squeue.h"
+#include "pgxc/waitstats.h"
 #include "storage/ipc.h"
 #include "storage/lwlock.h"
 #include "tcop/dest.h"
@@ -195,10 +199,12 @@ static bool DoRefreshRemoteHandles(void);
 static void pgxc_node_init(PGXCNodeHandle *handle, int sock,
 		bool global_session, int pid);
 static void pgxc_node_free(PGXCNodeHandle *handle);
+static void pgxc_node_set_inflight(PGXCNodeHandle *handle, bool inflight);
 static void pgxc_node_all_free(void);
 
 static int	get_int(PGXCNodeHandle * conn, size_t len, int *out);
 static int	get_char(PGXCNodeHandle * conn, char *out);
+static void pgxc_node_put_int64(PGXCNodeHandle *handle, int64 i);
 
 
 /*
@@ -226,6 +232,7 @@ init_pgxc_handle(PGXCNodeHandle *pgxc_handle)
 	pgxc_handle->inCursor = 0;
 	pgxc_handle->outEnd = 0;
 	pgxc_handle->needSync = false;
+	pgxc_handle->inflight = false;
 
 	if (pgxc_handle->outBuffer == NULL || pgxc_handle->inBuffer == NULL)
 	{
@@ -361,6 +368,39 @@ pgxc_node_free(PGXCNodeHandle *handle)
 	if (handle->sock != NO_SOCKET)
 		close(handle->sock);
 	handle->sock = NO_SOCKET;
+	pgxc_node_set_inflight(handle, false);
+}
+
+/*
+ * pgxc_node_set_inflight
+ *	  Account the Datanode connection as busy or idle in the node load.
+ */
+static void
+pgxc_node_set_inflight(PGXCNodeHandle *handle, bool inflight)
+{
+	if (handle->inflight == inflight)
+		return;
+
+	handle->inflight = inflight;
+
+	/* Only Datanode load is of interest */
+	if (dn_handles &&
+			handle >= dn_handles && handle < dn_handles + NumDataNodes)
+		PgxcNodeUpdateLoad(handle - dn_handles, handle->nodeoid, inflight);
+}
+
+/*
+ * PGXCNodeReleaseLoad
+ *	  Remove requests of this backend from the node load, called when the
+ * backend is ending and connections may still be busy.
+ */
+void
+PGXCNodeReleaseLoad(void)
+{
+	int i;
+
+	for (i = 0; dn_handles && i < NumDataNodes; i++)
+		pgxc_node_set_inflight(&dn_handles[i], false);
 }
 
 /*
@@ -467,6 +507,7 @@ pgxc_node_receive(const int conn_count,
 	bool	is_msg_buffered;
 	long 	timeout_ms;
 	struct	pollfd pool_fd[conn_count];
+	instr_time	wait_start;
 
 	/* sockets to be polled index */
 	sockets_to_poll = 0;
@@ -525,6 +566,7 @@ pgxc_node_receive(const int conn_count,
 	else
 		timeout_ms = (timeout->tv_sec * (uint64_t) 1000) + (timeout->tv_usec / 1000);
 
+	RemoteWaitStart(wait_start);
 retry:
 	CHECK_FOR_INTERRUPTS();
 	poll_val  = poll(pool_fd, conn_count, timeout_ms);
@@ -540,6 +582,19 @@ retry:
 		return NO_ERROR_OCCURED;
 	}
 
+	/* Account the wait to the nodes which ended it */
+	if (!INSTR_TIME_IS_ZERO(wait_start))
+	{
+		PGXCNodeHandle *answered[conn_count];
+		int		nanswered = 0;
+
+		for (i = 0; i < conn_count; i++)
+			if (pool_fd[i].fd != -1 && pool_fd[i].revents != 0)
+				answered[nanswered++] = connections[i];
+		RemoteWaitEndNodes(REMOTE_WAIT_RECEIVE, wait_start, answered,
+						   nanswered);
+	}
+
 	if (poll_val == 0)
 	{
 		/* Handle timeout */
@@ -1878,6 +1933,40 @@ pgxc_node_send_cmd_id(PGXCNodeHandle *handle, CommandId cid)
 	return 0;
 }
 
+/*
+ * pgxc_node_send_query_id
+ *	  Send the identifier of the query being executed down to the remote node,
+ *	  statistics of the statements it runs on behalf of the query are recorded
+ *	  under the same identifier
+ */
+int
+pgxc_node_send_query_id(PGXCNodeHandle *handle, uint32 queryId)
+{
+	int			msglen = 8;
+	uint32		n32;
+
+	/* Invalid connection state, return error */
+	if (handle->state != DN_CONNECTION_STATE_IDLE)
+		return EOF;
+
+	/* msgType + msgLen */
+	if (ensure_out_buffer_capacity(handle->outEnd + 1 + msglen, handle) != 0)
+	{
+		add_error_message(handle, "out of memory");
+		return EOF;
+	}
+
+	handle->outBuffer[handle->outEnd++] = 'q';
+	msglen = htonl(msglen);
+	memcpy(handle->outBuffer + handle->outEnd, &msglen, 4);
+	handle->outEnd += 4;
+	n32 = htonl(queryId);
+	memcpy(handle->outBuffer + handle->outEnd, &n32, 4);
+	handle->outEnd += 4;
+
+	return 0;
+}
+
 /*
  * pgxc_node_send_snapshot
  *	  Send the snapshot down to the remote node.
@@ -1897,6 +1986,11 @@ pgxc_node_send_snapshot(PGXCNodeHandle *handle, Snapshot snapshot)
 	msglen = 20;
 	if (snapshot->xcnt > 0)
 		msglen += snapshot->xcnt * 4;
+#ifdef XCP
+	/* timestamp of a timestamp based snapshot goes last */
+	if (snapshot->snapshot_ts != 0)
+		msglen += 8;
+#endif
 
 	/* msgType + msgLen */
 	if (ensure_out_buffer_capacity(handle->outEnd + 1 + msglen, handle) != 0)
@@ -1930,19 +2024,49 @@ pgxc_node_send_snapshot(PGXCNodeHandle *handle, Snapshot snapshot)
 		handle->outEnd += sizeof (TransactionId);
 	}
 
+#ifdef XCP
+	if (snapshot->snapshot_ts != 0)
+		pgxc_node_put_int64(handle, (int64) snapshot->snapshot_ts);
+#endif
+
 	return 0;
 }
 
 /*
- * pgxc_node_send_timestamp
- *	  Send the timestamp down to the remote node
+ * Append an int64 to the output buffer in network byte order, the caller
+ * has made room for it
  */
-int
-pgxc_node_send_timestamp(PGXCNodeHandle *handle, TimestampTz timestamp)
+static void
+pgxc_node_put_int64(PGXCNodeHandle *handle, int64 i)
 {
-	int		msglen = 12; /* 4 bytes for msglen and 8 bytes for timestamp (int64) */
 	uint32	n32;
-	int64	i = (int64) timestamp;
+
+	/* High order half first */
+#ifdef INT64_IS_BUSTED
+	/* don't try a right shift of 32 on a 32-bit word */
+	n32 = (i < 0) ? -1 : 0;
+#else
+	n32 = (uint32) (i >> 32);
+#endif
+	n32 = htonl(n32);
+	memcpy(handle->outBuffer + handle->outEnd, &n32, 4);
+	handle->outEnd += 4;
+
+	/* Now the low order half */
+	n32 = (uint32) i;
+	n32 = htonl(n32);
+	memcpy(handle->outBuffer + handle->outEnd, &n32, 4);
+	handle->outEnd += 4;
+}
+
+/*
+ * Send a message made of a single timestamp
+ */
+static int
+pgxc_node_send_timestamp_message(PGXCNodeHandle *handle, char msgtype,
+								 TimestampTz timestamp)
+{
+	int		msglen = 12; /* 4 bytes for msglen and 8 bytes for timestamp (int64) */
 
 	/* Invalid connection state, return error */
 	if (handle->state != DN_CONNECTION_STATE_IDLE)
@@ -1954,27 +2078,88 @@ pgxc_node_send_timestamp(PGXCNodeHandle *handle, TimestampTz timestamp)
 		add_error_message(handle, "out of memory");
 		return EOF;
 	}
-	handle->outBuffer[handle->outEnd++] = 't';
+	handle->outBuffer[handle->outEnd++] = msgtype;
 	msglen = htonl(msglen);
 	memcpy(handle->outBuffer + handle->outEnd, &msglen, 4);
 	handle->outEnd += 4;
 
-	/* High order half first */
-#ifdef INT64_IS_BUSTED
-	/* don't try a right shift of 32 on a 32-bit word */
-	n32 = (i < 0) ? -1 : 0;
-#else
-	n32 = (uint32) (i >> 32);
-#endif
-	n32 = htonl(n32);
-	memcpy(handle->outBuffer + handle->outEnd, &n32, 4);
+	pgxc_node_put_int64(handle, (int64) timestamp);
+
+	return 0;
+}
+
+/*
+ * pgxc_node_send_timestamp
+ *	  Send the timestamp down to the remote node
+ */
+int
+pgxc_node_send_timestamp(PGXCNodeHandle *handle, TimestampTz timestamp)
+{
+	return pgxc_node_send_timestamp_message(handle, 't', timestamp);
+}
+
+/*
+ * pgxc_node_send_commit_timestamp
+ *	  Send the commit timestamp of a transaction using timestamp based
+ *	  snapshots down to the remote node, ahead of its COMMIT PREPARED
+ */
+int
+pgxc_node_send_commit_timestamp(PGXCNodeHandle *handle, TimestampTz timestamp)
+{
+	return pgxc_node_send_timestamp_message(handle, 'T', timestamp);
+}
+
+/*
+ * pgxc_node_send_runtime_filter
+ *	  Send the runtime filter for the shared queue of the bound portal down
+ *	  to the remote node
+ */
+int
+pgxc_node_send_runtime_filter(PGXCNodeHandle *handle, const char *portal,
+							  const uint32 *filter, int size)
+{
+	/* portal name size (allow NULL) */
+	int			pnameLen = portal ? strlen(portal) + 1 : 1;
+	/* size + pnameLen + filter size + filter */
+	int			msgLen = 4 + pnameLen + 4 + size;
+	uint32		n32;
+	int			i;
+
+	/* Invalid connection state, return error */
+	if (handle->state != DN_CONNECTION_STATE_IDLE)
+		return EOF;
+
+	/* msgType + msgLen */
+	if (ensure_out_buffer_capacity(handle->outEnd + 1 + msgLen, handle) != 0)
+	{
+		add_error_message(handle, "out of memory");
+		return EOF;
+	}
+
+	handle->outBuffer[handle->outEnd++] = 'R';
+	/* size */
+	msgLen = htonl(msgLen);
+	memcpy(handle->outBuffer + handle->outEnd, &msgLen, 4);
 	handle->outEnd += 4;
+	/* portal name */
+	if (portal)
+	{
+		memcpy(handle->outBuffer + handle->outEnd, portal, pnameLen);
+		handle->outEnd += pnameLen;
+	}
+	else
+		handle->outBuffer[handle->outEnd++] = '\0';
 
-	/* Now the low order half */
-	n32 = (uint32) i;
-	n32 = htonl(n32);
+	/* filter size and bits */
+	n32 = htonl((uint32) size);
 	memcpy(handle->outBuffer + handle->outEnd, &n32, 4);
 	handle->outEnd += 4;
+	for (i = 0; i < size / sizeof(uint32); i++)
+	{
+		n32 = htonl(filter[i]);
+		memcpy(handle->outBuffer + handle->outEnd, &n32, 4);
+		handle->outEnd += 4;
+	}
 
 	return 0;
 }
@@ -2077,13 +2262,14 @@ get_any_handle(List *datanodelist)
 					/* The node is requested */
 					List   *allocate = list_make1_int(node);
 					int	   *pids;
+					char   *states;
 					int    *fds = PoolManagerGetConnections(allocate, NIL,
-							&pids);
+							&pids, &states);
 					PGXCNodeHandle		*node_handle;
 
 					if (!fds)
 					{
-						Assert(pids != NULL);
+						Assert(pids == NULL);
 						ereport(ERROR,
 								(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
 								 errmsg("Failed to get pooled connections"),
@@ -2101,8 +2287,10 @@ get_any_handle(List *datanodelist)
 					datanode_count++;
 
 					elog(DEBUG1, "Established a connection with datanode \"%s\","
-							"remote backend PID %d, socket fd %d, global session %c",
-							node_handle->nodename, (int) pids[0], fds[0], 'T');
+							"remote backend PID %d, socket fd %d, global session %c,"
+							" state %c",
+							node_handle->nodename, (int) pids[0], fds[0], 'T',
+							states[0]);
 
 					/*
 					 * set load_balancer for next time and return the handle
@@ -2311,7 +2499,9 @@ get_handles(List *datanodelist, List *coordlist, bool is_coord_only_query, bool
 	{
 		int	j = 0;
 		int *pids;
-		int	*fds = PoolManagerGetConnections(dn_allocate, co_allocate, &pids);
+		char *states;
+		int	*fds = PoolManagerGetConnections(dn_allocate, co_allocate, &pids,
+											 &states);
 
 		if (!fds)
 		{
@@ -2346,6 +2536,7 @@ get_handles(List *datanodelist, List *coordlist, bool is_coord_only_query, bool
 			{
 				int			node = lfirst_int(node_list_item);
 				int			fdsock = fds[j];
+				char		state = states[j];
 				int			be_pid = pids[j++];
 
 				if (node < 0 || node >= NumDataNodes)
@@ -2361,9 +2552,10 @@ get_handles(List *datanodelist, List *coordlist, bool is_coord_only_query, bool
 				datanode_count++;
 
 				elog(DEBUG1, "Established a connection with datanode \"%s\","
-						"remote backend PID %d, socket fd %d, global session %c",
+						"remote backend PID %d, socket fd %d, global session %c,"
+						" state %c",
 						node_handle->nodename, (int) be_pid, fdsock,
-						is_global_session ? 'T' : 'F');
+						is_global_session ? 'T' : 'F', state);
 			}
 		}
 		/* Initialisation for Coordinators */
@@ -2373,6 +2565,7 @@ get_handles(List *datanodelist, List *coordlist, bool is_coord_only_query, bool
 			{
 				int			node = lfirst_int(node_list_item);
 				int			be_pid = pids[j];
+				char		state = states[j];
 				int			fdsock = fds[j++];
 
 				if (node < 0 || node >= NumCoords)
@@ -2388,13 +2581,16 @@ get_handles(List *datanodelist, List *coordlist, bool is_coord_only_query, bool
 				coord_count++;
 
 				elog(DEBUG1, "Established a connection with coordinator \"%s\","
-						"remote backend PID %d, socket fd %d, global session %c",
+						"remote backend PID %d, socket fd %d, global session %c,"
+						" state %c",
 						node_handle->nodename, (int) be_pid, fdsock,
-						is_global_session ? 'T' : 'F');
+						is_global_session ? 'T' : 'F', state);
 			}
 		}
 
 		pfree(fds);
+		pfree(pids);
+		pfree(states);
 
 		if (co_allocate)
 			list_free(co_allocate);
@@ -2600,6 +2796,20 @@ PGXCNodeGetNodeIdFromName(char *node_name, char *node_type)
 	return PGXCNodeGetNodeId(nodeoid, node_type);
 }
 
+/*
+ * PGXCNodeIsConnected
+ *	  Check if the session currently holds a connection to the Datanode at
+ * the given position in handles array.
+ */
+bool
+PGXCNodeIsConnected(int nodeid)
+{
+	if (dn_handles == NULL || nodeid < 0 || nodeid >= NumDataNodes)
+		return false;
+
+	return dn_handles[nodeid].sock != NO_SOCKET;
+}
+
 /*
  * paramlist_delete_param
  *	  Delete parameter with the specified name from the parameter list.
@@ -2916,6 +3126,9 @@ PoolerMessagesPending(void)
 	if (HandlesRefreshPending)
 		return true;
 
+	if (PoolManagerReclaimPending())
+		return true;
+
 	return false;
 }
 
@@ -3110,6 +3323,10 @@ PGXCNodeSetConnectionState(PGXCNodeHandle *handle, DNConnectionState new_state)
 	elog(DEBUG5, "Changing connection state for node %s, old state %d, "
 			"new state %d", handle->nodename, handle->state, new_state);
 	handle->state = new_state;
+	pgxc_node_set_inflight(handle,
+						   new_state == DN_CONNECTION_STATE_QUERY ||
+						   new_state == DN_CONNECTION_STATE_COPY_IN ||
+						   new_state == DN_CONNECTION_STATE_COPY_OUT);
 }
 
 /*
@@ -3306,5 +3523,12 @@ HandlePoolerMessages(void)
 		elog(LOG, "Backend (%u), doing handles refresh",
 			 MyBackendId);
 	}
+
+	/*
+	 * The pooler wants its connections back. Return them now if the session
+	 * is idle, a transaction returns them when it ends.
+	 */
+	if (PoolManagerReclaimPending() && !IsTransactionOrTransactionBlock())
+		ReleaseIdleRemoteConnections();
 	return;
 }
@@ -28,8 +28,10 @@
 #include <stddef.h>
 #include "c.h"
 #include "postgres.h"
+#include "pgstat.h"
 #include "pgxc/poolcomm.h"
 #include "storage/ipc.h"
+#include "storage/latch.h"
 #include "utils/elog.h"
 #include "miscadmin.h"
 
@@ -496,38 +498,53 @@ pool_putmessage(PoolPort *port, char msgtype, const char *s, size_t len)
 	return 0;
 }
 
-/* message code('f'), size(8), node_count */
-#define SEND_MSG_BUFFER_SIZE 9
+/* message code('c'), size, connection count */
+#define SEND_CONN_HEADER_SIZE 9
+/* remote backend PID and state of each connection */
+#define SEND_CONN_ENTRY_SIZE 5
 /* message code('s'), result */
 #define SEND_RES_BUFFER_SIZE 5
 #define SEND_PID_BUFFER_SIZE (5 + (MaxConnections - 1) * 4)
 
 /*
- * Build up a message carrying file descriptors or process numbers and send them over specified
- * connection
+ * Send the connections to the nodes a session asked for, in a single
+ * message: the file descriptors travel as ancillary data, along with the PID
+ * of the remote backend and the state of each connection. A count of 0 tells
+ * the session the connections could not be acquired.
  */
 int
-pool_sendfds(PoolPort *port, int *fds, int count)
+pool_sendconns(PoolPort *port, int *fds, int *pids, char *states, int count)
 {
 	struct iovec iov[1];
 	struct msghdr msg;
-	char		buf[SEND_MSG_BUFFER_SIZE];
+	int			len = SEND_CONN_HEADER_SIZE + count * SEND_CONN_ENTRY_SIZE;
+	char	   *buf = palloc(len);
 	uint		n32;
-	int                     controllen =  CMSG_LEN(count * sizeof(int));
+	int			controllen = CMSG_LEN(count * sizeof(int));
 	struct cmsghdr *cmptr = NULL;
+	int			i;
 
-	buf[0] = 'f';
-	n32 = htonl((uint32) 8);
+	buf[0] = 'c';
+	n32 = htonl((uint32) (len - 1));
 	memcpy(buf + 1, &n32, 4);
 	n32 = htonl((uint32) count);
 	memcpy(buf + 5, &n32, 4);
+	for (i = 0; i < count; i++)
+	{
+		char	   *entry = buf + SEND_CONN_HEADER_SIZE + i * SEND_CONN_ENTRY_SIZE;
+
+		n32 = htonl((uint32) pids[i]);
+		memcpy(entry, &n32, 4);
+		entry[4] = states[i];
+	}
 
 	iov[0].iov_base = buf;
-	iov[0].iov_len = SEND_MSG_BUFFER_SIZE;
+	iov[0].iov_len = len;
 	msg.msg_iov = iov;
 	msg.msg_iovlen = 1;
 	msg.msg_name = NULL;
 	msg.msg_namelen = 0;
+	msg.msg_flags = 0;
 	if (count == 0)
 	{
 		msg.msg_control = NULL;
@@ -536,55 +553,99 @@ pool_sendfds(PoolPort *port, int *fds, int count)
 	else
 	{
 		if ((cmptr = malloc(CMSG_SPACE(count * sizeof(int)))) == NULL)
+		{
+			pfree(buf);
 			return EOF;
+		}
 		cmptr->cmsg_level = SOL_SOCKET;
 		cmptr->cmsg_type = SCM_RIGHTS;
 		cmptr->cmsg_len = controllen;
 		msg.msg_control = (caddr_t) cmptr;
 		msg.msg_controllen = controllen;
-		/* the fd to pass */
+		/* the fds to pass */
 		memcpy(CMSG_DATA(CMSG_FIRSTHDR(&msg)), fds, count * sizeof(int));
 	}
 
-	if (sendmsg(Socket(*port), &msg, 0) != SEND_MSG_BUFFER_SIZE)
+	if (sendmsg(Socket(*port), &msg, 0) != len)
 	{
 		if (cmptr)
 			free(cmptr);
+		pfree(buf);
 		return EOF;
 	}
 
 	if (cmptr)
 		free(cmptr);
+	pfree(buf);
 
 	return 0;
 }
 
 
 /*
- * Read a message from the specified connection carrying file descriptors
+ * Read the message sent by pool_sendconns, for count connections
+ *
+ * The pooler may keep the session waiting for connections, see
+ * pool_wait_timeout, so interrupts are processed while waiting. If one
+ * throws an error, the answer is still to come: the caller must read it
+ * before the next one, see PoolManagerDrainAnswer.
  */
 int
-pool_recvfds(PoolPort *port, int *fds, int count)
+pool_recvconns(PoolPort *port, int *fds, int *pids, char *states, int count)
 {
 	int			r;
+	int			len = SEND_CONN_HEADER_SIZE + count * SEND_CONN_ENTRY_SIZE;
+	char	   *buf;
 	uint		n32;
-	char		buf[SEND_MSG_BUFFER_SIZE];
 	struct iovec iov[1];
 	struct msghdr msg;
-	int                     controllen = CMSG_LEN(count * sizeof(int));
-	struct cmsghdr *cmptr = malloc(CMSG_SPACE(count * sizeof(int)));
+	int			controllen = CMSG_LEN(count * sizeof(int));
+	struct cmsghdr *cmptr;
+	int			i;
+
+	/* Wait for the answer before allocating anything */
+	for (;;)
+	{
+		int			rc;
+
+		rc = WaitLatchOrSocket(MyLatch,
+							   WL_LATCH_SET | WL_SOCKET_READABLE |
+							   WL_POSTMASTER_DEATH,
+							   Socket(*port), -1L,
+							   WAIT_EVENT_POOLER_CONNECTIONS);
+
+		if (rc & WL_POSTMASTER_DEATH)
+			ereport(FATAL,
+					(errcode(ERRCODE_ADMIN_SHUTDOWN),
+					 errmsg("terminating connection due to unexpected postmaster exit")));
+
+		if (rc & WL_LATCH_SET)
+		{
+			ResetLatch(MyLatch);
+			CHECK_FOR_INTERRUPTS();
+		}
+
+		if (rc & WL_SOCKET_READABLE)
+			break;
+	}
 
+	buf = palloc(len);
+	cmptr = malloc(CMSG_SPACE(count * sizeof(int)));
 	if (cmptr == NULL)
+	{
+		pfree(buf);
 		return EOF;
+	}
 
 	iov[0].iov_base = buf;
-	iov[0].iov_len = SEND_MSG_BUFFER_SIZE;
+	iov[0].iov_len = len;
 	msg.msg_iov = iov;
 	msg.msg_iovlen = 1;
 	msg.msg_name = NULL;
 	msg.msg_namelen = 0;
 	msg.msg_control = (caddr_t) cmptr;
 	msg.msg_controllen = controllen;
+	msg.msg_flags = 0;
 
 	r = recvmsg(Socket(*port), &msg, 0);
 	if (r < 0)
@@ -601,7 +662,7 @@ pool_recvfds(PoolPort *port, int *fds, int count)
 	{
 		goto failure;
 	}
-	else if (r != SEND_MSG_BUFFER_SIZE)
+	else if (r < SEND_CONN_HEADER_SIZE)
 	{
 		ereport(ERROR,
 				(errcode(ERRCODE_PROTOCOL_VIOLATION),
@@ -610,7 +671,7 @@ pool_recvfds(PoolPort *port, int *fds, int count)
 	}
 
 	/* Verify response */
-	if (buf[0] != 'f')
+	if (buf[0] != 'c')
 	{
 		ereport(ERROR,
 				(errcode(ERRCODE_PROTOCOL_VIOLATION),
@@ -618,16 +679,6 @@ pool_recvfds(PoolPort *port, int *fds, int count)
 		goto failure;
 	}
 
-	memcpy(&n32, buf + 1, 4);
-	n32 = ntohl(n32);
-	if (n32 != 8)
-	{
-		ereport(ERROR,
-				(errcode(ERRCODE_PROTOCOL_VIOLATION),
-				 errmsg("invalid message size")));
-		goto failure;
-	}
-
 	/*
 	 * If connection count is 0 it means pool does not have connections
 	 * to  fulfill request. Otherwise number of returned connections
@@ -652,11 +703,49 @@ pool_recvfds(PoolPort *port, int *fds, int count)
 		goto failure;
 	}
 
+	memcpy(&n32, buf + 1, 4);
+	n32 = ntohl(n32);
+	if (n32 != len - 1)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid message size")));
+		goto failure;
+	}
+
+	/* The descriptors came with the first byte, the rest may lag behind */
+	while (r < len)
+	{
+		int			n = recv(Socket(*port), buf + r, len - r, 0);
+
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR)
+				continue;
+			ereport(ERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("incomplete message from client")));
+			goto failure;
+		}
+		r += n;
+	}
+
 	memcpy(fds, CMSG_DATA(CMSG_FIRSTHDR(&msg)), count * sizeof(int));
+	for (i = 0; i < count; i++)
+	{
+		char	   *entry = buf + SEND_CONN_HEADER_SIZE + i * SEND_CONN_ENTRY_SIZE;
+
+		memcpy(&n32, entry, 4);
+		pids[i] = ntohl(n32);
+		states[i] = entry[4];
+	}
+
 	free(cmptr);
+	pfree(buf);
 	return 0;
 failure:
 	free(cmptr);
+	pfree(buf);
 	return EOF;
 }
 
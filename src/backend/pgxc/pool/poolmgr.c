@@ -31,13 +31,15 @@
  * descriptors for all the nodes at once.
  *
  *
- * Note: The connection requests are not queued; if a connection is not
- * unavailable (and can't be opened right away), the request will simply
- * fail. This should be implemented one day, although there is a chance
- * for deadlocks. For now, limiting connections should be done between
- * the application and the coordinator. Still, this is useful to avoid
- * having to re-establish connections to the datanodes all the time for
- * multiple coordinator backend sessions.
+ * Note: By default the connection requests are not queued; if a connection
+ * is not unavailable (and can't be opened right away), the request will
+ * simply fail. With pool_wait_timeout, requests for a node pool that
+ * reached max_pool_size wait for another session to return a connection,
+ * which bounds the number of connections to each node regardless of the
+ * number of sessions. Sessions holding connections each other waits for
+ * deadlock until the timeout expires, though. Still, this is useful to
+ * avoid having to re-establish connections to the datanodes all the time
+ * for multiple coordinator backend sessions.
  *
  * XXX Well, we try to do pools_maintenance(), which closes all old idle
  * connections. But we try to do that only once, to prevent infinite
@@ -131,7 +133,9 @@
  *
  *    Sends a request to the pool manager (through the pool handle).
  *    The pool manager handles this in handle_get_connections(), and
- *    sends back a list of file descriptors (pooled connections).
+ *    sends back a list of file descriptors (pooled connections), with
+ *    the PIDs of the remote backends and the state of the connections,
+ *    all in a single message.
  *
  * 4) PoolManagerReleaseConnections (backend session)
  *
@@ -242,6 +246,7 @@
 #include "access/xact.h"
 #include "catalog/pgxc_node.h"
 #include "commands/dbcommands.h"
+#include "common/ip.h"
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
 #include "nodes/nodes.h"
@@ -250,6 +255,7 @@
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
 #include "utils/resowner.h"
+#include "utils/timestamp.h"
 #include "lib/stringinfo.h"
 #include "libpq/pqformat.h"
 #include "pgxc/locator.h"
@@ -258,9 +264,11 @@
 #include "pgxc/pgxc.h"
 #include "pgxc/poolmgr.h"
 #include "pgxc/poolutils.h"
+#include "pgxc/waitstats.h"
 #include "postmaster/postmaster.h"		/* For UnixSocketDir */
 #include "storage/ipc.h"
 #include "storage/procarray.h"
+#include "storage/procsignal.h"
 #include "utils/varlena.h"
 
 #include "../interfaces/libpq/libpq-fe.h"
@@ -273,6 +281,11 @@ int			PoolMaintenanceTimeout = 30;
 int			MaxPoolSize = 100;
 int			PoolerPort = 6667;
 bool		PersistentConnections = false;
+bool		PoolStickyConnections = false;
+bool		PoolMultiplexing = false;
+int			PoolWaitTimeout = 0;
+int			PoolConnectTimeout = 500;
+int			PoolNodeProbeInterval = 1000;
 
 /* Flag to tell if we are Postgres-XC pooler process */
 static bool am_pgxc_pooler = false;
@@ -301,6 +314,99 @@ static MemoryContext PoolerCoreContext = NULL;
 /* Pool Agents */
 static MemoryContext PoolerAgentContext = NULL;
 
+/*
+ * Outcome of a connection attempt to a node
+ */
+typedef enum
+{
+	NODE_CONNECT_IN_PROGRESS,
+	NODE_CONNECT_OK,
+	NODE_CONNECT_REFUSED,		/* failed before the node answered */
+	NODE_CONNECT_REJECTED,		/* the node answered with an error */
+	NODE_CONNECT_TIMEOUT		/* pool_connect_timeout expired */
+} NodeConnectResult;
+
+/*
+ * A non-blocking connection attempt to a node
+ */
+typedef struct
+{
+	PGconn	   *conn;
+	PostgresPollingStatusType status;	/* what PQconnectPoll waits for */
+	TimestampTz deadline;		/* 0 if none */
+} NodeConnectAttempt;
+
+/* Longest time between two probes of a node that stays down, in ms */
+#define POOL_NODE_PROBE_MAX_INTERVAL	60000
+
+/*
+ * Circuit breaker of a node.
+ *
+ * Connecting to a node that is down can take as long as pool_connect_timeout,
+ * and the pooler serves no other session meanwhile. So once a connection to
+ * the node is refused or times out, or a backend marked it unhealthy, the
+ * breaker of the node is open: connection requests for it fail at once. The
+ * pooler probes the node every pool_node_probe_interval, doubled after each
+ * failed probe, and closes the breaker when a probe succeeds. The probes are
+ * part of the poll set of the pooler, so they never hold it back.
+ */
+typedef struct
+{
+	Oid			nodeoid;		/* hash key */
+	bool		open;
+	TimestampTz next_probe;		/* when to probe the node, if open */
+	int			failed_probes;	/* in a row, for the backoff */
+	NodeConnectAttempt probe;	/* probe in progress, if probe.conn is set */
+	NodeHealthStats stats;		/* not yet added to the shared node table */
+} PoolNodeBreaker;
+
+static HTAB *nodeBreakers = NULL;
+
+/*
+ * Numeric address of a node host.
+ *
+ * libpq resolves host names synchronously, in PQconnectStart, which would
+ * hold the pooler back as long as the name server does not answer, whatever
+ * pool_connect_timeout. So the pooler resolves the host of each node once,
+ * when the connection information is reloaded or it first connects to the
+ * node, and passes the address to libpq as hostaddr.
+ */
+typedef struct
+{
+	char		host[NAMEDATALEN];	/* hash key */
+	char		addr[NI_MAXHOST];	/* empty if the name was not resolved */
+} PoolHostAddr;
+
+static HTAB *hostAddrs = NULL;
+
+/*
+ * A connection request waiting for the pool to free connections.
+ *
+ * With pool_wait_timeout, a request for a node whose pool reached
+ * max_pool_size does not fail at once, the session waits for its answer
+ * until some other session returns a connection, or the timeout expires.
+ * The waiting requests are served in order of arrival.
+ */
+typedef struct
+{
+	PoolAgent  *agent;
+	List	   *datanodelist;	/* node indexes, as sent by the session */
+	List	   *coordlist;
+	TimestampTz deadline;
+} PoolWaiter;
+
+static List *poolWaiters = NIL;
+
+/*
+ * A node pool is under pressure from the moment it runs short of connections
+ * until it has POOL_PRESSURE_FREE_RATIO of its connections free again, and
+ * did not run short for POOL_PRESSURE_HOLD ms. Without this margin a single
+ * returned connection would end the pressure, and the sessions would be
+ * asked for their connections again by the next request.
+ */
+#define POOL_PRESSURE_FREE_RATIO	10
+#define POOL_PRESSURE_HOLD			1000
+
 /*
  * A list of connection pools per (one for each db/user combination).
  *
@@ -335,6 +441,18 @@ static PoolAgent **poolAgents;
  */
 static PoolHandle *poolHandle = NULL;
 
+/*
+ * Set when the pooler asks the session to return its connections, see
+ * PROCSIG_PGXCPOOL_RECLAIM, and cleared once they are returned.
+ */
+static volatile bool poolReclaimPending = false;
+
+/*
+ * Number of connections of a request the session gave up waiting for, whose
+ * answer is still to be read, see PoolManagerDrainAnswer.
+ */
+static int	poolPendingAnswer = 0;
+
 /*
  * PoolManager "lock" flag. The manager runs as a separate process, so
  * we can use this very simple approach to locking.
@@ -362,9 +480,20 @@ static bool remove_all_agent_references(Oid nodeoid);
 static DatabasePool *find_database_pool(const char *database, const char *user_name, const char *pgoptions);
 static DatabasePool *remove_database_pool(const char *database, const char *user_name);
 static int *agent_acquire_connections(PoolAgent *agent, List *datanodelist,
-		List *coordlist, int **connectionpids);
+		List *coordlist, int **connectionpids, char **states);
 static int cancel_query_on_connections(PoolAgent *agent, List *datanodelist, List *coordlist);
-static PGXCNodePoolSlot *acquire_connection(DatabasePool *dbPool, Oid node);
+static bool agent_can_acquire(PoolAgent *agent, List *datanodelist,
+		List *coordlist, bool raise_pressure);
+static void agent_send_connections(PoolAgent *agent, List *datanodelist,
+		List *coordlist);
+static bool agent_forget_waiter(PoolAgent *agent);
+static void serve_waiting_agents(void);
+static bool agent_holds_node(PoolAgent *agent, Oid node);
+static void agent_reclaim_connections(PoolAgent *agent);
+static void raise_pool_pressure(DatabasePool *dbPool, PGXCNodePool *nodePool);
+static void lower_pool_pressure(PGXCNodePool *nodePool);
+static PGXCNodePoolSlot *acquire_connection(DatabasePool *dbPool, Oid node,
+		bool *pressure);
 static void agent_release_connections(PoolAgent *agent, bool force_destroy);
 static void release_connection(DatabasePool *dbPool, PGXCNodePoolSlot *slot,
 							   Oid node, bool force_destroy);
@@ -395,12 +524,31 @@ static void pooler_quickdie(SIGNAL_ARGS);
 static void pooler_sighup(SIGNAL_ARGS);
 
 static void TryPingUnhealthyNode(Oid nodeoid);
+static PoolNodeBreaker *get_node_breaker(Oid nodeoid);
+static void open_node_breaker(PoolNodeBreaker *breaker);
+static void check_node_breakers(void);
+static void start_node_probe(PoolNodeBreaker *breaker);
+static void end_node_probe(PoolNodeBreaker *breaker, bool up);
+static int	add_node_probes(struct pollfd *fds, PoolNodeBreaker **breakers,
+				int *timeout);
+static void advance_node_probe(PoolNodeBreaker *breaker, bool ready);
+
+static const char *node_host_addr(const char *host);
+static void resolve_node_hosts(void);
 
 /* Open/close connection routines (invoked from Pool Manager) */
 static char *PGXCNodeConnStr(char *host, int port, char *dbname, char *user,
 							 char *pgoptions,
 							 char *remote_type, char *parent_node);
-static NODE_CONNECTION *PGXCNodeConnect(char *connstr);
+static void node_connect_start(NodeConnectAttempt *attempt,
+				   const char *connstr);
+static short node_connect_events(NodeConnectAttempt *attempt);
+static int	node_connect_timeout(NodeConnectAttempt *attempt);
+static NodeConnectResult node_connect_advance(NodeConnectAttempt *attempt,
+					 bool ready);
+static NodeConnectResult node_connect_wait(NodeConnectAttempt *attempt);
+static NODE_CONNECTION *PGXCNodeConnect(char *connstr,
+				NodeConnectResult *result);
 static void PGXCNodeClose(NODE_CONNECTION * conn);
 static int PGXCNodeConnected(NODE_CONNECTION * conn);
 static int PGXCNodePing(const char *connstr);
@@ -744,6 +892,7 @@ agent_create(void)
 	agent->coord_conn_oids = NULL;
 	agent->dn_connections = NULL;
 	agent->coord_connections = NULL;
+	agent->reclaim_sent = false;
 	agent->pid = 0;
 
 	/* Append new agent to the list */
@@ -984,6 +1133,9 @@ agent_destroy(PoolAgent *agent)
 
 	close(Socket(agent->port));
 
+	/* Forget the request the session was waiting for, if any */
+	(void) agent_forget_waiter(agent);
+
 	/*
 	 * Release all connections the session might be still holding.
 	 * 
@@ -1166,6 +1318,251 @@ PoolPingNodes()
 	}
 }
 
+/*
+ * get_node_breaker
+ *	  Find the circuit breaker of a node, creating it closed if needed.
+ */
+static PoolNodeBreaker *
+get_node_breaker(Oid nodeoid)
+{
+	PoolNodeBreaker *breaker;
+	bool		found;
+
+	if (nodeBreakers == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(PoolNodeBreaker);
+		ctl.hcxt = PoolerCoreContext;
+		nodeBreakers = hash_create("Node circuit breakers", 64, &ctl,
+								   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	breaker = (PoolNodeBreaker *) hash_search(nodeBreakers, &nodeoid,
+											  HASH_ENTER, &found);
+	if (!found)
+	{
+		breaker->open = false;
+		breaker->next_probe = 0;
+		breaker->failed_probes = 0;
+		breaker->probe.conn = NULL;
+		MemSet(&breaker->stats, 0, sizeof(NodeHealthStats));
+	}
+
+	return breaker;
+}
+
+/*
+ * open_node_breaker
+ *	  Stop trying to connect to a node, until a background probe succeeds.
+ */
+static void
+open_node_breaker(PoolNodeBreaker *breaker)
+{
+	if (!breaker->open)
+	{
+		breaker->open = true;
+		breaker->failed_probes = 0;
+		breaker->next_probe = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+														  PoolNodeProbeInterval);
+	}
+
+	if (!PgxcNodeUpdateHealth(breaker->nodeoid, false))
+		elog(WARNING, "Could not update health status of node %u",
+			 breaker->nodeoid);
+	else
+		elog(WARNING, "Health map updated to reflect DOWN node (%u)",
+			 breaker->nodeoid);
+}
+
+/*
+ * check_node_breakers
+ *	  Start probing the nodes which are down, and report the health
+ *	  statistics.
+ *
+ * Called by the pooler every pool_node_probe_interval. The breakers follow
+ * the shared health map first, as the backends mark the nodes they lost
+ * as unhealthy, and PoolPingNodes may have found them back.
+ */
+static void
+check_node_breakers(void)
+{
+	Oid				coOids[MaxCoords];
+	Oid				dnOids[MaxDataNodes];
+	bool			coHealthMap[MaxCoords];
+	bool			dnHealthMap[MaxDataNodes];
+	int				numCo;
+	int				numDn;
+	int				i;
+
+	PgxcNodeGetHealthMap(coOids, dnOids, &numCo, &numDn,
+						 coHealthMap, dnHealthMap);
+
+	for (i = 0; i < numCo + numDn; i++)
+	{
+		Oid			nodeoid = (i < numCo) ? coOids[i] : dnOids[i - numCo];
+		bool		healthy = (i < numCo) ? coHealthMap[i] : dnHealthMap[i - numCo];
+		PoolNodeBreaker *breaker = get_node_breaker(nodeoid);
+		TimestampTz now = GetCurrentTimestamp();
+
+		if (!healthy && !breaker->open)
+		{
+			breaker->open = true;
+			breaker->failed_probes = 0;
+			breaker->next_probe = TimestampTzPlusMilliseconds(now,
+												PoolNodeProbeInterval);
+		}
+		else if (healthy && breaker->open)
+		{
+			breaker->open = false;
+			if (breaker->probe.conn != NULL)
+			{
+				PQfinish(breaker->probe.conn);
+				breaker->probe.conn = NULL;
+			}
+		}
+
+		/* Half-open: see whether the node is back */
+		if (breaker->open && breaker->probe.conn == NULL &&
+			now >= breaker->next_probe)
+			start_node_probe(breaker);
+
+		if (breaker->stats.connect_failures > 0 ||
+			breaker->stats.fast_failures > 0 ||
+			breaker->stats.probes > 0)
+		{
+			PgxcNodeAddHealthStats(nodeoid, &breaker->stats);
+			MemSet(&breaker->stats, 0, sizeof(NodeHealthStats));
+		}
+	}
+}
+
+/*
+ * start_node_probe
+ *	  Start a non-blocking connection attempt to a node which is down.
+ *
+ * The pooler polls it along with the sessions, see add_node_probes.
+ */
+static void
+start_node_probe(PoolNodeBreaker *breaker)
+{
+	NodeDefinition *nodeDef = PgxcNodeGetDefinition(breaker->nodeoid);
+	char		connstr[MAXPGPATH * 2 + 256];
+	const char *addr;
+
+	/* Dropped meanwhile */
+	if (nodeDef == NULL)
+		return;
+
+	addr = node_host_addr(NameStr(nodeDef->nodehost));
+	sprintf(connstr,
+			"host=%s%s%s port=%d sslmode=disable", NameStr(nodeDef->nodehost),
+			addr ? " hostaddr=" : "", addr ? addr : "",
+			nodeDef->nodeport);
+	pfree(nodeDef);
+
+	breaker->stats.probes++;
+	node_connect_start(&breaker->probe, connstr);
+
+	/* It may fail right away, for example if the host name is unknown */
+	if (node_connect_advance(&breaker->probe, false) == NODE_CONNECT_REFUSED)
+		end_node_probe(breaker, false);
+}
+
+/*
+ * end_node_probe
+ *	  Close the breaker of a node if the probe found it back, otherwise
+ *	  back off before the next probe.
+ */
+static void
+end_node_probe(PoolNodeBreaker *breaker, bool up)
+{
+	int			interval = PoolNodeProbeInterval;
+	int			i;
+
+	PQfinish(breaker->probe.conn);
+	breaker->probe.conn = NULL;
+
+	if (up)
+	{
+		breaker->open = false;
+		breaker->failed_probes = 0;
+		if (PgxcNodeUpdateHealth(breaker->nodeoid, true))
+			elog(LOG, "Health map updated to reflect HEALTHY node (%u)",
+				 breaker->nodeoid);
+		return;
+	}
+
+	breaker->stats.failed_probes++;
+	breaker->failed_probes++;
+	for (i = 1; i < breaker->failed_probes &&
+		 interval < POOL_NODE_PROBE_MAX_INTERVAL; i++)
+		interval *= 2;
+	breaker->next_probe = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+								Min(interval, POOL_NODE_PROBE_MAX_INTERVAL));
+}
+
+/*
+ * add_node_probes
+ *	  Add the probes in progress to the poll set of the pooler.
+ *
+ * Returns the number of probes added, and lowers *timeout to the first
+ * deadline of a probe.
+ */
+static int
+add_node_probes(struct pollfd *fds, PoolNodeBreaker **breakers, int *timeout)
+{
+	HASH_SEQ_STATUS status;
+	PoolNodeBreaker *breaker;
+	int			count = 0;
+
+	if (nodeBreakers == NULL)
+		return 0;
+
+	hash_seq_init(&status, nodeBreakers);
+	while ((breaker = (PoolNodeBreaker *) hash_seq_search(&status)) != NULL)
+	{
+		int			probe_timeout;
+
+		if (breaker->probe.conn == NULL)
+			continue;
+
+		fds[count].fd = PQsocket(breaker->probe.conn);
+		fds[count].events = node_connect_events(&breaker->probe);
+		fds[count].revents = 0;
+		breakers[count++] = breaker;
+
+		probe_timeout = node_connect_timeout(&breaker->probe);
+		if (probe_timeout >= 0 && (*timeout < 0 || probe_timeout < *timeout))
+			*timeout = probe_timeout;
+	}
+
+	return count;
+}
+
+/*
+ * advance_node_probe
+ *	  Move a probe forward after poll, and end it once it completed.
+ *
+ * The node is up if it answered the probe, even with an error, see
+ * PGXCNodePing.
+ */
+static void
+advance_node_probe(PoolNodeBreaker *breaker, bool ready)
+{
+	NodeConnectResult result;
+
+	if (breaker->probe.conn == NULL)
+		return;
+
+	result = node_connect_advance(&breaker->probe, ready);
+	if (result != NODE_CONNECT_IN_PROGRESS)
+		end_node_probe(breaker, result == NODE_CONNECT_OK ||
+					   result == NODE_CONNECT_REJECTED);
+}
+
 /***********************************************************************
  * Communication with a pool manager (sending messages through socket).
  **********************************************************************/
@@ -1191,6 +1588,47 @@ PoolManagerDisconnect(void)
 	close(Socket(poolHandle->port));
 	free(poolHandle);
 	poolHandle = NULL;
+	poolReclaimPending = false;
+	poolPendingAnswer = 0;
+}
+
+/*
+ * PoolManagerDrainAnswer
+ *	  Read the answer to a connection request the session gave up on.
+ *
+ * An interrupt may end the wait for connections with an error, see
+ * PoolManagerGetConnections. The answer still comes, and must be read
+ * before the next one is expected. The pooler answers at once after the
+ * request was withdrawn. The connections it may have sent stay with the
+ * session's agent: they are handed out again if the session asks for the
+ * same nodes, and go back to the pool with the others.
+ */
+static void
+PoolManagerDrainAnswer(void)
+{
+	int		   *fds;
+	int		   *pids;
+	char	   *states;
+	int			i;
+
+	if (poolPendingAnswer == 0)
+		return;
+
+	fds = (int *) palloc(sizeof(int) * poolPendingAnswer);
+	pids = (int *) palloc(sizeof(int) * poolPendingAnswer);
+	states = (char *) palloc(sizeof(char) * poolPendingAnswer);
+
+	if (pool_recvconns(&poolHandle->port, fds, pids, states,
+					   poolPendingAnswer) == 0)
+	{
+		for (i = 0; i < poolPendingAnswer; i++)
+			close(fds[i]);
+	}
+	poolPendingAnswer = 0;
+
+	pfree(fds);
+	pfree(pids);
+	pfree(states);
 }
 
 
@@ -1200,16 +1638,20 @@ PoolManagerDisconnect(void)
  *
  * Acquires pooled connections for the specified nodes, and returns an
  * array of file descriptors, representing connections to the nodes.
- * It also provides array of PIDs of the backends (on remote nodes).
+ * It also provides array of PIDs of the backends (on remote nodes), and
+ * the state of each connection (POOL_CONN_* codes).
  */
 int *
-PoolManagerGetConnections(List *datanodelist, List *coordlist, int **pids)
+PoolManagerGetConnections(List *datanodelist, List *coordlist, int **pids,
+						  char **states)
 {
 	int			i;
 	ListCell   *nodelist_item;
 	int		   *fds;
 	int			totlen = list_length(datanodelist) + list_length(coordlist);
 	int			nodes[totlen + 2]; /* node OIDs + two node counts */
+	instr_time	wait_start;
+	bool		failed;
 
 	/* Make sure we're connected to the pool manager. */
 	if (poolHandle == NULL)
@@ -1255,34 +1697,52 @@ PoolManagerGetConnections(List *datanodelist, List *coordlist, int **pids)
 	 * Send the encoded datanode/coordinator OIDs to the pool manager,
 	 * flush the message nd wait for the response.
 	 */
+	RemoteWaitStart(wait_start);
+	PoolManagerDrainAnswer();
 	pool_putmessage(&poolHandle->port, 'g', (char *) nodes, sizeof(int) * (totlen + 2));
 	pool_flush(&poolHandle->port);
 
-	/* Allocate memory for file descriptors (node connections). */
+	/*
+	 * Allocate memory for file descriptors (node connections), PIDs of the
+	 * remote backends and states of the connections.
+	 */
 	fds = (int *) palloc(sizeof(int) * totlen);
-	if (fds == NULL)
+	*pids = (int *) palloc(sizeof(int) * totlen);
+	*states = (char *) palloc(sizeof(char) * totlen);
+
+	/*
+	 * Receive all of them, in a single message. An interrupt may end the
+	 * wait with an error, the answer then still comes later. Withdraw the
+	 * request, and have the next request read and discard the answer first,
+	 * see PoolManagerDrainAnswer. The connection to the pooler is kept: the
+	 * connections the session holds are still in use, by the abort at least.
+	 */
+	PG_TRY();
 	{
-		ereport(ERROR,
-				(errcode(ERRCODE_OUT_OF_MEMORY),
-				 errmsg("out of memory")));
+		failed = pool_recvconns(&poolHandle->port, fds, *pids, *states,
+								totlen) != 0;
 	}
-
-	/* receive file descriptors */
-	if (pool_recvfds(&poolHandle->port, fds, totlen))
+	PG_CATCH();
 	{
-		elog(WARNING, "failed to receive file descriptors for connections");
-		pfree(fds);
-		fds = NULL;
+		pool_putmessage(&poolHandle->port, 'w', NULL, 0);
+		pool_flush(&poolHandle->port);
+		poolPendingAnswer = totlen;
+		PG_RE_THROW();
 	}
+	PG_END_TRY();
 
-	/* receive PIDs for remote backends */
-	if (pool_recvpids(&poolHandle->port, pids) != totlen)
+	if (failed)
 	{
-		elog(WARNING, "failed to receive PIDs of remote backends");
+		RemoteWaitEnd(REMOTE_WAIT_POOLER, wait_start);
+		elog(WARNING, "failed to receive connections from the pooler");
+		pfree(fds);
 		pfree(*pids);
+		pfree(*states);
 		*pids = NULL;
+		*states = NULL;
 		return NULL;
 	}
+	RemoteWaitEnd(REMOTE_WAIT_POOLER, wait_start);
 
 	return fds;
 }
@@ -1318,6 +1778,8 @@ PoolManagerAbortTransactions(char *dbname, char *username, int **proc_pids)
 		PoolManagerConnect(get_database_name(MyDatabaseId),
 						   GetClusterUserName(), session_options());
 
+	PoolManagerDrainAnswer();
+
 	/* Message type */
 	pool_putbytes(&poolHandle->port, &msgtype, 1);
 
@@ -1407,6 +1869,8 @@ PoolManagerCleanConnection(List *datanodelist, List *coordlist,
 		}
 	}
 
+	PoolManagerDrainAnswer();
+
 	/* Message type */
 	pool_putbytes(&poolHandle->port, &msgtype, 1);
 
@@ -1470,6 +1934,8 @@ PoolManagerCheckConnectionInfo(void)
 	 */
 	PgxcNodeListAndCount();
 
+	PoolManagerDrainAnswer();
+
 	/* Send message to the pool manager and wait for a response. */
 	pool_putmessage(&poolHandle->port, 'q', NULL, 0);
 	pool_flush(&poolHandle->port);
@@ -1512,6 +1978,8 @@ PoolManagerRefreshConnectionInfo(void)
 
 	Assert(poolHandle);
 	PgxcNodeListAndCount();
+
+	PoolManagerDrainAnswer();
 	pool_putmessage(&poolHandle->port, 'R', NULL, 0);
 	pool_flush(&poolHandle->port);
 
@@ -1662,7 +2130,6 @@ static void
 handle_get_connections(PoolAgent * agent, StringInfo s)
 {
 	int		i;
-	int	   *fds, *pids = NULL;
 	int		datanodecount, coordcount;
 	List   *datanodelist = NIL;
 	List   *coordlist = NIL;
@@ -1697,23 +2164,67 @@ handle_get_connections(PoolAgent * agent, StringInfo s)
 	Assert(datanodecount >= 0 && coordcount >= 0);
 
 	/*
-	 * In case of error agent_acquire_connections will log the error and
-	 * return NULL.
+	 * Wait for connections rather than fail, if the pool is full. Also queue
+	 * the request behind those already waiting, they are served first.
 	 */
-	fds = agent_acquire_connections(agent, datanodelist, coordlist, &pids);
+	if (PoolWaitTimeout > 0 &&
+		(poolWaiters != NIL ||
+		 !agent_can_acquire(agent, datanodelist, coordlist, false)))
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(PoolerAgentContext);
+		PoolWaiter *waiter = (PoolWaiter *) palloc(sizeof(PoolWaiter));
+
+		waiter->agent = agent;
+		waiter->datanodelist = list_copy(datanodelist);
+		waiter->coordlist = list_copy(coordlist);
+		waiter->deadline = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+													   PoolWaitTimeout);
+		poolWaiters = lappend(poolWaiters, waiter);
+		MemoryContextSwitchTo(oldcontext);
+
+		/* Have the sessions holding connections return them */
+		(void) agent_can_acquire(agent, datanodelist, coordlist, true);
+
+		list_free(datanodelist);
+		list_free(coordlist);
+		return;
+	}
+
+	agent_send_connections(agent, datanodelist, coordlist);
 
 	list_free(datanodelist);
 	list_free(coordlist);
+}
+
+/*
+ * agent_send_connections
+ *	  Acquire connections to the specified nodes and send them to the session.
+ */
+static void
+agent_send_connections(PoolAgent *agent, List *datanodelist, List *coordlist)
+{
+	int	   *fds, *pids = NULL;
+	char   *states = NULL;
+	int		count = list_length(datanodelist) + list_length(coordlist);
 
-	/* Send the file descriptors back, along with the correct count. */
-	pool_sendfds(&agent->port, fds, fds ? datanodecount + coordcount : 0);
+	/*
+	 * In case of error agent_acquire_connections will log the error and
+	 * return NULL.
+	 */
+	fds = agent_acquire_connections(agent, datanodelist, coordlist, &pids,
+									&states);
+
+	/*
+	 * Send the file descriptors back, with the PIDs of the remote backends
+	 * serving the connections and their states, along with the correct count.
+	 */
+	pool_sendconns(&agent->port, fds, pids, states, fds ? count : 0);
 	if (fds)
+	{
 		pfree(fds);
-
-	/* Also send PIDs of the remote backends serving the connections. */
-	pool_sendpids(&agent->port, pids, pids ? datanodecount + coordcount : 0);
-	if (pids)
 		pfree(pids);
+		pfree(states);
+	}
 }
 
 /*
@@ -1859,6 +2370,17 @@ agent_handle_input(PoolAgent * agent, StringInfo s)
 					agent_release_connections(agent, destroy);
 				}
 				break;
+			case 'w':			/* WITHDRAW CONNECTION REQUEST */
+				pool_getmessage(&agent->port, s, 4);
+				pq_getmsgend(s);
+
+				/*
+				 * The session gave up waiting. Answer at once if the request
+				 * is still queued, the session expects one answer anyway.
+				 */
+				if (agent_forget_waiter(agent))
+					pool_sendconns(&agent->port, NULL, NULL, NULL, 0);
+				break;
 			case EOF:			/* EOF */
 				agent_destroy(agent);
 				return;
@@ -1888,16 +2410,18 @@ agent_handle_input(PoolAgent * agent, StringInfo s)
  *
  * Returns an array of file descriptors representing the connections, with
  * order matching the datanode/coordinator list. Also returns an array of
- * backend PIDs, handling those connections (on the remote nodes).
+ * backend PIDs, handling those connections (on the remote nodes), and an
+ * array of connection states (POOL_CONN_* codes).
  */
 static int *
 agent_acquire_connections(PoolAgent *agent, List *datanodelist,
-		List *coordlist, int **pids)
+		List *coordlist, int **pids, char **states)
 {
 	int			i;
 	int		   *result;
 	ListCell   *nodelist_item;
 	MemoryContext oldcontext;
+	bool		pressure = false;
 
 	Assert(agent);
 
@@ -1942,6 +2466,8 @@ agent_acquire_connections(PoolAgent *agent, List *datanodelist,
 				 errmsg("out of memory")));
 	}
 
+	*states = (char *) palloc((list_length(datanodelist) + list_length(coordlist)) * sizeof(char));
+
 	/*
 	 * Make sure the results (connections) are allocated in the memory
 	 * context for the DatabasePool.
@@ -1955,15 +2481,22 @@ agent_acquire_connections(PoolAgent *agent, List *datanodelist,
 		int			node = lfirst_int(nodelist_item);
 
 		/* Acquire from the pool if none */
-		if (agent->dn_connections[node] == NULL)
+		if (agent->dn_connections[node] != NULL)
+			(*states)[i] = POOL_CONN_KEPT;
+		else
 		{
 			PGXCNodePoolSlot *slot = acquire_connection(agent->pool,
-														agent->dn_conn_oids[node]);
+														agent->dn_conn_oids[node],
+														&pressure);
 
 			/* Handle failure */
 			if (slot == NULL)
 			{
 				pfree(result);
+				pfree(*pids);
+				pfree(*states);
+				*pids = NULL;
+				*states = NULL;
 				MemoryContextSwitchTo(oldcontext);
 				elog(LOG, "Pooler could not open a connection to node %d",
 						agent->dn_conn_oids[node]);
@@ -1972,6 +2505,8 @@ agent_acquire_connections(PoolAgent *agent, List *datanodelist,
 
 			/* Store in the descriptor */
 			agent->dn_connections[node] = slot;
+			(*states)[i] = slot->used ? POOL_CONN_POOLED : POOL_CONN_NEW;
+			slot->used = true;
 
 			/*
 			 * Update newly-acquired slot with session parameters.
@@ -1995,14 +2530,22 @@ agent_acquire_connections(PoolAgent *agent, List *datanodelist,
 		int			node = lfirst_int(nodelist_item);
 
 		/* Acquire from the pool if none */
-		if (agent->coord_connections[node] == NULL)
+		if (agent->coord_connections[node] != NULL)
+			(*states)[i] = POOL_CONN_KEPT;
+		else
 		{
-			PGXCNodePoolSlot *slot = acquire_connection(agent->pool, agent->coord_conn_oids[node]);
+			PGXCNodePoolSlot *slot = acquire_connection(agent->pool,
+														agent->coord_conn_oids[node],
+														&pressure);
 
 			/* Handle failure */
 			if (slot == NULL)
 			{
 				pfree(result);
+				pfree(*pids);
+				pfree(*states);
+				*pids = NULL;
+				*states = NULL;
 				MemoryContextSwitchTo(oldcontext);
 				elog(LOG, "Pooler could not open a connection to node %d",
 						agent->coord_conn_oids[node]);
@@ -2011,6 +2554,8 @@ agent_acquire_connections(PoolAgent *agent, List *datanodelist,
 
 			/* Store in the descriptor */
 			agent->coord_connections[node] = slot;
+			(*states)[i] = slot->used ? POOL_CONN_POOLED : POOL_CONN_NEW;
+			slot->used = true;
 
 			/*
 			 * Update newly-acquired slot with session parameters.
@@ -2030,9 +2575,188 @@ agent_acquire_connections(PoolAgent *agent, List *datanodelist,
 	/* make sure we got the expected total number of connections */
 	Assert(i == list_length(datanodelist) + list_length(coordlist));
 
+	/*
+	 * Connections from a pool short of connections must come back at the
+	 * end of the transaction, even to a sticky session.
+	 */
+	if (pressure)
+		agent_reclaim_connections(agent);
+
 	return result;
 }
 
+/*
+ * agent_can_acquire
+ *		Check that the pools can serve a connection request right away.
+ *
+ * Only looks for node pools which reached max_pool_size with no free
+ * connection, any other failure is left to agent_acquire_connections.
+ * With raise_pressure, also raise the pressure on all those pools.
+ */
+static bool
+agent_can_acquire(PoolAgent *agent, List *datanodelist, List *coordlist,
+				  bool raise_pressure)
+{
+	ListCell   *nodelist_item;
+	int			i;
+	bool		result = true;
+
+	if (agent->pool == NULL)
+		return true;
+
+	for (i = 0; i < 2; i++)
+	{
+		List	   *nodelist = (i == 0) ? datanodelist : coordlist;
+		int			num_connections = (i == 0) ? agent->num_dn_connections :
+			agent->num_coord_connections;
+
+		foreach(nodelist_item, nodelist)
+		{
+			int			node = lfirst_int(nodelist_item);
+			PGXCNodePoolSlot *held;
+			Oid			nodeoid;
+			PGXCNodePool *nodePool;
+
+			if (node < 0 || node >= num_connections)
+				continue;
+
+			held = (i == 0) ? agent->dn_connections[node] :
+				agent->coord_connections[node];
+			if (held != NULL)
+				continue;
+
+			nodeoid = (i == 0) ? agent->dn_conn_oids[node] :
+				agent->coord_conn_oids[node];
+			nodePool = (PGXCNodePool *) hash_search(agent->pool->nodePools,
+													&nodeoid, HASH_FIND, NULL);
+			if (nodePool && nodePool->freeSize == 0 &&
+				nodePool->size >= MaxPoolSize)
+			{
+				if (!raise_pressure)
+					return false;
+				raise_pool_pressure(agent->pool, nodePool);
+				result = false;
+			}
+		}
+	}
+
+	return result;
+}
+
+/*
+ * agent_holds_node
+ *		Does the session hold a connection to the node?
+ */
+static bool
+agent_holds_node(PoolAgent *agent, Oid node)
+{
+	int			i;
+
+	for (i = 0; i < agent->num_dn_connections; i++)
+		if (agent->dn_connections[i] && agent->dn_conn_oids[i] == node)
+			return true;
+
+	for (i = 0; i < agent->num_coord_connections; i++)
+		if (agent->coord_connections[i] && agent->coord_conn_oids[i] == node)
+			return true;
+
+	return false;
+}
+
+/*
+ * agent_reclaim_connections
+ *		Ask the session to return its connections.
+ *
+ * The session returns them at once if it is idle, or at the end of its
+ * transaction. It is asked only once until it returns them.
+ */
+static void
+agent_reclaim_connections(PoolAgent *agent)
+{
+	if (agent->reclaim_sent || agent->pid == 0)
+		return;
+
+	if (SendProcSignal(agent->pid, PROCSIG_PGXCPOOL_RECLAIM,
+					   InvalidBackendId) == 0)
+		agent->reclaim_sent = true;
+}
+
+/*
+ * agent_forget_waiter
+ *		Remove the connection request of the agent from the waiting ones.
+ *
+ * Returns false if the agent has no request waiting, its answer was sent
+ * already.
+ */
+static bool
+agent_forget_waiter(PoolAgent *agent)
+{
+	ListCell   *cell;
+	ListCell   *prev = NULL;
+
+	foreach(cell, poolWaiters)
+	{
+		PoolWaiter *waiter = (PoolWaiter *) lfirst(cell);
+
+		if (waiter->agent == agent)
+		{
+			poolWaiters = list_delete_cell(poolWaiters, cell, prev);
+			list_free(waiter->datanodelist);
+			list_free(waiter->coordlist);
+			pfree(waiter);
+			return true;
+		}
+		prev = cell;
+	}
+
+	return false;
+}
+
+/*
+ * serve_waiting_agents
+ *		Serve the connection requests waiting for the pools.
+ *
+ * Requests are served in order of arrival, as soon as the pools can serve
+ * them, or when they waited for pool_wait_timeout. In the latter case the
+ * acquisition is still tried, and fails if the pool is still full.
+ */
+static void
+serve_waiting_agents(void)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	ListCell   *cell;
+	ListCell   *prev = NULL;
+	ListCell   *next;
+
+	for (cell = list_head(poolWaiters); cell; cell = next)
+	{
+		PoolWaiter *waiter = (PoolWaiter *) lfirst(cell);
+
+		next = lnext(cell);
+
+		if (now < waiter->deadline &&
+			!agent_can_acquire(waiter->agent, waiter->datanodelist,
+							   waiter->coordlist, false))
+		{
+			prev = cell;
+			continue;
+		}
+
+		poolWaiters = list_delete_cell(poolWaiters, cell, prev);
+
+		if (now >= waiter->deadline)
+			elog(LOG, "session %d waited %d ms for pooled connections",
+				 waiter->agent->pid, PoolWaitTimeout);
+
+		agent_send_connections(waiter->agent, waiter->datanodelist,
+							   waiter->coordlist);
+
+		list_free(waiter->datanodelist);
+		list_free(waiter->coordlist);
+		pfree(waiter);
+	}
+}
+
 /*
  * cancel_query_on_connections
  *	  Cancel query running on connections managed by a PoolAgent.
@@ -2138,6 +2862,9 @@ PoolManagerReleaseConnections(bool force)
 	n32 = htonl((int) force);
 	pool_putbytes(&poolHandle->port, (char *) &n32, 4);
 	pool_flush(&poolHandle->port);
+
+	/* The pooler has got back what it asked for */
+	poolReclaimPending = false;
 }
 
 /*
@@ -2190,6 +2917,8 @@ PoolManagerCancelQuery(int dn_count, int* dn_list, int co_count, int* co_list)
 			buf[++i] = n32;
 		}
 	}
+
+	PoolManagerDrainAnswer();
 	pool_putmessage(&poolHandle->port, 'h', (char *) buf, (2 + dn_count + co_count) * sizeof(uint32));
 	pool_flush(&poolHandle->port);
 
@@ -2278,6 +3007,9 @@ agent_release_connections(PoolAgent *agent, bool force_destroy)
 	if (!force_destroy && agent->pool->oldest_idle == (time_t) 0)
 		agent->pool->oldest_idle = time(NULL);
 
+	/* The session may be asked for its connections again */
+	agent->reclaim_sent = false;
+
 	MemoryContextSwitchTo(oldcontext);
 }
 
@@ -2503,6 +3235,9 @@ reload_database_pools(PoolAgent *agent)
 	agent->dn_connections = (PGXCNodePoolSlot **)
 			palloc0(agent->num_dn_connections * sizeof(PGXCNodePoolSlot *));
 
+	/* The hosts may have moved, so the pools of altered nodes are dropped */
+	resolve_node_hosts();
+
 	/*
 	 * Scan the list of database pools and destroy any altered pool. The
 	 * pools will be recreated upon subsequent connection acquisition.
@@ -2579,6 +3314,9 @@ refresh_database_pools(PoolAgent *agent)
 	pfree(coOids);
 	pfree(dnOids);
 
+	if (res == POOL_REFRESH_SUCCESS)
+		resolve_node_hosts();
+
 	/*
 	 * Scan the list and destroy any altered pool. They will be recreated
 	 * automatically upon subsequent connection acquisition.
@@ -2798,17 +3536,29 @@ remove_database_pool(const char *database, const char *user_name)
  * connection can't be obtained.
  *
  * Also updates node health information in the shared memory, both in
- * case of success (healthy) or failure (unhealthy).
+ * case of success (healthy) or failure (unhealthy), and raises the pressure
+ * on the node pool when it runs out of connections. *pressure is set when
+ * the node pool is under pressure, and left alone otherwise.
  */
 static PGXCNodePoolSlot *
-acquire_connection(DatabasePool *dbPool, Oid node)
+acquire_connection(DatabasePool *dbPool, Oid node, bool *pressure)
 {
 	PGXCNodePool	   *nodePool;
 	PGXCNodePoolSlot   *slot;
+	PoolNodeBreaker	   *breaker;
 
 	Assert(dbPool);
 	Assert(OidIsValid(node));
 
+	/* Do not even try while the node is known to be down */
+	breaker = get_node_breaker(node);
+	if (breaker->open && PoolNodeProbeInterval > 0)
+	{
+		breaker->stats.fast_failures++;
+		elog(DEBUG1, "node %u is down, refusing to connect to it", node);
+		return NULL;
+	}
+
 	/* see if we have pool for the node */
 	nodePool = (PGXCNodePool *) hash_search(dbPool->nodePools, &node,
 											HASH_FIND, NULL);
@@ -2876,25 +3626,31 @@ acquire_connection(DatabasePool *dbPool, Oid node)
 		nodePool = grow_pool(dbPool, node);
 	}
 
+	/*
+	 * A full node pool does not mean the node is down, only that sessions
+	 * keep too many connections. Tell them to return theirs.
+	 */
+	if (nodePool && nodePool->freeSize == 0 && nodePool->size >= MaxPoolSize)
+		raise_pool_pressure(dbPool, nodePool);
+
+	if (nodePool && nodePool->pressure)
+		*pressure = true;
+
+	/*
+	 * grow_pool opened the circuit breaker of the node if the node is down,
+	 * which also updated the node health status in shared memory. A node
+	 * that answered with an error, for example because it has too many
+	 * clients, is not down. There is no need to mark the node as healthy on
+	 * success, the breaker is closed, and so is the node healthy.
+	 */
 	if (slot == NULL)
 	{
-		elog(WARNING, "can not connect to node %u", node);
-
-		/*
-		 * Before returning, update the node health status in shared
-		 * memory to indicate this node is down.
-		 */
-		if (!PgxcNodeUpdateHealth(node, false))
-			elog(WARNING, "Could not update health status of node %u", node);
+		if (nodePool && nodePool->size >= MaxPoolSize)
+			elog(WARNING, "connection pool for node %u is exhausted "
+				 "(max_pool_size %d)", node, MaxPoolSize);
 		else
-			elog(WARNING, "Health map updated to reflect DOWN node (%u)", node);
+			elog(WARNING, "can not connect to node %u", node);
 	}
-	else
-		/*
-		 * XXX Is this necessary? Isn't this just another source of latency
-		 * in the connection-acquisition path?
-		 */
-		PgxcNodeUpdateHealth(node, true);
 
 	return slot;
 }
@@ -2946,6 +3702,8 @@ release_connection(DatabasePool *dbPool, PGXCNodePoolSlot *slot,
 		 */
 		nodePool->slot[(nodePool->freeSize)++] = slot;
 		slot->released = time(NULL);
+
+		lower_pool_pressure(nodePool);
 	}
 	else
 	{
@@ -2963,6 +3721,63 @@ release_connection(DatabasePool *dbPool, PGXCNodePoolSlot *slot,
 }
 
 
+/*
+ * raise_pool_pressure
+ *	  Note that a node pool ran short of connections.
+ *
+ * Either the pool reached max_pool_size, or the node refused to open more
+ * connections. The sessions holding connections from the pool are asked to
+ * return them, see agent_reclaim_connections(). Those which are idle in a
+ * sticky session come back at once. While the pressure lasts, the sessions
+ * getting connections from the pool are asked to return them too.
+ */
+static void
+raise_pool_pressure(DatabasePool *dbPool, PGXCNodePool *nodePool)
+{
+	int			i;
+
+	if (!nodePool->pressure)
+		elog(DEBUG1, "Pooler: pool %s (%u) is short of connections",
+			 nodePool->connstr, nodePool->nodeoid);
+
+	nodePool->pressure = true;
+	nodePool->pressure_time = GetCurrentTimestamp();
+
+	for (i = 0; i < agentCount; i++)
+	{
+		PoolAgent  *agent = poolAgents[i];
+
+		if (agent->pool == dbPool && !agent->reclaim_sent &&
+			agent_holds_node(agent, nodePool->nodeoid))
+			agent_reclaim_connections(agent);
+	}
+}
+
+
+/*
+ * lower_pool_pressure
+ *	  End the pressure on a node pool with enough free connections again.
+ */
+static void
+lower_pool_pressure(PGXCNodePool *nodePool)
+{
+	if (!nodePool->pressure)
+		return;
+
+	if (nodePool->freeSize < Max(1, nodePool->size / POOL_PRESSURE_FREE_RATIO))
+		return;
+
+	if (!TimestampDifferenceExceeds(nodePool->pressure_time,
+									GetCurrentTimestamp(),
+									POOL_PRESSURE_HOLD))
+		return;
+
+	elog(DEBUG1, "Pooler: pool %s (%u) has connections to spare again",
+		 nodePool->connstr, nodePool->nodeoid);
+	nodePool->pressure = false;
+}
+
+
 /*
  * grow_pool
  *	  Increase size of a pool for a particular node if needed.
@@ -3013,6 +3828,7 @@ grow_pool(DatabasePool *dbPool, Oid node)
 		}
 		nodePool->freeSize = 0;
 		nodePool->size = 0;
+		nodePool->pressure = false;
 	}
 
 	/*
@@ -3023,6 +3839,9 @@ grow_pool(DatabasePool *dbPool, Oid node)
 	while (nodePool->freeSize == 0 && nodePool->size < MaxPoolSize)
 	{
 		PGXCNodePoolSlot *slot;
+		TimestampTz	start;
+		NodeConnectResult result;
+		bool		timedout;
 
 		/* Allocate new slot */
 		slot = (PGXCNodePoolSlot *) palloc(sizeof(PGXCNodePoolSlot));
@@ -3035,23 +3854,48 @@ grow_pool(DatabasePool *dbPool, Oid node)
 
 		/* If connection fails, be sure that slot is destroyed cleanly */
 		slot->xc_cancelConn = NULL;
+		slot->used = false;
 
 		/* Establish connection */
-		slot->conn = PGXCNodeConnect(nodePool->connstr);
+		start = GetCurrentTimestamp();
+		slot->conn = PGXCNodeConnect(nodePool->connstr, &result);
+		timedout = (result == NODE_CONNECT_TIMEOUT);
 		if (!PGXCNodeConnected(slot->conn))
 		{
+			PoolNodeBreaker *breaker = get_node_breaker(node);
+			long		secs;
+			int			usecs;
+
 			ereport(LOG,
 					(errcode(ERRCODE_CONNECTION_FAILURE),
 					 errmsg("failed to connect to node, connection string (%s),"
 						  " connection error (%s)",
 						  nodePool->connstr,
+						  timedout ? "timeout expired" :
 						  PQerrorMessage((PGconn*) slot->conn))));
 
 			destroy_slot(slot);
 
+			TimestampDifference(start, GetCurrentTimestamp(), &secs, &usecs);
+			breaker->stats.connect_failures++;
+			breaker->stats.wait_time += secs * USECS_PER_SEC + usecs;
+			if (timedout)
+				breaker->stats.connect_timeouts++;
+
+			/*
+			 * A node that refused the connection or did not answer in time
+			 * is down: stop trying until a probe finds it back.
+			 */
+			if (result == NODE_CONNECT_REFUSED || timedout)
+			{
+				open_node_breaker(breaker);
+				break;
+			}
+
 			/*
 			 * If we failed to connect, probably number of connections on
-			 * the target node reached max_connections. Release idle from
+			 * the target node reached max_connections. Have the sessions
+			 * return the connections they do not use, release idle from
 			 * this node, and retry.
 			 *
 			 * We do not want to enter endless loop here, so we only try
@@ -3063,6 +3907,8 @@ grow_pool(DatabasePool *dbPool, Oid node)
 			 * XXX Maybe temporarily marking the pool, so that it does not
 			 * get removed (pinned=true) would do the trick?
 			 */
+			raise_pool_pressure(dbPool, nodePool);
+
 			if (tryagain && nodePool->size > nodePool->freeSize)
 			{
 				pools_maintenance();
@@ -3166,7 +4012,10 @@ PoolerLoop(void)
 	StringInfoData 	input_message;
 	time_t			last_maintenance = (time_t) 0;
 	int				maintenance_timeout;
+	TimestampTz		next_node_check = 0;
 	struct pollfd	*pool_fd;
+	PoolNodeBreaker **probe_breakers;
+	int				nprobes;
 
 #ifdef HAVE_UNIX_SOCKETS
 	if (Unix_socket_directories)
@@ -3218,7 +4067,11 @@ PoolerLoop(void)
 	}
 #endif
 
-	pool_fd = (struct pollfd *) palloc((MaxConnections + 1) * sizeof(struct pollfd));
+	/* The sessions, then the probes of the nodes which are down */
+	pool_fd = (struct pollfd *) palloc((MaxConnections + 1 + MaxCoords + MaxDataNodes) *
+									   sizeof(struct pollfd));
+	probe_breakers = (PoolNodeBreaker **) palloc((MaxCoords + MaxDataNodes) *
+												 sizeof(PoolNodeBreaker *));
 
 	if (server_fd == -1)
 	{
@@ -3277,6 +4130,36 @@ PoolerLoop(void)
 		}
 		else
 			maintenance_timeout = -1;
+
+		/* Wake up in time to check the circuit breakers of the nodes */
+		if (PoolNodeProbeInterval > 0)
+		{
+			long		secs;
+			int			usecs;
+			int			check_timeout;
+
+			TimestampDifference(GetCurrentTimestamp(), next_node_check,
+								&secs, &usecs);
+			check_timeout = secs * 1000 + usecs / 1000;
+			if (maintenance_timeout < 0 || check_timeout < maintenance_timeout)
+				maintenance_timeout = check_timeout;
+		}
+
+		/* Wake up in time to fail the requests which waited too long */
+		if (poolWaiters != NIL)
+		{
+			PoolWaiter *waiter = (PoolWaiter *) linitial(poolWaiters);
+			long		secs;
+			int			usecs;
+			int			wait_timeout;
+
+			TimestampDifference(GetCurrentTimestamp(), waiter->deadline,
+								&secs, &usecs);
+			wait_timeout = secs * 1000 + usecs / 1000 + 1;
+			if (maintenance_timeout < 0 || wait_timeout < maintenance_timeout)
+				maintenance_timeout = wait_timeout;
+		}
+
 		/*
 		 * Emergency bailout if postmaster has died.  This is to avoid the
 		 * necessity for manual cleanup of all postmaster children.
@@ -3311,7 +4194,9 @@ PoolerLoop(void)
 		}
 
 		/* wait for event */
-		retval = poll(pool_fd, agentCount + 1, maintenance_timeout);
+		nprobes = add_node_probes(&pool_fd[agentCount + 1], probe_breakers,
+								  &maintenance_timeout);
+		retval = poll(pool_fd, agentCount + 1 + nprobes, maintenance_timeout);
 		if (retval < 0)
 		{
 			if (errno == EINTR || errno == EAGAIN)
@@ -3319,6 +4204,11 @@ PoolerLoop(void)
 			elog(FATAL, "poll returned with error %d", retval);
 		}
 
+		/* Probes which got an answer, or ran out of time */
+		for (i = 0; i < nprobes; i++)
+			advance_node_probe(probe_breakers[i],
+							   pool_fd[agentCount + 1 + i].revents != 0);
+
 		if (retval > 0)
 		{
 			/*
@@ -3340,13 +4230,28 @@ PoolerLoop(void)
 			if (pool_fd[0].revents & POLLIN)
 				agent_create();
 		}
-		else if (retval == 0)
+		else if (retval == 0 && PoolMaintenanceTimeout > 0 &&
+				 difftime(time(NULL), last_maintenance) >= PoolMaintenanceTimeout)
 		{
 			/* maintenance timeout */
 			pools_maintenance();
-			PoolPingNodes();
+			if (PoolNodeProbeInterval <= 0)
+				PoolPingNodes();
 			last_maintenance = time(NULL);
 		}
+
+		/* Connections may have been returned, or requests waited too long */
+		if (poolWaiters != NIL)
+			serve_waiting_agents();
+
+		/* Probe the nodes which are down, even when busy */
+		if (PoolNodeProbeInterval > 0 &&
+			GetCurrentTimestamp() >= next_node_check)
+		{
+			check_node_breakers();
+			next_node_check = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+														  PoolNodeProbeInterval);
+		}
 	}
 }
 
@@ -3681,6 +4586,50 @@ pools_maintenance(void)
 			difftime(time(NULL), now), count);
 }
 
+/*
+ * PoolManagerKeepConnections
+ *	  Should the session keep its connections at the end of a transaction?
+ *
+ * With persistent_datanode_connections the connections are always kept. With
+ * pool_sticky_connections a Coordinator session keeps them until the pooler
+ * asks for them, so the next transaction needs neither a round trip to the
+ * pooler nor the cleanup of the remote sessions.
+ */
+bool
+PoolManagerKeepConnections(void)
+{
+	if (PersistentConnections)
+		return true;
+
+	return PoolStickyConnections && IS_PGXC_COORDINATOR &&
+		!poolReclaimPending;
+}
+
+/*
+ * PoolManagerRequestReclaim
+ *	  Note that the pooler asked the session to return its connections.
+ *
+ * Called from the signal handler, see HandlePoolerReclaim().
+ */
+void
+PoolManagerRequestReclaim(void)
+{
+	poolReclaimPending = true;
+}
+
+/*
+ * PoolManagerReclaimPending
+ *	  Has the pooler asked the session to return its connections?
+ *
+ * It does so when a node pool the session holds a connection from runs
+ * short of connections.
+ */
+bool
+PoolManagerReclaimPending(void)
+{
+	return poolReclaimPending;
+}
+
 bool
 check_persistent_connections(bool *newval, void **extra, GucSource source)
 {
@@ -3693,6 +4642,110 @@ check_persistent_connections(bool *newval, void **extra, GucSource source)
 	return true;
 }
 
+/*
+ * node_host_addr
+ *	  Numeric address of a node host, NULL to let libpq resolve the name.
+ *
+ * The name is resolved the first time it is asked for, then the address is
+ * kept until resolve_node_hosts. If the name resolves to several addresses,
+ * only the first one is used. Host names starting with a slash are socket
+ * directories, not resolved.
+ */
+static const char *
+node_host_addr(const char *host)
+{
+	PoolHostAddr *entry;
+	char		key[NAMEDATALEN];
+	bool		found;
+
+	if (is_absolute_path(host))
+		return NULL;
+
+	if (hostAddrs == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = NAMEDATALEN;
+		ctl.entrysize = sizeof(PoolHostAddr);
+		ctl.hcxt = PoolerCoreContext;
+		hostAddrs = hash_create("Node host addresses", 64, &ctl,
+								HASH_ELEM | HASH_CONTEXT);
+	}
+
+	strlcpy(key, host, NAMEDATALEN);
+	entry = (PoolHostAddr *) hash_search(hostAddrs, key, HASH_ENTER, &found);
+	if (!found)
+	{
+		struct addrinfo hint;
+		struct addrinfo *addrs = NULL;
+		int			rc;
+
+		entry->addr[0] = '\0';
+
+		MemSet(&hint, 0, sizeof(hint));
+		hint.ai_family = AF_UNSPEC;
+		hint.ai_socktype = SOCK_STREAM;
+		rc = pg_getaddrinfo_all(host, NULL, &hint, &addrs);
+		if (rc != 0 || addrs == NULL)
+			elog(LOG, "could not resolve node host \"%s\": %s",
+				 host, gai_strerror(rc));
+		else
+		{
+			struct sockaddr_storage sa;
+
+			memcpy(&sa, addrs->ai_addr, addrs->ai_addrlen);
+			if (pg_getnameinfo_all(&sa, addrs->ai_addrlen,
+								   entry->addr, sizeof(entry->addr),
+								   NULL, 0, NI_NUMERICHOST) != 0)
+				entry->addr[0] = '\0';
+		}
+		if (addrs)
+			pg_freeaddrinfo_all(hint.ai_family, addrs);
+	}
+
+	return entry->addr[0] ? entry->addr : NULL;
+}
+
+/*
+ * resolve_node_hosts
+ *	  Forget the addresses of the node hosts and resolve them again.
+ *
+ * Called when the connection information of the nodes is reloaded, so that
+ * the connections made afterwards do not have to wait for name resolution.
+ */
+static void
+resolve_node_hosts(void)
+{
+	Oid		   *coOids;
+	Oid		   *dnOids;
+	int			numCo;
+	int			numDn;
+	int			i;
+
+	if (hostAddrs != NULL)
+	{
+		hash_destroy(hostAddrs);
+		hostAddrs = NULL;
+	}
+
+	PgxcNodeGetOids(&coOids, &dnOids, &numCo, &numDn, false);
+
+	for (i = 0; i < numCo + numDn; i++)
+	{
+		Oid			nodeoid = (i < numCo) ? coOids[i] : dnOids[i - numCo];
+		NodeDefinition *nodeDef = PgxcNodeGetDefinition(nodeoid);
+
+		if (nodeDef == NULL)
+			continue;
+		(void) node_host_addr(NameStr(nodeDef->nodehost));
+		pfree(nodeDef);
+	}
+
+	pfree(coOids);
+	pfree(dnOids);
+}
+
 /*
  * PGXCNodeConnStr
  *	  Builds a connection string for the provided connection parameters.
@@ -3708,6 +4761,7 @@ PGXCNodeConnStr(char *host, int port, char *dbname,
 {
 	char	   *out,
 				connstr[1024];
+	const char *addr = node_host_addr(host);
 	int			num;
 
 	/*
@@ -3717,8 +4771,9 @@ PGXCNodeConnStr(char *host, int port, char *dbname,
 	 * XXX What's application remote type?
 	 */
 	num = snprintf(connstr, sizeof(connstr),
-				   "host=%s port=%d dbname=%s user=%s application_name='pgxc:%s' sslmode=disable options='-c remotetype=%s -c parentnode=%s %s'",
-				   host, port, dbname, user, parent_node, remote_type, parent_node,
+				   "host=%s%s%s port=%d dbname=%s user=%s application_name='pgxc:%s' sslmode=disable options='-c remotetype=%s -c parentnode=%s %s'",
+				   host, addr ? " hostaddr=" : "", addr ? addr : "",
+				   port, dbname, user, parent_node, remote_type, parent_node,
 				   pgoptions);
 
 	/* Check for overflow */
@@ -3735,31 +4790,172 @@ PGXCNodeConnStr(char *host, int port, char *dbname,
 }
 
 
+/*
+ * node_connect_start
+ *	  Start a non-blocking connection attempt to a node.
+ *
+ * The attempt gives up after pool_connect_timeout. The deadline is enforced
+ * by the callers rather than with connect_timeout, which libpq rounds up to
+ * two seconds at least.
+ */
+static void
+node_connect_start(NodeConnectAttempt *attempt, const char *connstr)
+{
+	attempt->conn = PQconnectStart(connstr);
+	attempt->status = PGRES_POLLING_WRITING;
+	attempt->deadline = 0;
+	if (PoolConnectTimeout > 0)
+		attempt->deadline = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+														PoolConnectTimeout);
+}
+
+/*
+ * node_connect_events
+ *	  What to wait for on the socket of a connection attempt.
+ */
+static short
+node_connect_events(NodeConnectAttempt *attempt)
+{
+	return (attempt->status == PGRES_POLLING_READING) ? POLLIN : POLLOUT;
+}
+
+/*
+ * node_connect_timeout
+ *	  Milliseconds left to a connection attempt, -1 if it has no deadline.
+ */
+static int
+node_connect_timeout(NodeConnectAttempt *attempt)
+{
+	long		secs;
+	int			usecs;
+
+	if (attempt->deadline == 0)
+		return -1;
+
+	TimestampDifference(GetCurrentTimestamp(), attempt->deadline,
+						&secs, &usecs);
+	return secs * 1000 + (usecs + 999) / 1000;
+}
+
+/*
+ * node_connect_advance
+ *	  Move a connection attempt forward, once its socket is ready.
+ *
+ * A failure while the TCP connection was not established yet means the node
+ * refused it or could not be reached, any later failure means the node is
+ * listening and answered, for example that it has too many clients.
+ */
+static NodeConnectResult
+node_connect_advance(NodeConnectAttempt *attempt, bool ready)
+{
+	ConnStatusType before;
+
+	if (attempt->conn == NULL || PQstatus(attempt->conn) == CONNECTION_BAD)
+		return NODE_CONNECT_REFUSED;
+
+	if (!ready)
+	{
+		if (attempt->deadline != 0 &&
+			GetCurrentTimestamp() >= attempt->deadline)
+			return NODE_CONNECT_TIMEOUT;
+		return NODE_CONNECT_IN_PROGRESS;
+	}
+
+	before = PQstatus(attempt->conn);
+
+	attempt->status = PQconnectPoll(attempt->conn);
+	switch (attempt->status)
+	{
+		case PGRES_POLLING_OK:
+			return NODE_CONNECT_OK;
+		case PGRES_POLLING_FAILED:
+			if (before == CONNECTION_STARTED || before == CONNECTION_NEEDED)
+				return NODE_CONNECT_REFUSED;
+			return NODE_CONNECT_REJECTED;
+		default:
+			return NODE_CONNECT_IN_PROGRESS;
+	}
+}
+
+/*
+ * node_connect_wait
+ *	  Drive a connection attempt until it completes, fails or times out.
+ *
+ * Used when there is nothing else to do meanwhile: to grow a pool, and to
+ * ping a node from a backend.
+ */
+static NodeConnectResult
+node_connect_wait(NodeConnectAttempt *attempt)
+{
+	NodeConnectResult result;
+	bool		ready = false;
+
+	while ((result = node_connect_advance(attempt, ready)) ==
+		   NODE_CONNECT_IN_PROGRESS)
+	{
+		struct pollfd pfd;
+		int			rc;
+
+		pfd.fd = PQsocket(attempt->conn);
+		pfd.events = node_connect_events(attempt);
+		pfd.revents = 0;
+
+		rc = poll(&pfd, 1, node_connect_timeout(attempt));
+		if (rc < 0 && errno != EINTR && errno != EAGAIN)
+			return NODE_CONNECT_REFUSED;
+		ready = (rc > 0);
+	}
+
+	return result;
+}
+
 /*
  * PGXCNodeConnect
  *	  Connect to a Datanode using a constructed connection string.
+ *
+ * Returns NULL if the node did not complete the connection within
+ * pool_connect_timeout, otherwise the connection, which is bad if the
+ * attempt failed. *result tells how it went.
  */
 static NODE_CONNECTION *
-PGXCNodeConnect(char *connstr)
+PGXCNodeConnect(char *connstr, NodeConnectResult *result)
 {
-	PGconn	   *conn;
+	NodeConnectAttempt attempt;
 
-	/* Delegate call to the pglib */
-	conn = PQconnectdb(connstr);
-	return (NODE_CONNECTION *) conn;
+	/* Delegate call to the pglib, without blocking */
+	node_connect_start(&attempt, connstr);
+	*result = node_connect_wait(&attempt);
+	if (*result == NODE_CONNECT_TIMEOUT)
+	{
+		PQfinish(attempt.conn);
+		return NULL;
+	}
+
+	return (NODE_CONNECTION *) attempt.conn;
 }
 
 /*
  * PGXCNodePing
  *	  Check that a node (identified the connstring) responds correctly.
+ *
+ * The node is up if it answers the connection attempt within
+ * pool_connect_timeout, even with an error. Unlike PQping, a node refusing
+ * connections while it starts up counts as up: it answers at once, so
+ * trying it does not hold anybody back.
  */
 static int
 PGXCNodePing(const char *connstr)
 {
 	if (connstr[0])
 	{
-		PGPing status = PQping(connstr);
-		if (status == PQPING_OK)
+		NodeConnectAttempt attempt;
+		NodeConnectResult result;
+
+		node_connect_start(&attempt, connstr);
+		result = node_connect_wait(&attempt);
+		PQfinish(attempt.conn);
+
+		if (result == NODE_CONNECT_OK || result == NODE_CONNECT_REJECTED)
 			return 0;
 		else
 			return 1;
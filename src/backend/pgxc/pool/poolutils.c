@@ -32,6 +32,7 @@
 #include "catalog/pgxc_node.h"
 #include "commands/dbcommands.h"
 #include "commands/prepare.h"
+#include "funcapi.h"
 #include "storage/ipc.h"
 #include "storage/procarray.h"
 #include "storage/latch.h"
@@ -40,6 +41,7 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/resowner.h"
+#include "utils/timestamp.h"
 
 /*
  * pgxc_pool_check
@@ -130,6 +132,86 @@ pgxc_pool_reload(PG_FUNCTION_ARGS)
 	PG_RETURN_BOOL(true);
 }
 
+/*
+ * pgxc_stat_get_pool_nodes
+ *
+ * Health of the nodes as seen by the pooler, and what it went through with
+ * those which were down.
+ */
+Datum
+pgxc_stat_get_pool_nodes(PG_FUNCTION_ARGS)
+{
+#define POOL_NODES_COLS	10
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext oldcontext;
+	Oid		   *coOids;
+	Oid		   *dnOids;
+	int			numCo;
+	int			numDn;
+	int			i;
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+	MemoryContextSwitchTo(oldcontext);
+
+	PgxcNodeGetOids(&coOids, &dnOids, &numCo, &numDn, false);
+
+	for (i = 0; i < numCo + numDn; i++)
+	{
+		Oid			nodeoid = (i < numCo) ? coOids[i] : dnOids[i - numCo];
+		NodeDefinition *nodeDef = PgxcNodeGetDefinition(nodeoid);
+		NodeHealthStats *stats;
+		Datum		values[POOL_NODES_COLS];
+		bool		nulls[POOL_NODES_COLS];
+
+		/* Dropped meanwhile */
+		if (nodeDef == NULL)
+			continue;
+		stats = &nodeDef->nodehealthstats;
+
+		memset(nulls, 0, sizeof(nulls));
+		values[0] = NameGetDatum(&nodeDef->nodename);
+		values[1] = CharGetDatum(i < numCo ? PGXC_NODE_COORDINATOR :
+								 PGXC_NODE_DATANODE);
+		values[2] = BoolGetDatum(nodeDef->nodeishealthy);
+		if (stats->unhealthy_since != 0)
+			values[3] = TimestampTzGetDatum(stats->unhealthy_since);
+		else
+			nulls[3] = true;
+		values[4] = Int64GetDatum(stats->connect_failures);
+		values[5] = Int64GetDatum(stats->connect_timeouts);
+		values[6] = Int64GetDatum(stats->fast_failures);
+		values[7] = Int64GetDatum(stats->probes);
+		values[8] = Int64GetDatum(stats->failed_probes);
+		/* in milliseconds, like the other wait times */
+		values[9] = Float8GetDatum((double) stats->wait_time / 1000.0);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		pfree(nodeDef);
+	}
+
+	tuplestore_donestoring(tupstore);
+	PG_RETURN_VOID();
+}
+
 bool
 PgxcNodeRefresh(void)
 {
@@ -433,3 +515,25 @@ HandlePoolerRefresh(void)
 	/* make sure the event is processed in due course */
 	SetLatch(MyLatch);
 }
+
+/*
+ * HandlePoolerReclaim
+ *
+ * This is called when PROCSIG_PGXCPOOL_RECLAIM is activated.
+ * The pooler is short of connections to a node this session holds one to.
+ * Return the connections now if the session is idle, or at the end of the
+ * current transaction otherwise.
+ */
+void
+HandlePoolerReclaim(void)
+{
+	if (proc_exit_inprogress)
+		return;
+
+	InterruptPending = true;
+
+	PoolManagerRequestReclaim();
+
+	/* make sure the event is processed in due course */
+	SetLatch(MyLatch);
+}
@@ -31,6 +31,7 @@
 #include "pgxc/pgxc.h"
 #include "pgxc/pgxcnode.h"
 #include "pgxc/squeue.h"
+#include "pgxc/waitstats.h"
 #include "storage/latch.h"
 #include "storage/lwlock.h"
 #include "storage/shmem.h"
@@ -98,6 +99,19 @@ typedef struct
 #endif
 } ConsState;
 
+/*
+ * Runtime filter installed by a consumer, see SharedQueueSetFilter. Slots are
+ * assigned to consumer nodes in order of arrival and reset when the producer
+ * binds. The bits of a valid slot are never modified, so the producer may
+ * read them without locking.
+ */
+typedef struct
+{
+	int			sf_node;		/* Node id of the consumer parent or -1 */
+	bool		sf_valid;		/* filter bits are set */
+	uint32		sf_bits[FLEXIBLE_ARRAY_MEMBER];
+} SQueueFilter;
+
 /* Shared queue header */
 typedef struct SQueueHeader
 {
@@ -111,6 +125,9 @@ typedef struct SQueueHeader
 	bool		stat_finish;
 	long		stat_paused;
 #endif
+	int			sq_filtersize;	/* Size of a runtime filter, 0 if not used */
+	int			sq_nfilters;	/* Number of installed runtime filters */
+	char	   *sq_filters;		/* sq_nconsumers + 1 runtime filter slots */
 	int			sq_nconsumers;	/* Number of consumers */
 	ConsState 	sq_consumers[0];/* variable length array */
 } SQueueHeader;
@@ -137,6 +154,15 @@ static void *SQueueSyncs;
 #define SQUEUE_HDR_SIZE(nconsumers) \
 	(sizeof(SQueueHeader) + (nconsumers) * sizeof(ConsState))
 
+/* Runtime filters of the consumers and of the producer's own parent */
+#define SQUEUE_FILTER_SLOT_SIZE(size) \
+	MAXALIGN(offsetof(SQueueFilter, sf_bits) + (size))
+#define SQUEUE_FILTERS_SIZE(nconsumers, size) \
+	((size) > 0 ? ((nconsumers) + 1) * SQUEUE_FILTER_SLOT_SIZE(size) : 0)
+#define GET_SQUEUE_FILTER(sq, i) \
+	((SQueueFilter *) ((sq)->sq_filters + \
+					   (i) * SQUEUE_FILTER_SLOT_SIZE((sq)->sq_filtersize)))
+
 #define QUEUE_FREE_SPACE(cstate) \
 	((cstate)->cs_ntuples > 0 ? \
 		((cstate)->cs_qreadpos >= (cstate)->cs_qwritepos ? \
@@ -282,9 +308,11 @@ SharedQueueShmemSize(void)
  * registered on the Datanode. The number of consumers is known at this point,
  * so shared queue may be formatted during reservation. The first process that
  * is acquiring the shared queue on the Datanode does the formatting.
+ * If filtersize is not zero, space for runtime filters of that size is
+ * reserved in the queue, see SharedQueueSetFilter.
  */
 void
-SharedQueueAcquire(const char *sqname, int ncons)
+SharedQueueAcquire(const char *sqname, int ncons, int filtersize)
 {
 	bool		found;
 	SharedQueue sq;
@@ -293,6 +321,17 @@ SharedQueueAcquire(const char *sqname, int ncons)
 	Assert(IsConnFromDatanode());
 	Assert(ncons > 0);
 
+	/*
+	 * The planner keeps the filters well below that, unless shared_queue_size
+	 * is set differently on this node.
+	 */
+	if (SQUEUE_FILTERS_SIZE(ncons, filtersize) > SQUEUE_SIZE / 2)
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+				 errmsg("shared queue is too small for runtime filters of %d bytes",
+						filtersize),
+				 errhint("Increase shared_queue_size or disable enable_runtime_filter.")));
+
 tryagain:
 	LWLockAcquire(SQueuesLock, LW_EXCLUSIVE);
 
@@ -345,11 +384,23 @@ tryagain:
 
 		sq->sq_nconsumers = ncons;
 		/* Determine queue size for a single consumer */
-		qsize = (SQUEUE_SIZE - SQUEUE_HDR_SIZE(sq->sq_nconsumers)) / sq->sq_nconsumers;
+		qsize = (SQUEUE_SIZE - SQUEUE_HDR_SIZE(sq->sq_nconsumers) -
+				 SQUEUE_FILTERS_SIZE(sq->sq_nconsumers, filtersize)) /
+			sq->sq_nconsumers;
 
 		heapPtr = (char *) sq;
 		/* Skip header */
 		heapPtr += SQUEUE_HDR_SIZE(sq->sq_nconsumers);
+		/* Set up runtime filter slots */
+		sq->sq_filtersize = filtersize;
+		sq->sq_nfilters = 0;
+		sq->sq_filters = filtersize > 0 ? heapPtr : NULL;
+		for (i = 0; filtersize > 0 && i <= ncons; i++)
+		{
+			GET_SQUEUE_FILTER(sq, i)->sf_node = -1;
+			GET_SQUEUE_FILTER(sq, i)->sf_valid = false;
+		}
+		heapPtr += SQUEUE_FILTERS_SIZE(sq->sq_nconsumers, filtersize);
 		/* Set up consumer queues */
 		for (i = 0; i < ncons; i++)
 		{
@@ -502,6 +553,17 @@ SharedQueueBind(const char *sqname, List *consNodes,
 		sq->sq_nodeid = PGXC_PARENT_NODE_ID;
 		OwnLatch(&sq->sq_sync->sqs_producer_latch);
 
+		/*
+		 * Forget runtime filters of the previous execution, consumers install
+		 * new ones after they are bound.
+		 */
+		sq->sq_nfilters = 0;
+		for (i = 0; sq->sq_filtersize > 0 && i <= sq->sq_nconsumers; i++)
+		{
+			GET_SQUEUE_FILTER(sq, i)->sf_valid = false;
+			GET_SQUEUE_FILTER(sq, i)->sf_node = -1;
+		}
+
 		i = 0;
 		foreach(lc, distNodes)
 		{
@@ -693,6 +755,159 @@ SharedQueueBind(const char *sqname, List *consNodes,
 }
 
 
+/*
+ * SharedQueueFilterSize
+ *    Determine the size of the runtime filter for the expected number of keys,
+ * on a shared queue with the specified number of consumers. Returns 0 if the
+ * queue can't spare room for a reasonably sized filter.
+ *
+ * With 8 bits per key and two bits set per key about 5% of the rows with
+ * no match pass the filter. The filters, one per consumer and one for the
+ * producer itself, take at most a quarter of the queue.
+ */
+int
+SharedQueueFilterSize(double nkeys, int ncons)
+{
+	long		limit = SQUEUE_SIZE / 4 / (ncons + 1);
+	int			size = SQUEUE_FILTER_MIN_SIZE;
+
+	while (size < nkeys && size < SQUEUE_FILTER_MAX_SIZE)
+		size *= 2;
+	while (size > SQUEUE_FILTER_MIN_SIZE &&
+		   SQUEUE_FILTER_SLOT_SIZE(size) > limit)
+		size /= 2;
+
+	if (SQUEUE_FILTER_SLOT_SIZE(size) > limit)
+		return 0;
+	return size;
+}
+
+
+/*
+ * SharedQueueSetFilter
+ *    Install runtime filter for the rows produced for the current session's
+ * parent node. The consumer should be bound to the queue already, so the
+ * filter is not discarded by the producer binding later. If the queue is not
+ * found nothing is filtered, the filter is an optimization only.
+ *
+ * The slot is filled in before it is marked valid and is not modified after
+ * that, since the producer may be reading it. If the node has installed a
+ * filter already, the slot is invalidated instead, and no rows are filtered
+ * for the node until the producer binds again.
+ */
+void
+SharedQueueSetFilter(const char *sqname, const uint32 *filter, int size)
+{
+	bool		found;
+	SharedQueue sq;
+	int			i;
+
+	LWLockAcquire(SQueuesLock, LW_EXCLUSIVE);
+
+	PGXC_PARENT_NODE_ID = PGXCNodeGetNodeIdFromName(PGXC_PARENT_NODE,
+			&PGXC_PARENT_NODE_TYPE);
+	sq = (SharedQueue) hash_search(SharedQueues, sqname, HASH_FIND, &found);
+	if (!found)
+	{
+		LWLockRelease(SQueuesLock);
+		elog(DEBUG1, "SQueue %s not found, runtime filter is ignored", sqname);
+		return;
+	}
+
+	LWLockAcquire(sq->sq_sync->sqs_producer_lwlock, LW_EXCLUSIVE);
+	LWLockRelease(SQueuesLock);
+
+	if (size != sq->sq_filtersize)
+	{
+		LWLockRelease(sq->sq_sync->sqs_producer_lwlock);
+		elog(DEBUG1, "SQueue %s has no room for runtime filter of %d bytes, "
+			 "it is ignored", sqname, size);
+		return;
+	}
+
+	for (i = 0; i <= sq->sq_nconsumers; i++)
+	{
+		SQueueFilter *sqf = GET_SQUEUE_FILTER(sq, i);
+
+		if (sqf->sf_node == PGXC_PARENT_NODE_ID)
+		{
+			sqf->sf_valid = false;
+			elog(DEBUG1, "SQueue %s, runtime filter is reinstalled for node %d, "
+				 "filtering is disabled", sqname, PGXC_PARENT_NODE_ID);
+			break;
+		}
+		if (sqf->sf_node == -1)
+		{
+			sqf->sf_node = PGXC_PARENT_NODE_ID;
+			memcpy(sqf->sf_bits, filter, size);
+			/* Producer reads the slot without locking */
+			pg_write_barrier();
+			sqf->sf_valid = true;
+			sq->sq_nfilters++;
+
+			elog(DEBUG1, "SQueue %s, runtime filter is installed for node %d",
+				 sqname, PGXC_PARENT_NODE_ID);
+			break;
+		}
+	}
+
+	LWLockRelease(sq->sq_sync->sqs_producer_lwlock);
+}
+
+
+/*
+ * SharedQueueGetFilter
+ *    Return runtime filter installed for the specified consumer and its size,
+ * or NULL. Invoked by the producer for each row it is dispatching, so is lock
+ * free.
+ */
+const uint32 *
+SharedQueueGetFilter(SharedQueue squeue, int consumerIdx, int *size)
+{
+	int			nodeid;
+	int			i;
+
+	if (squeue->sq_nfilters == 0)
+		return NULL;
+
+	if (consumerIdx == SQ_CONS_SELF)
+		nodeid = squeue->sq_nodeid;
+	else
+		nodeid = squeue->sq_consumers[consumerIdx].cs_node;
+
+	for (i = 0; i <= squeue->sq_nconsumers; i++)
+	{
+		SQueueFilter *sqf = GET_SQUEUE_FILTER(squeue, i);
+
+		if (!sqf->sf_valid)
+			continue;
+		pg_read_barrier();
+		if (sqf->sf_node == nodeid)
+		{
+			*size = squeue->sq_filtersize;
+			return sqf->sf_bits;
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * SharedQueueGetConsumerNode
+ *    Return the node id of the parent of the specified consumer, or -1 if no
+ * consumer is bound to the slot.
+ */
+int
+SharedQueueGetConsumerNode(SharedQueue squeue, int consumerIdx)
+{
+	if (consumerIdx == SQ_CONS_SELF)
+		return squeue->sq_nodeid;
+	if (consumerIdx < 0 || consumerIdx >= squeue->sq_nconsumers)
+		return -1;
+	return squeue->sq_consumers[consumerIdx].cs_node;
+}
+
+
 /*
  * Push data from the local tuplestore to the queue for specified consumer.
  * Return true if succeeded and the tuplestore is now empty. Return false
@@ -972,6 +1187,7 @@ SharedQueueRead(SharedQueue squeue, int consumerIdx,
 	SQueueSync *sqsync = squeue->sq_sync;
 	RemoteDataRow datarow;
 	int 		datalen;
+	instr_time	wait_start;
 
 	Assert(cstate->cs_qlength > 0);
 
@@ -1062,9 +1278,11 @@ SharedQueueRead(SharedQueue squeue, int consumerIdx,
 			LWLockRelease(sqsync->sqs_producer_lwlock);
 
 			/* Wait for notification about available info */
+			RemoteWaitStart(wait_start);
 			WaitLatch(&sqsync->sqs_consumer_sync[consumerIdx].cs_latch,
 					WL_LATCH_SET | WL_POSTMASTER_DEATH, -1,
 					WAIT_EVENT_MQ_INTERNAL);
+			RemoteWaitEnd(REMOTE_WAIT_SQUEUE_READ, wait_start);
 
 			/* got the notification, restore lock and try again */
 			LWLockAcquire(sqsync->sqs_producer_lwlock, LW_SHARED);
@@ -1337,9 +1555,14 @@ bool
 SharedQueueWaitOnProducerLatch(SharedQueue squeue, long timeout)
 {
 	SQueueSync *sqsync = squeue->sq_sync;
-	int rc = WaitLatch(&sqsync->sqs_producer_latch,
+	instr_time	wait_start;
+	int rc;
+
+	RemoteWaitStart(wait_start);
+	rc = WaitLatch(&sqsync->sqs_producer_latch,
 			WL_LATCH_SET | WL_POSTMASTER_DEATH | WL_TIMEOUT,
 			timeout, WAIT_EVENT_MQ_INTERNAL);
+	RemoteWaitEnd(REMOTE_WAIT_SQUEUE_WRITE, wait_start);
 	ResetLatch(&sqsync->sqs_producer_latch);
 	return (rc & WL_TIMEOUT);
 }
@@ -1508,6 +1731,7 @@ SharedQueueUnBind(SharedQueue squeue, bool failed)
 	int			wait_result = 0;
 	int         i                = 0;
 	int         consumer_running = 0;
+	instr_time	wait_start;
 
 	elog(DEBUG1, "SQueue %s, unbinding the SQueue (failed: %c) - producer node %d, "
 			"pid %d, nconsumers %d", squeue->sq_key, failed ? 'T' : 'F',
@@ -1566,9 +1790,11 @@ CHECK:
 		elog(DEBUG1, "SQueue %s, wait while %d consumers finish, %d consumers"
 				"not yet bound", squeue->sq_key, c_count, unbound_count);
 		/* wait for a notification */
+		RemoteWaitStart(wait_start);
 		wait_result = WaitLatch(&sqsync->sqs_producer_latch,
 								WL_LATCH_SET | WL_POSTMASTER_DEATH | WL_TIMEOUT,
 								10000L, WAIT_EVENT_MQ_INTERNAL);
+		RemoteWaitEnd(REMOTE_WAIT_SQUEUE_WRITE, wait_start);
 
 		/*
 		 * If we hit a timeout, reset the consumers which still hasn't
@@ -18,6 +18,9 @@
 #include "access/parallel.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#ifdef XCP
+#include "pgxc/resolver.h"
+#endif
 #include "port/atomics.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/postmaster.h"
@@ -130,6 +133,15 @@ static const struct
 	{
 		"ApplyWorkerMain", ApplyWorkerMain
 	}
+#ifdef XCP
+	,
+	{
+		"TwoPhaseResolverLauncherMain", TwoPhaseResolverLauncherMain
+	},
+	{
+		"TwoPhaseResolverMain", TwoPhaseResolverMain
+	}
+#endif
 };
 
 /* Private functions. */
@@ -59,10 +59,15 @@ static void cm_sighup_handler(SIGNAL_ARGS);
 static void cm_sigterm_handler(SIGNAL_ARGS);
 static void ClusterMonitorSetReportedGlobalXmin(GlobalTransactionId xmin);
 static void ClusterMonitorSetReportingGlobalXmin(GlobalTransactionId xmin);
+static void ClusterMonitorRefreshSnapshot(void);
+static void ClusterMonitorAdvanceGlobalXmin(GlobalTransactionId xmin);
 
 /* PID of clustser monitoring process */
 int			ClusterMonitorPid = 0;
 
+/* GUC variable, in milliseconds; 0 disables the snapshot cache */
+int			gtm_snapshot_cache_max_age = 0;
+
 #define CLUSTER_MONITOR_NAPTIME	5
 
 /*
@@ -79,6 +84,9 @@ ClusterMonitorInit(void)
 	GlobalTransactionId newOldestXmin;
 	GlobalTransactionId lastGlobalXmin;
 	GlobalTransactionId latestCompletedXid;
+	TimestampTz last_report = 0;
+	pgsocket	xmin_sock = PGINVALID_SOCKET;
+	bool		xmin_subscribe = true;
 	int status;
 
 	am_clustermon = true;
@@ -171,6 +179,12 @@ ClusterMonitorInit(void)
 		if (got_SIGTERM)
 			goto shutdown;
 
+		/* Start over with a new subscription and report */
+		UnsubscribeGlobalXminGTM();
+		xmin_sock = PGINVALID_SOCKET;
+		xmin_subscribe = true;
+		last_report = 0;
+
 		/*
 		 * Sleep at least 1 second after any error.  We don't want to be
 		 * filling the error logs as fast as we can.
@@ -194,23 +208,44 @@ ClusterMonitorInit(void)
 	/* loop until shutdown request */
 	while (!got_SIGTERM)
 	{
-		struct timeval nap;
+		long		secs;
+		int			usecs;
+		long		naptime;
+		bool		cache_snapshot;
 		int			rc;
 
 		/*
-		 * Repeat at CLUSTER_MONITOR_NAPTIME seconds interval
+		 * Repeat at CLUSTER_MONITOR_NAPTIME seconds interval. When the
+		 * snapshot cache is enabled, wake up often enough to keep it within
+		 * half of its maximum age.
 		 */
-		nap.tv_sec = CLUSTER_MONITOR_NAPTIME;
-		nap.tv_usec = 0;
+		TimestampDifference(GetCurrentTimestamp(),
+							TimestampTzPlusMilliseconds(last_report,
+								CLUSTER_MONITOR_NAPTIME * 1000L),
+							&secs, &usecs);
+		naptime = secs * 1000L + usecs / 1000;
+
+		cache_snapshot = IS_PGXC_COORDINATOR && gtm_snapshot_cache_max_age > 0;
+		if (cache_snapshot)
+			naptime = Min(naptime, Max(gtm_snapshot_cache_max_age / 2, 1));
+		else
+			naptime = Max(naptime, 1);
 
 		/*
 		 * Wait until naptime expires or we get some type of signal (all the
 		 * signal handlers will wake us by calling SetLatch).
 		 */
-		rc = WaitLatch(MyLatch,
-					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
-					   (nap.tv_sec * 1000L) + (nap.tv_usec / 1000L),
-					   WAIT_EVENT_CLUSTER_MONITOR_MAIN);
+		if (xmin_sock != PGINVALID_SOCKET)
+			rc = WaitLatchOrSocket(MyLatch,
+								   WL_LATCH_SET | WL_TIMEOUT |
+								   WL_POSTMASTER_DEATH | WL_SOCKET_READABLE,
+								   xmin_sock, naptime,
+								   WAIT_EVENT_CLUSTER_MONITOR_MAIN);
+		else
+			rc = WaitLatch(MyLatch,
+						   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+						   naptime,
+						   WAIT_EVENT_CLUSTER_MONITOR_MAIN);
 
 		ResetLatch(MyLatch);
 
@@ -232,6 +267,50 @@ ClusterMonitorInit(void)
 		{
 			got_SIGHUP = false;
 			ProcessConfigFile(PGC_SIGHUP);
+			xmin_subscribe = true;
+		}
+
+		/*
+		 * GTM sends us the GlobalXmin as soon as another node's report
+		 * advances it, so that vacuum does not have to wait for our own next
+		 * report to learn about it.
+		 */
+		if (rc & WL_SOCKET_READABLE)
+		{
+			GlobalTransactionId pushedXmin;
+			GlobalTransactionId pushedLatestCompletedXid;
+
+			status = ReceiveGlobalXminGTM(&pushedXmin,
+										  &pushedLatestCompletedXid);
+			if (status == EOF)
+				xmin_sock = PGINVALID_SOCKET;
+			else if (status == 0)
+				ClusterMonitorAdvanceGlobalXmin(pushedXmin);
+		}
+
+		if (IS_PGXC_COORDINATOR && gtm_snapshot_cache_max_age > 0)
+			ClusterMonitorRefreshSnapshot();
+		else if (cache_snapshot)
+		{
+			/* Cache was just disabled, make sure nobody uses it any more */
+			LWLockAcquire(SnapshotCacheLock, LW_EXCLUSIVE);
+			ClusterMonitorCtl->snapshot_cache.valid = false;
+			LWLockRelease(SnapshotCacheLock);
+		}
+
+		if (!TimestampDifferenceExceeds(last_report, GetCurrentTimestamp(),
+										CLUSTER_MONITOR_NAPTIME * 1000))
+			continue;
+		last_report = GetCurrentTimestamp();
+
+		/*
+		 * A GTM proxy refuses the subscription. Don't ask again until
+		 * something changes, we learn the GlobalXmin from our own reports.
+		 */
+		if (xmin_sock == PGINVALID_SOCKET && xmin_subscribe)
+		{
+			xmin_sock = SubscribeGlobalXminGTM();
+			xmin_subscribe = (xmin_sock != PGINVALID_SOCKET);
 		}
 
 		/*
@@ -297,6 +376,7 @@ ClusterMonitorInit(void)
 
 	/* Normal exit from the cluster monitor is here */
 shutdown:
+	UnsubscribeGlobalXminGTM();
 	UnregisterGTM(nodetype);
 	ereport(LOG,
 			(errmsg("cluster monitor shutting down")));
@@ -360,6 +440,7 @@ ClusterMonitorShmemInit(void)
 		/* First time through, so initialize */
 		MemSet(ClusterMonitorCtl, 0, ClusterMonitorShmemSize());
 		SpinLockInit(&ClusterMonitorCtl->mutex);
+		pg_atomic_init_u64(&ClusterMonitorCtl->gtm_seqno, 0);
 	}
 }
 
@@ -426,6 +507,39 @@ ClusterMonitorSetReportingGlobalXmin(GlobalTransactionId xmin)
 	SpinLockRelease(&ClusterMonitorCtl->mutex);
 }
 
+/*
+ * Accept a GlobalXmin pushed by GTM.
+ *
+ * GTM computes it from the xmins reported by all nodes, so as long as we are
+ * not excluded from the computation it can't go past the xmin we reported
+ * last. Check that anyway rather than risk failing the consistency check in
+ * ClusterMonitorSetGlobalXmin, and just wait for our next report otherwise.
+ */
+static void
+ClusterMonitorAdvanceGlobalXmin(GlobalTransactionId xmin)
+{
+	GlobalTransactionId reported_xmin;
+	GlobalTransactionId current_xmin;
+
+	SpinLockAcquire(&ClusterMonitorCtl->mutex);
+	reported_xmin = ClusterMonitorCtl->reported_recent_global_xmin;
+	current_xmin = ClusterMonitorCtl->gtm_recent_global_xmin;
+	SpinLockRelease(&ClusterMonitorCtl->mutex);
+
+	if (!GlobalTransactionIdIsValid(xmin) ||
+		!GlobalTransactionIdIsValid(reported_xmin) ||
+		TransactionIdFollows(xmin, reported_xmin))
+		return;
+
+	if (GlobalTransactionIdIsValid(current_xmin) &&
+		!TransactionIdFollows(xmin, current_xmin))
+		return;
+
+	elog(DEBUG1, "GTM advanced RecentGlobalXmin from %d to %d",
+		 current_xmin, xmin);
+	ClusterMonitorSetGlobalXmin(xmin);
+}
+
 GlobalTransactionId
 ClusterMonitorGetReportingGlobalXmin(void)
 {
@@ -437,3 +551,122 @@ ClusterMonitorGetReportingGlobalXmin(void)
 
 	return reporting_xmin;
 }
+
+/*
+ * Remember the completed transaction count GTM returned with a commit or a
+ * snapshot. A cached snapshot taken by GTM before the count reached this
+ * value may not see the commit, or may be older than a snapshot a session
+ * has already used, see ClusterMonitorGetCachedSnapshot.
+ */
+void
+ClusterMonitorNoteSeqno(uint64 seqno)
+{
+	uint64		cur;
+
+	if (ClusterMonitorCtl == NULL)
+		return;
+
+	cur = pg_atomic_read_u64(&ClusterMonitorCtl->gtm_seqno);
+	while (cur < seqno)
+	{
+		if (pg_atomic_compare_exchange_u64(&ClusterMonitorCtl->gtm_seqno,
+										   &cur, seqno))
+			break;
+	}
+}
+
+/*
+ * Fetch a fresh snapshot from GTM into the shared snapshot cache.
+ */
+static void
+ClusterMonitorRefreshSnapshot(void)
+{
+	ClusterMonitorSnapshotCache *cache = &ClusterMonitorCtl->snapshot_cache;
+	GTM_Snapshot gtm_snapshot;
+	TimestampTz requested_at;
+
+	requested_at = GetCurrentTimestamp();
+
+	gtm_snapshot = GetSnapshotGTM(InvalidGlobalTransactionId, true);
+
+	LWLockAcquire(SnapshotCacheLock, LW_EXCLUSIVE);
+	if (gtm_snapshot == NULL ||
+		gtm_snapshot->sn_xcnt > GTM_MAX_GLOBAL_TRANSACTIONS)
+	{
+		elog(DEBUG1, "could not refresh the cached snapshot");
+		cache->valid = false;
+	}
+	else
+	{
+		cache->seqno = gtm_snapshot->sn_seqno;
+		cache->requested_at = requested_at;
+		cache->xmin = gtm_snapshot->sn_xmin;
+		cache->xmax = gtm_snapshot->sn_xmax;
+		cache->xcnt = gtm_snapshot->sn_xcnt;
+		memcpy(cache->xip, gtm_snapshot->sn_xip,
+			   sizeof (GlobalTransactionId) * gtm_snapshot->sn_xcnt);
+		cache->valid = true;
+	}
+	LWLockRelease(SnapshotCacheLock);
+}
+
+/*
+ * Use the snapshot cached by the cluster monitor as the global snapshot, if
+ * there is one that is recent enough.
+ *
+ * GTM counts the transactions it has completed and returns the count with
+ * each commit and snapshot. The cached snapshot is used only if GTM took it
+ * after reaching the highest count this node has been told about, so a
+ * statement sees the effects of every transaction committed through this
+ * Coordinator before it started, and never sees less than a snapshot already
+ * obtained from GTM on this node. Commits made through other Coordinators
+ * may be missed for at most gtm_snapshot_cache_max_age milliseconds, counted
+ * from the request of the snapshot to now, the current time read by the
+ * caller before taking any lock.
+ *
+ * The caller must hold ClusterMonitorLock, so that the xmin being reported to
+ * GTM cannot move past the snapshot's xmin. Returns false if the caller must
+ * get a snapshot from GTM instead.
+ */
+bool
+ClusterMonitorGetCachedSnapshot(TimestampTz now)
+{
+	ClusterMonitorSnapshotCache *cache = &ClusterMonitorCtl->snapshot_cache;
+	GlobalTransactionId oldest_xmin;
+	uint64		seqno;
+	bool		usable;
+
+	if (gtm_snapshot_cache_max_age <= 0)
+		return false;
+
+	seqno = pg_atomic_read_u64(&ClusterMonitorCtl->gtm_seqno);
+
+	/* The snapshot must not be older than any xmin GTM knows about */
+	SpinLockAcquire(&ClusterMonitorCtl->mutex);
+	oldest_xmin = ClusterMonitorCtl->gtm_recent_global_xmin;
+	if (TransactionIdIsValid(ClusterMonitorCtl->reported_recent_global_xmin) &&
+		(!TransactionIdIsValid(oldest_xmin) ||
+		 TransactionIdPrecedes(oldest_xmin,
+							   ClusterMonitorCtl->reported_recent_global_xmin)))
+		oldest_xmin = ClusterMonitorCtl->reported_recent_global_xmin;
+	if (TransactionIdIsValid(ClusterMonitorCtl->reporting_recent_global_xmin) &&
+		(!TransactionIdIsValid(oldest_xmin) ||
+		 TransactionIdPrecedes(oldest_xmin,
+							   ClusterMonitorCtl->reporting_recent_global_xmin)))
+		oldest_xmin = ClusterMonitorCtl->reporting_recent_global_xmin;
+	SpinLockRelease(&ClusterMonitorCtl->mutex);
+
+	LWLockAcquire(SnapshotCacheLock, LW_SHARED);
+	usable = cache->valid &&
+		cache->seqno >= seqno &&
+		!TimestampDifferenceExceeds(cache->requested_at, now,
+									gtm_snapshot_cache_max_age) &&
+		(!TransactionIdIsValid(oldest_xmin) ||
+		 !TransactionIdPrecedes(cache->xmin, oldest_xmin));
+	if (usable)
+		SetGlobalSnapshotData(cache->xmin, cache->xmax, cache->xcnt,
+							  cache->xip, SNAPSHOT_DIRECT);
+	LWLockRelease(SnapshotCacheLock);
+
+	return usable;
+}
@@ -3578,6 +3578,9 @@ pgstat_get_wait_activity(WaitEventActivity w)
 		case WAIT_EVENT_CLUSTER_MONITOR_MAIN:
 			event_name = "ClusterMonitorMain";
 			break;
+		case WAIT_EVENT_TWOPHASE_RESOLVER_MAIN:
+			event_name = "TwoPhaseResolverMain";
+			break;
 			/* no default case, so that compiler will warn */
 	}
 
@@ -3676,6 +3679,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_PARALLEL_BITMAP_SCAN:
 			event_name = "ParallelBitmapScan";
 			break;
+		case WAIT_EVENT_POOLER_CONNECTIONS:
+			event_name = "PoolerConnections";
+			break;
 		case WAIT_EVENT_PROCARRAY_GROUP_UPDATE:
 			event_name = "ProcArrayGroupUpdate";
 			break;
@@ -114,6 +114,7 @@
 #include "pgxc/locator.h"
 #include "nodes/nodes.h"
 #include "pgxc/poolmgr.h"
+#include "pgxc/resolver.h"
 #include "access/gtm.h"
 #endif
 #include "pg_getopt.h"
@@ -580,6 +581,7 @@ char *parentPGXCNode = NULL;
 int  parentPGXCNodeId = -1;
 int	 parentPGXCPid = -1;
 char parentPGXCNodeType = PGXC_NODE_DATANODE;
+uint32 parentPGXCQueryId = 0;
 #endif
 
 #ifdef PGXC
@@ -1071,6 +1073,11 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	ApplyLauncherRegister();
 
+#ifdef XCP
+	/* Likewise the resolver of in-doubt 2PC, on Coordinators */
+	TwoPhaseResolverRegister();
+#endif
+
 	/*
 	 * process any libraries that should be preloaded at postmaster start
 	 */
@@ -54,6 +54,8 @@
 #include "pgxc/pgxc.h"
 #include "pgxc/squeue.h"
 #include "pgxc/pause.h"
+#include "pgxc/waitstats.h"
+#include "commands/sequence.h"
 #endif
 #include "utils/backend_random.h"
 #include "utils/snapmgr.h"
@@ -158,8 +160,12 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		if (IS_PGXC_DATANODE)
 			size = add_size(size, SharedQueueShmemSize());
 		if (IS_PGXC_COORDINATOR)
+		{
 			size = add_size(size, ClusterLockShmemSize());
+			size = add_size(size, SequenceShmemSize());
+		}
 		size = add_size(size, ClusterMonitorShmemSize());
+		size = add_size(size, RemoteWaitStatsShmemSize());
 #endif
 		size = add_size(size, ApplyLauncherShmemSize());
 		size = add_size(size, SnapMgrShmemSize());
@@ -294,8 +300,12 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	if (IS_PGXC_DATANODE)
 		SharedQueuesInit();
 	if (IS_PGXC_COORDINATOR)
+	{
 		ClusterLockShmemInit();
+		SequenceShmemInit();
+	}
 	ClusterMonitorShmemInit();
+	RemoteWaitStatsShmemInit();
 #endif
 
 	/*
@@ -57,6 +57,7 @@
 #include <signal.h>
 
 #include "access/clog.h"
+#include "access/commit_ts.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
 #include "access/twophase.h"
@@ -66,6 +67,7 @@
 #include "miscadmin.h"
 #include "postmaster/clustermon.h"
 #include "pgstat.h"
+#include "storage/lmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "storage/spin.h"
@@ -185,6 +187,9 @@ typedef struct
 	int gxcnt;
 	int max_gxcnt;
 	TransactionId *gxip;
+#ifdef XCP
+	TimestampTz snapshot_ts;	/* of a timestamp based snapshot, or 0 */
+#endif
 } GlobalSnapshotData;
 
 GlobalSnapshotData globalSnapshot = {
@@ -200,6 +205,56 @@ static void GetSnapshotFromGlobalSnapshot(Snapshot snapshot);
 static void GetSnapshotDataFromGTM(Snapshot snapshot);
 #endif
 
+#ifdef XCP
+/*
+ * Transactions which committed with a timestamp from GTM
+ *
+ * A timestamp based snapshot must treat the transactions which committed with
+ * a later timestamp as running, even those which had already committed when
+ * the snapshot was taken on this node. Its xmin must precede their XIDs, and
+ * vacuum must keep the row versions they deleted. For this, we keep the
+ * oldest XID committed within each TS_COMMIT_BUCKET_MS of commit timestamps.
+ * It is held back in the xmin we report to GTM.
+ *
+ * The buckets are kept until the oldest snapshot timestamp of our backends
+ * (PGPROC->snapshotTs), and at least TS_COMMIT_LOG_GRACE_MS for the snapshots
+ * of the transactions yet to reach this node. The buckets which would not fit
+ * in the ring are merged into one. A snapshot whose timestamp is older than
+ * what we still remember can't be taken.
+ */
+#define TS_COMMIT_BUCKET_MS			100
+#define TS_COMMIT_LOG_GRACE_MS		(60 * 1000)
+#define TS_COMMIT_LOG_BUCKETS	(TS_COMMIT_LOG_GRACE_MS / TS_COMMIT_BUCKET_MS)
+
+#define TsCommitBucketId(ts)	((ts) / (TS_COMMIT_BUCKET_MS * INT64CONST(1000)))
+#define TsCommitBucketEnd(id)	(((id) + 1) * TS_COMMIT_BUCKET_MS * INT64CONST(1000))
+
+typedef struct TsCommitBucket
+{
+	int64		id;				/* commit timestamp / bucket width, or -1 */
+	TransactionId xmin;			/* oldest XID committed in the bucket */
+} TsCommitBucket;
+
+typedef struct TsCommitLogData
+{
+	TimestampTz	discarded;		/* end of the latest bucket dropped */
+	int64		horizon;		/* oldest bucket still needed */
+	int64		merged;			/* latest bucket merged, or -1 */
+	TransactionId merged_xmin;	/* oldest XID in the merged buckets */
+	int64		computed;		/* current bucket when xmin was computed */
+	TransactionId xmin;			/* oldest XID in all the buckets */
+	TsCommitBucket buckets[TS_COMMIT_LOG_BUCKETS];
+} TsCommitLogData;
+
+static TsCommitLogData *tsCommitLog;
+
+static TimestampTz GetSnapshotTimestamp(bool latest);
+static void WaitForTimestampCommits(void);
+static TransactionId TsCommitLogGetXmin(void);
+static int64 TsCommitLogHorizon(void);
+static TransactionId TsCommitLogSnapshotXmin(TimestampTz snapshot_ts);
+#endif
+
 /* Primitives for KnownAssignedXids array handling for standby */
 static void KnownAssignedXidsCompress(bool force);
 static void KnownAssignedXidsAdd(TransactionId from_xid, TransactionId to_xid,
@@ -264,6 +319,10 @@ ProcArrayShmemSize(void)
 						mul_size(sizeof(bool), TOTAL_MAX_CACHED_SUBXIDS));
 	}
 
+#ifdef XCP
+	size = add_size(size, sizeof(TsCommitLogData));
+#endif
+
 	return size;
 }
 
@@ -318,6 +377,28 @@ CreateSharedProcArray(void)
 							&found);
 	}
 
+#ifdef XCP
+	tsCommitLog = (TsCommitLogData *)
+		ShmemInitStruct("Timestamp Commit Log", sizeof(TsCommitLogData),
+						&found);
+	if (!found)
+	{
+		int			i;
+
+		tsCommitLog->discarded = 0;
+		tsCommitLog->horizon = 0;
+		tsCommitLog->merged = -1;
+		tsCommitLog->merged_xmin = InvalidTransactionId;
+		tsCommitLog->computed = -1;
+		tsCommitLog->xmin = InvalidTransactionId;
+		for (i = 0; i < TS_COMMIT_LOG_BUCKETS; i++)
+		{
+			tsCommitLog->buckets[i].id = -1;
+			tsCommitLog->buckets[i].xmin = InvalidTransactionId;
+		}
+	}
+#endif
+
 	/* Register and initialize fields of ProcLWLockTranche */
 	LWLockRegisterTranche(LWTRANCHE_PROC, "proc");
 }
@@ -510,6 +591,11 @@ ProcArrayEndTransaction(PGPROC *proc, TransactionId latestXid)
 		Assert(pgxact->nxids == 0);
 		Assert(pgxact->overflowed == false);
 	}
+
+#ifdef XCP
+	/* Our XID is gone, snapshots need not wait for us any more */
+	proc->tsCommitting = false;
+#endif
 }
 
 /*
@@ -1420,6 +1506,9 @@ GetOldestXminInternal(Relation rel, int flags, bool computeLocal,
 
 	volatile TransactionId replication_slot_xmin = InvalidTransactionId;
 	volatile TransactionId replication_slot_catalog_xmin = InvalidTransactionId;
+#ifdef XCP
+	TransactionId ts_xmin;
+#endif
 
 	/*
 	 * If we're not computing a relation specific limit, or if a shared
@@ -1436,6 +1525,12 @@ GetOldestXminInternal(Relation rel, int flags, bool computeLocal,
 			xmin = FirstNormalTransactionId;
 		return xmin;
 	}
+
+	/*
+	 * Transactions which committed with a timestamp from GTM. This must be
+	 * read before the procarray, see TsCommitLogSnapshotXmin.
+	 */
+	ts_xmin = TsCommitLogGetXmin();
 #endif
 
 	/* Cannot look for individual databases during recovery */
@@ -1526,6 +1621,12 @@ GetOldestXminInternal(Relation rel, int flags, bool computeLocal,
 		}
 	}
 
+#ifdef XCP
+	if (TransactionIdIsNormal(ts_xmin) &&
+		TransactionIdPrecedes(ts_xmin, result))
+		result = ts_xmin;
+#endif
+
 	/* fetch into volatile var while ProcArrayLock is held */
 	replication_slot_xmin = procArray->replication_slot_xmin;
 	replication_slot_catalog_xmin = procArray->replication_slot_catalog_xmin;
@@ -1667,6 +1768,19 @@ GetSnapshotData(Snapshot snapshot, bool latest)
 	volatile TransactionId replication_slot_catalog_xmin = InvalidTransactionId;
 #ifdef XCP
 	TransactionId clustermon_xmin;
+	TimestampTz	snapshot_ts;
+#endif
+
+#ifdef XCP
+	/*
+	 * With timestamp based snapshots every node computes its snapshot from
+	 * its own procarray, once the transactions which may commit with an
+	 * earlier timestamp are done.
+	 */
+	snapshot->snapshot_ts = 0;
+	snapshot_ts = GetSnapshotTimestamp(latest);
+	if (snapshot_ts != 0)
+		WaitForTimestampCommits();
 #endif
 
 #ifdef PGXC  /* PGXC_DATANODE */
@@ -1680,7 +1794,12 @@ GetSnapshotData(Snapshot snapshot, bool latest)
 	 * may still want to use this model for performance of their XL cluster, at
 	 * the cost of reduced global consistency
 	 */ 
+#ifdef XCP
+	if (snapshot_ts == 0 &&
+		GlobalSnapshotSource == GLOBAL_SNAPSHOT_SOURCE_GTM)
+#else
 	if (GlobalSnapshotSource == GLOBAL_SNAPSHOT_SOURCE_GTM)
+#endif
 	{
 		/*
 		 * Obtain a global snapshot for a Postgres-XC session
@@ -1894,8 +2013,37 @@ GetSnapshotData(Snapshot snapshot, bool latest)
 	replication_slot_xmin = procArray->replication_slot_xmin;
 	replication_slot_catalog_xmin = procArray->replication_slot_catalog_xmin;
 
+#ifdef XCP
+	/*
+	 * Transactions committed with a later timestamp than the snapshot one are
+	 * running for the snapshot. The lock is kept until our xmin is set.
+	 */
+	if (snapshot_ts != 0)
+	{
+		TransactionId ts_xmin;
+
+		LWLockAcquire(TimestampCommitLogLock, LW_SHARED);
+		ts_xmin = TsCommitLogSnapshotXmin(snapshot_ts);
+		if (TransactionIdIsNormal(ts_xmin) &&
+			TransactionIdPrecedes(ts_xmin, xmin))
+			xmin = ts_xmin;
+	}
+#endif
+
 	if (!TransactionIdIsValid(MyPgXact->xmin))
+	{
 		MyPgXact->xmin = TransactionXmin = xmin;
+#ifdef XCP
+		MyProc->snapshotTs = snapshot_ts;
+#endif
+	}
+#ifdef XCP
+	else if (MyProc->snapshotTs == 0)
+		MyProc->snapshotTs = snapshot_ts;
+
+	if (snapshot_ts != 0)
+		LWLockRelease(TimestampCommitLogLock);
+#endif
 
 	LWLockRelease(ProcArrayLock);
 
@@ -1943,6 +2091,9 @@ GetSnapshotData(Snapshot snapshot, bool latest)
 	snapshot->suboverflowed = suboverflowed;
 
 	snapshot->curcid = GetCurrentCommandId(false);
+#ifdef XCP
+	snapshot->snapshot_ts = snapshot_ts;
+#endif
 
 #ifdef PGXC
 	if (!RecoveryInProgress())
@@ -3381,6 +3532,9 @@ SetGlobalSnapshotData(TransactionId xmin, TransactionId xmax,
 	globalSnapshot.gxmax = xmax;
 	globalSnapshot.gxcnt = xcnt;
 	memcpy(globalSnapshot.gxip, xip, sizeof (TransactionId) * xcnt);
+#ifdef XCP
+	globalSnapshot.snapshot_ts = 0;
+#endif
 	elog (DEBUG1, "global snapshot info: gxmin: %d, gxmax: %d, gxcnt: %d", xmin, xmax, xcnt);
 }
 
@@ -3394,9 +3548,319 @@ UnsetGlobalSnapshotData(void)
 	globalSnapshot.gxmin = InvalidTransactionId;
 	globalSnapshot.gxmax = InvalidTransactionId;
 	globalSnapshot.gxcnt = 0;
+#ifdef XCP
+	globalSnapshot.snapshot_ts = 0;
+#endif
 	elog (DEBUG1, "unset snapshot info");
 }
 
+#ifdef XCP
+/*
+ * Store the timestamp the Coordinator sent along with the snapshot data, if
+ * it uses timestamp based snapshots
+ */
+void
+SetGlobalSnapshotTimestamp(TimestampTz snapshot_ts)
+{
+	globalSnapshot.snapshot_ts = snapshot_ts;
+}
+
+/*
+ * Timestamp of a timestamp based snapshot, or 0 if the snapshot is to be
+ * taken the usual way.
+ *
+ * The Coordinator gets the timestamp from GTM once per transaction, or once
+ * per statement under READ COMMITTED, and sends it down with the snapshots,
+ * so that all the nodes agree on the transactions they show. A fresh one is
+ * taken from GTM when the latest snapshot is asked for.
+ */
+static TimestampTz
+GetSnapshotTimestamp(bool latest)
+{
+	TimestampTz snapshot_ts = 0;
+
+	if (RecoveryInProgress() || !IsPostmasterEnvironment ||
+			IsInitProcessingMode())
+		return 0;
+
+	if (globalSnapshot.snapshot_ts != 0 &&
+			(IsConnFromCoord() || IsConnFromDatanode()))
+	{
+		if (!latest)
+			snapshot_ts = globalSnapshot.snapshot_ts;
+	}
+	else if (GlobalSnapshotSource != GLOBAL_SNAPSHOT_SOURCE_TIMESTAMP)
+		return 0;
+
+	if (!track_commit_timestamp)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("timestamp based snapshots require track_commit_timestamp to be enabled")));
+
+	if (latest)
+	{
+		snapshot_ts = GetTimestampGTM();
+		if (snapshot_ts == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_FAILURE),
+					 errmsg("could not obtain a snapshot timestamp from GTM")));
+	}
+	else if (snapshot_ts == 0)
+		snapshot_ts = AssignXactSnapshotTimestamp();
+
+	SetXactSnapshotTimestamp(snapshot_ts);
+	return snapshot_ts;
+}
+
+/*
+ * Wait for the transactions which may have been given a commit timestamp
+ * preceding the one of the snapshot we are about to take, but are not
+ * committed yet: those between AssignXactCommitTimestamp and the end of
+ * their commit, and the prepared ones. Any other transaction gets its commit
+ * timestamp after the snapshot timestamp was handed out, so it stays
+ * invisible to the snapshot whenever it commits.
+ */
+static void
+WaitForTimestampCommits(void)
+{
+	ProcArrayStruct *arrayP = procArray;
+	TransactionId *xids;
+	int			nxids = 0;
+	int			index;
+
+	xids = (TransactionId *) palloc(arrayP->maxProcs * sizeof(TransactionId));
+
+	LWLockAcquire(ProcArrayLock, LW_SHARED);
+
+	for (index = 0; index < arrayP->numProcs; index++)
+	{
+		int			pgprocno = arrayP->pgprocnos[index];
+		volatile PGPROC *proc = &allProcs[pgprocno];
+		volatile PGXACT *pgxact = &allPgXact[pgprocno];
+		TransactionId xid = pgxact->xid;
+
+		if (proc == MyProc || !TransactionIdIsNormal(xid))
+			continue;
+
+		if (proc->pid == 0 || proc->tsCommitting)
+			xids[nxids++] = xid;
+	}
+
+	LWLockRelease(ProcArrayLock);
+
+	for (index = 0; index < nxids; index++)
+		XactLockTableWait(xids[index], NULL, NULL, XLTW_None);
+
+	pfree(xids);
+}
+
+/*
+ * Remember that xid commits with the given timestamp from GTM. This must be
+ * done before the XID leaves the procarray, so that the xmin we report to
+ * GTM covers it all the time.
+ */
+void
+ProcArrayNoteTimestampCommit(TransactionId xid, TimestampTz commit_ts)
+{
+	int64		id = TsCommitBucketId(commit_ts);
+	TsCommitBucket *bucket = &tsCommitLog->buckets[id % TS_COMMIT_LOG_BUCKETS];
+
+	LWLockAcquire(TimestampCommitLogLock, LW_EXCLUSIVE);
+
+	/*
+	 * Reuse the slot of an older bucket, merging it if a snapshot may still
+	 * need it. A commit with a timestamp that old just lowers the xmin of the
+	 * newer bucket.
+	 */
+	if (bucket->id < id)
+	{
+		if (bucket->id >= tsCommitLog->horizon)
+		{
+			tsCommitLog->merged = Max(tsCommitLog->merged, bucket->id);
+			if (!TransactionIdIsValid(tsCommitLog->merged_xmin) ||
+				TransactionIdPrecedes(bucket->xmin, tsCommitLog->merged_xmin))
+				tsCommitLog->merged_xmin = bucket->xmin;
+		}
+		else if (bucket->id >= 0)
+			tsCommitLog->discarded = Max(tsCommitLog->discarded,
+										 TsCommitBucketEnd(bucket->id));
+		bucket->id = id;
+		bucket->xmin = InvalidTransactionId;
+	}
+
+	if (!TransactionIdIsValid(bucket->xmin) ||
+		TransactionIdPrecedes(xid, bucket->xmin))
+		bucket->xmin = xid;
+	if (!TransactionIdIsValid(tsCommitLog->xmin) ||
+		TransactionIdPrecedes(xid, tsCommitLog->xmin))
+		tsCommitLog->xmin = xid;
+
+	LWLockRelease(TimestampCommitLogLock);
+}
+
+/*
+ * Oldest XID of the transactions which committed with a timestamp from GTM
+ * and may still be needed, or InvalidTransactionId.
+ *
+ * The result is cached: ProcArrayNoteTimestampCommit lowers it, and the
+ * buckets no longer needed are dropped only once per bucket width.
+ */
+static TransactionId
+TsCommitLogGetXmin(void)
+{
+	int64		current;
+	TransactionId xmin = InvalidTransactionId;
+	int			i;
+
+	/*
+	 * Nothing to do unless timestamp based snapshots are in use. A commit
+	 * being noted concurrently is still in the procarray.
+	 */
+	if (!TransactionIdIsValid(tsCommitLog->xmin))
+		return InvalidTransactionId;
+
+	current = TsCommitBucketId(GetCurrentTimestamp());
+
+	LWLockAcquire(TimestampCommitLogLock, LW_SHARED);
+	if (tsCommitLog->computed == current)
+	{
+		xmin = tsCommitLog->xmin;
+		LWLockRelease(TimestampCommitLogLock);
+		return xmin;
+	}
+	LWLockRelease(TimestampCommitLogLock);
+
+	LWLockAcquire(TimestampCommitLogLock, LW_EXCLUSIVE);
+	if (tsCommitLog->computed == current)
+	{
+		xmin = tsCommitLog->xmin;
+		LWLockRelease(TimestampCommitLogLock);
+		return xmin;
+	}
+
+	tsCommitLog->horizon = Max(tsCommitLog->horizon, TsCommitLogHorizon());
+
+	if (tsCommitLog->merged >= 0)
+	{
+		if (tsCommitLog->merged < tsCommitLog->horizon)
+		{
+			tsCommitLog->discarded = Max(tsCommitLog->discarded,
+									TsCommitBucketEnd(tsCommitLog->merged));
+			tsCommitLog->merged = -1;
+			tsCommitLog->merged_xmin = InvalidTransactionId;
+		}
+		else
+			xmin = tsCommitLog->merged_xmin;
+	}
+
+	for (i = 0; i < TS_COMMIT_LOG_BUCKETS; i++)
+	{
+		TsCommitBucket *bucket = &tsCommitLog->buckets[i];
+
+		if (bucket->id < 0)
+			continue;
+
+		if (bucket->id < tsCommitLog->horizon)
+		{
+			tsCommitLog->discarded = Max(tsCommitLog->discarded,
+										 TsCommitBucketEnd(bucket->id));
+			bucket->id = -1;
+			bucket->xmin = InvalidTransactionId;
+			continue;
+		}
+
+		if (!TransactionIdIsValid(xmin) ||
+			TransactionIdPrecedes(bucket->xmin, xmin))
+			xmin = bucket->xmin;
+	}
+	tsCommitLog->xmin = xmin;
+	tsCommitLog->computed = current;
+	LWLockRelease(TimestampCommitLogLock);
+
+	return xmin;
+}
+
+/*
+ * Oldest bucket a snapshot may still need: the one of the oldest snapshot
+ * timestamp of our backends, or the grace period.
+ *
+ * The caller holds TimestampCommitLogLock exclusively. A backend publishes
+ * its snapshot timestamp under the lock, after it checked the timestamp is
+ * not older than what we remember, so we can read them without ProcArrayLock.
+ * The ones of backends without an xmin are stale.
+ */
+static int64
+TsCommitLogHorizon(void)
+{
+	TimestampTz oldest;
+	int			i;
+
+	oldest = GetCurrentTimestamp() - TS_COMMIT_LOG_GRACE_MS * INT64CONST(1000);
+
+	for (i = 0; i < ProcGlobal->allProcCount; i++)
+	{
+		volatile PGPROC *proc = &allProcs[i];
+		volatile PGXACT *pgxact = &allPgXact[i];
+		TimestampTz snapshot_ts = proc->snapshotTs;
+
+		if (snapshot_ts != 0 && snapshot_ts < oldest &&
+			TransactionIdIsValid(pgxact->xmin))
+			oldest = snapshot_ts;
+	}
+
+	return TsCommitBucketId(oldest);
+}
+
+/*
+ * Oldest XID a snapshot with the given timestamp must see as running although
+ * it committed, or InvalidTransactionId.
+ *
+ * The caller holds TimestampCommitLogLock until it has set its xmin. Since
+ * GetOldestXminInternal reads the buckets before the procarray, it sees
+ * either the bucket which holds that XID or our xmin.
+ */
+static TransactionId
+TsCommitLogSnapshotXmin(TimestampTz snapshot_ts)
+{
+	int64		id = TsCommitBucketId(snapshot_ts);
+	TransactionId xmin = InvalidTransactionId;
+	TransactionId global_xmin;
+	int			i;
+
+	if (tsCommitLog->discarded > snapshot_ts)
+		ereport(ERROR,
+				(errcode(ERRCODE_SNAPSHOT_TOO_OLD),
+				 errmsg("snapshot too old"),
+				 errdetail("The commits following the snapshot timestamp are no longer tracked on this node.")));
+
+	if (tsCommitLog->merged >= id)
+		xmin = tsCommitLog->merged_xmin;
+
+	for (i = 0; i < TS_COMMIT_LOG_BUCKETS; i++)
+	{
+		TsCommitBucket *bucket = &tsCommitLog->buckets[i];
+
+		if (bucket->id < id)
+			continue;
+
+		if (!TransactionIdIsValid(xmin) ||
+			TransactionIdPrecedes(bucket->xmin, xmin))
+			xmin = bucket->xmin;
+	}
+
+	/* Row versions they deleted may be gone already */
+	global_xmin = ClusterMonitorGetGlobalXmin();
+	if (TransactionIdIsValid(xmin) && TransactionIdIsValid(global_xmin) &&
+		TransactionIdPrecedes(xmin, global_xmin))
+		ereport(ERROR,
+				(errcode(ERRCODE_SNAPSHOT_TOO_OLD),
+				 errmsg("snapshot too old"),
+				 errdetail("Transactions committed after the snapshot timestamp are older than the global xmin.")));
+
+	return xmin;
+}
+#endif
+
 
 /*
  * Entry of snapshot obtention for Postgres-XC node
@@ -3447,6 +3911,8 @@ GetSnapshotDataFromGTM(Snapshot snapshot)
 	GlobalTransactionId reporting_xmin;
 	bool canbe_grouped = (!FirstSnapshotSet) || (!IsolationUsesXactSnapshot());
 	bool xmin_changed = false;
+	bool use_cache;
+	TimestampTz now = 0;
 
 	/*
 	 * We never want to use a snapshot whose xmin is older than the
@@ -3468,9 +3934,32 @@ GetSnapshotDataFromGTM(Snapshot snapshot)
 	 * fresh snapshot from the GTM.
 	 *
 	 */
-	
+
+	/*
+	 * A statement snapshot of a read committed transaction may come from the
+	 * cache maintained by the cluster monitor, saving the round trip to GTM.
+	 * The age of the cached snapshot is checked against the current time,
+	 * read before taking the lock.
+	 */
+	use_cache = IS_PGXC_LOCAL_COORDINATOR && gtm_snapshot_cache_max_age > 0 &&
+		!IsolationUsesXactSnapshot() &&
+		!TransactionIdIsValid(GetCurrentTransactionIdIfAny());
+	if (use_cache)
+		now = GetCurrentTimestamp();
+
 	LWLockAcquire(ClusterMonitorLock, LW_SHARED);
 
+	if (use_cache && ClusterMonitorGetCachedSnapshot(now))
+	{
+		RecentGlobalXmin = ClusterMonitorGetGlobalXmin();
+		if (!TransactionIdIsValid(RecentGlobalXmin))
+			RecentGlobalXmin = FirstNormalTransactionId;
+		RecentGlobalDataXmin = RecentGlobalXmin;
+		GetSnapshotFromGlobalSnapshot(snapshot);
+		LWLockRelease(ClusterMonitorLock);
+		return;
+	}
+
 retry:
 	reporting_xmin = ClusterMonitorGetReportingGlobalXmin();
 	
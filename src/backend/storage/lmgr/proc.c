@@ -378,6 +378,8 @@ InitProcess(void)
 #ifdef XCP
 	MyProc->coordId = InvalidOid;
 	MyProc->coordPid = 0;
+	MyProc->tsCommitting = false;
+	MyProc->snapshotTs = 0;
 #endif
 	MyProc->isBackgroundWorker = IsBackgroundWorker;
 	MyPgXact->delayChkpt = false;
@@ -558,6 +560,8 @@ InitAuxiliaryProcess(void)
 #ifdef XCP
 	MyProc->coordId = InvalidOid;
 	MyProc->coordPid = 0;
+	MyProc->tsCommitting = false;
+	MyProc->snapshotTs = 0;
 #endif
 #ifdef PGXC
 	MyProc->isPooler = false;
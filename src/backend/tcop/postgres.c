@@ -92,6 +92,7 @@
 #ifdef XCP
 #include "pgxc/pause.h"
 #include "pgxc/squeue.h"
+#include "pgxc/waitstats.h"
 #endif
 #include "commands/copy.h"
 /* PGXC_DATANODE */
@@ -594,7 +595,10 @@ SocketBackend(StringInfo inBuf)
 		case 'g':				/* GXID */
 		case 's':				/* Snapshot */
 		case 't':				/* Timestamp */
+		case 'T':				/* Commit timestamp */
 		case 'b':				/* Barrier */
+		case 'R':				/* Runtime filter */
+		case 'q':				/* Query id */
 			break;
 #endif
 
@@ -2429,6 +2433,13 @@ exec_execute_message(const char *portal_name, long max_rows)
 			CommandCounterIncrement();
 		}
 
+#ifdef XCP
+		/* Report instrumentation of the plan sent down by the master node */
+		if (portal->strategy == PORTAL_ONE_SELECT ||
+			portal->strategy == PORTAL_DISTRIBUTED)
+			SendRemoteInstrumentation(PortalGetQueryDesc(portal));
+#endif
+
 		/* Send appropriate CommandComplete to client */
 		EndCommand(completionTag, dest);
 	}
@@ -4089,6 +4100,7 @@ PostgresMain(int argc, char *argv[],
 	parentPGXCNode = NULL;
 	parentPGXCNodeId = -1;
 	parentPGXCNodeType = PGXC_NODE_DATANODE;
+	parentPGXCQueryId = 0;
 	cluster_lock_held = false;
 	cluster_ex_lock_held = false;
 #endif /* XCP */
@@ -4551,6 +4563,12 @@ PostgresMain(int argc, char *argv[],
 		 */
 		if (send_ready_for_query)
 		{
+#ifdef XCP
+			/* Publish the remote waits of the statements just run */
+			FlushRemoteWaits();
+			/* The query of the parent node is over */
+			parentPGXCQueryId = 0;
+#endif
 			if (IsAbortedTransactionBlockState())
 			{
 				set_ps_display("idle in transaction (aborted)", false);
@@ -5015,9 +5033,19 @@ PostgresMain(int argc, char *argv[],
 				}
 				else
 					xip = NULL;
+#ifdef XCP
+				/* Timestamp of a timestamp based snapshot, if any */
+				if (input_message.cursor < input_message.len)
+					timestamp = (TimestampTz) pq_getmsgint64(&input_message);
+				else
+					timestamp = 0;
+#endif
 				pq_getmsgend(&input_message);
 				SetGlobalSnapshotData(xmin, xmax, xcnt, xip,
 						SNAPSHOT_COORDINATOR);
+#ifdef XCP
+				SetGlobalSnapshotTimestamp(timestamp);
+#endif
 				if (xip)
 					pfree(xip);
 				break;
@@ -5033,6 +5061,16 @@ PostgresMain(int argc, char *argv[],
 				SetCurrentGTMDeltaTimestamp(timestamp);
 				break;
 
+#ifdef XCP
+			case 'T':			/* commit timestamp */
+				timestamp = (TimestampTz) pq_getmsgint64(&input_message);
+				pq_getmsgend(&input_message);
+
+				/* To be used by the COMMIT PREPARED that follows */
+				SetXactCommitTimestamp(timestamp);
+				break;
+#endif
+
 			case 'b':			/* barrier */
 				{
 					int command;
@@ -5063,6 +5101,36 @@ PostgresMain(int argc, char *argv[],
 					}
 				}
 				break;
+
+			case 'R':			/* runtime filter */
+				{
+					const char *portal_name;
+					uint32	   *filter;
+					int			size;
+					int			i;
+
+					portal_name = pq_getmsgstring(&input_message);
+					size = pq_getmsgint(&input_message, 4);
+					if (size < SQUEUE_FILTER_MIN_SIZE ||
+						size > SQUEUE_FILTER_MAX_SIZE ||
+						(size & (size - 1)) != 0)
+						ereport(ERROR,
+								(errcode(ERRCODE_PROTOCOL_VIOLATION),
+								 errmsg("invalid runtime filter size %d", size)));
+					filter = (uint32 *) palloc(size);
+					for (i = 0; i < size / sizeof(uint32); i++)
+						filter[i] = (uint32) pq_getmsgint(&input_message, 4);
+					pq_getmsgend(&input_message);
+
+					SharedQueueSetFilter(portal_name, filter, size);
+					pfree(filter);
+				}
+				break;
+
+			case 'q':			/* query id */
+				parentPGXCQueryId = (uint32) pq_getmsgint(&input_message, 4);
+				pq_getmsgend(&input_message);
+				break;
 #endif /* PGXC */
 
 			default:
@@ -166,7 +166,12 @@ ProcessQuery(PlannedStmt *plan,
 	 */
 	queryDesc = CreateQueryDesc(plan, sourceText,
 								GetActiveSnapshot(), InvalidSnapshot,
+#ifdef XCP
+								dest, params, queryEnv,
+								plan->instrument_options);
+#else
 								dest, params, queryEnv, 0);
+#endif
 
 	/*
 	 * Call ExecutorStart to prepare the plan for execution
@@ -278,6 +283,10 @@ ProcessQuery(PlannedStmt *plan,
 		}
 
 	}
+#ifdef XCP
+	/* Report instrumentation to the node which has sent down the plan */
+	SendRemoteInstrumentation(queryDesc);
+#endif
 	ExecutorEnd(queryDesc);
 	FreeQueryDesc(queryDesc);
 }
@@ -638,7 +647,8 @@ PortalStart(Portal portal, ParamListInfo params,
 
 				/*
 				 * Create QueryDesc in portal's context; for the moment, set
-				 * the destination to DestNone.
+				 * the destination to DestNone. Collect instrumentation if
+				 * the master node is going to report it.
 				 */
 				queryDesc = CreateQueryDesc((PlannedStmt *) linitial(portal->stmts),
 											portal->sourceText,
@@ -647,7 +657,7 @@ PortalStart(Portal portal, ParamListInfo params,
 											None_Receiver,
 											params,
 											NULL,
-											0);
+											((PlannedStmt *) linitial(portal->stmts))->instrument_options);
 				/*
 				 * If parent node have sent down parameters, and at least one
 				 * of them is PARAM_EXEC we should avoid "single execution"
@@ -844,7 +854,11 @@ PortalStart(Portal portal, ParamListInfo params,
 											None_Receiver,
 											params,
 											portal->queryEnv,
+#ifdef XCP
+											linitial_node(PlannedStmt, portal->stmts)->instrument_options);
+#else
 											0);
+#endif
 
 				/*
 				 * If it's a scrollable cursor, executor needs to support
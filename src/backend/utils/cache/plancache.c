@@ -2042,6 +2042,7 @@ SetRemoteSubplan(CachedPlanSource *plansource, const char *plan_string)
 	stmt = makeNode(PlannedStmt);
 
 	stmt->commandType = rstmt->commandType;
+	stmt->queryId = rstmt->queryId;
 	stmt->hasReturning = rstmt->hasReturning;
 	stmt->canSetTag = true;
 	stmt->transientPlan = false; // ???
@@ -2062,6 +2063,7 @@ SetRemoteSubplan(CachedPlanSource *plansource, const char *plan_string)
 	stmt->distributionKey = rstmt->distributionKey;
 	stmt->distributionNodes = rstmt->distributionNodes;
 	stmt->distributionRestrict = rstmt->distributionRestrict;
+	stmt->instrument_options = rstmt->instrument_options;
 
 	/*
 	 * Set up SharedQueue if intermediate results need to be distributed
@@ -2070,7 +2072,8 @@ SetRemoteSubplan(CachedPlanSource *plansource, const char *plan_string)
 	if (IsConnFromDatanode() && stmt->pname &&
 			list_length(stmt->distributionRestrict) > 1)
 		SharedQueueAcquire(stmt->pname,
-						   list_length(stmt->distributionRestrict) - 1);
+						   list_length(stmt->distributionRestrict) - 1,
+						   rstmt->runtimeFilterSize);
 
 	/*
 	 * Create and fill the CachedPlan struct within the new context.
@@ -76,6 +76,7 @@
 #include "catalog/pg_user_mapping.h"
 #ifdef PGXC
 #include "catalog/pgxc_class.h"
+#include "catalog/pgxc_class_stats.h"
 #include "catalog/pgxc_node.h"
 #include "catalog/pgxc_group.h"
 #endif
@@ -591,6 +592,17 @@ static const struct cachedesc cacheinfo[] = {
 		},
 		1024
 	},
+	{PgxcClassStatsRelationId,	/* PGXCCLASSSTATS */
+		PgxcClassStatsRelidNodeIndexId,
+		2,
+		{
+			Anum_pgxc_class_stats_pcsrelid,
+			Anum_pgxc_class_stats_pcsnode,
+			0,
+			0
+		},
+		1024
+	},
 	{PgxcGroupRelationId,	/* PGXCGROUPNAME */
 		PgxcGroupGroupNameIndexId,
 		1,
@@ -77,12 +77,15 @@
 #include "commands/sequence.h"
 #include "parser/parse_utilcmd.h"
 #include "pgxc/nodemgr.h"
+#include "pgxc/resolver.h"
 #include "pgxc/squeue.h"
+#include "pgxc/waitstats.h"
 #include "utils/snapmgr.h"
 #endif
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/clustermon.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/syslogger.h"
 #include "postmaster/walwriter.h"
@@ -445,6 +448,7 @@ static const struct config_enum_entry huge_pages_options[] = {
 static const struct config_enum_entry global_snapshot_source_options[] = {
 	{"gtm", GLOBAL_SNAPSHOT_SOURCE_GTM, true},
 	{"coordinator", GLOBAL_SNAPSHOT_SOURCE_COORDINATOR, true},
+	{"timestamp", GLOBAL_SNAPSHOT_SOURCE_TIMESTAMP, true},
 	{NULL, 0, false}
 };
 #endif
@@ -979,6 +983,39 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 #ifdef PGXC
+#ifdef XCP
+	{
+		{"enable_broadcast_join", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner to replicate one side of a distributed join."),
+			gettext_noop("Network transfer is charged to the join cost, so "
+						 "replicating the smaller side to all nodes is weighed "
+						 "against redistributing both sides.")
+		},
+		&enable_broadcast_join,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_redistributed_grouping", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner to aggregate on Datanodes after "
+						 "redistributing rows by a grouping key."),
+			NULL
+		},
+		&enable_redistributed_grouping,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_runtime_filter", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables hash joins to filter redistributed outer "
+						 "rows at their producers."),
+			NULL
+		},
+		&enable_runtime_filter,
+		false,
+		NULL, NULL, NULL
+	},
+#endif
 	{
 		{"enable_fast_query_shipping", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of fast query shipping to ship query directly to datanode."),
@@ -988,6 +1025,37 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"load_balance_replicated_reads", PGC_USERSET, COORDINATORS,
+			gettext_noop("Route reads of replicated tables to the least loaded Datanode."),
+			gettext_noop("If disabled a random Datanode is chosen when "
+						 "no preferred Datanode holds the table.")
+		},
+		&load_balance_replicated_reads,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"pool_sticky_connections", PGC_USERSET, DATA_NODES,
+			gettext_noop("Keep connections to nodes between transactions while the pool has spare ones."),
+			gettext_noop("The connections are returned at the end of the first transaction "
+						 "after the pooler runs short of connections.")
+		},
+		&PoolStickyConnections,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"pool_multiplexing", PGC_SIGHUP, DATA_NODES,
+			gettext_noop("Share connections to nodes among sessions at transaction granularity."),
+			gettext_noop("Sessions holding prepared statements return their connections "
+						 "when the pooler runs short of them, and prepare the statements "
+						 "again on the connections they get next.")
+		},
+		&PoolMultiplexing,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"loose_constraints", PGC_USERSET, COORDINATORS,
 			gettext_noop("Relax enforcing of constraints"),
@@ -1374,6 +1442,18 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+#ifdef XCP
+	{
+		{"track_remote_waits", PGC_SUSET, STATS_COLLECTOR,
+			gettext_noop("Collects timing statistics for waits on GTM, remote "
+						 "nodes, shared queues and the pooler."),
+			NULL
+		},
+		&track_remote_waits,
+		false,
+		NULL, NULL, NULL
+	},
+#endif
 
 	{
 		{"update_process_title", PGC_SUSET, PROCESS_TITLE,
@@ -3037,6 +3117,20 @@ static struct config_int ConfigureNamesInt[] =
 		1024, 100, 102400,
 		NULL, NULL, NULL
 	},
+
+#ifdef XCP
+	{
+		{"remote_wait_stats_max", PGC_POSTMASTER, STATS_COLLECTOR,
+			gettext_noop("Sets the maximum number of statements tracked by "
+						 "track_remote_waits."),
+			NULL
+		},
+		&remote_wait_stats_max,
+		1000, 100, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+#endif
+
 #ifdef PGXC
 	{
 		{"sequence_range", PGC_USERSET, COORDINATORS,
@@ -3049,6 +3143,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"shared_sequence_cache", PGC_POSTMASTER, COORDINATORS,
+			gettext_noop("Sets the number of sequences whose values are shared "
+						 "by all sessions of a Coordinator."),
+			gettext_noop("0 disables the shared cache."),
+		},
+		&SharedSequenceCacheSize,
+		0, 0, 1000000,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"pool_conn_keepalive", PGC_SIGHUP, DATA_NODES,
 			gettext_noop("Close connections if they are idle in the pool for that time."),
@@ -3071,6 +3176,40 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"pool_connect_timeout", PGC_SIGHUP, DATA_NODES,
+			gettext_noop("Maximum time the pooler waits for a connection to a node."),
+			gettext_noop("A value of 0 waits as long as the operating system does."),
+			GUC_UNIT_MS
+		},
+		&PoolConnectTimeout,
+		500, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"pool_node_probe_interval", PGC_SIGHUP, DATA_NODES,
+			gettext_noop("Time between two probes of a node the pooler could not connect to."),
+			gettext_noop("Connection requests for the node fail at once until a probe "
+						 "succeeds. A value of 0 turns this off."),
+			GUC_UNIT_MS
+		},
+		&PoolNodeProbeInterval,
+		1000, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"pool_wait_timeout", PGC_SIGHUP, DATA_NODES,
+			gettext_noop("Maximum time a session waits for a connection from a full pool."),
+			gettext_noop("A value of 0 makes the request fail at once."),
+			GUC_UNIT_MS
+		},
+		&PoolWaitTimeout,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_pool_size", PGC_SIGHUP, DATA_NODES,
 			gettext_noop("Max pool size."),
@@ -3102,6 +3241,42 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gtm_snapshot_cache_max_age", PGC_SIGHUP, GTM,
+			gettext_noop("Sets the maximum age of a GTM snapshot shared by the "
+						 "sessions of a Coordinator."),
+			gettext_noop("0 disables the shared snapshot."),
+			GUC_UNIT_MS
+		},
+		&gtm_snapshot_cache_max_age,
+		0, 0, 60000,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"twophase_resolver_naptime", PGC_SIGHUP, XC_HOUSEKEEPING_OPTIONS,
+			gettext_noop("Time to sleep between runs of the resolver of "
+						 "in-doubt two-phase transactions."),
+			gettext_noop("0 disables the resolver."),
+			GUC_UNIT_S
+		},
+		&twophase_resolver_naptime,
+		60, 0, INT_MAX / 1000,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"twophase_resolver_min_age", PGC_SIGHUP, XC_HOUSEKEEPING_OPTIONS,
+			gettext_noop("Minimum age of an implicit two-phase transaction "
+						 "before the resolver finishes it."),
+			NULL,
+			GUC_UNIT_S
+		},
+		&twophase_resolver_min_age,
+		60, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_datanodes", PGC_POSTMASTER, DATA_NODES,
 			gettext_noop("Maximum number of Datanodes in the cluster."),
@@ -3319,6 +3494,26 @@ static struct config_real ConfigureNamesReal[] =
 		&remote_query_cost,
 		DEFAULT_REMOTE_QUERY_COST, 0, DBL_MAX, NULL, NULL
 	},
+
+	{
+		{"network_message_cost", PGC_USERSET, QUERY_TUNING_COST,
+			gettext_noop("Sets the planner's estimate of the cost of "
+						 "sending a tuple to a remote node."),
+			NULL
+		},
+		&network_message_cost,
+		DEFAULT_NETWORK_MESSAGE_COST, 0, DBL_MAX, NULL, NULL
+	},
+
+	{
+		{"distribution_skew_threshold", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets how many times its share of rows a Datanode may "
+						 "hold before ANALYZE warns about the table."),
+			gettext_noop("Zero disables the warning.")
+		},
+		&distribution_skew_threshold,
+		2.0, 0, 1000, NULL, NULL
+	},
 #endif
 
 	{
@@ -3944,6 +4139,19 @@ static struct config_string ConfigureNamesString[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gtm_sequence_servers", PGC_POSTMASTER, GTM,
+			gettext_noop("Sets the GTM instances which own the sequences."),
+			gettext_noop("A comma-separated list of host[:port], each sequence "
+						 "belongs to one of them depending on the hash of its "
+						 "name. Empty keeps the sequences on the main GTM."),
+			GUC_LIST_INPUT
+		},
+		&GtmSequenceServers,
+		"",
+		check_gtm_sequence_servers, NULL, NULL
+	},
+
 	{
 		{"pgxc_node_name", PGC_POSTMASTER, GTM,
 			gettext_noop("The Coordinator or Datanode name."),
@@ -4303,6 +4511,11 @@ static struct config_enum ConfigureNamesEnum[] =
 			gettext_noop("Set preferred source of a snapshot."),
 			gettext_noop("When set to 'coordinator', a snapshot is taken at "
 					"the coordinator at the risk of reduced consistency. "
+					"When set to 'timestamp', every node takes its own "
+					"snapshot and hides commits with a later commit "
+					"timestamp than the one obtained from GTM at the "
+					"start of the transaction; this is "
+					"experimental and requires track_commit_timestamp. "
 					"Default is 'gtm'")
 		},
 		&GlobalSnapshotSource,
@@ -248,6 +248,9 @@ typedef struct SerializedSnapshotData
 	CommandId	curcid;
 	TimestampTz whenTaken;
 	XLogRecPtr	lsn;
+#ifdef XCP
+	TimestampTz snapshot_ts;
+#endif
 } SerializedSnapshotData;
 
 Size
@@ -394,6 +397,10 @@ GetTransactionSnapshot(void)
 	/* Don't allow catalog snapshot to be older than xact snapshot. */
 	InvalidateCatalogSnapshot();
 
+#ifdef XCP
+	/* A timestamp based snapshot must not miss the latest commits either */
+	NextXactSnapshotTimestamp();
+#endif
 	CurrentSnapshot = GetSnapshotData(&CurrentSnapshotData, false);
 
 	return CurrentSnapshot;
@@ -2121,6 +2128,9 @@ SerializeSnapshot(Snapshot snapshot, char *start_address)
 	serialized_snapshot.curcid = snapshot->curcid;
 	serialized_snapshot.whenTaken = snapshot->whenTaken;
 	serialized_snapshot.lsn = snapshot->lsn;
+#ifdef XCP
+	serialized_snapshot.snapshot_ts = snapshot->snapshot_ts;
+#endif
 
 	/*
 	 * Ignore the SubXID array if it has overflowed, unless the snapshot was
@@ -2195,6 +2205,9 @@ RestoreSnapshot(char *start_address)
 	snapshot->curcid = serialized_snapshot.curcid;
 	snapshot->whenTaken = serialized_snapshot.whenTaken;
 	snapshot->lsn = serialized_snapshot.lsn;
+#ifdef XCP
+	snapshot->snapshot_ts = serialized_snapshot.snapshot_ts;
+#endif
 
 	/* Copy XIDs, if present. */
 	if (serialized_snapshot.xcnt > 0)
@@ -61,6 +61,7 @@
 
 #include "postgres.h"
 
+#include "access/commit_ts.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
 #include "access/subtrans.h"
@@ -1461,6 +1462,39 @@ HeapTupleIsSurelyDead(HeapTuple htup, TransactionId OldestXmin)
 	return TransactionIdPrecedes(HeapTupleHeaderGetRawXmax(tuple), OldestXmin);
 }
 
+#ifdef XCP
+/*
+ * XidCommittedAfterSnapshot
+ *		Is the given XID, which is not running for the snapshot, to be treated
+ *		as still in progress because it committed after a timestamp based
+ *		snapshot was taken?
+ *
+ * The transactions the snapshot must not see may have committed before it was
+ * computed on this node, see GetSnapshotTimestamp. The commit timestamp of the
+ * last XID looked at is remembered, as tuples often come in runs written by
+ * the same transaction.
+ */
+static bool
+XidCommittedAfterSnapshot(TransactionId xid, Snapshot snapshot)
+{
+	static TransactionId cachedXid = InvalidTransactionId;
+	static TimestampTz cachedTs = 0;
+
+	if (snapshot->snapshot_ts == 0 || !TransactionIdIsNormal(xid))
+		return false;
+
+	if (!TransactionIdEquals(xid, cachedXid))
+	{
+		/* Aborted transactions have no commit timestamp */
+		if (!TransactionIdGetCommitTsData(xid, &cachedTs, NULL))
+			cachedTs = 0;
+		cachedXid = xid;
+	}
+
+	return cachedTs > snapshot->snapshot_ts;
+}
+#endif
+
 /*
  * XidInMVCCSnapshot
  *		Is the given XID still-in-progress according to the snapshot?
@@ -1486,7 +1520,11 @@ XidInMVCCSnapshot(TransactionId xid, Snapshot snapshot)
 
 	/* Any xid < xmin is not in-progress */
 	if (TransactionIdPrecedes(xid, snapshot->xmin))
+#ifdef XCP
+		return XidCommittedAfterSnapshot(xid, snapshot);
+#else
 		return false;
+#endif
 	/* Any xid >= xmax is in-progress */
 	if (TransactionIdFollowsOrEquals(xid, snapshot->xmax))
 		return true;
@@ -1531,7 +1569,11 @@ XidInMVCCSnapshot(TransactionId xid, Snapshot snapshot)
 			 * xmax.
 			 */
 			if (TransactionIdPrecedes(xid, snapshot->xmin))
+#ifdef XCP
+				return XidCommittedAfterSnapshot(xid, snapshot);
+#else
 				return false;
+#endif
 		}
 
 		for (i = 0; i < snapshot->xcnt; i++)
@@ -1580,7 +1622,11 @@ XidInMVCCSnapshot(TransactionId xid, Snapshot snapshot)
 		}
 	}
 
+#ifdef XCP
+	return XidCommittedAfterSnapshot(xid, snapshot);
+#else
 	return false;
+#endif
 }
 
 /*
@@ -882,6 +882,32 @@ makeEmptyGTM_Conn(void)
 	return conn;
 }
 
+/*
+ * GTMPQmakeHookConn
+ *	 - make a GTM_Conn which is not connected to any server
+ *
+ * Messages are constructed in the connection as usual, but when flushed the
+ * output buffer is handed over to flush_hook, which is expected to consume
+ * it.  gtm_sync_standby() calls sync_hook instead of talking to the server.
+ * Routines waiting for a reply from the server can not be used.
+ */
+GTM_Conn *
+GTMPQmakeHookConn(int (*flush_hook) (GTM_Conn *conn),
+				  int (*sync_hook) (GTM_Conn *conn))
+{
+	GTM_Conn	   *conn;
+
+	conn = makeEmptyGTM_Conn();
+	if (conn == NULL)
+		return NULL;
+
+	conn->sock = -1;
+	conn->flush_hook = flush_hook;
+	conn->sync_hook = sync_hook;
+
+	return conn;
+}
+
 /*
  * freeGTM_Conn
  *	 - free an idle (closed) GTM_Conn data structure
@@ -1345,6 +1371,19 @@ GTMPQsocket(const GTM_Conn *conn)
 	return conn->sock;
 }
 
+/*
+ * Number of transactions GTM had completed when it sent the last commit
+ * result or snapshot on this connection.  Comparing it with the seqno of a
+ * snapshot tells whether the snapshot sees the commits made so far.
+ */
+uint64
+GTMPQlastSeqno(const GTM_Conn *conn)
+{
+	if (!conn)
+		return 0;
+	return conn->last_seqno;
+}
+
 void
 GTMPQtrace(GTM_Conn *conn, FILE *debug_port)
 {
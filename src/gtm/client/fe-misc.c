@@ -504,7 +504,7 @@ gtmpqPutMsgEnd(GTM_Conn *conn)
 	/* Make message eligible to send */
 	conn->outCount = conn->outMsgEnd;
 
-	if (conn->outCount >= 8192)
+	if (conn->outCount >= 8192 && conn->flush_hook == NULL)
 	{
 		int			toSend = conn->outCount - (conn->outCount % 8192);
 
@@ -845,7 +845,11 @@ gtmpqFlush(GTM_Conn *conn)
 		fflush(conn->Pfdebug);
 
 	if (conn->outCount > 0)
+	{
+		if (conn->flush_hook)
+			return (*conn->flush_hook) (conn);
 		return gtmpqSendSome(conn, conn->outCount);
+	}
 
 	return 0;
 }
@@ -251,6 +251,18 @@ fail:
 
 GTM_Result *
 GTMPQgetResult(GTM_Conn *conn)
+{
+	return GTMPQgetResultTimed(conn, (time_t) -1);
+}
+
+/*
+ * GTMPQgetResultTimed
+ *	  Like GTMPQgetResult, but do not wait past finish_time.
+ *
+ * finish_time = ((time_t) -1) disables the wait limit.
+ */
+GTM_Result *
+GTMPQgetResultTimed(GTM_Conn *conn, time_t finish_time)
 {
 	GTM_Result *res;
 
@@ -268,7 +280,7 @@ GTMPQgetResult(GTM_Conn *conn)
 		 */
 		while ((flushResult = gtmpqFlush(conn)) > 0)
 		{
-			if (gtmpqWait(false, true, conn))
+			if (gtmpqWaitTimed(false, true, conn, finish_time))
 			{
 				flushResult = -1;
 				break;
@@ -277,7 +289,7 @@ GTMPQgetResult(GTM_Conn *conn)
 
 		/* Wait for some more data, and load it. */
 		if (flushResult ||
-			gtmpqWait(true, false, conn) ||
+			gtmpqWaitTimed(true, false, conn, finish_time) ||
 			gtmpqReadData(conn) < 0)
 		{
 			/*
@@ -406,6 +418,11 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 			if (gtmpqGetnchar((char *)&result->gr_resdata.grd_eof_txn.status,
 						   sizeof (int), conn))
 				result->gr_status = GTM_RESULT_ERROR;
+			if (gtmpqGetnchar((char *)&result->gr_seqno,
+						   sizeof (uint64), conn))
+				result->gr_status = GTM_RESULT_ERROR;
+			else
+				conn->last_seqno = result->gr_seqno;
 			break;
 
 		case TXN_GET_GXID_RESULT:
@@ -463,6 +480,16 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 				result->gr_status = GTM_RESULT_ERROR;
 				break;
 			}
+			if (result->gr_type == TXN_COMMIT_MULTI_RESULT)
+			{
+				if (gtmpqGetnchar((char *)&result->gr_seqno,
+								  sizeof (uint64), conn))
+				{
+					result->gr_status = GTM_RESULT_ERROR;
+					break;
+				}
+				conn->last_seqno = result->gr_seqno;
+			}
 			break;
 
 		case SNAPSHOT_GXID_GET_RESULT:
@@ -539,6 +566,15 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 				break;
 			}
 
+			if (gtmpqGetnchar((char *)&result->gr_snapshot.sn_seqno,
+						   sizeof (uint64), conn))
+			{
+				result->gr_status = GTM_RESULT_ERROR;
+				break;
+			}
+			if (result->gr_snapshot.sn_seqno > conn->last_seqno)
+				conn->last_seqno = result->gr_snapshot.sn_seqno;
+
 			break;
 
 		case SEQUENCE_INIT_RESULT:
@@ -659,6 +695,16 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 			else
 				result->gr_resdata.grd_txn_get_gid_data.nodestring = NULL;
 
+			{
+				char		attached;
+
+				if (gtmpqGetc(&attached, conn))
+				{
+					result->gr_status = GTM_RESULT_ERROR;
+					break;
+				}
+				result->gr_resdata.grd_txn_get_gid_data.attached = (attached != 0);
+			}
 			break;
 
 		case TXN_GXID_LIST_RESULT:
@@ -796,7 +842,56 @@ gtmpqParseSuccess(GTM_Conn *conn, GTM_Result *result)
 		case BARRIER_RESULT:
 			break;
 
+		case GET_TIMESTAMP_RESULT:
+			if (gtmpqGetnchar((char *)&result->gr_resdata.grd_timestamp,
+							  sizeof (GTM_Timestamp), conn))
+				result->gr_status = GTM_RESULT_ERROR;
+			break;
+
+		case TXN_GET_GID_DATA_MULTI_RESULT:
+		{
+			int			txn_count;
+			GTM_GIDData *data;
+			int			i;
+
+			result->gr_resdata.grd_txn_get_gid_data_multi.txn_count = 0;
+			result->gr_resdata.grd_txn_get_gid_data_multi.data = NULL;
+			if (gtmpqGetInt(&txn_count, sizeof (int), conn) ||
+				txn_count <= 0 || txn_count > GTM_MAX_GLOBAL_TRANSACTIONS)
+			{
+				result->gr_status = GTM_RESULT_ERROR;
+				break;
+			}
+			data = (GTM_GIDData *) malloc(sizeof (GTM_GIDData) * txn_count);
+			if (data == NULL)
+			{
+				result->gr_status = GTM_RESULT_ERROR;
+				break;
+			}
+			result->gr_resdata.grd_txn_get_gid_data_multi.data = data;
+
+			for (i = 0; i < txn_count; i++)
+			{
+				char		attached;
+
+				if (gtmpqGetInt(&data[i].status, sizeof (int), conn) ||
+					gtmpqGetnchar((char *)&data[i].gxid,
+								  sizeof (GlobalTransactionId), conn) ||
+					gtmpqGetnchar((char *)&data[i].prepared_gxid,
+								  sizeof (GlobalTransactionId), conn) ||
+					gtmpqGetc(&attached, conn))
+				{
+					result->gr_status = GTM_RESULT_ERROR;
+					break;
+				}
+				data[i].attached = (attached != 0);
+			}
+			result->gr_resdata.grd_txn_get_gid_data_multi.txn_count = txn_count;
+			break;
+		}
+
 		case REPORT_XMIN_RESULT:
+		case XMIN_NOTIFY_RESULT:
 			if (gtmpqGetnchar((char *)&result->gr_resdata.grd_report_xmin.latest_completed_xid,
 							  sizeof (GlobalTransactionId), conn))
 			{
@@ -893,6 +988,12 @@ gtmpqFreeResultData(GTM_Result *result, GTM_PGXCNodeType remote_type)
 		case BARRIER_RESULT:
 			break;
 
+		case TXN_GET_GID_DATA_MULTI_RESULT:
+			if (result->gr_resdata.grd_txn_get_gid_data_multi.data != NULL)
+				free(result->gr_resdata.grd_txn_get_gid_data_multi.data);
+			result->gr_resdata.grd_txn_get_gid_data_multi.data = NULL;
+			break;
+
 		case SNAPSHOT_GET_RESULT:
 		case SNAPSHOT_GXID_GET_RESULT:
 			/*
@@ -77,6 +77,8 @@ static int alter_sequence_internal(GTM_Conn *conn, GTM_SequenceKey key, GTM_Sequ
 		GTM_Sequence minval, GTM_Sequence maxval,
 		GTM_Sequence startval, GTM_Sequence lastval, bool cycle,
 		bool is_restart, bool is_backup);
+static int register_session_internal(GTM_Conn *conn, const char *coord_name,
+		int coord_procid, int coord_backendid, bool is_backup);
 static int node_register_worker(GTM_Conn *conn, GTM_PGXCNodeType type, const char *host, GTM_PGXCNodePort port,
 								char *node_name, char *datafolder,
 								GTM_PGXCNodeStatus status, bool is_backup);
@@ -1021,7 +1023,8 @@ get_gid_data(GTM_Conn *conn,
 			 char *gid,
 			 GlobalTransactionId *gxid,
 			 GlobalTransactionId *prepared_gxid,
-			 char **nodestring)
+			 char **nodestring,
+			 bool *attached)
 {
 	bool txn_read_only = false;
 	GTM_Result *res = NULL;
@@ -1058,6 +1061,73 @@ get_gid_data(GTM_Conn *conn,
 		*gxid = res->gr_resdata.grd_txn_get_gid_data.gxid;
 		*prepared_gxid = res->gr_resdata.grd_txn_get_gid_data.prepared_gxid;
 		*nodestring = res->gr_resdata.grd_txn_get_gid_data.nodestring;
+		if (attached)
+			*attached = res->gr_resdata.grd_txn_get_gid_data.attached;
+	}
+
+	return res->gr_status;
+
+receive_failed:
+send_failed:
+	conn->result = makeEmptyResultIfIsNull(conn->result);
+	conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+	return -1;
+}
+
+/*
+ * get_gid_data for several GIDs in one round trip. data receives gid_count
+ * entries, a GID GTM does not know of gets a status other than STATUS_OK.
+ */
+int
+get_gid_data_multi(GTM_Conn *conn,
+				   GTM_IsolationLevel isolevel,
+				   int gid_count,
+				   char **gids,
+				   GTM_GIDData *data)
+{
+	bool txn_read_only = false;
+	GTM_Result *res = NULL;
+	time_t finish_time;
+	int i;
+
+	/* Start the message */
+	if (gtmpqPutMsgStart('C', true, conn) ||
+		gtmpqPutInt(MSG_TXN_GET_GID_DATA_MULTI, sizeof (GTM_MessageType), conn) ||
+		gtmpqPutInt(isolevel, sizeof (GTM_IsolationLevel), conn) ||
+		gtmpqPutc(txn_read_only, conn) ||
+		gtmpqPutInt(gid_count, sizeof (int), conn))
+		goto send_failed;
+
+	for (i = 0; i < gid_count; i++)
+	{
+		if (gtmpqPutInt(strlen(gids[i]), sizeof (GTM_StrLen), conn) ||
+			gtmpqPutnchar(gids[i], strlen(gids[i]), conn))
+			goto send_failed;
+	}
+
+	/* Finish the message */
+	if (gtmpqPutMsgEnd(conn))
+		goto send_failed;
+
+	/* Flush to ensure backend gets it. */
+	if (gtmpqFlush(conn))
+		goto send_failed;
+
+	finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
+	if (gtmpqWaitTimed(true, false, conn, finish_time) ||
+		gtmpqReadData(conn) < 0)
+		goto receive_failed;
+
+	if ((res = GTMPQgetResult(conn)) == NULL)
+		goto receive_failed;
+
+	if (res->gr_status == GTM_RESULT_OK)
+	{
+		Assert(res->gr_type == TXN_GET_GID_DATA_MULTI_RESULT);
+		if (res->gr_resdata.grd_txn_get_gid_data_multi.txn_count != gid_count)
+			return GTM_RESULT_ERROR;
+		memcpy(data, res->gr_resdata.grd_txn_get_gid_data_multi.data,
+			   sizeof (GTM_GIDData) * gid_count);
 	}
 
 	return res->gr_status;
@@ -2384,6 +2454,9 @@ gtm_sync_standby(GTM_Conn *conn)
 	GTM_Result *res = NULL;
 	time_t finish_time;
 
+	if (conn->sync_hook)
+		return (*conn->sync_hook) (conn);
+
 	if (gtmpqPutMsgStart('C', true, conn))
 		goto send_failed;
 
@@ -2427,6 +2500,26 @@ send_failed:
 int
 register_session(GTM_Conn *conn, const char *coord_name, int coord_procid,
 				 int coord_backendid)
+{
+	return register_session_internal(conn, coord_name, coord_procid,
+									 coord_backendid, false);
+}
+
+/*
+ * Forward the session registration to the GTM standby without waiting for the
+ * reply. The standby still replies, whoever reads the connection must skip it.
+ */
+int
+bkup_register_session(GTM_Conn *conn, const char *coord_name, int coord_procid,
+					  int coord_backendid)
+{
+	return register_session_internal(conn, coord_name, coord_procid,
+									 coord_backendid, true);
+}
+
+static int
+register_session_internal(GTM_Conn *conn, const char *coord_name,
+						  int coord_procid, int coord_backendid, bool is_backup)
 {
 	GTM_Result *res = NULL;
 	time_t 		finish_time;
@@ -2454,6 +2547,9 @@ register_session(GTM_Conn *conn, const char *coord_name, int coord_procid,
 		goto send_failed;
 	}
 
+	if (is_backup)
+		return GTM_RESULT_OK;
+
 	finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
 	if (gtmpqWaitTimed(true, false, conn, finish_time) ||
 		gtmpqReadData(conn) < 0)
@@ -2535,3 +2631,141 @@ send_failed:
 
 }
 
+/*
+ * Ask GTM to send the GlobalXmin over this connection whenever it advances.
+ * The connection can't be used for anything else afterwards; the values are
+ * read with receive_global_xmin() when the socket becomes readable.
+ *
+ * GTM acknowledges the subscription with the current value. A GTM proxy
+ * refuses it, in which case the caller must keep polling.
+ */
+int
+subscribe_global_xmin(GTM_Conn *conn, const char *node_name,
+		GTM_PGXCNodeType type)
+{
+	GTM_Result *res = NULL;
+	time_t 		finish_time;
+
+	if (gtmpqPutMsgStart('C', true, conn) ||
+		gtmpqPutInt(MSG_SUBSCRIBE_XMIN, sizeof (GTM_MessageType), conn) ||
+		gtmpqPutInt(type, sizeof (GTM_PGXCNodeType), conn) ||
+		gtmpqPutInt(strlen(node_name), sizeof (GTM_StrLen), conn) ||
+		gtmpqPutnchar(node_name, strlen(node_name), conn))
+	{
+		goto send_failed;
+	}
+
+	/* Finish the message. */
+	if (gtmpqPutMsgEnd(conn))
+	{
+		goto send_failed;
+	}
+
+	/* Flush to ensure backend gets it. */
+	if (gtmpqFlush(conn))
+	{
+		goto send_failed;
+	}
+
+	finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
+	if (gtmpqWaitTimed(true, false, conn, finish_time) ||
+		gtmpqReadData(conn) < 0)
+		goto receive_failed;
+
+	if ((res = GTMPQgetResult(conn)) == NULL)
+		goto receive_failed;
+
+	if (res->gr_status != GTM_RESULT_OK)
+		return res->gr_status;
+	if (res->gr_type != XMIN_NOTIFY_RESULT)
+		return -1;
+
+	return 0;
+
+receive_failed:
+send_failed:
+	conn->result = makeEmptyResultIfIsNull(conn->result);
+	conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+	return -1;
+}
+
+/*
+ * Read the notifications which arrived on a connection subscribed with
+ * subscribe_global_xmin(), returning the most recent one. Only call it when
+ * the socket is readable.
+ */
+int
+receive_global_xmin(GTM_Conn *conn,
+		GlobalTransactionId *global_xmin,
+		GlobalTransactionId *latest_completed_xid,
+		int *errcode)
+{
+	GTM_Result *res = NULL;
+
+	if (gtmpqReadData(conn) < 0)
+		goto receive_failed;
+
+	do
+	{
+		if ((res = GTMPQgetResult(conn)) == NULL)
+			goto receive_failed;
+
+		if (res->gr_status != GTM_RESULT_OK ||
+			res->gr_type != XMIN_NOTIFY_RESULT)
+			return -1;
+
+		*latest_completed_xid = res->gr_resdata.grd_report_xmin.latest_completed_xid;
+		*global_xmin = res->gr_resdata.grd_report_xmin.global_xmin;
+		*errcode = res->gr_resdata.grd_report_xmin.errcode;
+	} while (conn->inStart < conn->inEnd);
+
+	return 0;
+
+receive_failed:
+	conn->result = makeEmptyResultIfIsNull(conn->result);
+	conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+	return -1;
+}
+
+/*
+ * Get a timestamp from GTM, larger than any it handed out before.
+ */
+int
+get_timestamp(GTM_Conn *conn, GTM_Timestamp *timestamp)
+{
+	GTM_Result *res = NULL;
+	time_t 		finish_time;
+
+	if (gtmpqPutMsgStart('C', true, conn) ||
+		gtmpqPutInt(MSG_GET_TIMESTAMP, sizeof (GTM_MessageType), conn))
+		goto send_failed;
+
+	/* Finish the message. */
+	if (gtmpqPutMsgEnd(conn))
+		goto send_failed;
+
+	/* Flush to ensure backend gets it. */
+	if (gtmpqFlush(conn))
+		goto send_failed;
+
+	finish_time = time(NULL) + CLIENT_GTM_TIMEOUT;
+	if (gtmpqWaitTimed(true, false, conn, finish_time) ||
+		gtmpqReadData(conn) < 0)
+		goto receive_failed;
+
+	if ((res = GTMPQgetResult(conn)) == NULL)
+		goto receive_failed;
+
+	if (res->gr_status == GTM_RESULT_OK)
+	{
+		Assert(res->gr_type == GET_TIMESTAMP_RESULT);
+		*timestamp = res->gr_resdata.grd_timestamp;
+	}
+	return res->gr_status;
+
+receive_failed:
+send_failed:
+	conn->result = makeEmptyResultIfIsNull(conn->result);
+	conn->result->gr_status = GTM_RESULT_COMM_ERROR;
+	return -1;
+}
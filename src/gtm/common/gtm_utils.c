@@ -95,6 +95,9 @@ static struct enum_name message_name_tab[] =
 	{MSG_BKUP_TXN_BEGIN_GETGXID_AUTOVACUUM, "MSG_BKUP_TXN_BEGIN_GETGXID_AUTOVACUUM"},
 	{MSG_DATA_FLUSH, "MSG_DATA_FLUSH"},
 	{MSG_BACKEND_DISCONNECT, "MSG_BACKEND_DISCONNECT"},
+	{MSG_SUBSCRIBE_XMIN, "MSG_SUBSCRIBE_XMIN"},
+	{MSG_GET_TIMESTAMP, "MSG_GET_TIMESTAMP"},
+	{MSG_TXN_GET_GID_DATA_MULTI, "MSG_TXN_GET_GID_DATA_MULTI"},
 	{MSG_TYPE_COUNT, "MSG_TYPE_COUNT"},
 	{-1, NULL}
 };
@@ -140,6 +143,9 @@ static struct enum_name result_name_tab[] =
 	{TXN_GET_ALL_PREPARED_RESULT, "TXN_GET_ALL_PREPARED_RESULT"},
 	{TXN_BEGIN_GETGXID_AUTOVACUUM_RESULT, "TXN_BEGIN_GETGXID_AUTOVACUUM_RESULT"},
 	{REPORT_XMIN_RESULT, "REPORT_XMIN_RESULT"},
+	{XMIN_NOTIFY_RESULT, "XMIN_NOTIFY_RESULT"},
+	{GET_TIMESTAMP_RESULT, "GET_TIMESTAMP_RESULT"},
+	{TXN_GET_GID_DATA_MULTI_RESULT, "TXN_GET_GID_DATA_MULTI_RESULT"},
 	{RESULT_TYPE_COUNT, "RESULT_TYPE_COUNT"},
 	{-1, NULL}
 };
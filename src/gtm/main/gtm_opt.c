@@ -53,6 +53,7 @@ extern int tcp_keepalives_idle;
 extern int tcp_keepalives_count;
 extern int tcp_keepalives_interval;
 extern char *GTMDataDir;
+extern int GTMMaxSequenceRange;
 
 
 
@@ -191,6 +192,17 @@ struct config_int ConfigureNamesInt[] =
 		0, 0, INT_MAX,
 		0, NULL
 	},
+	{
+		{GTM_OPTNAME_MAX_SEQUENCE_RANGE, GTMC_STARTUP,
+			gettext_noop("Maximum number of sequence values granted to a Coordinator at once."),
+			gettext_noop("The range grows with the rate the Coordinator consumes the sequence at. "
+						 "1 disables adaptive ranges."),
+			0
+		},
+		&GTMMaxSequenceRange,
+		1, 1, INT_MAX,
+		0, NULL
+	},
 	/* End-of-list marker */
 	{
 		{NULL, 0, NULL, NULL, 0}, NULL, 0, 0, 0, 0, NULL
@@ -28,23 +28,45 @@
 #include "gtm/libpq-int.h"
 #include "gtm/pqformat.h"
 #include "gtm/gtm_backup.h"
+#include "gtm/gtm_wal.h"
+#include "gtm/gtm_time.h"
+#include "port/atomics.h"
 
 extern bool Backup_synchronously;
 
+/*
+ * Upper bound of the range of values handed to a Coordinator at once.  The
+ * default of 1 disables adaptive range granting.
+ */
+int GTMMaxSequenceRange = 1;
+
 typedef struct GTM_SeqInfoHashBucket
 {
 	gtm_List   *shb_list;
 	GTM_RWLock	shb_lock;
 } GTM_SeqInfoHashBucket;
 
+/*
+ * Each bucket has a lock of its own and is padded to a multiple of the cache
+ * line size, so that threads working on sequences in different buckets do
+ * not contend for the same cache lines.
+ */
+typedef union GTM_SeqInfoHashBucketPadded
+{
+	GTM_SeqInfoHashBucket	bucket;
+	char		pad[CACHELINEALIGN(sizeof(GTM_SeqInfoHashBucket))];
+} GTM_SeqInfoHashBucketPadded;
+
 typedef struct GTM_SeqAlteredInfo
 {
 	GTM_SequenceKey	curr_key;
 	GTM_SequenceKey	prev_key;
 } GTM_SeqAlteredInfo;
  
-#define SEQ_HASH_TABLE_SIZE		1024
-static GTM_SeqInfoHashBucket GTMSequences[SEQ_HASH_TABLE_SIZE];
+#define SEQ_HASH_TABLE_SIZE		4096	/* must be a power of 2 */
+static GTM_SeqInfoHashBucketPadded GTMSequences[SEQ_HASH_TABLE_SIZE];
+
+#define SEQ_BUCKET(hash)		(&GTMSequences[(hash)].bucket)
 
 static uint32 seq_gethash(GTM_SequenceKey key);
 static bool seq_keys_equal(GTM_SequenceKey key1, GTM_SequenceKey key2);
@@ -61,21 +83,31 @@ static int seq_drop_with_dbkey(GTM_SequenceKey nsp);
 static bool GTM_NeedSeqRestoreUpdateInternal(GTM_SeqInfo *seqinfo);
 
 static GTM_Sequence get_rangemax(GTM_SeqInfo *seqinfo, GTM_Sequence range);
+static GTM_Sequence seq_adaptive_range(GTM_SeqInfo *seqinfo, char *coord_name,
+				   GTM_Sequence range);
+static bool seq_get_next_fast(GTM_SequenceKey seqkey, char *coord_name,
+				  int coord_procid, GTM_Sequence *result);
+static void seq_set_lastval_internal(GTM_SeqInfo *seqinfo, char *coord_name,
+						 int coord_procid, GTM_Sequence newval);
 
 /*
  * Get the hash value given the sequence key
  *
- * XXX This should probably be replaced by a better hash function.
+ * Sequence names tend to differ in a few characters only, so use FNV-1a
+ * rather than a sum of the characters to spread them over the buckets.
  */
 static uint32
 seq_gethash(GTM_SequenceKey key)
 {
-	uint32 total = 0;
+	uint32 hash = 2166136261U;
 	int ii;
 
 	for (ii = 0; ii < key->gsk_keylen; ii++)
-		total += key->gsk_key[ii];
-	return (total % SEQ_HASH_TABLE_SIZE);
+	{
+		hash ^= (unsigned char) key->gsk_key[ii];
+		hash *= 16777619U;
+	}
+	return (hash & (SEQ_HASH_TABLE_SIZE - 1));
 }
 
 /*
@@ -106,7 +138,7 @@ seq_find_seqinfo(GTM_SequenceKey seqkey)
 	gtm_ListCell *elem;
 	GTM_SeqInfo *curr_seqinfo = NULL;
 
-	bucket = &GTMSequences[hash];
+	bucket = SEQ_BUCKET(hash);
 
 	GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_READ);
 
@@ -172,7 +204,7 @@ seq_add_seqinfo(GTM_SeqInfo *seqinfo)
 	GTM_SeqInfoHashBucket	*bucket;
 	gtm_ListCell *elem;
 
-	bucket = &GTMSequences[hash];
+	bucket = SEQ_BUCKET(hash);
 
 	GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_WRITE);
 
@@ -211,7 +243,7 @@ seq_remove_seqinfo(GTM_SeqInfo *seqinfo)
 	uint32 hash = seq_gethash(seqinfo->gs_key);
 	GTM_SeqInfoHashBucket	*bucket;
 
-	bucket = &GTMSequences[hash];
+	bucket = SEQ_BUCKET(hash);
 
 	GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_WRITE);
 	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
@@ -247,8 +279,8 @@ seq_rename_seqinfo(GTM_SeqInfo *seqinfo, GTM_SequenceKey newkey)
 	gtm_ListCell *elem;
 	MemoryContext oldContext;
 
-	oldbucket = &GTMSequences[oldhash];
-	newbucket = &GTMSequences[newhash];
+	oldbucket = SEQ_BUCKET(oldhash);
+	newbucket = SEQ_BUCKET(newhash);
 
 	/*
 	 * We must lock both old and new hash buckets. To avoid deadlock, we must
@@ -376,6 +408,7 @@ GTM_SeqOpen(GTM_SequenceKey seqkey,
 		ereport(ERROR, (ENOMEM, errmsg("Out of memory")));
 
 	GTM_RWLockInit(&seqinfo->gs_lock);
+	GTM_MutexLockInit(&seqinfo->gs_lastval_lock);
 
 	seqinfo->gs_ref_count = 0;
 	seqinfo->gs_key = seq_copy_key(seqkey);
@@ -452,12 +485,16 @@ GTM_SeqOpen(GTM_SequenceKey seqkey,
 	seqinfo->gs_max_lastvals = 0;
 	seqinfo->gs_lastval_count = 0;
 	seqinfo->gs_last_values = NULL;
+	seqinfo->gs_max_coordranges = 0;
+	seqinfo->gs_coordrange_count = 0;
+	seqinfo->gs_coord_ranges = NULL;
 
 	seqinfo->gs_backedUpValue = seqinfo->gs_value;
 
 	if ((errcode = seq_add_seqinfo(seqinfo)))
 	{
 		GTM_RWLockDestroy(&seqinfo->gs_lock);
+		GTM_MutexLockDestroy(&seqinfo->gs_lastval_lock);
 		pfree(seqinfo->gs_key);
 		pfree(seqinfo);
 	}
@@ -468,8 +505,6 @@ GTM_SeqOpen(GTM_SequenceKey seqkey,
 					TopMostMemoryContext));
 	}
 
-	GTM_SetNeedBackup();
-
 	return errcode;
 }
 
@@ -553,6 +588,7 @@ GTM_SeqRestore(GTM_SequenceKey seqkey,
 		ereport(ERROR, (ENOMEM, errmsg("Out of memory")));
 
 	GTM_RWLockInit(&seqinfo->gs_lock);
+	GTM_MutexLockInit(&seqinfo->gs_lastval_lock);
 
 	seqinfo->gs_ref_count = 0;
 	seqinfo->gs_key = seq_copy_key(seqkey);
@@ -567,6 +603,9 @@ GTM_SeqRestore(GTM_SequenceKey seqkey,
 	seqinfo->gs_max_lastvals = 0;
 	seqinfo->gs_lastval_count = 0;
 	seqinfo->gs_last_values = NULL;
+	seqinfo->gs_max_coordranges = 0;
+	seqinfo->gs_coordrange_count = 0;
+	seqinfo->gs_coord_ranges = NULL;
 	seqinfo->gs_value = curval;
 	seqinfo->gs_backedUpValue = seqinfo->gs_value;
 
@@ -578,12 +617,60 @@ GTM_SeqRestore(GTM_SequenceKey seqkey,
 	if ((errcode = seq_add_seqinfo(seqinfo)))
 	{
 	 	GTM_RWLockDestroy(&seqinfo->gs_lock);
+		GTM_MutexLockDestroy(&seqinfo->gs_lastval_lock);
 		pfree(seqinfo->gs_key);
 		pfree(seqinfo);
 	}
 	return errcode;
 }
 
+/*
+ * Apply the sequence value found in the WAL.
+ *
+ * Called during the WAL replay at startup.  The sequence may have been
+ * dropped or renamed since the record was written, the control file written
+ * by the same operation then takes care of it and the record is ignored.
+ */
+void
+GTM_SeqRedoValue(GTM_SequenceKey seqkey, GTM_Sequence value, bool called)
+{
+	GTM_SeqInfo *seqinfo = seq_find_seqinfo(seqkey);
+
+	if (seqinfo == NULL)
+		return;
+
+	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
+	seqinfo->gs_value = seqinfo->gs_backedUpValue = value;
+	seqinfo->gs_called = called;
+	GTM_RWLockRelease(&seqinfo->gs_lock);
+	seq_release_seqinfo(seqinfo);
+}
+
+/*
+ * Redo a value handed out by the nextval fast path.  These are logged without
+ * the sequence locked exclusively, so may come out of order and only ever
+ * move the sequence forward.
+ */
+void
+GTM_SeqRedoAdvance(GTM_SequenceKey seqkey, GTM_Sequence value)
+{
+	GTM_SeqInfo *seqinfo = seq_find_seqinfo(seqkey);
+
+	if (seqinfo == NULL)
+		return;
+
+	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
+	if (!SEQ_IS_CALLED(seqinfo) ||
+		(SEQ_IS_ASCENDING(seqinfo) ?
+		 value > seqinfo->gs_value : value < seqinfo->gs_value))
+	{
+		seqinfo->gs_value = seqinfo->gs_backedUpValue = value;
+		seqinfo->gs_called = true;
+	}
+	GTM_RWLockRelease(&seqinfo->gs_lock);
+	seq_release_seqinfo(seqinfo);
+}
+
 /*
  * Destroy the given sequence depending on type of given key
  */
@@ -693,7 +780,7 @@ seq_drop_with_dbkey(GTM_SequenceKey nsp)
 
 	for(ii = 0; ii < SEQ_HASH_TABLE_SIZE; ii++)
 	{
-		bucket = &GTMSequences[ii];
+		bucket = SEQ_BUCKET(ii);
 
 		GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_READ);
 
@@ -810,6 +897,8 @@ GTM_SeqGetCurrent(GTM_SequenceKey seqkey, char *coord_name,
 	}
 
 	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_READ);
+	/* The nextval fast path may be updating the values */
+	GTM_MutexLockAcquire(&seqinfo->gs_lastval_lock);
 
 	for (i = 0; i < seqinfo->gs_lastval_count; i++)
 	{
@@ -822,6 +911,7 @@ GTM_SeqGetCurrent(GTM_SequenceKey seqkey, char *coord_name,
 		}
 	}
 
+	GTM_MutexLockRelease(&seqinfo->gs_lastval_lock);
 	GTM_RWLockRelease(&seqinfo->gs_lock);
 	seq_release_seqinfo(seqinfo);
 	if (!found)
@@ -835,14 +925,14 @@ GTM_SeqGetCurrent(GTM_SequenceKey seqkey, char *coord_name,
 
 /*
  * Store the sequence value as last for the specified distributed session
+ *
+ * The caller holds the sequence lock, in read mode on the nextval fast path,
+ * so the values are protected by a mutex of their own.
  */
 static void
 seq_set_lastval(GTM_SeqInfo *seqinfo, char *coord_name,
 				int coord_procid, GTM_Sequence newval)
 {
-	GTM_SeqLastVal *lastval;
-	int			i;
-
 	/* Can not assign value to not defined value */
 	if (coord_name == NULL || coord_procid == 0)
 		return;
@@ -850,6 +940,18 @@ seq_set_lastval(GTM_SeqInfo *seqinfo, char *coord_name,
 	elog(DEBUG1, "Remember last value of Sequence %s in session %s:%d",
 			seqinfo->gs_key->gsk_key, coord_name, coord_procid);
 
+	GTM_MutexLockAcquire(&seqinfo->gs_lastval_lock);
+	seq_set_lastval_internal(seqinfo, coord_name, coord_procid, newval);
+	GTM_MutexLockRelease(&seqinfo->gs_lastval_lock);
+}
+
+static void
+seq_set_lastval_internal(GTM_SeqInfo *seqinfo, char *coord_name,
+						 int coord_procid, GTM_Sequence newval)
+{
+	GTM_SeqLastVal *lastval;
+	int			i;
+
 	/*
 	 * If last value is already defined for the session update it
 	 */
@@ -925,6 +1027,8 @@ GTM_SeqSetVal(GTM_SequenceKey seqkey, char *coord_name,
 	if (!iscalled)
 		seq_set_lastval(seqinfo, coord_name, coord_procid, nextval);
 
+	GTM_WalLogSeqValue(seqinfo->gs_key, seqinfo->gs_value, seqinfo->gs_called);
+
 	/* Remove the old key with the old name */
 	GTM_RWLockRelease(&seqinfo->gs_lock);
 	seq_release_seqinfo(seqinfo);
@@ -934,14 +1038,33 @@ GTM_SeqSetVal(GTM_SequenceKey seqkey, char *coord_name,
 
 /*
  * Get next value for the sequence
+ *
+ * On entry *range is the number of values the caller asked for.  Unless
+ * applying a backup, the request may be widened according to the rate the
+ * Coordinator has been consuming the sequence at, and *range is set to the
+ * number of values actually granted.
  */
 static int
 GTM_SeqGetNext(GTM_SequenceKey seqkey, char *coord_name,
-			   int coord_procid, GTM_Sequence range,
+			   int coord_procid, bool is_backup, GTM_Sequence *range,
 			   GTM_Sequence *result, GTM_Sequence *rangemax)
 {
-	GTM_SeqInfo *seqinfo = seq_find_seqinfo(seqkey);
+	GTM_SeqInfo *seqinfo;
+
+	/*
+	 * A single value needs no range computation, try to get it without
+	 * locking the sequence exclusively.  Adaptive ranges need the sequence
+	 * locked to account for the request.
+	 */
+	if (*range <= 1 &&
+		(is_backup || GTMMaxSequenceRange <= 1 || coord_name == NULL) &&
+		seq_get_next_fast(seqkey, coord_name, coord_procid, result))
+	{
+		*rangemax = *result;
+		return 0;
+	}
 
+	seqinfo = seq_find_seqinfo(seqkey);
 	if (seqinfo == NULL)
 	{
 		ereport(LOG,
@@ -1017,9 +1140,12 @@ GTM_SeqGetNext(GTM_SequenceKey seqkey, char *coord_name,
 			}
 		}
 	}
+	if (!is_backup)
+		*range = seq_adaptive_range(seqinfo, coord_name, *range);
+
 	/* if range is specified calculate valid max value for this range */
-	if (range > 1)
-		*rangemax = get_rangemax(seqinfo, range);
+	if (*range > 1)
+		*rangemax = get_rangemax(seqinfo, *range);
 	else
 		*rangemax = *result;
 	/*
@@ -1033,11 +1159,102 @@ GTM_SeqGetNext(GTM_SequenceKey seqkey, char *coord_name,
 	 */
 	seq_set_lastval(seqinfo, coord_name, coord_procid, *rangemax);
 	seqinfo->gs_value = *rangemax;
+	GTM_WalLogSeqValue(seqinfo->gs_key, seqinfo->gs_value, seqinfo->gs_called);
 	GTM_RWLockRelease(&seqinfo->gs_lock);
 	seq_release_seqinfo(seqinfo);
 	return 0;
 }
 
+/*
+ * Fast path of GTM_SeqGetNext for a single value of a sequence which does
+ * not cycle.
+ *
+ * The sequence is only locked in read mode and its value is advanced with a
+ * compare-and-swap, so concurrent nextval calls on the same sequence do not
+ * serialize on the sequence lock.  Everything else that changes the value
+ * locks the sequence in write mode and so excludes the fast path.  Holding
+ * the bucket lock keeps the sequence from being removed, no reference needs
+ * to be taken.
+ *
+ * Returns false if the value has to be obtained through the slow path: the
+ * sequence is not found, cycles, has not been called yet or is about to
+ * reach its bound.
+ */
+static bool
+seq_get_next_fast(GTM_SequenceKey seqkey, char *coord_name,
+				  int coord_procid, GTM_Sequence *result)
+{
+#ifndef PG_HAVE_ATOMIC_U64_SIMULATION
+	GTM_SeqInfoHashBucket *bucket = SEQ_BUCKET(seq_gethash(seqkey));
+	GTM_SeqInfo *seqinfo = NULL;
+	gtm_ListCell *elem;
+	pg_atomic_uint64 *value;
+	uint64		oldval;
+	GTM_Sequence newval;
+	bool		done = false;
+
+	StaticAssertStmt(sizeof(pg_atomic_uint64) == sizeof(GTM_Sequence),
+					 "sequence value can not be accessed atomically");
+
+	GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_READ);
+
+	gtm_foreach(elem, bucket->shb_list)
+	{
+		seqinfo = (GTM_SeqInfo *) gtm_lfirst(elem);
+		if (seq_keys_equal(seqinfo->gs_key, seqkey))
+			break;
+		seqinfo = NULL;
+	}
+
+	if (seqinfo == NULL)
+	{
+		GTM_RWLockRelease(&bucket->shb_lock);
+		return false;
+	}
+
+	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_READ);
+
+	if (seqinfo->gs_state != SEQ_STATE_ACTIVE ||
+		SEQ_IS_CYCLE(seqinfo) || !SEQ_IS_CALLED(seqinfo))
+		goto out;
+
+	value = (pg_atomic_uint64 *) &seqinfo->gs_value;
+	oldval = pg_atomic_read_u64(value);
+	for (;;)
+	{
+		GTM_Sequence curval = (GTM_Sequence) oldval;
+
+		/* Leave reporting of the wrap-around to the slow path */
+		if (SEQ_IS_ASCENDING(seqinfo) ?
+			seqinfo->gs_max_value - seqinfo->gs_increment_by < curval :
+			seqinfo->gs_min_value - seqinfo->gs_increment_by > curval)
+			goto out;
+
+		newval = curval + seqinfo->gs_increment_by;
+		if (pg_atomic_compare_exchange_u64(value, &oldval, (uint64) newval))
+			break;
+	}
+
+	seq_set_lastval(seqinfo, coord_name, coord_procid, newval);
+
+	/*
+	 * Values handed out concurrently may reach the WAL out of order, log
+	 * the value so that the redo only moves the sequence forward.
+	 */
+	GTM_WalLogSeqAdvance(seqinfo->gs_key, newval);
+
+	*result = newval;
+	done = true;
+
+out:
+	GTM_RWLockRelease(&seqinfo->gs_lock);
+	GTM_RWLockRelease(&bucket->shb_lock);
+	return done;
+#else
+	return false;
+#endif
+}
+
 /*
  * Given a sequence and the requested range for its values, calculate
  * the legitimate maximum permissible value for this range. In
@@ -1048,44 +1265,120 @@ static GTM_Sequence
 get_rangemax(GTM_SeqInfo *seqinfo, GTM_Sequence range)
 {
 	GTM_Sequence rangemax = seqinfo->gs_value;
+	uint64		distance;
+	uint64		step;
+	uint64		steps;
 
 	/*
 	 * Deduct 1 from range because the currval has been accounted
 	 * for already before this call has been made
 	 */
 	range--;
+
+	/*
+	 * Work out how many increments fit between the current value and the
+	 * bound the sequence is moving towards, and cap the range there.  The
+	 * distance is computed unsigned, it may not fit into a signed integer.
+	 */
 	if (SEQ_IS_ASCENDING(seqinfo))
 	{
-		/*
-		 * Check if the sequence will overflow because of the range
-		 * request. If yes, cap it at close to or equal to max value
-		 */
-		while (range != 0 &&
-				(seqinfo->gs_max_value - seqinfo->gs_increment_by >=
-				  rangemax))
+		distance = (uint64) seqinfo->gs_max_value - (uint64) rangemax;
+		step = (uint64) seqinfo->gs_increment_by;
+	}
+	else
+	{
+		distance = (uint64) rangemax - (uint64) seqinfo->gs_min_value;
+		step = - (uint64) seqinfo->gs_increment_by;
+	}
+
+	steps = distance / step;
+	if (steps > (uint64) range)
+		steps = (uint64) range;
+
+	return (GTM_Sequence) ((uint64) rangemax +
+						   steps * (uint64) seqinfo->gs_increment_by);
+}
+
+/*
+ * Work out how many values to grant to the Coordinator asking for the next
+ * values of the sequence.
+ *
+ * GTM tracks how frequently each Coordinator comes back for the sequence.
+ * The range granted to a Coordinator doubles every time it returns within a
+ * second, up to max_sequence_range, is halved if it has been idle for more
+ * than three seconds and drops back to a single value after five seconds.
+ * The caller never gets less than it asked for.  Must be called with the
+ * sequence locked for write.
+ */
+static GTM_Sequence
+seq_adaptive_range(GTM_SeqInfo *seqinfo, char *coord_name, GTM_Sequence range)
+{
+	GTM_SeqCoordRange *coordrange = NULL;
+	GTM_Timestamp now;
+	int			i;
+
+	if (GTMMaxSequenceRange <= 1 || coord_name == NULL)
+		return range;
+
+	for (i = 0; i < seqinfo->gs_coordrange_count; i++)
+	{
+		if (strcmp(seqinfo->gs_coord_ranges[i].gs_coord_name, coord_name) == 0)
 		{
-			rangemax += seqinfo->gs_increment_by;
-			range--;
+			coordrange = &seqinfo->gs_coord_ranges[i];
+			break;
 		}
 	}
-	else
+
+	now = GTM_TimestampGetCurrent();
+
+	if (coordrange == NULL)
 	{
-		/*
-		 * Check if the sequence will underflow because of the range
-		 * request. If yes, cap it at close to or equal to min value
-		 *
-		 * Note: The gs_increment_by is a signed integer and is negative for
-		 * descending sequences. So we don't need special handling below
-		 */
-		while (range != 0 &&
-				(seqinfo->gs_min_value - seqinfo->gs_increment_by <=
-				 rangemax))
+		/* First request from this Coordinator, add new entry */
+		if (seqinfo->gs_coordrange_count == seqinfo->gs_max_coordranges)
 		{
-			rangemax += seqinfo->gs_increment_by;
-			range--;
+#define INIT_COORDRANGES 4
+
+			if (seqinfo->gs_max_coordranges == 0)
+			{
+				MemoryContext oldContext;
+				oldContext = MemoryContextSwitchTo(TopMostMemoryContext);
+				seqinfo->gs_coord_ranges = (GTM_SeqCoordRange *)
+						palloc(INIT_COORDRANGES * sizeof(GTM_SeqCoordRange));
+				seqinfo->gs_max_coordranges = INIT_COORDRANGES;
+				MemoryContextSwitchTo(oldContext);
+			}
+			else
+			{
+				int newsize = seqinfo->gs_max_coordranges * 2;
+				seqinfo->gs_coord_ranges = (GTM_SeqCoordRange *)
+						repalloc(seqinfo->gs_coord_ranges,
+								 newsize * sizeof(GTM_SeqCoordRange));
+				seqinfo->gs_max_coordranges = newsize;
+			}
 		}
+
+		coordrange = &seqinfo->gs_coord_ranges[seqinfo->gs_coordrange_count++];
+		strlcpy(coordrange->gs_coord_name, coord_name, SP_NODE_NAME);
+		coordrange->gs_range = 1;
 	}
-	return rangemax;
+	else if (!GTM_TimestampDifferenceExceeds(coordrange->gs_last_grant, now, 1000))
+	{
+		if (coordrange->gs_range <= GTMMaxSequenceRange / 2)
+			coordrange->gs_range *= 2;
+		else
+			coordrange->gs_range = GTMMaxSequenceRange;
+	}
+	else if (GTM_TimestampDifferenceExceeds(coordrange->gs_last_grant, now, 5000))
+		coordrange->gs_range = 1;
+	else if (GTM_TimestampDifferenceExceeds(coordrange->gs_last_grant, now, 3000))
+		coordrange->gs_range = Max(coordrange->gs_range / 2, 1);
+
+	coordrange->gs_last_grant = now;
+
+	elog(DEBUG1, "Granting range " INT64_FORMAT " of Sequence %s to %s",
+		 Max(range, coordrange->gs_range), seqinfo->gs_key->gsk_key, coord_name);
+
+	return Max(range, coordrange->gs_range);
 }
 
 /*
@@ -1106,10 +1399,9 @@ GTM_SeqReset(GTM_SequenceKey seqkey)
 
 	GTM_RWLockAcquire(&seqinfo->gs_lock, GTM_LOCKMODE_WRITE);
 	seqinfo->gs_value = seqinfo->gs_backedUpValue = seqinfo->gs_init_value;
+	GTM_WalLogSeqValue(seqinfo->gs_key, seqinfo->gs_value, seqinfo->gs_called);
+	GTM_RWLockRelease(&seqinfo->gs_lock);
 
-	GTM_RWLockRelease(&gtm_bkup_lock);
-
-	GTM_SetNeedBackup();
 	seq_release_seqinfo(seqinfo);
 	return 0;
 }
@@ -1121,8 +1413,8 @@ GTM_InitSeqManager(void)
 
 	for (ii = 0; ii < SEQ_HASH_TABLE_SIZE; ii++)
 	{
-		GTMSequences[ii].shb_list = gtm_NIL;
-		GTM_RWLockInit(&GTMSequences[ii].shb_lock);
+		SEQ_BUCKET(ii)->shb_list = gtm_NIL;
+		GTM_RWLockInit(&SEQ_BUCKET(ii)->shb_lock);
 	}
 }
 
@@ -1393,7 +1685,7 @@ ProcessSequenceListCommand(Port *myport, StringInfo message)
 		GTM_SeqInfoHashBucket *b;
 		gtm_ListCell *elem;
 
-		b = &GTMSequences[i];
+		b = SEQ_BUCKET(i);
 
 		GTM_RWLockAcquire(&b->shb_lock, GTM_LOCKMODE_READ);
 
@@ -1587,7 +1879,7 @@ ProcessSequenceGetNextCommand(Port *myport, StringInfo message, bool is_backup)
 	memcpy(&range, pq_getmsgbytes(message, sizeof (GTM_Sequence)),
 		   sizeof (GTM_Sequence));
 
-	if (GTM_SeqGetNext(&seqkey, coord_name, coord_procid, range,
+	if (GTM_SeqGetNext(&seqkey, coord_name, coord_procid, is_backup, &range,
 					&seqval, &rangemax))
 		ereport(ERROR,
 				(ERANGE,
@@ -1620,8 +1912,8 @@ ProcessSequenceGetNextCommand(Port *myport, StringInfo message, bool is_backup)
 
 			elog(DEBUG1, "get_next() returns GTM_Sequence %ld.", loc_seq);
 		}
-		/* Save control file info */
-        SaveControlInfo();
+		/* Make the new value durable before handing it out */
+		GTM_WalSync();
 
 		/* Respond to the client */
 		pq_beginmessage(&buf, 'S');
@@ -1733,8 +2025,8 @@ ProcessSequenceSetValCommand(Port *myport, StringInfo message, bool is_backup)
 
 			elog(DEBUG1, "set_val() returns rc %d.", rc);
 		}
-		/* Save control file info */
-        SaveControlInfo();
+		/* Make the new value durable before handing it out */
+		GTM_WalSync();
 
 		/* Respond to the client */
 		pq_beginmessage(&buf, 'S');
@@ -1806,8 +2098,8 @@ ProcessSequenceResetCommand(Port *myport, StringInfo message, bool is_backup)
 
 			elog(DEBUG1, "reset_sequence() returns rc %d.", rc);
 		}
-		/* Save control file info */
-        SaveControlInfo();
+		/* Make the new value durable before handing it out */
+		GTM_WalSync();
 
 		/* Respond to the client */
 		pq_beginmessage(&buf, 'S');
@@ -2195,7 +2487,7 @@ GTM_SaveSeqInfo2(FILE *ctlf, bool isBackup)
 
 	for (hash = 0; hash < SEQ_HASH_TABLE_SIZE; hash++)
 	{
-		bucket = &GTMSequences[hash];
+		bucket = SEQ_BUCKET(hash);
 
 		GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_READ);
 
@@ -2274,7 +2566,7 @@ GTM_UpdateRestorePointSeq(void)
 
 	for (hash = 0; hash < SEQ_HASH_TABLE_SIZE; hash++)
 	{
-		bucket = &GTMSequences[hash];
+		bucket = SEQ_BUCKET(hash);
 
 		GTM_RWLockAcquire(&bucket->shb_lock, GTM_LOCKMODE_READ);
 
@@ -2318,7 +2610,7 @@ GTM_CleanupSeqSession(char *coord_name, int coord_procid)
 
 	for (i = 0; i < SEQ_HASH_TABLE_SIZE; i++)
 	{
-		GTM_SeqInfoHashBucket *bucket = &GTMSequences[i];
+		GTM_SeqInfoHashBucket *bucket = SEQ_BUCKET(i);
 		gtm_ListCell *elem;
 		GTM_SeqInfo *curr_seqinfo;
 
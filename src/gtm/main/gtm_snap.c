@@ -276,6 +276,7 @@ GTM_GetTransactionSnapshot(GTM_TransactionHandle handle[], int txn_count, int *s
 	snapshot->sn_xmin = xmin;
 	snapshot->sn_xmax = xmax;
 	snapshot->sn_xcnt = count;
+	snapshot->sn_seqno = GTMTransactions.gt_completed_seqno;
 
 	/*
 	 * Now, before the proc array lock is released, set the xmin in the txninfo
@@ -324,6 +325,7 @@ GTM_GetTransactionSnapshot(GTM_TransactionHandle handle[], int txn_count, int *s
 					mysnap->sn_xmin = snapshot->sn_xmin;
 					mysnap->sn_xmax = snapshot->sn_xmax;
 					mysnap->sn_xcnt = snapshot->sn_xcnt;
+					mysnap->sn_seqno = snapshot->sn_seqno;
 					memcpy(mysnap->sn_xip, snapshot->sn_xip,
 							sizeof (GlobalTransactionId) * snapshot->sn_xcnt);
 				}
@@ -431,6 +433,7 @@ ProcessGetSnapshotCommand(Port *myport, StringInfo message, bool get_gxid)
 	pq_sendint(&buf, snapshot->sn_xcnt, sizeof (int));
 	pq_sendbytes(&buf, (char *)snapshot->sn_xip,
 				 sizeof(GlobalTransactionId) * snapshot->sn_xcnt);
+	pq_sendbytes(&buf, (char *)&snapshot->sn_seqno, sizeof (uint64));
 	pq_endmessage(myport, &buf);
 
 	if (myport->remote_type != GTM_NODE_GTM_PROXY)
@@ -496,6 +499,7 @@ ProcessGetSnapshotCommandMulti(Port *myport, StringInfo message)
 	pq_sendint(&buf, snapshot->sn_xcnt, sizeof (int));
 	pq_sendbytes(&buf, (char *)snapshot->sn_xip,
 				 sizeof(GlobalTransactionId) * snapshot->sn_xcnt);
+	pq_sendbytes(&buf, (char *)&snapshot->sn_seqno, sizeof (uint64));
 	pq_endmessage(myport, &buf);
 
 	if (myport->remote_type != GTM_NODE_GTM_PROXY)
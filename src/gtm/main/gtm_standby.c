@@ -144,6 +144,8 @@ gtm_standby_restore_gxid(void)
 		GTMTransactions.gt_transactions_array[handle].gti_isolevel = txn.gt_transactions_array[i].gti_isolevel;
 		GTMTransactions.gt_transactions_array[handle].gti_readonly = txn.gt_transactions_array[i].gti_readonly;
 		GTMTransactions.gt_transactions_array[handle].gti_proxy_client_id = txn.gt_transactions_array[i].gti_proxy_client_id;
+		/* the clients of the active GTM are not connected to us */
+		GTMTransactions.gt_transactions_array[handle].gti_detached = true;
 
 		if (txn.gt_transactions_array[i].nodestring == NULL )
 			GTMTransactions.gt_transactions_array[handle].nodestring = NULL;
@@ -0,0 +1,404 @@
+/*-------------------------------------------------------------------------
+ *
+ * gtm_standby_log.c
+ *		Log of the backup messages shipped to GTM standby
+ *
+ * Every command changing GTM state is backed up on the standby by sending
+ * it the corresponding backup message.  Rather than having each worker
+ * thread talk to the standby over a connection of its own, inline with the
+ * client request, worker threads append the messages to a single log and a
+ * dedicated sender thread ships the log to the standby in batches over one
+ * connection.  The standby thus applies the changes in the order they were
+ * made, and the standby round trips are taken off the client requests.
+ *
+ * Positions in the log (LSNs) are byte offsets in the stream of messages.
+ * After each batch the sender asks the standby to confirm it has processed
+ * everything sent so far and advances the acknowledged LSN.  When
+ * synchronous_backup is on, gtm_sync_standby() waits for the acknowledged
+ * LSN to reach the last message of the calling thread, otherwise nothing
+ * waits for the standby.
+ *
+ * Worker threads keep using the bkup_*() client routines, the connection
+ * they write to is made by GTMPQmakeHookConn() and appends to the log.
+ *
+ * A standby which neither takes a batch nor confirms it in time is dropped,
+ * so that a dead standby cannot hold up the active GTM.  The time limit
+ * follows the keepalive settings, the time they take to notice a dead peer.
+ *
+ * Portions Copyright (c) 2012-2014, TransLattice, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *		src/gtm/main/gtm_standby_log.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "gtm/gtm_standby.h"
+
+#include <time.h>
+
+#include "gtm/elog.h"
+#include "gtm/gtm.h"
+#include "gtm/gtm_c.h"
+#include "gtm/gtm_client.h"
+#include "gtm/gtm_msg.h"
+#include "gtm/libpq-fe.h"
+#include "gtm/libpq-int.h"
+#include "gtm/memutils.h"
+#include "gtm/standby_utils.h"
+
+extern int tcp_keepalives_idle;
+extern int tcp_keepalives_interval;
+extern int tcp_keepalives_count;
+
+/* Size of the log buffer, the writers wait for the sender when it is full */
+#define GTM_STANDBY_LOG_SIZE		(1024 * 1024)
+
+/* Maximum amount of data the sender ships before asking for a confirmation */
+#define GTM_STANDBY_LOG_BATCH_SIZE	(64 * 1024)
+
+/*
+ * How long to wait for the standby to take and confirm a batch, in seconds,
+ * if keepalives are not set up
+ */
+#define GTM_STANDBY_LOG_TIMEOUT		20
+
+typedef struct GTM_StandbyLogData
+{
+	GTM_MutexLock	sl_lock;
+	GTM_CV			sl_insert_cv;	/* new data in the log, for the sender */
+	GTM_CV			sl_ack_cv;		/* acknowledged LSN has advanced */
+	char		   *sl_buffer;
+	uint64			sl_insert_lsn;	/* end of the last message appended */
+	uint64			sl_ack_lsn;		/* end of the data confirmed by standby
+									 * or discarded */
+	uint32			sl_generation;	/* incremented when the log is reset */
+	bool			sl_started;
+} GTM_StandbyLogData;
+
+static GTM_StandbyLogData GTMStandbyLog;
+
+static int GTM_StandbyLogAppend(GTM_Conn *conn);
+static int GTM_StandbyLogSync(GTM_Conn *conn);
+static int GTM_StandbyLogTimeout(void);
+static bool GTM_StandbyLogSend(GTM_Conn *standby, uint64 start_lsn,
+				   uint64 end_lsn);
+static void *GTM_StandbyLogSender(void *argp);
+
+/*
+ * Set up the log and start the sender thread.  Must be called from the main
+ * thread, before any worker thread is started.
+ */
+void
+GTM_StandbyLogStart(void)
+{
+	GTM_StandbyLogData *log = &GTMStandbyLog;
+	GTM_ThreadInfo *thrinfo;
+	int			err;
+
+	GTM_MutexLockInit(&log->sl_lock);
+	GTM_CVInit(&log->sl_insert_cv);
+	GTM_CVInit(&log->sl_ack_cv);
+	log->sl_buffer = (char *) malloc(GTM_STANDBY_LOG_SIZE);
+	if (log->sl_buffer == NULL)
+		ereport(FATAL,
+				(ENOMEM,
+				 errmsg("Failed to allocate the GTM standby log")));
+	log->sl_insert_lsn = 0;
+	log->sl_ack_lsn = 0;
+	log->sl_generation = 0;
+
+	/*
+	 * The sender is not a client thread, it is not registered with the thread
+	 * manager, but needs its own memory contexts for error reporting.
+	 */
+	thrinfo = (GTM_ThreadInfo *) malloc(sizeof (GTM_ThreadInfo));
+	if (thrinfo == NULL)
+		ereport(FATAL,
+				(ENOMEM,
+				 errmsg("Failed to allocate the GTM standby log sender")));
+	memset(thrinfo, 0, sizeof (GTM_ThreadInfo));
+	GTM_RWLockInit(&thrinfo->thr_lock);
+	thrinfo->thr_status = GTM_THREAD_RUNNING;
+	thrinfo->thr_thread_context = AllocSetContextCreate(TopMemoryContext,
+														"TopMemoryContext",
+														ALLOCSET_DEFAULT_MINSIZE,
+														ALLOCSET_DEFAULT_INITSIZE,
+														ALLOCSET_DEFAULT_MAXSIZE,
+														false);
+	thrinfo->thr_parent_context = TopMemoryContext;
+	thrinfo->thr_error_context = AllocSetContextCreate(ErrorContext,
+													   "ErrorContext",
+													   8 * 1024,
+													   8 * 1024,
+													   8 * 1024,
+													   false);
+
+	if ((err = pthread_create(&thrinfo->thr_id, NULL, GTM_StandbyLogSender,
+							  thrinfo)))
+		ereport(FATAL,
+				(err,
+				 errmsg("Failed to create the GTM standby log sender: error %s",
+						strerror(err))));
+	pthread_detach(thrinfo->thr_id);
+
+	log->sl_started = true;
+}
+
+/*
+ * Make a connection for the calling thread to send backup messages to the
+ * standby through the log.  Returns NULL if there is no standby to back up to.
+ */
+GTM_Conn *
+GTM_StandbyLogOpen(void)
+{
+	if (Recovery_IsStandby() || !GTMStandbyLog.sl_started)
+		return NULL;
+
+	if (find_standby_node_info() == NULL)
+	{
+		elog(DEBUG1, "Any GTM standby node not found in registered node(s).");
+		return NULL;
+	}
+
+	return GTMPQmakeHookConn(GTM_StandbyLogAppend, GTM_StandbyLogSync);
+}
+
+/*
+ * Discard the messages not yet confirmed by the standby and make the sender
+ * reconnect.  Called when a new standby registers, it has already copied the
+ * GTM state those messages would change.
+ */
+void
+GTM_StandbyLogReset(void)
+{
+	GTM_StandbyLogData *log = &GTMStandbyLog;
+
+	if (!log->sl_started)
+		return;
+
+	GTM_MutexLockAcquire(&log->sl_lock);
+	log->sl_generation++;
+	log->sl_ack_lsn = log->sl_insert_lsn;
+	GTM_CVBcast(&log->sl_ack_cv);
+	GTM_MutexLockRelease(&log->sl_lock);
+}
+
+/*
+ * Flush hook of the connection, move the messages from the connection output
+ * buffer to the log.
+ */
+static int
+GTM_StandbyLogAppend(GTM_Conn *conn)
+{
+	GTM_StandbyLogData *log = &GTMStandbyLog;
+	uint64		len = conn->outCount;
+	uint64		pos;
+	uint64		first;
+
+	if (len > GTM_STANDBY_LOG_SIZE)
+	{
+		elog(LOG, "Backup message of %lu bytes does not fit in the standby log",
+			 (unsigned long) len);
+		conn->outCount = 0;
+		return EOF;
+	}
+
+	GTM_MutexLockAcquire(&log->sl_lock);
+
+	/* Wait for the sender to make room */
+	while (log->sl_insert_lsn + len - log->sl_ack_lsn > GTM_STANDBY_LOG_SIZE)
+		GTM_CVWait(&log->sl_ack_cv, &log->sl_lock);
+
+	pos = log->sl_insert_lsn % GTM_STANDBY_LOG_SIZE;
+	first = Min(len, GTM_STANDBY_LOG_SIZE - pos);
+	memcpy(log->sl_buffer + pos, conn->outBuffer, first);
+	if (first < len)
+		memcpy(log->sl_buffer, conn->outBuffer + first, len - first);
+	log->sl_insert_lsn += len;
+	GetMyThreadInfo->thr_standby_lsn = log->sl_insert_lsn;
+
+	GTM_CVSignal(&log->sl_insert_cv);
+	GTM_MutexLockRelease(&log->sl_lock);
+
+	conn->outCount = 0;
+	return 0;
+}
+
+/*
+ * Sync hook of the connection, wait until the standby confirms the last
+ * message written by the calling thread.
+ */
+static int
+GTM_StandbyLogSync(GTM_Conn *conn)
+{
+	GTM_StandbyLogData *log = &GTMStandbyLog;
+	uint64		lsn = GetMyThreadInfo->thr_standby_lsn;
+
+	GTM_MutexLockAcquire(&log->sl_lock);
+	while (log->sl_ack_lsn < lsn)
+		GTM_CVWait(&log->sl_ack_cv, &log->sl_lock);
+	GTM_MutexLockRelease(&log->sl_lock);
+
+	return GTM_RESULT_OK;
+}
+
+/*
+ * Time the standby is given to take and confirm a batch, in seconds
+ */
+static int
+GTM_StandbyLogTimeout(void)
+{
+	if (tcp_keepalives_idle > 0 && tcp_keepalives_interval > 0 &&
+		tcp_keepalives_count > 0)
+		return tcp_keepalives_idle +
+			tcp_keepalives_interval * tcp_keepalives_count;
+
+	return GTM_STANDBY_LOG_TIMEOUT;
+}
+
+/*
+ * Send the log between the given positions to the standby and wait for it to
+ * confirm them.  Returns false if the connection failed or the standby did
+ * not answer in time.
+ */
+static bool
+GTM_StandbyLogSend(GTM_Conn *standby, uint64 start_lsn, uint64 end_lsn)
+{
+	GTM_StandbyLogData *log = &GTMStandbyLog;
+	uint64		len = end_lsn - start_lsn;
+	uint64		pos = start_lsn % GTM_STANDBY_LOG_SIZE;
+	uint64		first = Min(len, GTM_STANDBY_LOG_SIZE - pos);
+	GTM_Result *res;
+	time_t		finish_time = time(NULL) + GTM_StandbyLogTimeout();
+	int			flushResult;
+
+	/*
+	 * The log is a stream of complete messages, copy it over as is.  The
+	 * writers do not touch the data until we advance the acknowledged LSN.
+	 */
+	if (gtmpqPutMsgStart(0, false, standby) ||
+		gtmpqPutnchar(log->sl_buffer + pos, first, standby) ||
+		(first < len &&
+		 gtmpqPutnchar(log->sl_buffer, len - first, standby)) ||
+		gtmpqPutMsgEnd(standby))
+		return false;
+
+	if (gtmpqPutMsgStart('C', true, standby) ||
+		gtmpqPutInt(MSG_SYNC_STANDBY, sizeof (GTM_MessageType), standby) ||
+		gtmpqPutMsgEnd(standby))
+		return false;
+
+	/* The socket is non-blocking, a standby not reading must not stall us */
+	while ((flushResult = gtmpqFlush(standby)) > 0)
+	{
+		if (gtmpqWaitTimed(false, true, standby, finish_time))
+			return false;
+	}
+	if (flushResult < 0)
+		return false;
+
+	/* Skip replies to the other messages, if any, up to the confirmation */
+	while ((res = GTMPQgetResultTimed(standby, finish_time)) != NULL)
+	{
+		if (res->gr_type == SYNC_STANDBY_RESULT)
+			return (res->gr_status == GTM_RESULT_OK);
+	}
+
+	return false;
+}
+
+/*
+ * Main loop of the sender thread
+ */
+static void *
+GTM_StandbyLogSender(void *argp)
+{
+	GTM_ThreadInfo *thrinfo = (GTM_ThreadInfo *) argp;
+	GTM_StandbyLogData *log = &GTMStandbyLog;
+	GTM_Conn   *standby = NULL;
+	uint32		generation = 0;
+
+	SetMyThreadInfo(thrinfo);
+	MemoryContextSwitchTo(TopMemoryContext);
+
+	elog(DEBUG1, "GTM standby log sender started");
+
+	for (;;)
+	{
+		uint64		start_lsn;
+		uint64		end_lsn;
+		bool		reset;
+		bool		sent = false;
+
+		GTM_MutexLockAcquire(&log->sl_lock);
+		while (log->sl_ack_lsn == log->sl_insert_lsn)
+			GTM_CVWait(&log->sl_insert_cv, &log->sl_lock);
+
+		reset = (generation != log->sl_generation);
+		generation = log->sl_generation;
+		start_lsn = log->sl_ack_lsn;
+		end_lsn = Min(log->sl_insert_lsn,
+					  start_lsn + GTM_STANDBY_LOG_BATCH_SIZE);
+		GTM_MutexLockRelease(&log->sl_lock);
+
+		/* Standby has changed, the old connection is of no use */
+		if (reset && standby)
+		{
+			GTMPQfinish(standby);
+			standby = NULL;
+		}
+
+		if (standby == NULL && GTMThreads->gt_standby_ready)
+		{
+			standby = gtm_standby_connect_to_standby();
+			if (standby && !pg_set_noblock(standby->sock))
+			{
+				elog(LOG, "Could not set the connection to GTM standby "
+					 "to non-blocking mode");
+				GTMPQfinish(standby);
+				standby = NULL;
+			}
+			if (standby == NULL)
+				GTMThreads->gt_standby_ready = false;
+		}
+
+		if (standby)
+		{
+			sent = GTM_StandbyLogSend(standby, start_lsn, end_lsn);
+			if (!sent)
+			{
+				elog(LOG, "Communication error with GTM standby, "
+					 "the backup is discontinued: %s",
+					 GTMPQerrorMessage(standby));
+				GTMPQfinish(standby);
+				standby = NULL;
+
+				/* This will make the worker threads drop the standby */
+				GTMThreads->gt_standby_ready = false;
+			}
+		}
+
+		/*
+		 * Advance the acknowledged LSN.  If there is no standby to send the
+		 * data to, it is discarded, as is the data the standby has failed to
+		 * confirm.  Waiters are released either way.
+		 */
+		GTM_MutexLockAcquire(&log->sl_lock);
+		if (generation == log->sl_generation)
+		{
+			if (sent)
+				log->sl_ack_lsn = end_lsn;
+			else
+				log->sl_ack_lsn = log->sl_insert_lsn;
+		}
+		GTM_CVBcast(&log->sl_ack_cv);
+		GTM_MutexLockRelease(&log->sl_lock);
+
+		if (sent)
+			elog(DEBUG3, "GTM standby has confirmed the log up to %lu",
+				 (unsigned long) end_lsn);
+	}
+
+	return NULL;
+}
@@ -346,6 +346,9 @@ GTM_ThreadCleanup(void *argp)
 		thrinfo->thr_conn->standby = NULL;
 	}
 
+	/* Nobody may send GlobalXmin notifications on the port any more */
+	GTM_UnsubscribeGlobalXmin(thrinfo->thr_conn);
+
 	/*
 	 * TODO Close the open connection.
 	 */
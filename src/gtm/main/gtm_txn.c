@@ -131,6 +131,8 @@
 #include "gtm/gtm_txn.h"
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include "gtm/assert.h"
 #include "gtm/elog.h"
 #include "gtm/gtm.h"
@@ -143,9 +145,35 @@
 #include "gtm/libpq-int.h"
 #include "gtm/pqformat.h"
 #include "gtm/gtm_backup.h"
+#include "gtm/gtm_wal.h"
+#include "port/atomics.h"
 
 extern bool Backup_synchronously;
 
+/*
+ * Nodes subscribed to GTM_GlobalXmin notifications
+ *
+ * A node subscribes on a connection it dedicates to this and never sends
+ * anything else on. Only the thread serving the connection writes to it: the
+ * thread that advanced GTM_GlobalXmin, while processing a node's report,
+ * merely writes a byte to the wakeup pipe of each subscriber. The serving
+ * thread waits for both its connection and its pipe, see
+ * GTM_WaitCommandOrXmin, and sends the notification itself. A stalled
+ * subscriber thus only stalls its own thread. The list is protected by
+ * XminSubscribersLock.
+ */
+typedef struct GTM_XminSubscriber
+{
+	Port			   *port;
+	GTM_PGXCNodeType	type;
+	char				node_name[NI_MAXHOST];
+	int					wakeup[2];	/* pipe, written to when xmin advances */
+} GTM_XminSubscriber;
+
+static gtm_List *XminSubscribers = gtm_NIL;
+static GlobalTransactionId XminNotified = InvalidGlobalTransactionId;
+static GTM_MutexLock XminSubscribersLock;
+
 /* Local functions */
 static bool GTM_SetDoVacuum(GTM_TransactionHandle handle);
 static void GTM_TransactionInfo_Init(GTM_TransactionInfo *gtm_txninfo,
@@ -156,13 +184,16 @@ static void GTM_TransactionInfo_Init(GTM_TransactionInfo *gtm_txninfo,
 									 const char *global_sessionid,
 									 bool readonly);
 static void GTM_TransactionInfo_Clean(GTM_TransactionInfo *gtm_txninfo);
+static uint64 GTM_GetCompletedSeqno(void);
+static void GTM_NotifyGlobalXmin(GlobalTransactionId global_xmin);
 static GTM_TransactionHandle GTM_GlobalSessionIDToHandle(
 									const char *global_sessionid);
-static bool GTM_NeedXidRestoreUpdate(void);
 
-GlobalTransactionId ControlXid;  /* last one written to control file */
 GTM_Transactions GTMTransactions;
 
+/* Last timestamp handed out by GTM_GetTimestamp() */
+static pg_atomic_uint64 GTMLastTimestamp;
+
 /*
  * GTM_InitTxnManager
  *	Initializes the internal data structures used by GTM.
@@ -231,9 +262,18 @@ GTM_InitTxnManager(void)
 	GTMTransactions.gt_open_transactions = gtm_NIL;
 	GTMTransactions.gt_lastslot = -1;
 
-	GTMTransactions.gt_gtm_state = GTM_STARTING;
+	GTM_MutexLockInit(&XminSubscribersLock);
+
+	/*
+	 * Start counting from the current time in microseconds, so that the
+	 * counter does not go back when GTM restarts, unless more than one
+	 * transaction per microsecond completed on average.
+	 */
+	GTMTransactions.gt_completed_seqno = (uint64) GTM_TimestampGetCurrent();
 
-	ControlXid = FirstNormalGlobalTransactionId;
+	pg_atomic_init_u64(&GTMLastTimestamp, 0);
+
+	GTMTransactions.gt_gtm_state = GTM_STARTING;
 
 	return;
 }
@@ -447,6 +487,7 @@ GTM_RemoveTransInfoMulti(GTM_TransactionInfo *gtm_txninfo[], int txn_count)
 			continue;
 
 		GTMTransactions.gt_open_transactions = gtm_list_delete(GTMTransactions.gt_open_transactions, gtm_txninfo[ii]);
+		GTMTransactions.gt_completed_seqno++;
 
 		/*
 		 * If this transaction is newer than the current gt_latestCompletedXid,
@@ -516,6 +557,7 @@ GTM_RemoveAllTransInfos(uint32 client_id, int backend_id)
 		{
 			/* remove the entry */
 			GTMTransactions.gt_open_transactions = gtm_list_delete_cell(GTMTransactions.gt_open_transactions, cell, prev);
+			GTMTransactions.gt_completed_seqno++;
 
 			/* update the latestCompletedXid */
 			if (GlobalTransactionIdIsNormal(gtm_txninfo->gti_gxid) &&
@@ -539,6 +581,16 @@ GTM_RemoveAllTransInfos(uint32 client_id, int backend_id)
 		}
 		else
 		{
+			/*
+			 * A prepared transaction of the departing client stays, but
+			 * nobody is going to finish it any more. Remember that, so that
+			 * the 2PC resolver can tell it from one still being committed.
+			 */
+			if (gtm_txninfo->gti_in_use &&
+				GTM_CLIENT_ID_EQ(gtm_txninfo->gti_client_id, client_id) &&
+				((gtm_txninfo->gti_proxy_client_id == backend_id) || (backend_id == -1)))
+				gtm_txninfo->gti_detached = true;
+
 			prev = cell;
 			cell = gtm_lnext(cell);
 		}
@@ -547,6 +599,25 @@ GTM_RemoveAllTransInfos(uint32 client_id, int backend_id)
 	GTM_RWLockRelease(&GTMTransactions.gt_TransArrayLock);
 }
 
+/*
+ * GTM_GetCompletedSeqno
+ *		Number of transactions completed so far.
+ *
+ * Sent back with commit results, so that clients can tell whether a snapshot
+ * they hold was taken after their commit.
+ */
+static uint64
+GTM_GetCompletedSeqno(void)
+{
+	uint64 seqno;
+
+	GTM_RWLockAcquire(&GTMTransactions.gt_TransArrayLock, GTM_LOCKMODE_READ);
+	seqno = GTMTransactions.gt_completed_seqno;
+	GTM_RWLockRelease(&GTMTransactions.gt_TransArrayLock);
+
+	return seqno;
+}
+
 /*
  * GTMGetLastClientIdentifier
  *		Get the latest client identifier assigned to currently open transactions.
@@ -651,7 +722,6 @@ GTM_GetGlobalTransactionIdMulti(GTM_TransactionHandle handles[], int txn_count,
 	GTM_TransactionInfo *gtm_txninfo = NULL;
 	int ii;
 	int new_handles_count = 0;
-	bool save_control = false;
 
 	elog(DEBUG1, "GTM_GetGlobalTransactionIdMulti: generate GXIDs for %d transactions", txn_count);
 
@@ -737,25 +807,15 @@ GTM_GetGlobalTransactionIdMulti(GTM_TransactionHandle handles[], int txn_count,
 			new_handles[new_handles_count++] = gtm_txninfo->gti_handle;
 	}
 
-	/*
-	 * Periodically write the xid and sequence info out to the control file.
-	 * Try and handle wrapping, too.
-	 */
-	if (GlobalTransactionIdIsValid(xid) &&
-			(xid - ControlXid > CONTROL_INTERVAL || xid < ControlXid))
-	{
-		save_control = true;
-		ControlXid = xid;
-	}
-
-	if (GTM_NeedXidRestoreUpdate())
-		GTM_SetNeedBackup();
+	/* Log the new next GXID, the GXIDs must not be reused after a crash */
+	if (GlobalTransactionIdIsValid(xid))
+		GTM_WalLogNextXid(GTMTransactions.gt_nextXid);
 
 	GTM_RWLockRelease(&GTMTransactions.gt_XidGenLock);
 
-	/* save control info when not holding the XidGenLock */
-	if (save_control)
-		SaveControlInfo();
+	/* and make it durable before the GXIDs are handed out */
+	if (GlobalTransactionIdIsValid(xid))
+		GTM_WalSync();
 
 	if (new_txn_count)
 		*new_txn_count = new_handles_count;
@@ -813,13 +873,9 @@ GTM_ReadNewGlobalTransactionId(void)
  *
  * The function also switches the GTM from 'starting' to 'running' state.
  *
- * This is handled by gtm_backup.c.  Anyway, because this function is to be
- * called by GTM_RestoreTransactionId() and the backup will be performed
- * afterwards, we don't care the new value of GTMTransactions.gt_nextXid here
- * (it may even be invalid or stale).
- *
- * XXX We don't yet handle any crash recovery. So if the GTM did not shutdown
- * cleanly, it's not quite sure what'll happen.
+ * If the GTM did not shutdown cleanly, the GXIDs assigned after the control
+ * file was written are recovered afterwards from the WAL, see
+ * GTM_RedoNextGlobalTransactionId().
  */
 void
 GTM_SetNextGlobalTransactionId(GlobalTransactionId gxid)
@@ -836,14 +892,22 @@ GTM_SetNextGlobalTransactionId(GlobalTransactionId gxid)
 }
 
 /*
- * GTM_SetControlXid
- *		Sets the control GXID.
+ * GTM_RedoNextGlobalTransactionId
+ *		Advance the next global XID to the one found in the WAL.
+ *
+ * Called during the WAL replay at startup, after the GXID saved in the
+ * control file has been restored.
  */
 void
-GTM_SetControlXid(GlobalTransactionId gxid)
+GTM_RedoNextGlobalTransactionId(GlobalTransactionId gxid)
 {
-	elog(DEBUG1, "GTM_SetControlXid: setting control GXID %u", gxid);
-	ControlXid = gxid;
+	GTM_RWLockAcquire(&GTMTransactions.gt_XidGenLock, GTM_LOCKMODE_WRITE);
+	if (GlobalTransactionIdFollows(gxid, GTMTransactions.gt_nextXid))
+	{
+		GTMTransactions.gt_nextXid = gxid;
+		GTMTransactions.gt_latestCompletedXid = gxid - 1;
+	}
+	GTM_RWLockRelease(&GTMTransactions.gt_XidGenLock);
 }
 
 /*
@@ -1044,6 +1108,7 @@ GTM_TransactionInfo_Init(GTM_TransactionInfo *gtm_txninfo,
 
 	gtm_txninfo->gti_isolevel = isolevel;
 	gtm_txninfo->gti_readonly = readonly;
+	gtm_txninfo->gti_detached = false;
 	gtm_txninfo->gti_in_use = true;
 
 	if (global_sessionid)
@@ -1516,6 +1581,7 @@ GTM_StartPreparedTransaction(GTM_TransactionHandle txn,
  * GTM_GetGIDData
  *		Returns gti_gxid and nodestring for a transaction handle.
  *
+ * *detached tells whether the client that prepared the transaction is gone.
  * The nodestring (if available) is allocated in TopMostMemoryContext.
  * If there is no matching transaction info (no open transaction for the
  * handle), the rertur value is STATUS_ERROR.
@@ -1525,6 +1591,7 @@ GTM_StartPreparedTransaction(GTM_TransactionHandle txn,
 static int
 GTM_GetGIDData(GTM_TransactionHandle prepared_txn,
 			   GlobalTransactionId *prepared_gxid,
+			   bool *detached,
 			   char **nodestring)
 {
 	GTM_TransactionInfo	*gtm_txninfo = NULL;
@@ -1540,6 +1607,7 @@ GTM_GetGIDData(GTM_TransactionHandle prepared_txn,
 
 	/* then get the necessary Data */
 	*prepared_gxid = gtm_txninfo->gti_gxid;
+	*detached = gtm_txninfo->gti_detached;
 	if (gtm_txninfo->nodestring)
 	{
 		*nodestring = (char *) palloc(strlen(gtm_txninfo->nodestring) + 1);
@@ -1574,7 +1642,6 @@ GTM_BkupBeginTransactionGetGXIDMulti(GlobalTransactionId *gxid,
 	int count;
 	MemoryContext oldContext;
 
-	bool save_control = false;
 	GlobalTransactionId xid = InvalidGlobalTransactionId;
 
 	oldContext = MemoryContextSwitchTo(TopMostMemoryContext);
@@ -1614,22 +1681,15 @@ GTM_BkupBeginTransactionGetGXIDMulti(GlobalTransactionId *gxid,
 	}
 
 	/*
-	 * Periodically write the xid and sequence info out to the control file.
-	 * Try and handle wrapping, too.
+	 * Log the next GXID as well, in case we are promoted.  Nobody waits for
+	 * the standby to reply, the record is made durable by the next
+	 * MSG_SYNC_STANDBY.
 	 */
-	if (GlobalTransactionIdIsValid(xid) &&
-			(xid - ControlXid > CONTROL_INTERVAL || xid < ControlXid))
-	{
-		save_control = true;
-		ControlXid = xid;
-	}
+	if (GlobalTransactionIdIsValid(xid))
+		GTM_WalLogNextXid(xid);
 
 	GTM_RWLockRelease(&GTMTransactions.gt_TransArrayLock);
 
-	/* save control info when not holding the XidGenLock */
-	if (save_control)
-		SaveControlInfo();
-
 	MemoryContextSwitchTo(oldContext);
 }
 
@@ -1685,8 +1745,12 @@ ProcessBeginTransactionCommand(Port *myport, StringInfo message)
 
 	MemoryContextSwitchTo(oldContext);
 
-	/* GXID has been received, now it's time to get a GTM timestamp */
-	timestamp = GTM_TimestampGetCurrent();
+	/*
+	 * GXID has been received, now it's time to get a GTM timestamp. It comes
+	 * from the same sequence as MSG_GET_TIMESTAMP, so that it can serve as
+	 * the timestamp of timestamp based snapshots.
+	 */
+	timestamp = GTM_GetTimestamp();
 
 	/* Backup first */
 	if (GetMyThreadInfo->thr_conn->standby)
@@ -1776,8 +1840,12 @@ ProcessBeginTransactionGetGXIDCommand(Port *myport, StringInfo message)
 
 	oldContext = MemoryContextSwitchTo(TopMemoryContext);
 
-	/* GXID has been received, now it's time to get a GTM timestamp */
-	timestamp = GTM_TimestampGetCurrent();
+	/*
+	 * GXID has been received, now it's time to get a GTM timestamp. It comes
+	 * from the same sequence as MSG_GET_TIMESTAMP, so that it can serve as
+	 * the timestamp of timestamp based snapshots.
+	 */
+	timestamp = GTM_GetTimestamp();
 
 	/*
 	 * Start a new transaction
@@ -2041,8 +2109,12 @@ ProcessBeginTransactionGetGXIDCommandMulti(Port *myport, StringInfo message)
 
 	MemoryContextSwitchTo(oldContext);
 
-	/* GXID has been received, now it's time to get a GTM timestamp */
-	timestamp = GTM_TimestampGetCurrent();
+	/*
+	 * GXID has been received, now it's time to get a GTM timestamp. It comes
+	 * from the same sequence as MSG_GET_TIMESTAMP, so that it can serve as
+	 * the timestamp of timestamp based snapshots.
+	 */
+	timestamp = GTM_GetTimestamp();
 
 	/* Backup first */
 	if (GetMyThreadInfo->thr_conn->standby)
@@ -2150,6 +2222,7 @@ ProcessCommitTransactionCommand(Port *myport, StringInfo message, bool is_backup
 	int status = STATUS_OK;
 	int waited_xid_count;
 	GlobalTransactionId *waited_xids = NULL;
+	uint64 seqno;
 
 	const char *data = pq_getmsgbytes(message, sizeof (gxid));
 
@@ -2218,6 +2291,8 @@ ProcessCommitTransactionCommand(Port *myport, StringInfo message, bool is_backup
 		}
 		pq_sendbytes(&buf, (char *)&gxid, sizeof(gxid));
 		pq_sendbytes(&buf, (char *)&status, sizeof(status));
+		seqno = GTM_GetCompletedSeqno();
+		pq_sendbytes(&buf, (char *)&seqno, sizeof(seqno));
 		pq_endmessage(myport, &buf);
 
 		if (myport->remote_type != GTM_NODE_GTM_PROXY)
@@ -2251,6 +2326,7 @@ ProcessCommitPreparedTransactionCommand(Port *myport, StringInfo message, bool i
 	int ii;
 	int waited_xid_count;
 	GlobalTransactionId *waited_xids = NULL;
+	uint64 seqno;
 
 	for (ii = 0; ii < txn_count; ii++)
 	{
@@ -2333,6 +2409,8 @@ ProcessCommitPreparedTransactionCommand(Port *myport, StringInfo message, bool i
 		}
 		pq_sendbytes(&buf, (char *)&gxid[0], sizeof(GlobalTransactionId));
 		pq_sendbytes(&buf, (char *)&status[0], 4);
+		seqno = GTM_GetCompletedSeqno();
+		pq_sendbytes(&buf, (char *)&seqno, sizeof(seqno));
 		pq_endmessage(myport, &buf);
 
 		if (myport->remote_type != GTM_NODE_GTM_PROXY)
@@ -2369,6 +2447,7 @@ ProcessGetGIDDataTransactionCommand(Port *myport, StringInfo message)
 	GTM_TransactionHandle txn, prepared_txn;
 	/* Data to be sent back to client */
 	GlobalTransactionId gxid, prepared_gxid;
+	bool detached = false;
 
 	/* take the isolation level and read_only instructions */
 	txn_isolation_level = pq_getmsgint(message, sizeof (GTM_IsolationLevel));
@@ -2405,7 +2484,8 @@ ProcessGetGIDDataTransactionCommand(Port *myport, StringInfo message)
 	/*
 	 * Make the internal process, get the prepared information from GID.
 	 */
-	if (GTM_GetGIDData(prepared_txn, &prepared_gxid, &nodestring) != STATUS_OK)
+	if (GTM_GetGIDData(prepared_txn, &prepared_gxid, &detached,
+					   &nodestring) != STATUS_OK)
 		ereport(ERROR,
 				(EINVAL,
 				 errmsg("Failed to get the information of prepared transaction")));
@@ -2470,6 +2550,9 @@ retry:
 	else
 		pq_sendint(&buf, 0, 4);
 
+	/* Is the session that prepared the transaction still around? */
+	pq_sendbyte(&buf, !detached);
+
 	/* End of message */
 	pq_endmessage(myport, &buf);
 
@@ -2479,6 +2562,128 @@ retry:
 	pfree(gid);
 	return;
 }
+
+/*
+ * Process MSG_TXN_GET_GID_DATA_MULTI
+ *
+ * Same as MSG_TXN_GET_GID_DATA for several GIDs in one round trip, used by
+ * the 2PC resolver of the Coordinators. A GID GTM does not know of does not
+ * fail the whole message, its status tells. The node strings are not sent.
+ */
+void
+ProcessGetGIDDataTransactionCommandMulti(Port *myport, StringInfo message)
+{
+	StringInfoData buf;
+	GTM_IsolationLevel txn_isolation_level;
+	bool txn_read_only;
+	int txn_count;
+	int status[GTM_MAX_GLOBAL_TRANSACTIONS];
+	GlobalTransactionId gxid[GTM_MAX_GLOBAL_TRANSACTIONS];
+	GlobalTransactionId prepared_gxid[GTM_MAX_GLOBAL_TRANSACTIONS];
+	bool attached[GTM_MAX_GLOBAL_TRANSACTIONS];
+	int ii;
+
+	txn_isolation_level = pq_getmsgint(message, sizeof (GTM_IsolationLevel));
+	txn_read_only = pq_getmsgbyte(message);
+	txn_count = pq_getmsgint(message, sizeof (int));
+
+	if (txn_count <= 0 || txn_count > GTM_MAX_GLOBAL_TRANSACTIONS)
+		elog(PANIC, "Zero or more than %d transactions not supported",
+				GTM_MAX_GLOBAL_TRANSACTIONS);
+
+	for (ii = 0; ii < txn_count; ii++)
+	{
+		char *gid;
+		char *nodestring = NULL;
+		int gidlen;
+		GTM_TransactionHandle txn, prepared_txn;
+		bool detached = false;
+
+		gidlen = pq_getmsgint(message, sizeof (GTM_StrLen));
+		gid = (char *) palloc(gidlen + 1);
+		memcpy(gid, (char *)pq_getmsgbytes(message, gidlen), gidlen);
+		gid[gidlen] = '\0';
+
+		status[ii] = STATUS_ERROR;
+		gxid[ii] = InvalidGlobalTransactionId;
+		prepared_gxid[ii] = InvalidGlobalTransactionId;
+		attached[ii] = false;
+
+		prepared_txn = GTM_GIDToHandle(gid);
+		pfree(gid);
+		if (prepared_txn == InvalidTransactionHandle)
+			continue;
+
+		txn = GTM_BeginTransaction(txn_isolation_level, txn_read_only, NULL);
+		if (txn == InvalidTransactionHandle)
+			ereport(ERROR,
+				(EINVAL,
+				 errmsg("Failed to start a new transaction")));
+
+		gxid[ii] = GTM_GetGlobalTransactionId(txn);
+		if (gxid[ii] == InvalidGlobalTransactionId)
+			ereport(ERROR,
+					(EINVAL,
+					 errmsg("Failed to get a new transaction id")));
+
+		if (GTM_GetGIDData(prepared_txn, &prepared_gxid[ii], &detached,
+						   &nodestring) != STATUS_OK)
+		{
+			/* Nobody will finish with it */
+			GTM_RollbackTransaction(txn);
+			gxid[ii] = InvalidGlobalTransactionId;
+			continue;
+		}
+		if (nodestring)
+			pfree(nodestring);
+
+		status[ii] = STATUS_OK;
+		attached[ii] = !detached;
+
+		/* See ProcessGetGIDDataTransactionCommand */
+		if (GetMyThreadInfo->thr_conn->standby)
+		{
+			GTM_Conn *oldconn = GetMyThreadInfo->thr_conn->standby;
+			int count = 0;
+
+retry:
+			bkup_begin_transaction_gxid(GetMyThreadInfo->thr_conn->standby,
+					   gxid[ii],
+					   txn_isolation_level,
+					   false,
+					   NULL,
+					   -1,
+					   0);
+
+			if (gtm_standby_check_communication_error(&count, oldconn))
+				goto retry;
+		}
+	}
+
+	pq_getmsgend(message);
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendint(&buf, TXN_GET_GID_DATA_MULTI_RESULT, 4);
+	if (myport->remote_type == GTM_NODE_GTM_PROXY)
+	{
+		GTM_ProxyMsgHeader proxyhdr;
+		proxyhdr.ph_conid = myport->conn_id;
+		pq_sendbytes(&buf, (char *)&proxyhdr, sizeof (GTM_ProxyMsgHeader));
+	}
+
+	pq_sendint(&buf, txn_count, sizeof(int));
+	for (ii = 0; ii < txn_count; ii++)
+	{
+		pq_sendint(&buf, status[ii], sizeof(int));
+		pq_sendbytes(&buf, (char *)&gxid[ii], sizeof(GlobalTransactionId));
+		pq_sendbytes(&buf, (char *)&prepared_gxid[ii], sizeof(GlobalTransactionId));
+		pq_sendbyte(&buf, attached[ii]);
+	}
+	pq_endmessage(myport, &buf);
+
+	if (myport->remote_type != GTM_NODE_GTM_PROXY)
+		pq_flush(myport);
+}
 /*
  * Process MSG_TXN_GXID_LIST
  */
@@ -2643,6 +2848,7 @@ ProcessCommitTransactionCommandMulti(Port *myport, StringInfo message, bool is_b
 	int status[GTM_MAX_GLOBAL_TRANSACTIONS];
 	int txn_count;
 	int ii;
+	uint64 seqno;
 
 	txn_count = pq_getmsgint(message, sizeof (int));
 
@@ -2705,6 +2911,8 @@ ProcessCommitTransactionCommandMulti(Port *myport, StringInfo message, bool is_b
 		}
 		pq_sendbytes(&buf, (char *)&txn_count, sizeof(txn_count));
 		pq_sendbytes(&buf, (char *)status, sizeof(int) * txn_count);
+		seqno = GTM_GetCompletedSeqno();
+		pq_sendbytes(&buf, (char *)&seqno, sizeof(seqno));
 		pq_endmessage(myport, &buf);
 
 		if (myport->remote_type != GTM_NODE_GTM_PROXY)
@@ -3145,6 +3353,267 @@ ProcessReportXminCommand(Port *myport, StringInfo message, bool is_backup)
 		pq_endmessage(myport, &buf);
 		pq_flush(myport);
 	}
+
+	if (errcode == 0)
+		GTM_NotifyGlobalXmin(global_xmin);
+}
+
+/*
+ * Send the current GTM_GlobalXmin to a subscriber. Returns false if the
+ * connection is broken. Only called by the thread serving the connection.
+ */
+static bool
+SendXminNotification(GTM_XminSubscriber *sub)
+{
+	StringInfoData buf;
+	GlobalTransactionId global_xmin;
+	int errcode;
+
+	global_xmin = GTM_GetGlobalXmin(sub->type, sub->node_name, &errcode);
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendint(&buf, XMIN_NOTIFY_RESULT, 4);
+	pq_sendbytes(&buf, (char *)&GTMTransactions.gt_latestCompletedXid, sizeof (GlobalTransactionId));
+	pq_sendbytes(&buf, (char *)&global_xmin, sizeof (GlobalTransactionId));
+	pq_sendbytes(&buf, (char *)&errcode, sizeof (errcode));
+	pq_endmessage(sub->port, &buf);
+
+	return pq_flush(sub->port) == 0;
+}
+
+/*
+ * Process MSG_SUBSCRIBE_XMIN message
+ *
+ * Register the connection for GTM_GlobalXmin notifications. The current
+ * value is sent right away, which also tells the node the subscription is
+ * accepted.
+ */
+void
+ProcessSubscribeXminCommand(Port *myport, StringInfo message)
+{
+	GTM_ConnectionInfo *conn = GetMyThreadInfo->thr_conn;
+	GTM_StrLen nodelen;
+	GTM_XminSubscriber *sub;
+	MemoryContext oldContext;
+	int		i;
+
+	if (myport->remote_type == GTM_NODE_GTM_PROXY)
+		ereport(ERROR,
+				(EPROTO,
+				 errmsg("GlobalXmin notifications can not be proxied")));
+
+	oldContext = MemoryContextSwitchTo(TopMostMemoryContext);
+	sub = (GTM_XminSubscriber *) palloc0(sizeof (GTM_XminSubscriber));
+	MemoryContextSwitchTo(oldContext);
+
+	sub->port = myport;
+
+	/* Read Node Type */
+	sub->type = pq_getmsgint(message, sizeof (GTM_PGXCNodeType));
+
+	/* get node name */
+	nodelen = pq_getmsgint(message, sizeof (GTM_StrLen));
+	if (nodelen < 0 || nodelen >= NI_MAXHOST)
+		ereport(ERROR,
+				(EPROTO,
+				 errmsg("Invalid node name length %d", nodelen)));
+	memcpy(sub->node_name, (char *)pq_getmsgbytes(message, nodelen), nodelen);
+	sub->node_name[nodelen] = '\0';
+	pq_getmsgend(message);
+
+	if (conn->xmin_sub != NULL)
+	{
+		pfree(sub);
+		ereport(ERROR,
+				(EPROTO,
+				 errmsg("Connection already subscribed to GlobalXmin notifications")));
+	}
+
+	/* Neither end may block, a full pipe already means "wake up" */
+	if (pipe(sub->wakeup) < 0)
+	{
+		pfree(sub);
+		ereport(ERROR,
+				(errno,
+				 errmsg("Could not create GlobalXmin notification pipe: %m")));
+	}
+	for (i = 0; i < 2; i++)
+		fcntl(sub->wakeup[i], F_SETFL,
+			  fcntl(sub->wakeup[i], F_GETFL) | O_NONBLOCK);
+
+	if (!SendXminNotification(sub))
+	{
+		close(sub->wakeup[0]);
+		close(sub->wakeup[1]);
+		pfree(sub);
+		return;
+	}
+
+	conn->xmin_sub = sub;
+	GTM_MutexLockAcquire(&XminSubscribersLock);
+	XminSubscribers = gtm_lappend(XminSubscribers, sub);
+	GTM_MutexLockRelease(&XminSubscribersLock);
+
+	elog(DEBUG1, "node %s subscribed to GlobalXmin notifications",
+		 sub->node_name);
+}
+
+/*
+ * Wake up the threads serving the subscribed nodes if GTM_GlobalXmin has
+ * advanced since the last notification. Nothing is sent from here, and the
+ * writes to the pipes never block.
+ */
+static void
+GTM_NotifyGlobalXmin(GlobalTransactionId global_xmin)
+{
+	gtm_ListCell *cell;
+
+	if (!GlobalTransactionIdIsValid(global_xmin))
+		return;
+
+	GTM_MutexLockAcquire(&XminSubscribersLock);
+	if (GlobalTransactionIdIsValid(XminNotified) &&
+		!GlobalTransactionIdFollows(global_xmin, XminNotified))
+	{
+		GTM_MutexLockRelease(&XminSubscribersLock);
+		return;
+	}
+	XminNotified = global_xmin;
+
+	gtm_foreach(cell, XminSubscribers)
+	{
+		GTM_XminSubscriber *sub = (GTM_XminSubscriber *) gtm_lfirst(cell);
+		char		c = 0;
+
+		/* EAGAIN means the thread has not woken up for the previous one */
+		(void) write(sub->wakeup[1], &c, 1);
+	}
+	GTM_MutexLockRelease(&XminSubscribersLock);
+}
+
+/*
+ * Wait for the next command on a connection
+ *
+ * On a connection subscribed to GlobalXmin notifications, also wait for the
+ * wakeup pipe, and send the current GlobalXmin when it is written to. Returns
+ * when a command can be read, or the connection is closed.
+ */
+void
+GTM_WaitCommandOrXmin(GTM_ConnectionInfo *conn)
+{
+	GTM_XminSubscriber *sub = conn->xmin_sub;
+	Port	   *myport = conn->con_port;
+
+	if (sub == NULL)
+		return;
+
+	/* Commands already read from the socket come first */
+	while (myport->PqRecvPointer >= myport->PqRecvLength)
+	{
+		struct pollfd fds[2];
+
+		fds[0].fd = myport->sock;
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		fds[1].fd = sub->wakeup[0];
+		fds[1].events = POLLIN;
+		fds[1].revents = 0;
+
+		if (poll(fds, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+
+		if (fds[1].revents & POLLIN)
+		{
+			char		buf[64];
+
+			/* One notification covers all the wakeups so far */
+			while (read(sub->wakeup[0], buf, sizeof (buf)) > 0)
+				;
+
+			if (!SendXminNotification(sub))
+				return;
+		}
+
+		if (fds[0].revents != 0)
+			return;
+	}
+}
+
+/*
+ * Forget the subscription made on a connection which is being closed.
+ */
+void
+GTM_UnsubscribeGlobalXmin(GTM_ConnectionInfo *conn)
+{
+	GTM_XminSubscriber *sub = conn->xmin_sub;
+
+	if (sub == NULL)
+		return;
+
+	GTM_MutexLockAcquire(&XminSubscribersLock);
+	XminSubscribers = gtm_list_delete_ptr(XminSubscribers, sub);
+	GTM_MutexLockRelease(&XminSubscribersLock);
+
+	conn->xmin_sub = NULL;
+	close(sub->wakeup[0]);
+	close(sub->wakeup[1]);
+
+	elog(DEBUG1, "node %s unsubscribed from GlobalXmin notifications",
+		 sub->node_name);
+	pfree(sub);
+}
+
+/*
+ * Hand out a timestamp larger than any returned before
+ *
+ * Nodes running with timestamp based snapshots take one for each snapshot
+ * and one for each commit, so this is only a compare-and-swap on the last
+ * value: no lock and no lookup in the transaction array. The values follow
+ * the wall clock of GTM, bumped by one microsecond when it did not move.
+ */
+GTM_Timestamp
+GTM_GetTimestamp(void)
+{
+	uint64		last = pg_atomic_read_u64(&GTMLastTimestamp);
+	GTM_Timestamp now = GTM_TimestampGetCurrent();
+	GTM_Timestamp result;
+
+	do
+	{
+		result = Max(now, (GTM_Timestamp) last + 1);
+	} while (!pg_atomic_compare_exchange_u64(&GTMLastTimestamp, &last,
+											 (uint64) result));
+
+	return result;
+}
+
+void
+ProcessGetTimestampCommand(Port *myport, StringInfo message)
+{
+	StringInfoData buf;
+	GTM_Timestamp timestamp;
+
+	pq_getmsgend(message);
+
+	timestamp = GTM_GetTimestamp();
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendint(&buf, GET_TIMESTAMP_RESULT, 4);
+	if (myport->remote_type == GTM_NODE_GTM_PROXY)
+	{
+		GTM_ProxyMsgHeader proxyhdr;
+		proxyhdr.ph_conid = myport->conn_id;
+		pq_sendbytes(&buf, (char *)&proxyhdr, sizeof (GTM_ProxyMsgHeader));
+	}
+	pq_sendbytes(&buf, (char *)&timestamp, sizeof (GTM_Timestamp));
+	pq_endmessage(myport, &buf);
+
+	if (myport->remote_type != GTM_NODE_GTM_PROXY)
+		pq_flush(myport);
 }
 
 /*
@@ -3159,12 +3628,6 @@ GTM_SetShuttingDown(void)
 	GTM_RWLockRelease(&GTMTransactions.gt_XidGenLock);
 }
 
-static
-bool GTM_NeedXidRestoreUpdate(void)
-{
-	return(GlobalTransactionIdPrecedesOrEquals(GTMTransactions.gt_backedUpXid, GTMTransactions.gt_nextXid));
-}
-
 /*
  * GTM_RememberCreatedSequence
  *		Remember a sequence created by a given transaction (GXID).
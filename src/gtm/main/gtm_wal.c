@@ -0,0 +1,699 @@
+/*-------------------------------------------------------------------------
+ *
+ * gtm_wal.c
+ *		Write-ahead log of GTM state changes
+ *
+ * The GXID counter and the sequence values change with nearly every request
+ * GTM serves.  Rather than rewriting the control file on these changes, each
+ * of them is appended to the WAL as a small record carrying the new value,
+ * and the control file is only rewritten by a checkpoint.  The WAL is made
+ * durable before the new GXID or sequence value is handed out, so after a
+ * crash replaying the records past the last checkpoint restores exactly the
+ * state the clients have seen.
+ *
+ * Records are appended to an in-memory buffer by the threads changing the
+ * state, under the locks protecting that state, so that they appear in the
+ * WAL in the order of the changes.  A thread about to reply calls
+ * GTM_WalSync(), which waits for its last record to be written and fsync'ed.
+ * The first waiter to find nobody flushing writes out everything appended so
+ * far and the threads which appended meanwhile are released by the same
+ * fsync, so concurrent requests share the fsyncs.
+ *
+ * The WAL is split into segment files named after the LSN of their first
+ * record.  A checkpoint switches to a new segment, writes the control file
+ * and then removes the segments before it.  Positions in the WAL (LSNs) are
+ * byte offsets in the stream of records, segment headers excluded.
+ *
+ * Portions Copyright (c) 2012-2014, TransLattice, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *		src/gtm/main/gtm_wal.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "gtm/gtm_wal.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "gtm/elog.h"
+#include "gtm/gtm.h"
+#include "gtm/gtm_lock.h"
+#include "gtm/gtm_seq.h"
+#include "gtm/gtm_txn.h"
+#include "gtm/memutils.h"
+#include "port/pg_crc32c.h"
+
+#define GTM_WAL_SEGMENT_PREFIX	"gtm_wal."
+#define GTM_WAL_MAGIC			0x47574C31	/* "GWL1" */
+
+/* Record types */
+#define GTM_WAL_NEXT_XID		1
+#define GTM_WAL_SEQ_VALUE		2
+#define GTM_WAL_SEQ_ADVANCE		3	/* value may only move forward */
+
+/* Records never get anywhere near this, anything longer is garbage */
+#define GTM_WAL_MAX_RECORD		(64 * 1024)
+
+typedef struct GTM_WalSegmentHeader
+{
+	uint32			wsh_magic;
+	uint32			wsh_pad;
+	GTM_WalLSN		wsh_start_lsn;
+} GTM_WalSegmentHeader;
+
+typedef struct GTM_WalRecord
+{
+	uint32			wr_len;			/* total length, header included */
+	uint32			wr_type;
+	pg_crc32c		wr_crc;			/* of the payload and the fields above */
+} GTM_WalRecord;
+
+typedef struct GTM_WalSeqValue
+{
+	GTM_Sequence	ws_value;
+	uint32			ws_called;
+	uint32			ws_keylen;
+	/* sequence key follows */
+} GTM_WalSeqValue;
+
+typedef struct GTM_WalData
+{
+	GTM_MutexLock	wal_lock;
+	GTM_CV			wal_flush_cv;	/* flush LSN has advanced */
+	char		   *wal_buffer;		/* records appended since last write */
+	Size			wal_buflen;
+	Size			wal_bufsize;
+	char		   *wal_spare;		/* buffer not in use by the flusher */
+	Size			wal_sparesize;
+	int				wal_fd;			/* current segment */
+	GTM_WalLSN		wal_seg_start;	/* LSN the current segment starts at */
+	GTM_WalLSN		wal_insert_lsn;	/* end of the last record appended */
+	GTM_WalLSN		wal_flush_lsn;	/* end of the data fsync'ed */
+	GTM_WalLSN		wal_redo_lsn;	/* start of WAL needed by the recovery */
+	bool			wal_flushing;	/* somebody is writing out the buffer */
+	bool			wal_ckpt_requested;
+} GTM_WalData;
+
+static GTM_WalData GTMWal;
+
+extern char *GTMDataDir;
+
+static void GTM_WalInsert(uint32 type, const char *payload, Size len);
+static void GTM_WalLogSeq(uint32 type, GTM_SequenceKey seqkey,
+			  GTM_Sequence value, bool called);
+static void GTM_WalWrite(int fd, const char *data, Size len);
+static void GTM_WalOpenSegment(GTM_WalLSN start_lsn);
+static void GTM_WalRemoveSegments(GTM_WalLSN redo_lsn);
+static int GTM_WalListSegments(GTM_WalLSN **segments);
+static GTM_WalLSN GTM_WalReplaySegment(GTM_WalLSN seg_start, GTM_WalLSN redo_lsn);
+static void GTM_WalRedo(GTM_WalRecord *record, char *payload);
+static void GTM_WalSegmentPath(char *path, GTM_WalLSN start_lsn);
+static void GTM_WalSyncDataDir(void);
+
+void
+GTM_WalInit(void)
+{
+	GTM_MutexLockInit(&GTMWal.wal_lock);
+	GTM_CVInit(&GTMWal.wal_flush_cv);
+	GTMWal.wal_fd = -1;
+	GTMWal.wal_ckpt_requested = false;
+}
+
+/*
+ * Replay the WAL records following the last checkpoint and return the end of
+ * the valid WAL.
+ *
+ * Records before redo_lsn are already reflected in the control file and are
+ * skipped.  Pass InvalidGTMWalLSN if the state has not been read from a
+ * control file pointing to the WAL, so that nothing is replayed.
+ */
+GTM_WalLSN
+GTM_WalReplay(GTM_WalLSN redo_lsn)
+{
+	GTM_WalLSN *segments;
+	GTM_WalLSN	end_lsn = 0;
+	int			nsegments;
+	int			i;
+
+	nsegments = GTM_WalListSegments(&segments);
+
+	for (i = 0; i < nsegments; i++)
+	{
+		GTM_WalLSN	seg_end;
+
+		/*
+		 * A segment starting past the end of the previous one means a part of
+		 * the WAL is missing.  The records following the hole can not be
+		 * applied, the state they were based on is unknown.
+		 */
+		if (redo_lsn != InvalidGTMWalLSN && i > 0 &&
+			segments[i] > end_lsn && end_lsn > redo_lsn)
+			elog(FATAL, "GTM WAL segment starting at %X/%X is missing, "
+				 "found segment starting at %X/%X",
+				 (uint32) (end_lsn >> 32), (uint32) end_lsn,
+				 (uint32) (segments[i] >> 32), (uint32) segments[i]);
+
+		seg_end = GTM_WalReplaySegment(segments[i], redo_lsn);
+		if (seg_end > end_lsn)
+			end_lsn = seg_end;
+	}
+
+	if (redo_lsn != InvalidGTMWalLSN && redo_lsn > end_lsn)
+		end_lsn = redo_lsn;
+
+	if (redo_lsn != InvalidGTMWalLSN)
+		elog(LOG, "GTM WAL replayed from %X/%X to %X/%X",
+			 (uint32) (redo_lsn >> 32), (uint32) redo_lsn,
+			 (uint32) (end_lsn >> 32), (uint32) end_lsn);
+
+	if (segments)
+		free(segments);
+
+	return end_lsn;
+}
+
+/*
+ * Start appending the WAL at end_lsn.  The startup checkpoint then removes
+ * all the segments replayed.
+ */
+void
+GTM_WalStartup(GTM_WalLSN end_lsn)
+{
+	GTM_MutexLockAcquire(&GTMWal.wal_lock);
+
+	GTM_WalOpenSegment(end_lsn);
+	GTMWal.wal_insert_lsn = GTMWal.wal_flush_lsn = end_lsn;
+	GTMWal.wal_redo_lsn = end_lsn;
+
+	GTM_MutexLockRelease(&GTMWal.wal_lock);
+}
+
+/*
+ * Log the next GXID to be assigned.  Called with gt_XidGenLock held.
+ */
+void
+GTM_WalLogNextXid(GlobalTransactionId next_xid)
+{
+	GTM_WalInsert(GTM_WAL_NEXT_XID, (char *) &next_xid, sizeof (next_xid));
+}
+
+/*
+ * Log the new value of a sequence.  Called with the sequence lock held.
+ */
+void
+GTM_WalLogSeqValue(GTM_SequenceKey seqkey, GTM_Sequence value, bool called)
+{
+	GTM_WalLogSeq(GTM_WAL_SEQ_VALUE, seqkey, value, called);
+}
+
+/*
+ * Log a value handed out by the nextval fast path.  Called with the sequence
+ * lock held in read mode, so records of concurrent calls may be logged in any
+ * order.
+ */
+void
+GTM_WalLogSeqAdvance(GTM_SequenceKey seqkey, GTM_Sequence value)
+{
+	GTM_WalLogSeq(GTM_WAL_SEQ_ADVANCE, seqkey, value, true);
+}
+
+static void
+GTM_WalLogSeq(uint32 type, GTM_SequenceKey seqkey, GTM_Sequence value,
+			  bool called)
+{
+	Size		len = sizeof (GTM_WalSeqValue) + seqkey->gsk_keylen;
+	char	   *payload = (char *) palloc(len);
+	GTM_WalSeqValue *rec = (GTM_WalSeqValue *) payload;
+
+	rec->ws_value = value;
+	rec->ws_called = called ? 1 : 0;
+	rec->ws_keylen = seqkey->gsk_keylen;
+	memcpy(payload + sizeof (GTM_WalSeqValue), seqkey->gsk_key,
+		   seqkey->gsk_keylen);
+
+	GTM_WalInsert(type, payload, len);
+
+	pfree(payload);
+}
+
+/*
+ * Append a record to the WAL buffer.  The record is written out by the next
+ * flush, the calling thread remembers its end to wait for it in GTM_WalSync.
+ */
+static void
+GTM_WalInsert(uint32 type, const char *payload, Size len)
+{
+	GTM_WalRecord record;
+	Size		total = sizeof (GTM_WalRecord) + len;
+
+	/* Not started yet, nothing changes before the startup checkpoint */
+	if (GTMWal.wal_fd < 0)
+		return;
+
+	memset(&record, 0, sizeof (record));
+	record.wr_len = total;
+	record.wr_type = type;
+	INIT_CRC32C(record.wr_crc);
+	COMP_CRC32C(record.wr_crc, payload, len);
+	COMP_CRC32C(record.wr_crc, (char *) &record, offsetof(GTM_WalRecord, wr_crc));
+	FIN_CRC32C(record.wr_crc);
+
+	GTM_MutexLockAcquire(&GTMWal.wal_lock);
+
+	if (GTMWal.wal_buflen + total > GTMWal.wal_bufsize)
+	{
+		Size		newsize = Max(GTMWal.wal_bufsize * 2, 8192);
+		char	   *newbuf;
+
+		while (newsize < GTMWal.wal_buflen + total)
+			newsize *= 2;
+		newbuf = realloc(GTMWal.wal_buffer, newsize);
+		if (newbuf == NULL)
+		{
+			GTM_MutexLockRelease(&GTMWal.wal_lock);
+			ereport(ERROR, (ENOMEM, errmsg("Out of memory")));
+		}
+		GTMWal.wal_buffer = newbuf;
+		GTMWal.wal_bufsize = newsize;
+	}
+
+	memcpy(GTMWal.wal_buffer + GTMWal.wal_buflen, &record, sizeof (record));
+	memcpy(GTMWal.wal_buffer + GTMWal.wal_buflen + sizeof (record), payload, len);
+	GTMWal.wal_buflen += total;
+	GTMWal.wal_insert_lsn += total;
+
+	GetMyThreadInfo->thr_wal_lsn = GTMWal.wal_insert_lsn;
+
+	GTM_MutexLockRelease(&GTMWal.wal_lock);
+}
+
+/*
+ * Wait until the records appended by this thread are durable.
+ */
+void
+GTM_WalSync(void)
+{
+	GTM_WalLSN	lsn = GetMyThreadInfo->thr_wal_lsn;
+
+	GTM_MutexLockAcquire(&GTMWal.wal_lock);
+
+	while (GTMWal.wal_flush_lsn < lsn)
+	{
+		char	   *data;
+		Size		len;
+		Size		size;
+		GTM_WalLSN	end_lsn;
+		int			fd;
+
+		if (GTMWal.wal_flushing)
+		{
+			GTM_CVWait(&GTMWal.wal_flush_cv, &GTMWal.wal_lock);
+			continue;
+		}
+
+		/*
+		 * Take over everything appended so far and let the others append to
+		 * the spare buffer while we write.
+		 */
+		data = GTMWal.wal_buffer;
+		len = GTMWal.wal_buflen;
+		size = GTMWal.wal_bufsize;
+		end_lsn = GTMWal.wal_insert_lsn;
+		fd = GTMWal.wal_fd;
+
+		GTMWal.wal_buffer = GTMWal.wal_spare;
+		GTMWal.wal_bufsize = GTMWal.wal_sparesize;
+		GTMWal.wal_buflen = 0;
+		GTMWal.wal_spare = NULL;
+		GTMWal.wal_sparesize = 0;
+		GTMWal.wal_flushing = true;
+
+		GTM_MutexLockRelease(&GTMWal.wal_lock);
+
+		GTM_WalWrite(fd, data, len);
+		if (fsync(fd) != 0)
+			elog(PANIC, "could not fsync GTM WAL: %s", strerror(errno));
+
+		GTM_MutexLockAcquire(&GTMWal.wal_lock);
+
+		GTMWal.wal_spare = data;
+		GTMWal.wal_sparesize = size;
+		GTMWal.wal_flush_lsn = end_lsn;
+		GTMWal.wal_flushing = false;
+		GTM_CVBcast(&GTMWal.wal_flush_cv);
+	}
+
+	GTM_MutexLockRelease(&GTMWal.wal_lock);
+}
+
+/*
+ * Has enough WAL been written since the last checkpoint to take another one?
+ * Returns true to only one caller, which is expected to run the checkpoint.
+ */
+bool
+GTM_WalNeedCheckpoint(void)
+{
+	bool		request = false;
+
+	/*
+	 * Unlocked check first, this is done after every command.  A stale value
+	 * only delays the checkpoint until the next command.
+	 */
+	if (GTMWal.wal_ckpt_requested ||
+		GTMWal.wal_insert_lsn - GTMWal.wal_redo_lsn < GTM_WAL_CHECKPOINT_SIZE)
+		return false;
+
+	GTM_MutexLockAcquire(&GTMWal.wal_lock);
+	if (!GTMWal.wal_ckpt_requested &&
+		GTMWal.wal_insert_lsn - GTMWal.wal_redo_lsn >= GTM_WAL_CHECKPOINT_SIZE)
+		request = GTMWal.wal_ckpt_requested = true;
+	GTM_MutexLockRelease(&GTMWal.wal_lock);
+
+	return request;
+}
+
+/*
+ * Start a checkpoint: make all the WAL appended so far durable and switch to
+ * a new segment.  Returns the LSN the replay has to start from once the
+ * control file written by the checkpoint is in place.
+ *
+ * Every change logged before the returned LSN has been applied to the
+ * in-memory state, so the control file written next reflects it.  Changes
+ * logged after it may or may not be reflected, replaying them is harmless as
+ * the records carry the new values rather than increments.
+ */
+GTM_WalLSN
+GTM_WalStartCheckpoint(void)
+{
+	GTM_WalLSN	redo_lsn;
+
+	GTM_MutexLockAcquire(&GTMWal.wal_lock);
+
+	while (GTMWal.wal_flushing)
+		GTM_CVWait(&GTMWal.wal_flush_cv, &GTMWal.wal_lock);
+
+	/* Nothing appended since the segment was opened, keep using it */
+	if (GTMWal.wal_fd >= 0 && GTMWal.wal_insert_lsn != GTMWal.wal_seg_start)
+	{
+		GTM_WalWrite(GTMWal.wal_fd, GTMWal.wal_buffer, GTMWal.wal_buflen);
+		if (fsync(GTMWal.wal_fd) != 0)
+			elog(PANIC, "could not fsync GTM WAL: %s", strerror(errno));
+		close(GTMWal.wal_fd);
+
+		GTMWal.wal_buflen = 0;
+		GTMWal.wal_flush_lsn = GTMWal.wal_insert_lsn;
+		GTM_CVBcast(&GTMWal.wal_flush_cv);
+
+		GTM_WalOpenSegment(GTMWal.wal_insert_lsn);
+	}
+	redo_lsn = GTMWal.wal_insert_lsn;
+
+	GTM_MutexLockRelease(&GTMWal.wal_lock);
+
+	return redo_lsn;
+}
+
+/*
+ * Finish a checkpoint once the control file pointing to redo_lsn has been
+ * made durable: the segments before it are not needed anymore.
+ */
+void
+GTM_WalEndCheckpoint(GTM_WalLSN redo_lsn)
+{
+	GTM_MutexLockAcquire(&GTMWal.wal_lock);
+	GTMWal.wal_redo_lsn = redo_lsn;
+	GTMWal.wal_ckpt_requested = false;
+	GTM_MutexLockRelease(&GTMWal.wal_lock);
+
+	GTM_WalRemoveSegments(redo_lsn);
+}
+
+static void
+GTM_WalWrite(int fd, const char *data, Size len)
+{
+	while (len > 0)
+	{
+		ssize_t		written = write(fd, data, len);
+
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			elog(PANIC, "could not write GTM WAL: %s", strerror(errno));
+		}
+		data += written;
+		len -= written;
+	}
+}
+
+/*
+ * Create the segment starting at start_lsn and make it the current one.
+ * Called with the WAL lock held.
+ */
+static void
+GTM_WalOpenSegment(GTM_WalLSN start_lsn)
+{
+	char		path[MAXPGPATH];
+	GTM_WalSegmentHeader header;
+
+	GTM_WalSegmentPath(path, start_lsn);
+
+	GTMWal.wal_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (GTMWal.wal_fd < 0)
+		elog(PANIC, "could not create GTM WAL segment \"%s\": %s",
+			 path, strerror(errno));
+
+	memset(&header, 0, sizeof (header));
+	header.wsh_magic = GTM_WAL_MAGIC;
+	header.wsh_start_lsn = start_lsn;
+	GTM_WalWrite(GTMWal.wal_fd, (char *) &header, sizeof (header));
+	if (fsync(GTMWal.wal_fd) != 0)
+		elog(PANIC, "could not fsync GTM WAL segment \"%s\": %s",
+			 path, strerror(errno));
+	GTM_WalSyncDataDir();
+
+	GTMWal.wal_seg_start = start_lsn;
+}
+
+static void
+GTM_WalRemoveSegments(GTM_WalLSN redo_lsn)
+{
+	GTM_WalLSN *segments;
+	int			nsegments;
+	int			i;
+
+	nsegments = GTM_WalListSegments(&segments);
+	for (i = 0; i < nsegments; i++)
+	{
+		char		path[MAXPGPATH];
+
+		if (segments[i] >= redo_lsn)
+			continue;
+		GTM_WalSegmentPath(path, segments[i]);
+		if (unlink(path) != 0)
+			elog(LOG, "could not remove GTM WAL segment \"%s\": %s",
+				 path, strerror(errno));
+	}
+
+	if (segments)
+		free(segments);
+}
+
+static int
+segment_cmp(const void *a, const void *b)
+{
+	GTM_WalLSN	lsn1 = *(const GTM_WalLSN *) a;
+	GTM_WalLSN	lsn2 = *(const GTM_WalLSN *) b;
+
+	return (lsn1 > lsn2) - (lsn1 < lsn2);
+}
+
+/*
+ * Return the start LSNs of the existing WAL segments, in ascending order.
+ */
+static int
+GTM_WalListSegments(GTM_WalLSN **segments)
+{
+	DIR		   *dir;
+	struct dirent *de;
+	int			nsegments = 0;
+	int			maxsegments = 16;
+	Size		prefixlen = strlen(GTM_WAL_SEGMENT_PREFIX);
+
+	*segments = (GTM_WalLSN *) malloc(maxsegments * sizeof (GTM_WalLSN));
+	if (*segments == NULL)
+		ereport(ERROR, (ENOMEM, errmsg("Out of memory")));
+
+	dir = opendir(GTMDataDir);
+	if (dir == NULL)
+		elog(FATAL, "could not open GTM data directory \"%s\": %s",
+			 GTMDataDir, strerror(errno));
+
+	while ((de = readdir(dir)) != NULL)
+	{
+		uint32		hi;
+		uint32		lo;
+
+		if (strncmp(de->d_name, GTM_WAL_SEGMENT_PREFIX, prefixlen) != 0 ||
+			strlen(de->d_name) != prefixlen + 16 ||
+			strspn(de->d_name + prefixlen, "0123456789ABCDEF") != 16 ||
+			sscanf(de->d_name + prefixlen, "%08X%08X", &hi, &lo) != 2)
+			continue;
+
+		if (nsegments == maxsegments)
+		{
+			GTM_WalLSN *newsegs;
+
+			maxsegments *= 2;
+			newsegs = realloc(*segments, maxsegments * sizeof (GTM_WalLSN));
+			if (newsegs == NULL)
+			{
+				closedir(dir);
+				ereport(ERROR, (ENOMEM, errmsg("Out of memory")));
+			}
+			*segments = newsegs;
+		}
+		(*segments)[nsegments++] = ((GTM_WalLSN) hi << 32) | lo;
+	}
+	closedir(dir);
+
+	qsort(*segments, nsegments, sizeof (GTM_WalLSN), segment_cmp);
+
+	return nsegments;
+}
+
+/*
+ * Read the segment starting at seg_start, applying the records at or after
+ * redo_lsn.  Returns the end of the valid records in the segment.
+ *
+ * Reading stops at the first record failing the checks, which is normally
+ * the one being written when GTM went down.
+ */
+static GTM_WalLSN
+GTM_WalReplaySegment(GTM_WalLSN seg_start, GTM_WalLSN redo_lsn)
+{
+	char		path[MAXPGPATH];
+	FILE	   *f;
+	GTM_WalSegmentHeader header;
+	GTM_WalLSN	lsn = seg_start;
+	char	   *payload;
+	int			nrecords = 0;
+
+	GTM_WalSegmentPath(path, seg_start);
+
+	f = fopen(path, "r");
+	if (f == NULL)
+		elog(FATAL, "could not open GTM WAL segment \"%s\": %s",
+			 path, strerror(errno));
+
+	if (fread(&header, sizeof (header), 1, f) != 1 ||
+		header.wsh_magic != GTM_WAL_MAGIC ||
+		header.wsh_start_lsn != seg_start)
+	{
+		elog(LOG, "skipping GTM WAL segment \"%s\" with invalid header", path);
+		fclose(f);
+		return seg_start;
+	}
+
+	payload = (char *) malloc(GTM_WAL_MAX_RECORD);
+	if (payload == NULL)
+		ereport(ERROR, (ENOMEM, errmsg("Out of memory")));
+
+	for (;;)
+	{
+		GTM_WalRecord record;
+		Size		len;
+		pg_crc32c	crc;
+
+		if (fread(&record, sizeof (record), 1, f) != 1)
+			break;
+		if (record.wr_len < sizeof (record) || record.wr_len > GTM_WAL_MAX_RECORD)
+			break;
+		len = record.wr_len - sizeof (record);
+		if (len > 0 && fread(payload, len, 1, f) != 1)
+			break;
+
+		INIT_CRC32C(crc);
+		COMP_CRC32C(crc, payload, len);
+		COMP_CRC32C(crc, (char *) &record, offsetof(GTM_WalRecord, wr_crc));
+		FIN_CRC32C(crc);
+		if (!EQ_CRC32C(crc, record.wr_crc))
+			break;
+
+		if (redo_lsn != InvalidGTMWalLSN && lsn >= redo_lsn)
+		{
+			GTM_WalRedo(&record, payload);
+			nrecords++;
+		}
+		lsn += record.wr_len;
+	}
+
+	free(payload);
+	fclose(f);
+
+	elog(DEBUG1, "replayed %d records from GTM WAL segment \"%s\"", nrecords, path);
+
+	return lsn;
+}
+
+static void
+GTM_WalRedo(GTM_WalRecord *record, char *payload)
+{
+	switch (record->wr_type)
+	{
+		case GTM_WAL_NEXT_XID:
+			{
+				GlobalTransactionId next_xid;
+
+				memcpy(&next_xid, payload, sizeof (next_xid));
+				GTM_RedoNextGlobalTransactionId(next_xid);
+				break;
+			}
+
+		case GTM_WAL_SEQ_VALUE:
+		case GTM_WAL_SEQ_ADVANCE:
+			{
+				GTM_WalSeqValue rec;
+				GTM_SequenceKeyData seqkey;
+
+				memcpy(&rec, payload, sizeof (rec));
+				seqkey.gsk_keylen = rec.ws_keylen;
+				seqkey.gsk_key = payload + sizeof (rec);
+				seqkey.gsk_type = GTM_SEQ_FULL_NAME;
+				if (record->wr_type == GTM_WAL_SEQ_ADVANCE)
+					GTM_SeqRedoAdvance(&seqkey, rec.ws_value);
+				else
+					GTM_SeqRedoValue(&seqkey, rec.ws_value, rec.ws_called != 0);
+				break;
+			}
+
+		default:
+			elog(FATAL, "unexpected GTM WAL record type %u", record->wr_type);
+	}
+}
+
+static void
+GTM_WalSegmentPath(char *path, GTM_WalLSN start_lsn)
+{
+	snprintf(path, MAXPGPATH, "%s/%s%08X%08X", GTMDataDir,
+			 GTM_WAL_SEGMENT_PREFIX,
+			 (uint32) (start_lsn >> 32), (uint32) start_lsn);
+}
+
+/*
+ * Make the creation of a segment durable.
+ */
+static void
+GTM_WalSyncDataDir(void)
+{
+	int			fd = open(GTMDataDir, O_RDONLY);
+
+	if (fd < 0)
+		return;
+	(void) fsync(fd);
+	close(fd);
+}
@@ -48,6 +48,7 @@
 #include "gtm/gtm_opt.h"
 #include "gtm/gtm_utils.h"
 #include "gtm/gtm_backup.h"
+#include "gtm/gtm_wal.h"
 
 extern int	optind;
 extern char *optarg;
@@ -135,10 +136,9 @@ MainThreadInit()
 	pthread_key_create(&threadinfo_key, NULL);
 
 	/*
-	 * Initialize the lock protecting the global threads info and backup lock info.
+	 * Initialize the lock protecting the global threads info.
 	 */
 	GTM_RWLockInit(&GTMThreads->gt_lock);
-	GTM_RWLockInit(&gtm_bkup_lock);
 
 	/*
 	 * Set the next client identifier to be issued after connection
@@ -230,6 +230,7 @@ BaseInit()
 
 	DebugFileOpen();
 
+	GTM_WalInit();
 	GTM_InitTxnManager();
 	GTM_InitSeqManager();
 	GTM_InitNodeManager();
@@ -315,6 +316,7 @@ void
 SaveControlInfo(void)
 {
 	FILE	   *ctlf;
+	GTM_WalLSN	redo_lsn;
 
 	GTM_MutexLockAcquire(&control_lock);
 
@@ -323,19 +325,36 @@ SaveControlInfo(void)
 	if (ctlf == NULL)
 	{
 		fprintf(stderr, "Failed to create/open the control file\n");
-		fclose(ctlf);
 		GTM_MutexLockRelease(&control_lock);
 		return;
 	}
 
+	/*
+	 * This is a checkpoint: the WAL written before redo_lsn is reflected in
+	 * the state saved below and is not needed anymore once the control file
+	 * is in place.
+	 */
+	redo_lsn = GTM_WalStartCheckpoint();
+
 	GTM_SaveVersion(ctlf);
+	fprintf(ctlf, "wal_redo: " UINT64_FORMAT "\n", redo_lsn);
 	GTM_SaveTxnInfo(ctlf);
 	GTM_SaveSeqInfo(ctlf);
+
+	if (fflush(ctlf) != 0 || fsync(fileno(ctlf)) != 0)
+	{
+		elog(LOG, "could not write the control file: %s", strerror(errno));
+		fclose(ctlf);
+		GTM_MutexLockRelease(&control_lock);
+		return;
+	}
 	fclose(ctlf);
 
 	remove(GTMControlFile);
 	rename(GTMControlFileTmp, GTMControlFile);
 
+	GTM_WalEndCheckpoint(redo_lsn);
+
 	GTM_MutexLockRelease(&control_lock);
 }
 
@@ -348,6 +367,7 @@ main(int argc, char *argv[])
 	GlobalTransactionId next_gxid = InvalidGlobalTransactionId;
 	FILE	   *ctlf;
 	bool		force_xid = false;
+	GTM_WalLSN	wal_end = InvalidGTMWalLSN;
 
 	/*
 	 * Local variable to hold command line options.
@@ -655,6 +675,9 @@ main(int argc, char *argv[])
 			exit(1);
 		}
 		elog(LOG, "Restoring sequences from the active-GTM succeeded.");
+
+		/* Nothing to replay, just find the end of the WAL */
+		wal_end = GTM_WalReplay(InvalidGTMWalLSN);
 	}
 	else
 	{
@@ -712,11 +735,17 @@ main(int argc, char *argv[])
 			fclose(ctlf);
 
 		GTM_MutexLockRelease(&control_lock);
+
+		/* Bring the state up to date with the changes logged since */
+		wal_end = GTM_WalReplay(restoreContext.wal_redo);
 	}
 
-	/* Backup the restore point */
-	GTM_SetNeedBackup();
-	GTM_WriteRestorePoint();
+	/*
+	 * Start the WAL after whatever is left of the previous one, and take a
+	 * checkpoint so that the WAL replayed is not needed anymore.
+	 */
+	GTM_WalStartup(wal_end);
+	SaveControlInfo();
 
 	if (Recovery_IsStandby())
 	{
@@ -831,6 +860,9 @@ main(int argc, char *argv[])
 		elog(DEBUG1, "Startup connection with the active-GTM closed.");
 	}
 
+	/* Start shipping the backup messages to the standby */
+	GTM_StandbyLogStart();
+
 	/*
 	 * Accept any new connections. Fork a new thread for each incoming
 	 * connection
@@ -1004,7 +1036,7 @@ ServerLoop(void)
 					{
 						GTM_Conn *standby = NULL;
 
-						standby = gtm_standby_connect_to_standby();
+						standby = GTM_StandbyLogOpen();
 
 
 						if (GTMAddConnection(port, standby) != STATUS_OK)
@@ -1221,6 +1253,10 @@ GTM_ThreadMain(void *argp)
 		 * operation.
 		 */
 		GTM_RWLockRelease(&thrinfo->thr_lock);
+
+		/* Send GlobalXmin notifications meanwhile, on a subscribed connection */
+		GTM_WaitCommandOrXmin(thrinfo->thr_conn);
+
 		/*
 		 * (3) read a command (loop blocks here)
 		 */
@@ -1242,7 +1278,7 @@ GTM_ThreadMain(void *argp)
 				thrinfo->thr_status != GTM_THREAD_BACKUP)
 		{
 			/* Connect to GTM-Standby */
-			thrinfo->thr_conn->standby = gtm_standby_connect_to_standby();
+			thrinfo->thr_conn->standby = GTM_StandbyLogOpen();
 			if (thrinfo->thr_conn->standby == NULL)
 				GTMThreads->gt_standby_ready = false;	/* This will make other threads to disconnect from
 														 * the standby, if needed.*/
@@ -1393,6 +1429,9 @@ ProcessCommand(Port *myport, StringInfo input_message)
 #ifdef XCP
 		case MSG_REPORT_XMIN:
 		case MSG_BKUP_REPORT_XMIN:
+		case MSG_SUBSCRIBE_XMIN:
+		case MSG_GET_TIMESTAMP:
+		case MSG_TXN_GET_GID_DATA_MULTI:
 #endif
 			ProcessTransactionCommand(myport, mtype, input_message);
 			break;
@@ -1446,8 +1485,9 @@ ProcessCommand(Port *myport, StringInfo input_message)
 					 errmsg("invalid frontend message type %d",
 							mtype)));
 	}
-	if (GTM_NeedBackup())
-		GTM_WriteRestorePoint();
+
+	if (GTM_WalNeedCheckpoint())
+		SaveControlInfo();
 }
 
 static int
@@ -1555,6 +1595,12 @@ ProcessSyncStandbyCommand(Port *myport, GTM_MessageType mtype, StringInfo messag
 
 	pq_getmsgend(message);
 
+	/*
+	 * When we are the standby, the backup messages processed so far become
+	 * durable before the active GTM is told so.
+	 */
+	GTM_WalSync();
+
 	pq_beginmessage(&buf, 'S');
 	pq_sendint(&buf, SYNC_STANDBY_RESULT, 4);
 	pq_endmessage(myport, &buf);
@@ -1732,6 +1778,18 @@ ProcessTransactionCommand(Port *myport, GTM_MessageType mtype, StringInfo messag
 		case MSG_BKUP_REPORT_XMIN:
 			ProcessReportXminCommand(myport, message, true);
 			break;
+
+		case MSG_SUBSCRIBE_XMIN:
+			ProcessSubscribeXminCommand(myport, message);
+			break;
+
+		case MSG_GET_TIMESTAMP:
+			ProcessGetTimestampCommand(myport, message);
+			break;
+
+		case MSG_TXN_GET_GID_DATA_MULTI:
+			ProcessGetGIDDataTransactionCommandMulti(myport, message);
+			break;
 			
 		default:
 			Assert(0);			/* Shouldn't come here.. keep compiler quite */
@@ -2239,8 +2297,7 @@ PromoteToActive(void)
 					 errmsg("could not close GTM configuration file \"%s\": %m",
 							conf_file)));
 	}
-	GTM_SetNeedBackup();
-	GTM_WriteRestorePoint();
+	SaveControlInfo();
 	return;
 }
 
@@ -2303,6 +2360,8 @@ GTM_RestoreStart(FILE *ctlf, struct GTM_RestoreContext *context)
 
 	Assert(ctlf);
 
+	context->wal_redo = InvalidGTMWalLSN;
+
 	if (fscanf(ctlf, "version: %d\n", &version) == 1)
 	{
 		elog(LOG, "Read control file version %d", version);
@@ -2313,6 +2372,14 @@ GTM_RestoreStart(FILE *ctlf, struct GTM_RestoreContext *context)
 		elog(LOG, "Failed to read file version");
 		context->version = -1;
 	}
+
+	/*
+	 * Control files written by a checkpoint point to the WAL, barrier backups
+	 * don't and are restored as the older versions.
+	 */
+	if (context->version >= 20261019 &&
+		fscanf(ctlf, "wal_redo: " UINT64_FORMAT "\n", &context->wal_redo) != 1)
+		context->wal_redo = InvalidGTMWalLSN;
 }
 
 void
@@ -2325,11 +2392,11 @@ GTM_RestoreTxnInfo(FILE *ctlf, GlobalTransactionId next_gxid,
 	if (ctlf)
 	{
 		/*
-		 * If the control file version is 20160302, then we expect to see
-		 * next_xid and global_xmin saved as first two lines. For older
-		 * versions, just the next_xid is stored
+		 * Since control file version 20160302, we expect to see next_xid and
+		 * global_xmin saved as first two lines. For older versions, just the
+		 * next_xid is stored
 		 */
-		if (context && context->version == 20160302)
+		if (context && context->version >= 20160302)
 		{
 			if (fscanf(ctlf, "next_xid: %u\n", &saved_gxid) != 1)
 				saved_gxid = InvalidGlobalTransactionId;
@@ -2361,11 +2428,15 @@ GTM_RestoreTxnInfo(FILE *ctlf, GlobalTransactionId next_gxid,
 	{
 		if (GlobalTransactionIdIsValid(saved_gxid))
 		{
-			/* 
-			 * Add in extra amount in case we had not gracefully stopped
+			/*
+			 * The GXIDs assigned after the control file was written are
+			 * recovered from the WAL.  Without the WAL add in extra amount in
+			 * case we had not gracefully stopped
 			 */
-			next_gxid = saved_gxid + CONTROL_INTERVAL;
-			GTM_SetControlXid(next_gxid);
+			if (context && context->wal_redo != InvalidGTMWalLSN)
+				next_gxid = saved_gxid;
+			else
+				next_gxid = saved_gxid + CONTROL_INTERVAL;
 		}
 		else
 			saved_gxid = next_gxid = InitialGXIDValue_Default;
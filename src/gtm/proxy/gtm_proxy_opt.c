@@ -52,6 +52,9 @@ extern int GTMProxyPortNumber;
 extern int GTMConnectRetryInterval;
 extern int GTMServerPortNumber;
 extern int GTMProxyWorkerThreads;
+extern int GTMProxyBatchTargetSize;
+extern int GTMProxyBatchMaxDelay;
+extern int GTMProxyBatchStatsInterval;
 extern char *GTMProxyDataDir;
 extern char *GTMProxyConfigFileName;
 extern char *GTMConfigFileName;
@@ -220,6 +223,39 @@ struct config_int ConfigureNamesInt[] =
 		GTM_PROXY_DEFAULT_WORKERS, 1, INT_MAX,
 		0, NULL
 	},
+	{
+		{
+			GTM_OPTNAME_BATCH_TARGET_SIZE, GTMC_STARTUP,
+			gettext_noop("Number of grouped commands after which a batching window is closed."),
+			NULL,
+			0
+		},
+		&GTMProxyBatchTargetSize,
+		32, 1, INT_MAX,
+		0, NULL
+	},
+	{
+		{
+			GTM_OPTNAME_BATCH_MAX_DELAY, GTMC_STARTUP,
+			gettext_noop("Maximum time in microseconds a batching window delays commands."),
+			gettext_noop("Zero disables batching windows."),
+			0
+		},
+		&GTMProxyBatchMaxDelay,
+		0, 0, 1000000,
+		0, NULL
+	},
+	{
+		{
+			GTM_OPTNAME_BATCH_STATS_INTERVAL, GTMC_STARTUP,
+			gettext_noop("Interval in seconds to log batch size and latency statistics."),
+			gettext_noop("Zero disables the statistics report."),
+			GTMOPT_UNIT_S
+		},
+		&GTMProxyBatchStatsInterval,
+		0, 0, INT_MAX / 1000,
+		0, NULL
+	},
 	/* End-of-list marker */
 	{
 		{NULL, 0, NULL, NULL, 0}, NULL, 0, 0, 0, 0, NULL
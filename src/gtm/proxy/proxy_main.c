@@ -46,6 +46,8 @@
 /* For reconnect control lock */
 #include "gtm/gtm_lock.h"
 #include "gtm/gtm_opt.h"
+#include "gtm/gtm_time.h"
+#include "gtm/gtm_utils.h"
 
 extern int	optind;
 extern char *optarg;
@@ -65,6 +67,9 @@ extern char *optarg;
 #endif
 
 static int poll_timeout_ms = 10;
+
+/* Cycles without a batching window after a window did not pay off, at most */
+#define GTM_PROXY_MAX_BATCH_BACKOFF	64
 static char *progname = "gtm_proxy";
 char	   *ListenAddresses;
 int			GTMProxyPortNumber;
@@ -78,6 +83,14 @@ int			GTMServerPortNumber;
 
 int			GTMConnectRetryInterval = 60;
 
+/*
+ * Batching window of the worker threads, and how often they report their
+ * batch statistics
+ */
+int			GTMProxyBatchTargetSize = 32;
+int			GTMProxyBatchMaxDelay = 0;
+int			GTMProxyBatchStatsInterval = 0;
+
 /*
  * Keepalives setup for the connection with GTM server
  */
@@ -163,6 +176,13 @@ static void ProcessResponse(GTMProxy_ThreadInfo *thrinfo,
 		GTMProxy_CommandInfo *cmdinfo, GTM_Result *res);
 
 static void GTMProxy_ProcessPendingCommands(GTMProxy_ThreadInfo *thrinfo);
+static void GTMProxy_WaitForCommands(GTMProxy_ThreadInfo *thrinfo, long timeout_us);
+static void GTMProxy_ReadCommands(GTMProxy_ThreadInfo *thrinfo, uint32 first,
+		StringInfo input_message);
+static void GTMProxy_BatchCommands(GTMProxy_ThreadInfo *thrinfo,
+		StringInfo input_message);
+static void GTMProxy_CountCommands(GTMProxy_ThreadInfo *thrinfo);
+static void GTMProxy_ReportCommandStats(GTMProxy_ThreadInfo *thrinfo);
 static void GTMProxy_CommandPending(GTMProxy_ConnectionInfo *conninfo,
 		GTM_MessageType mtype, GTMProxy_CommandData cmd_data);
 
@@ -857,6 +877,12 @@ main(int argc, char *argv[])
 	 */
 	Proxy_ThreadInfo = palloc0(sizeof(GTMProxy_ThreadInfo *) * GTMProxyWorkerThreads);
 
+	/*
+	 * The message name table is built on first use, do that before the
+	 * worker threads may look names up concurrently
+	 */
+	(void) gtm_util_message_name(MSG_TXN_BEGIN);
+
 	/*
 	 * Pre-fork so many worker threads
 	 */
@@ -1080,14 +1106,12 @@ void *
 GTMProxy_ThreadMain(void *argp)
 {
 	GTMProxy_ThreadInfo *thrinfo = (GTMProxy_ThreadInfo *)argp;
-	int qtype;
 	StringInfoData input_message;
 	sigjmp_buf  local_sigjmp_buf;
 	int32 saved_seqno = -1;
-	int ii, nrfds;
+	int ii;
 	char gtm_connect_string[1024];
 	int	first_turn = TRUE;	/* Used only to set longjmp target at the first turn of thread loop */
-	GTMProxy_CommandData cmd_data = {};
 
 	elog(DEBUG3, "Starting the connection helper thread");
 
@@ -1126,16 +1150,17 @@ GTMProxy_ThreadMain(void *argp)
 	initStringInfo(&input_message);
 
 	thrinfo->reconnect_issued = FALSE;
+	thrinfo->thr_stats_start = GTM_TimestampGetCurrent();
 
+#ifdef HAVE_SYS_EPOLL_H
 	/*
-	 * Initialize comand backup area
+	 * Set up the epoll set the client connections of this thread are
+	 * registered with as they are adopted
 	 */
-	for (ii = 0; ii < GTM_PROXY_MAX_CONNECTIONS; ii++)
-	{
-		thrinfo->thr_any_backup[ii] = FALSE;
-		thrinfo->thr_qtype[ii] = 0;
-		initStringInfo(&(thrinfo->thr_inBufData[ii]));
-	}
+	thrinfo->thr_epoll_fd = epoll_create(GTM_PROXY_INIT_CONNECTIONS);
+	if (thrinfo->thr_epoll_fd < 0)
+		elog(FATAL, "epoll_create failed: %m");
+#endif
 
 	/*
 	 * If an exception is encountered, processing resumes here so we abort the
@@ -1171,14 +1196,16 @@ GTMProxy_ThreadMain(void *argp)
 			{
 				int connIndx = thrinfo->thr_conn_map[ii];
 				GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
-				
+
+				conninfo->con_revents = 0;
+
 				/*
 				 * Now clean up disconnected connections
 				 */
 				if (conninfo->con_disconnected)
 				{
 					EmitErrorReport(conninfo->con_port);
-					if (conninfo->con_port->sock > 0)
+					if (conninfo->con_port && conninfo->con_port->sock > 0)
 						StreamClose(conninfo->con_port->sock);
 					GTMProxy_ThreadRemoveConnection(thrinfo, conninfo);
 					pfree(conninfo);
@@ -1242,19 +1269,22 @@ GTMProxy_ThreadMain(void *argp)
 		 */
 		if (!first_turn)
 		{
-			GTMProxy_ConnectionInfo	*auth_required[GTM_PROXY_MAX_CONNECTIONS];
+			GTMProxy_ConnectionInfo	**auth_required = NULL;
 			int						auth_required_count = 0;
 
+			thrinfo->thr_ready_count = 0;
+			thrinfo->thr_cycle++;
+
 			/*
 			 * Check if there are any changes to the connection array assigned to
-			 * this thread. If so, we need to rebuild the fd array.
+			 * this thread. If so, adopt the new connections and rebuild the fd
+			 * array.
 			 */
 			GTM_MutexLockAcquire(&thrinfo->thr_lock);
 			if (saved_seqno != thrinfo->thr_seqno)
 			{
-				saved_seqno = thrinfo->thr_seqno;
-
-				while (thrinfo->thr_conn_count <= 0)
+				while (thrinfo->thr_conn_count <= 0 &&
+					   thrinfo->thr_new_conns == NULL)
 				{
 					/*
 					 * No connections assigned to the thread. Wait for at least one
@@ -1283,24 +1313,37 @@ GTMProxy_ThreadMain(void *argp)
 					}
 				}
 
-				memset(thrinfo->thr_poll_fds, 0, sizeof (thrinfo->thr_poll_fds));
-
 				/*
-				 * Now grab all the open connections. A lock is being hold so no
+				 * Now grab all the new connections. A lock is being hold so no
 				 * new connections can be added.
 				 */
+				GTMProxy_ThreadAdoptConnections(thrinfo);
+				saved_seqno = thrinfo->thr_seqno;
+
+				auth_required = (GTMProxy_ConnectionInfo **)
+					palloc(thrinfo->thr_conn_count * sizeof (GTMProxy_ConnectionInfo *));
+
 				for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
 				{
 					int connIndx = thrinfo->thr_conn_map[ii];
 					GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
 
+#ifndef HAVE_SYS_EPOLL_H
+					thrinfo->thr_poll_fds[ii].fd = -1;
+					thrinfo->thr_poll_fds[ii].events = POLLIN;
+					thrinfo->thr_poll_fds[ii].revents = 0;
+#endif
+
 					/*
 					 * Detect if the connection has been dropped to avoid
-					 * a segmentation fault.
+					 * a segmentation fault. Such connections are served in
+					 * this cycle only to be cleaned up.
 					 */
-					if (conninfo->con_port == NULL)
+					if (conninfo->con_port == NULL || conninfo->con_disconnected)
 					{
 						conninfo->con_disconnected = true;
+						conninfo->con_cycle = thrinfo->thr_cycle;
+						thrinfo->thr_ready_conns[thrinfo->thr_ready_count++] = conninfo;
 						continue;
 					}
 
@@ -1312,9 +1355,9 @@ GTMProxy_ThreadMain(void *argp)
 						auth_required[auth_required_count++] = conninfo;
 					}
 
+#ifndef HAVE_SYS_EPOLL_H
 					thrinfo->thr_poll_fds[ii].fd = conninfo->con_port->sock;
-					thrinfo->thr_poll_fds[ii].events = POLLIN;
-					thrinfo->thr_poll_fds[ii].revents = 0;
+#endif
 				}
 			}
 			GTM_MutexLockRelease(&thrinfo->thr_lock);
@@ -1329,24 +1372,33 @@ GTMProxy_ThreadMain(void *argp)
 				GTMProxy_HandshakeConnection(auth_required[ii]);
 			}
 
-			while (true)
-			{
-				Enable_Longjmp();
-				nrfds = poll(thrinfo->thr_poll_fds, thrinfo->thr_conn_count,
-							poll_timeout_ms);
-				Disable_Longjmp();
+			/*
+			 * Wait for commands
+			 */
+			GTMProxy_WaitForCommands(thrinfo, poll_timeout_ms * 1000L);
 
-				if (nrfds < 0)
+			/*
+			 * Commands saved before a reconnection to GTM are replayed even
+			 * if their connection has nothing new to say.
+			 */
+			if (thrinfo->thr_backup_count > 0)
+			{
+				for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
 				{
-					if (errno == EINTR)
-						continue;
-					elog(FATAL, "poll returned with error %d", nrfds);
+					int connIndx = thrinfo->thr_conn_map[ii];
+					GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
+
+					if (conninfo->con_any_backup &&
+						conninfo->con_cycle != thrinfo->thr_cycle &&
+						!conninfo->con_disconnected)
+					{
+						conninfo->con_cycle = thrinfo->thr_cycle;
+						thrinfo->thr_ready_conns[thrinfo->thr_ready_count++] = conninfo;
+					}
 				}
-				else
-					break;
 			}
 
-			if (nrfds == 0)
+			if (thrinfo->thr_ready_count == 0)
 				continue;
 
 			/*
@@ -1392,80 +1444,12 @@ setjmp_again:
 			continue;
 		}
 
-		/*
-		 * Just reset the input buffer to avoid repeated palloc/pfrees
-		 *
-		 * XXX We should consider resetting the MessageContext periodically to
-		 * handle any memory leaks
-		 */
-		resetStringInfo(&input_message);
-
 		/*
 		 * Now, read command from each of the connections that has some data to
-		 * be read.
+		 * be read, and give the others a chance to join the batch.
 		 */
-		for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
-		{
-			int connIndx = thrinfo->thr_conn_map[ii];
-			GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
-			thrinfo->thr_conn = conninfo;
-
-			if (thrinfo->thr_poll_fds[ii].revents & POLLHUP)
-			{
-				/*
-				 * The fd has become invalid. The connection is broken. Add it
-				 * to the remove_list and cleanup at the end of this round of
-				 * cleanup.
-				 */
-				GTMProxy_CommandPending(thrinfo->thr_conn,
-							MSG_BACKEND_DISCONNECT, cmd_data);
-				continue;
-			}
-
-			if ((thrinfo->thr_any_backup[connIndx]) ||
-				(thrinfo->thr_poll_fds[ii].revents & POLLIN))
-			{
-				/*
-				 * (3) read a command (loop blocks here)
-				 */
-				qtype = ReadCommand(thrinfo->thr_conn, &input_message);
-
-				thrinfo->thr_poll_fds[ii].revents = 0;
-
-				switch(qtype)
-				{
-					case 'C':
-						ProcessCommand(thrinfo->thr_conn, thrinfo->thr_gtm_conn,
-								&input_message);
-						HandlePostCommand(thrinfo->thr_conn, thrinfo->thr_gtm_conn);
-						break;
-
-					case 'X':
-					case EOF:
-						/*
-						 * Connection termination request
-						 *
-						 * Close the socket and remember the connection
-						 * as disconnected. All such connections will be
-						 * removed after the command processing is over. We
-						 * can't remove it just yet because we pass the slot id
-						 * to the server to quickly find the backend connection
-						 * while processing proxied messages.
-						 */
-						GTMProxy_CommandPending(thrinfo->thr_conn,
-												MSG_BACKEND_DISCONNECT, cmd_data);
-						break;
-					default:
-						/*
-						 * Also disconnect if protocol error
-						 */
-						GTMProxy_HandleDisconnect(thrinfo->thr_conn, thrinfo->thr_gtm_conn);
-						elog(ERROR, "Unexpected message, or client disconnected abruptly.");
-						break;
-				}
-
-			}
-		}
+		GTMProxy_ReadCommands(thrinfo, 0, &input_message);
+		GTMProxy_BatchCommands(thrinfo, &input_message);
 
 		/*
 		 * Ok. All the commands are processed. Commands which can be proxied
@@ -1491,6 +1475,8 @@ setjmp_again:
 		gtmpqFlush(thrinfo->thr_gtm_conn);
 		Disable_Longjmp();
 
+		GTMProxy_CountCommands(thrinfo);
+
 		/*
 		 * Read back the responses and put them on to the right backend
 		 * connection.
@@ -1536,19 +1522,27 @@ setjmp_again:
 		thrinfo->thr_processed_commands = gtm_NIL;
 
 		/*
-		 * Now clean up disconnected connections
+		 * Now clean up disconnected connections. Only connections served in
+		 * this cycle can have been disconnected.
 		 */
-		for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
+		for (ii = 0; ii < thrinfo->thr_ready_count; ii++)
 		{
-			int connIndx = thrinfo->thr_conn_map[ii];
-			GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
+			GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_ready_conns[ii];
+
+			conninfo->con_revents = 0;
 			if (conninfo->con_disconnected)
 			{
 				GTMProxy_ThreadRemoveConnection(thrinfo, conninfo);
 				pfree(conninfo);
-				ii--;
 			}
 		}
+		thrinfo->thr_ready_count = 0;
+
+		if (GTMProxyBatchStatsInterval > 0 &&
+			GTM_TimestampDifferenceExceeds(thrinfo->thr_stats_start,
+										   GTM_TimestampGetCurrent(),
+										   GTMProxyBatchStatsInterval * 1000))
+			GTMProxy_ReportCommandStats(thrinfo);
 	}
 
 	/* can't get here because the above loop never exits */
@@ -1557,6 +1551,353 @@ setjmp_again:
 	return thrinfo;
 }
 
+/*
+ * Wait up to timeout_us microseconds for client connections to have
+ * something to say, and add those not served yet in this cycle to the ready
+ * list. Only the connections which are active are looked at, so the cost of
+ * a cycle depends on their number rather than on the number of connections
+ * served by the thread.
+ */
+static void
+GTMProxy_WaitForCommands(GTMProxy_ThreadInfo *thrinfo, long timeout_us)
+{
+	int ii, nrfds;
+
+	while (true)
+	{
+		Enable_Longjmp();
+#ifdef HAVE_SYS_EPOLL_H
+		if (timeout_us % 1000 == 0)
+			nrfds = epoll_wait(thrinfo->thr_epoll_fd,
+							   thrinfo->thr_epoll_events,
+							   thrinfo->thr_conn_array_size,
+							   timeout_us / 1000);
+		else
+		{
+			/*
+			 * epoll_wait() counts in milliseconds. The epoll descriptor is
+			 * readable as soon as one of its sockets is, so wait on it with
+			 * a finer timeout first.
+			 */
+			struct pollfd pfd;
+			struct timespec ts;
+
+			pfd.fd = thrinfo->thr_epoll_fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			ts.tv_sec = timeout_us / 1000000L;
+			ts.tv_nsec = (timeout_us % 1000000L) * 1000L;
+			nrfds = ppoll(&pfd, 1, &ts, NULL);
+			if (nrfds > 0)
+				nrfds = epoll_wait(thrinfo->thr_epoll_fd,
+								   thrinfo->thr_epoll_events,
+								   thrinfo->thr_conn_array_size, 0);
+		}
+#else
+		nrfds = poll(thrinfo->thr_poll_fds, thrinfo->thr_conn_count,
+					(timeout_us + 999) / 1000);
+#endif
+		Disable_Longjmp();
+
+		if (nrfds < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			elog(FATAL, "poll returned with error %d", nrfds);
+		}
+		else
+			break;
+	}
+
+#ifdef HAVE_SYS_EPOLL_H
+	for (ii = 0; ii < nrfds; ii++)
+	{
+		struct epoll_event *event = &thrinfo->thr_epoll_events[ii];
+		GTMProxy_ConnectionInfo *conninfo =
+			(GTMProxy_ConnectionInfo *) event->data.ptr;
+
+		if (conninfo->con_cycle == thrinfo->thr_cycle)
+			continue;
+
+		if (event->events & (EPOLLHUP | EPOLLERR))
+			conninfo->con_revents = POLLHUP;
+		else if (event->events & EPOLLIN)
+			conninfo->con_revents = POLLIN;
+		else
+			continue;
+		conninfo->con_cycle = thrinfo->thr_cycle;
+		thrinfo->thr_ready_conns[thrinfo->thr_ready_count++] = conninfo;
+	}
+#else
+	for (ii = 0; nrfds > 0 && ii < thrinfo->thr_conn_count; ii++)
+	{
+		if (thrinfo->thr_poll_fds[ii].revents == 0)
+			continue;
+
+		nrfds--;
+		if (thrinfo->thr_poll_fds[ii].revents & (POLLIN | POLLHUP))
+		{
+			int connIndx = thrinfo->thr_conn_map[ii];
+			GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
+
+			if (conninfo->con_cycle != thrinfo->thr_cycle)
+			{
+				conninfo->con_revents = thrinfo->thr_poll_fds[ii].revents;
+				conninfo->con_cycle = thrinfo->thr_cycle;
+				thrinfo->thr_ready_conns[thrinfo->thr_ready_count++] = conninfo;
+			}
+		}
+		thrinfo->thr_poll_fds[ii].revents = 0;
+	}
+#endif
+}
+
+/*
+ * Read and process one command from each connection on the ready list,
+ * starting at the given position
+ */
+static void
+GTMProxy_ReadCommands(GTMProxy_ThreadInfo *thrinfo, uint32 first,
+		StringInfo input_message)
+{
+	GTMProxy_CommandData cmd_data = {};
+	uint32 ii;
+	int qtype;
+
+	/*
+	 * Just reset the input buffer to avoid repeated palloc/pfrees
+	 *
+	 * XXX We should consider resetting the MessageContext periodically to
+	 * handle any memory leaks
+	 */
+	resetStringInfo(input_message);
+
+	for (ii = first; ii < thrinfo->thr_ready_count; ii++)
+	{
+		GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_ready_conns[ii];
+		thrinfo->thr_conn = conninfo;
+
+		if (conninfo->con_disconnected)
+			continue;
+
+		if (conninfo->con_revents & POLLHUP)
+		{
+			/*
+			 * The fd has become invalid. The connection is broken. Add it
+			 * to the remove_list and cleanup at the end of this round of
+			 * cleanup.
+			 */
+			GTMProxy_CommandPending(thrinfo->thr_conn,
+						MSG_BACKEND_DISCONNECT, cmd_data);
+			continue;
+		}
+
+		if ((conninfo->con_any_backup) ||
+			(conninfo->con_revents & POLLIN))
+		{
+			/*
+			 * (3) read a command (loop blocks here)
+			 */
+			qtype = ReadCommand(thrinfo->thr_conn, input_message);
+
+			conninfo->con_revents = 0;
+
+			switch(qtype)
+			{
+				case 'C':
+					ProcessCommand(thrinfo->thr_conn, thrinfo->thr_gtm_conn,
+							input_message);
+					HandlePostCommand(thrinfo->thr_conn, thrinfo->thr_gtm_conn);
+					break;
+
+				case 'X':
+				case EOF:
+					/*
+					 * Connection termination request
+					 *
+					 * Close the socket and remember the connection
+					 * as disconnected. All such connections will be
+					 * removed after the command processing is over. We
+					 * can't remove it just yet because we pass the slot id
+					 * to the server to quickly find the backend connection
+					 * while processing proxied messages.
+					 */
+					GTMProxy_CommandPending(thrinfo->thr_conn,
+											MSG_BACKEND_DISCONNECT, cmd_data);
+					break;
+				default:
+					/*
+					 * Also disconnect if protocol error
+					 */
+					GTMProxy_HandleDisconnect(thrinfo->thr_conn, thrinfo->thr_gtm_conn);
+					elog(ERROR, "Unexpected message, or client disconnected abruptly.");
+					break;
+			}
+
+		}
+	}
+}
+
+/*
+ * Number of commands waiting to be grouped and sent to GTM
+ */
+static int
+GTMProxy_PendingCount(GTMProxy_ThreadInfo *thrinfo)
+{
+	int count = 0;
+	int ii;
+
+	for (ii = 0; ii < MSG_TYPE_COUNT; ii++)
+	{
+		if (ii != MSG_BACKEND_DISCONNECT)
+			count += gtm_list_length(thrinfo->thr_pending_commands[ii]);
+	}
+	return count;
+}
+
+/*
+ * Batching window
+ *
+ * Commands of the same type read in one cycle are sent to GTM as a single
+ * grouped message. Unless batch_target_size of them are pending already,
+ * keep reading commands from other connections for up to batch_max_delay
+ * microseconds so that larger groups are formed, trading latency for GTM
+ * throughput. A window which does not gain any command is wasted latency, so
+ * windows are skipped for an exponentially growing number of cycles after
+ * such one, until a window pays off again.
+ */
+static void
+GTMProxy_BatchCommands(GTMProxy_ThreadInfo *thrinfo, StringInfo input_message)
+{
+	GTM_Timestamp start;
+	bool gained = false;
+
+	if (GTMProxyBatchMaxDelay <= 0 || GTMProxyBatchTargetSize <= 1)
+		return;
+
+	if (thrinfo->thr_batch_skip > 0)
+	{
+		thrinfo->thr_batch_skip--;
+		return;
+	}
+
+	if (GTMProxy_PendingCount(thrinfo) == 0)
+		return;
+
+	start = GTM_TimestampGetCurrent();
+	while (GTMProxy_PendingCount(thrinfo) < GTMProxyBatchTargetSize)
+	{
+		uint32 first = thrinfo->thr_ready_count;
+		long remaining;
+
+		remaining = GTMProxyBatchMaxDelay - (GTM_TimestampGetCurrent() - start);
+		if (remaining <= 0)
+			break;
+
+		GTMProxy_WaitForCommands(thrinfo, remaining);
+		if (thrinfo->thr_ready_count == first)
+			break;
+
+		GTMProxy_ReadCommands(thrinfo, first, input_message);
+		gained = true;
+	}
+
+	if (gained)
+		thrinfo->thr_batch_backoff = 0;
+	else
+	{
+		thrinfo->thr_batch_backoff = (thrinfo->thr_batch_backoff == 0) ? 1 :
+			Min(thrinfo->thr_batch_backoff * 2, GTM_PROXY_MAX_BATCH_BACKOFF);
+		thrinfo->thr_batch_skip = thrinfo->thr_batch_backoff;
+	}
+}
+
+static int
+GTMProxy_HistogramBucket(uint64 value, int nbuckets)
+{
+	int bucket = 0;
+
+	while (value > 1 && bucket < nbuckets - 1)
+	{
+		value >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+/*
+ * Account for the commands just flushed to GTM
+ */
+static void
+GTMProxy_CountCommands(GTMProxy_ThreadInfo *thrinfo)
+{
+	GTM_Timestamp now = GTM_TimestampGetCurrent();
+	gtm_ListCell *elem = NULL;
+
+	gtm_foreach(elem, thrinfo->thr_processed_commands)
+	{
+		GTMProxy_CommandInfo *cmdinfo = (GTMProxy_CommandInfo *)gtm_lfirst(elem);
+		GTMProxy_CommandStats *stats = &thrinfo->thr_cmd_stats[cmdinfo->ci_mtype];
+		GTM_Timestamp latency = now - cmdinfo->ci_read_time;
+
+		stats->cs_commands++;
+		stats->cs_latency[GTMProxy_HistogramBucket(Max(latency, 0),
+												   GTM_PROXY_LATENCY_BUCKETS)]++;
+	}
+}
+
+static void
+GTMProxy_AppendHistogram(StringInfo buf, uint64 *hist, int nbuckets)
+{
+	int ii;
+
+	for (ii = 0; ii < nbuckets; ii++)
+	{
+		if (hist[ii] > 0)
+			appendStringInfo(buf, " " UINT64_FORMAT ":" UINT64_FORMAT,
+							 (uint64) 1 << ii, hist[ii]);
+	}
+}
+
+/*
+ * Log the batch size and the proxy-added latency, i.e. the time from reading
+ * a command until it is flushed to GTM, of each message type and start
+ * counting again
+ */
+static void
+GTMProxy_ReportCommandStats(GTMProxy_ThreadInfo *thrinfo)
+{
+	StringInfoData buf;
+	int ii;
+
+	initStringInfo(&buf);
+	for (ii = 0; ii < MSG_TYPE_COUNT; ii++)
+	{
+		GTMProxy_CommandStats *stats = &thrinfo->thr_cmd_stats[ii];
+		char *name;
+
+		if (stats->cs_commands == 0)
+			continue;
+
+		name = gtm_util_message_name(ii);
+		resetStringInfo(&buf);
+		appendStringInfo(&buf, "%s: " UINT64_FORMAT " commands in "
+						 UINT64_FORMAT " batches; batch size",
+						 name ? name : "UNKNOWN_MESSAGE",
+						 stats->cs_commands, stats->cs_batches);
+		GTMProxy_AppendHistogram(&buf, stats->cs_batch_size,
+								 GTM_PROXY_BATCH_BUCKETS);
+		appendStringInfoString(&buf, "; latency (us)");
+		GTMProxy_AppendHistogram(&buf, stats->cs_latency,
+								 GTM_PROXY_LATENCY_BUCKETS);
+		elog(LOG, "%s", buf.data);
+	}
+	pfree(buf.data);
+
+	memset(thrinfo->thr_cmd_stats, 0, sizeof (thrinfo->thr_cmd_stats));
+	thrinfo->thr_stats_start = GTM_TimestampGetCurrent();
+}
+
 /*
  * Add the accepted connection to the pool
  */
@@ -1601,6 +1942,7 @@ ProcessCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 		case MSG_TXN_PREPARE:
 		case MSG_TXN_START_PREPARED:
 		case MSG_TXN_GET_GID_DATA:
+		case MSG_TXN_GET_GID_DATA_MULTI:
 		case MSG_TXN_COMMIT_PREPARED:
 		case MSG_SNAPSHOT_GET:
 		case MSG_SEQUENCE_INIT:
@@ -1616,6 +1958,7 @@ ProcessCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 		case MSG_TXN_COMMIT:
 		case MSG_REGISTER_SESSION:
 		case MSG_REPORT_XMIN:
+		case MSG_GET_TIMESTAMP:
 		case MSG_NODE_REGISTER:
 		case MSG_NODE_UNREGISTER:
 			GTMProxy_ProxyCommand(conninfo, gtm_conn, mtype, input_message);
@@ -1634,6 +1977,29 @@ ProcessCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 			ProcessSnapshotCommand(conninfo, gtm_conn, mtype, input_message);
 			break;
 
+		case MSG_SUBSCRIBE_XMIN:
+			/*
+			 * Notifications can't be multiplexed over our connection to GTM.
+			 * Refuse the subscription, so the node keeps learning GlobalXmin
+			 * when it reports its own. An ERROR would be sent to every
+			 * connection with a pending message, so build the reply here.
+			 */
+			{
+				StringInfoData buf;
+
+				elog(DEBUG1, "refusing GlobalXmin subscription");
+
+				pq_beginmessage(&buf, 'E');
+				pq_sendbyte(&buf, PG_DIAG_SEVERITY);
+				pq_sendstring(&buf, "ERROR");
+				pq_sendbyte(&buf, PG_DIAG_MESSAGE_PRIMARY);
+				pq_sendstring(&buf, "GlobalXmin notifications can not be proxied");
+				pq_sendbyte(&buf, '\0');
+				pq_endmessage(conninfo->con_port, &buf);
+				pq_flush(conninfo->con_port);
+			}
+			return;
+
 		default:
 			ereport(FATAL,
 					(EPROTO,
@@ -1717,8 +2083,6 @@ HandleGTMError(GTM_Conn *gtm_conn)
 static GTM_Conn *
 HandlePostCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn)
 {
-	int		connIdx = conninfo->con_id;
-
 	Assert(conninfo && gtm_conn);
 	/*
 	 * Check if the response was handled without error.
@@ -1734,8 +2098,12 @@ HandlePostCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn)
 		/*
 		 * Command handled without error.  Clear the backup.
 		 */
-		resetStringInfo(&GetMyThreadInfo->thr_inBufData[connIdx]);
-		GetMyThreadInfo->thr_any_backup[connIdx] = FALSE;
+		if (conninfo->con_any_backup)
+		{
+			resetStringInfo(&conninfo->con_inBufData);
+			conninfo->con_any_backup = false;
+			GetMyThreadInfo->thr_backup_count--;
+		}
 		return(gtm_conn);
 	}
 
@@ -1755,10 +2123,12 @@ IsProxiedMessage(GTM_MessageType mtype)
 		case MSG_TXN_COMMIT_PREPARED:
 		case MSG_TXN_GET_GXID:
 		case MSG_TXN_GET_GID_DATA:
+		case MSG_TXN_GET_GID_DATA_MULTI:
 		case MSG_NODE_REGISTER:
 		case MSG_NODE_UNREGISTER:
 		case MSG_REGISTER_SESSION:
 		case MSG_REPORT_XMIN:
+		case MSG_GET_TIMESTAMP:
 		case MSG_SNAPSHOT_GXID_GET:
 		case MSG_SEQUENCE_INIT:
 		case MSG_SEQUENCE_GET_CURRENT:
@@ -1860,6 +2230,7 @@ ProcessResponse(GTMProxy_ThreadInfo *thrinfo, GTMProxy_CommandInfo *cmdinfo,
 				pq_sendint(&buf, TXN_COMMIT_MULTI_RESULT, 4);
 				pq_sendbytes(&buf, (const char *)&txn_count, sizeof (int));
 				pq_sendbytes(&buf, (const char *)&status, sizeof (int));
+				pq_sendbytes(&buf, (const char *)&res->gr_seqno, sizeof (uint64));
 				pq_endmessage(cmdinfo->ci_conn->con_port, &buf);
 				pq_flush(cmdinfo->ci_conn->con_port);
 			}
@@ -1936,6 +2307,7 @@ ProcessResponse(GTMProxy_ThreadInfo *thrinfo, GTMProxy_CommandInfo *cmdinfo,
 				pq_sendint(&buf, res->gr_snapshot.sn_xcnt, sizeof (int));
 				pq_sendbytes(&buf, (char *)res->gr_snapshot.sn_xip,
 							 sizeof(GlobalTransactionId) * res->gr_snapshot.sn_xcnt);
+				pq_sendbytes(&buf, (char *)&res->gr_snapshot.sn_seqno, sizeof (uint64));
 				pq_endmessage(cmdinfo->ci_conn->con_port, &buf);
 				pq_flush(cmdinfo->ci_conn->con_port);
 			}
@@ -1956,10 +2328,12 @@ ProcessResponse(GTMProxy_ThreadInfo *thrinfo, GTMProxy_CommandInfo *cmdinfo,
 		case MSG_TXN_COMMIT_PREPARED:
 		case MSG_TXN_GET_GXID:
 		case MSG_TXN_GET_GID_DATA:
+		case MSG_TXN_GET_GID_DATA_MULTI:
 		case MSG_NODE_REGISTER:
 		case MSG_NODE_UNREGISTER:
 		case MSG_REGISTER_SESSION:
 		case MSG_REPORT_XMIN:
+		case MSG_GET_TIMESTAMP:
 		case MSG_SNAPSHOT_GXID_GET:
 		case MSG_SEQUENCE_INIT:
 		case MSG_SEQUENCE_GET_CURRENT:
@@ -1974,7 +2348,7 @@ ProcessResponse(GTMProxy_ThreadInfo *thrinfo, GTMProxy_CommandInfo *cmdinfo,
 		case MSG_TXN_COMMIT:
 			Assert(IsProxiedMessage(cmdinfo->ci_mtype));
 			if ((res->gr_proxyhdr.ph_conid == InvalidGTMProxyConnID) ||
-				(res->gr_proxyhdr.ph_conid >= GTM_PROXY_MAX_CONNECTIONS) ||
+				(res->gr_proxyhdr.ph_conid >= thrinfo->thr_conn_array_size) ||
 				(thrinfo->thr_all_conns[res->gr_proxyhdr.ph_conid] != cmdinfo->ci_conn))
 			{
 				ReleaseCmdBackup(cmdinfo);
@@ -2052,10 +2426,9 @@ static int
 ReadCommand(GTMProxy_ConnectionInfo *conninfo, StringInfo inBuf)
 {
 	int 			qtype;
-	int				connIdx = conninfo->con_id;
 	int				anyBackup;
 
-	anyBackup = (GetMyThreadInfo->thr_any_backup[connIdx] ? TRUE : FALSE);
+	anyBackup = (conninfo->con_any_backup ? TRUE : FALSE);
 
 	/*
 	 * Get message type code from the frontend.
@@ -2063,16 +2436,16 @@ ReadCommand(GTMProxy_ConnectionInfo *conninfo, StringInfo inBuf)
 	if (!anyBackup)
 	{
 		qtype = pq_getbyte(conninfo->con_port);
-		GetMyThreadInfo->thr_qtype[connIdx] = qtype;
+		conninfo->con_qtype = qtype;
 		/*
-		 * We should not update thr_any_backup here.  This should be
+		 * We should not update con_any_backup here.  This should be
 		 * updated when the backup is consumed or command processing
 		 * is done.
 		 */
 	}
 	else
 	{
-		qtype = GetMyThreadInfo->thr_qtype[connIdx];
+		qtype = conninfo->con_qtype;
 	}
 
 	if (qtype == EOF)			/* frontend disconnected */
@@ -2124,17 +2497,18 @@ ReadCommand(GTMProxy_ConnectionInfo *conninfo, StringInfo inBuf)
 		if (pq_getmessage(conninfo->con_port, inBuf, 0))
 			return EOF;			/* suitable message already logged */
 
-		copyStringInfo(&(GetMyThreadInfo->thr_inBufData[connIdx]), inBuf);
+		copyStringInfo(&conninfo->con_inBufData, inBuf);
 
 		/*
 		 * The next line is added because we added the code to clear backup
 		 * when the response is processed.
 		 */
-		GetMyThreadInfo->thr_any_backup[connIdx] = TRUE;
+		conninfo->con_any_backup = true;
+		GetMyThreadInfo->thr_backup_count++;
 	}
 	else
 	{
-		copyStringInfo(inBuf, &(GetMyThreadInfo->thr_inBufData[connIdx]));
+		copyStringInfo(inBuf, &conninfo->con_inBufData);
 	}
 	return qtype;
 }
@@ -2259,6 +2633,7 @@ GTMProxy_ProxyCommand(GTMProxy_ConnectionInfo *conninfo, GTM_Conn *gtm_conn,
 	cmdinfo->ci_mtype = mtype;
 	cmdinfo->ci_conn = conninfo;
 	cmdinfo->ci_res_index = 0;
+	cmdinfo->ci_read_time = GTM_TimestampGetCurrent();
 	thrinfo->thr_processed_commands = gtm_lappend(thrinfo->thr_processed_commands, cmdinfo);
 
 	/* Finish the message. */
@@ -2292,6 +2667,7 @@ GTMProxy_CommandPending(GTMProxy_ConnectionInfo *conninfo, GTM_MessageType mtype
 	cmdinfo->ci_conn = conninfo;
 	cmdinfo->ci_res_index = 0;
 	cmdinfo->ci_data = cmd_data;
+	cmdinfo->ci_read_time = GTM_TimestampGetCurrent();
 	thrinfo->thr_pending_commands[mtype] = gtm_lappend(thrinfo->thr_pending_commands[mtype], cmdinfo);
 
 	MemoryContextSwitchTo(oldContext);
@@ -2435,6 +2811,11 @@ GTMProxy_ProcessPendingCommands(GTMProxy_ThreadInfo *thrinfo)
 				gtm_list_length(thrinfo->thr_pending_commands[ii]) == 0)
 			continue;
 
+		thrinfo->thr_cmd_stats[ii].cs_batches++;
+		thrinfo->thr_cmd_stats[ii].cs_batch_size[
+			GTMProxy_HistogramBucket(gtm_list_length(thrinfo->thr_pending_commands[ii]),
+									 GTM_PROXY_BATCH_BUCKETS)]++;
+
 		/*
 		 * Start a new group message and fill in the headers
 		 */
@@ -3147,11 +3528,13 @@ ConnectGTM(void)
  */
 static void ReleaseCmdBackup(GTMProxy_CommandInfo *cmdinfo)
 {
-	GTMProxy_ConnID connIdx = cmdinfo->ci_conn->con_id;
+	GTMProxy_ConnectionInfo *conninfo = cmdinfo->ci_conn;
 
-	GetMyThreadInfo->thr_any_backup[connIdx] = FALSE;
-	GetMyThreadInfo->thr_qtype[connIdx] = 0;
-	resetStringInfo(&(GetMyThreadInfo->thr_inBufData[connIdx]));
+	if (conninfo->con_any_backup)
+		GetMyThreadInfo->thr_backup_count--;
+	conninfo->con_any_backup = false;
+	conninfo->con_qtype = 0;
+	resetStringInfo(&conninfo->con_inBufData);
 }
 
 
@@ -14,6 +14,7 @@
  */
 #include <pthread.h>
 #include "gtm/gtm_proxy.h"
+#include "gtm/assert.h"
 #include "gtm/memutils.h"
 #include "gtm/libpq.h"
 
@@ -334,7 +335,7 @@ GTMProxy_ThreadMainWrapper(void *argp)
  * Add the given connection info structure to a thread which is selected by a
  * round-robin manner. The caller is responsible for only accepting the
  * connection. Other things including the authentication is done by the worker
- * thread when it finds a new entry in the connection list.
+ * thread when it adopts the connection from its queue of new connections.
  *
  * Return the reference to the GTMProxy_ThreadInfo structure of the thread
  * which will be serving this connection
@@ -343,7 +344,6 @@ GTMProxy_ThreadInfo *
 GTMProxy_ThreadAddConnection(GTMProxy_ConnectionInfo *conninfo)
 {
 	GTMProxy_ThreadInfo *thrinfo = NULL;
-	GTMProxy_ConnID connIndx, ii;
 
 	/*
 	 * Get the next thread in the queue
@@ -368,72 +368,30 @@ GTMProxy_ThreadAddConnection(GTMProxy_ConnectionInfo *conninfo)
 	GTM_RWLockRelease(&GTMProxyThreads->gt_lock);
 
 	/*
-	 * Lock the threadninfo structure to safely add the new connection to the
-	 * thread structure. The thread will see the connection when it queries the
-	 * socket descriptor in the next cycle
+	 * Lock the threadninfo structure to safely queue the new connection. The
+	 * connection arrays belong to the worker thread, which picks the
+	 * connection up from the queue at the top of its next cycle and assigns
+	 * it a slot.
 	 */
 	GTM_MutexLockAcquire(&thrinfo->thr_lock);
 
-	if (thrinfo->thr_conn_count >= GTM_PROXY_MAX_CONNECTIONS)
+	if (thrinfo->thr_conn_count + thrinfo->thr_new_conn_count >=
+			GTM_PROXY_MAX_CONNECTIONS)
 	{
 		GTM_MutexLockRelease(&thrinfo->thr_lock);
 		elog(LOG, "Too many connections");
 		return NULL;
 	}
 
-	connIndx = -1;
-	for (ii = 0; ii < GTM_PROXY_MAX_CONNECTIONS; ii++)
-	{
-		if (thrinfo->thr_all_conns[ii] == NULL)
-		{
-			/*
-			 * Great, found a free slot to track the connection
-			 */
-			connIndx = ii;
-			break;
-		}
-	}
-
-	if (connIndx == -1)
-	{
-		GTM_MutexLockRelease(&thrinfo->thr_lock);
-		elog(LOG, "Too many connections - could not find a free slot");
-		return NULL;
-	}
+	conninfo->con_id = InvalidGTMProxyConnID;
+	conninfo->con_thrinfo = thrinfo;
+	conninfo->con_next = thrinfo->thr_new_conns;
+	thrinfo->thr_new_conns = conninfo;
+	thrinfo->thr_new_conn_count++;
 
 	/*
-	 * Save the array slotid in the conninfo structure. We send this to the GTM
-	 * server as an identifier which the GTM server sends us back in the
-	 * response. We use that information to route the response back to the
-	 * approrpiate connection.
-	 *
-	 * Note that the reason to use the array slotid in the messages to/from GTM
-	 * is to ensure that the corresponding connection can be quickly found
-	 * while proxying responses back to the client.
-	 */
-	conninfo->con_id = connIndx;
-	thrinfo->thr_all_conns[connIndx] = conninfo;
-
-	/*
-	 * We also maintain a map of currently used array slots in a separate data
-	 * structure. This allows us to quickly iterate through all open
-	 * connections servred by a thread. So while iterating through all open
-	 * connections, the correct mechanism would be something as follow:
-	 *
-	 * for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
-	 * {
-	 * 		int connIndx = thrinfo->thr_conn_map[ii];
-	 * 	 	GTMProxy_ConnectionInfo *conninfo = * 	 	thrinfo->thr_all_conns[connIndx];	
-	 * 	 	.....
-	 * }
-	 */  
-	thrinfo->thr_conn_map[thrinfo->thr_conn_count] = connIndx;
-	thrinfo->thr_conn_count++;
-
-	/*
-	 * Now increment the seqno since a new connection is added to the array.
-	 * Before we do the next poll(), the fd array will be forced to be
-	 * reconstructed.
+	 * Now increment the seqno since a new connection is pending. Before we
+	 * wait for events again, the worker will adopt it.
 	 */
    	thrinfo->thr_seqno++;
 
@@ -452,42 +410,202 @@ GTMProxy_ThreadAddConnection(GTMProxy_ConnectionInfo *conninfo)
 }
 
 /*
- * Remove the connection from the array and compact the array
+ * Double the size of the connection arrays of the worker thread
  */
-int
-GTMProxy_ThreadRemoveConnection(GTMProxy_ThreadInfo *thrinfo, GTMProxy_ConnectionInfo *conninfo)
+static void
+GTMProxy_ThreadEnlargeConnections(GTMProxy_ThreadInfo *thrinfo)
 {
-	int ii;
-	int connIndx;
+	MemoryContext oldContext;
+	uint32 oldsize = thrinfo->thr_conn_array_size;
+	uint32 newsize;
+	uint32 ii;
 
-	/*
-	 * Lock the threadninfo structure to safely remove the connection from the
-	 * thread structure.
-	 */
-	GTM_MutexLockAcquire(&thrinfo->thr_lock);
+	if (oldsize == 0)
+		newsize = GTM_PROXY_INIT_CONNECTIONS;
+	else
+		newsize = Min(oldsize * 2, GTM_PROXY_MAX_CONNECTIONS);
+
+	if (newsize <= oldsize)
+		elog(ERROR, "Too many connections");
+
+	oldContext = MemoryContextSwitchTo(TopMemoryContext);
+
+	if (oldsize == 0)
+	{
+		thrinfo->thr_all_conns = (GTMProxy_ConnectionInfo **)
+			palloc(newsize * sizeof (GTMProxy_ConnectionInfo *));
+		thrinfo->thr_conn_map = (int *) palloc(newsize * sizeof (int));
+		thrinfo->thr_ready_conns = (GTMProxy_ConnectionInfo **)
+			palloc(newsize * sizeof (GTMProxy_ConnectionInfo *));
+#ifdef HAVE_SYS_EPOLL_H
+		thrinfo->thr_epoll_events = (struct epoll_event *)
+			palloc(newsize * sizeof (struct epoll_event));
+#else
+		thrinfo->thr_poll_fds = (struct pollfd *)
+			palloc(newsize * sizeof (struct pollfd));
+#endif
+	}
+	else
+	{
+		thrinfo->thr_all_conns = (GTMProxy_ConnectionInfo **)
+			repalloc(thrinfo->thr_all_conns,
+					 newsize * sizeof (GTMProxy_ConnectionInfo *));
+		thrinfo->thr_conn_map = (int *)
+			repalloc(thrinfo->thr_conn_map, newsize * sizeof (int));
+		thrinfo->thr_ready_conns = (GTMProxy_ConnectionInfo **)
+			repalloc(thrinfo->thr_ready_conns,
+					 newsize * sizeof (GTMProxy_ConnectionInfo *));
+#ifdef HAVE_SYS_EPOLL_H
+		thrinfo->thr_epoll_events = (struct epoll_event *)
+			repalloc(thrinfo->thr_epoll_events,
+					 newsize * sizeof (struct epoll_event));
+#else
+		thrinfo->thr_poll_fds = (struct pollfd *)
+			repalloc(thrinfo->thr_poll_fds, newsize * sizeof (struct pollfd));
+#endif
+	}
 
-	connIndx = -1;
-	for (ii = 0; ii < GTM_PROXY_MAX_CONNECTIONS; ii++)
+	MemoryContextSwitchTo(oldContext);
+
+	for (ii = oldsize; ii < newsize; ii++)
+	{
+		thrinfo->thr_all_conns[ii] = NULL;
+		thrinfo->thr_conn_map[ii] = -1;
+	}
+
+	thrinfo->thr_conn_array_size = newsize;
+}
+
+/*
+ * Move the connections queued by the main thread into the connection array
+ * of the worker thread. Must be called by the worker thread itself, with
+ * thr_lock held.
+ */
+void
+GTMProxy_ThreadAdoptConnections(GTMProxy_ThreadInfo *thrinfo)
+{
+	while (thrinfo->thr_new_conns != NULL)
 	{
-		if (thrinfo->thr_all_conns[ii] == conninfo)
+		GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_new_conns;
+		GTMProxy_ConnID connIndx;
+		MemoryContext oldContext;
+
+		if (thrinfo->thr_conn_count >= thrinfo->thr_conn_array_size)
+			GTMProxy_ThreadEnlargeConnections(thrinfo);
+
+		/*
+		 * There is at least one free slot now. Slots are reused so that
+		 * connection ids stay within the range of GTMProxy_ConnID.
+		 */
+		for (connIndx = 0; connIndx < thrinfo->thr_conn_array_size; connIndx++)
 		{
-			connIndx = ii;
-			break;
+			if (thrinfo->thr_all_conns[connIndx] == NULL)
+				break;
+		}
+		Assert(connIndx < thrinfo->thr_conn_array_size);
+
+		thrinfo->thr_new_conns = conninfo->con_next;
+		thrinfo->thr_new_conn_count--;
+		conninfo->con_next = NULL;
+
+		/*
+		 * Save the array slotid in the conninfo structure. We send this to
+		 * the GTM server as an identifier which the GTM server sends us back
+		 * in the response. We use that information to route the response
+		 * back to the approrpiate connection.
+		 *
+		 * Note that the reason to use the array slotid in the messages
+		 * to/from GTM is to ensure that the corresponding connection can be
+		 * quickly found while proxying responses back to the client.
+		 */
+		conninfo->con_id = connIndx;
+		thrinfo->thr_all_conns[connIndx] = conninfo;
+
+		/*
+		 * We also maintain a map of currently used array slots in a separate
+		 * data structure. This allows us to quickly iterate through all open
+		 * connections servred by a thread. So while iterating through all
+		 * open connections, the correct mechanism would be something as
+		 * follow:
+		 *
+		 * for (ii = 0; ii < thrinfo->thr_conn_count; ii++)
+		 * {
+		 * 		int connIndx = thrinfo->thr_conn_map[ii];
+		 * 	 	GTMProxy_ConnectionInfo *conninfo = thrinfo->thr_all_conns[connIndx];
+		 * 	 	.....
+		 * }
+		 */
+		thrinfo->thr_conn_map[thrinfo->thr_conn_count] = connIndx;
+		thrinfo->thr_conn_count++;
+
+		/*
+		 * Initialize command backup area
+		 */
+		oldContext = MemoryContextSwitchTo(TopMemoryContext);
+		conninfo->con_any_backup = false;
+		conninfo->con_qtype = 0;
+		initStringInfo(&conninfo->con_inBufData);
+		conninfo->con_revents = 0;
+		MemoryContextSwitchTo(oldContext);
+
+		/*
+		 * Detect if the connection has been dropped to avoid a segmentation
+		 * fault. It is cleaned up like any other disconnected connection.
+		 */
+		if (conninfo->con_port == NULL)
+		{
+			conninfo->con_disconnected = true;
+			continue;
+		}
+
+#ifdef HAVE_SYS_EPOLL_H
+		{
+			struct epoll_event event;
+
+			/*
+			 * Level-triggered, so a connection whose data was not consumed
+			 * in one cycle is reported again in the next one. The socket is
+			 * dropped from the set implicitly when it is closed.
+			 */
+			event.events = EPOLLIN;
+			event.data.ptr = conninfo;
+			if (epoll_ctl(thrinfo->thr_epoll_fd, EPOLL_CTL_ADD,
+						  conninfo->con_port->sock, &event) < 0)
+			{
+				conninfo->con_disconnected = true;
+				elog(LOG, "could not add connection to epoll set: %m");
+			}
 		}
+#endif
 	}
+}
 
-	if (connIndx == -1)
-	{
-		GTM_MutexLockRelease(&thrinfo->thr_lock);
+/*
+ * Remove the connection from the array and compact the array
+ *
+ * Must be called by the worker thread serving the connection. The socket is
+ * expected to be closed already.
+ */
+int
+GTMProxy_ThreadRemoveConnection(GTMProxy_ThreadInfo *thrinfo, GTMProxy_ConnectionInfo *conninfo)
+{
+	int ii;
+	int connIndx = conninfo->con_id;
+
+	if (connIndx < 0 || connIndx >= thrinfo->thr_conn_array_size ||
+		thrinfo->thr_all_conns[connIndx] != conninfo)
 		elog(ERROR, "No such connection");
-	}
 
 	/*
 	 * Reset command backup info
 	 */
-	thrinfo->thr_any_backup[connIndx] = FALSE;
-	thrinfo->thr_qtype[connIndx] = 0;
-	resetStringInfo(&(thrinfo->thr_inBufData[connIndx]));
+	if (conninfo->con_any_backup)
+		thrinfo->thr_backup_count--;
+	conninfo->con_any_backup = false;
+	conninfo->con_qtype = 0;
+	if (conninfo->con_inBufData.data)
+		pfree(conninfo->con_inBufData.data);
+	conninfo->con_inBufData.data = NULL;
 	thrinfo->thr_all_conns[connIndx] = NULL;
 
 	/*
@@ -500,10 +618,13 @@ GTMProxy_ThreadRemoveConnection(GTMProxy_ThreadInfo *thrinfo, GTMProxy_Connectio
 	}
 
 	if (ii >= thrinfo->thr_conn_count)
-	{
-		GTM_MutexLockRelease(&thrinfo->thr_lock);
 		elog(FATAL, "Failed to find connection mapping to %d", connIndx);
-	}
+
+	/*
+	 * Lock the threadninfo structure, the main thread looks at the number of
+	 * connections when it queues new ones.
+	 */
+	GTM_MutexLockAcquire(&thrinfo->thr_lock);
 
 	/*
 	 * If this is the last entry in the array ? If not, then copy the last
@@ -526,8 +647,8 @@ GTMProxy_ThreadRemoveConnection(GTMProxy_ThreadInfo *thrinfo, GTMProxy_Connectio
 	thrinfo->thr_conn_count--;
 
 	/*
-	 * Increment the seqno to ensure that the next time before we poll, the fd
-	 * array is reconstructed.
+	 * Increment the seqno to ensure that the next time before we wait, the
+	 * fd array is reconstructed.
 	 */
 	thrinfo->thr_seqno++;
 	GTM_MutexLockRelease(&thrinfo->thr_lock);
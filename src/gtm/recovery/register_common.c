@@ -1238,5 +1238,37 @@ GTM_HandleGlobalXmin(GTM_PGXCNodeType type, char *node_name,
 	}
 
 
+	return global_xmin;
+}
+
+/*
+ * Return the current GTM_GlobalXmin for the given node.
+ *
+ * errcode is set as in GTM_HandleGlobalXmin if the node is not registered or
+ * currently excluded from the GTM_GlobalXmin computation, in which case the
+ * node must not use the returned value.
+ */
+GlobalTransactionId
+GTM_GetGlobalXmin(GTM_PGXCNodeType type, char *node_name, int *errcode)
+{
+	GTM_PGXCNodeInfo *nodeinfo;
+	GlobalTransactionId global_xmin;
+
+	GTM_RWLockAcquire(&PGXCNodesLock, GTM_LOCKMODE_READ);
+	global_xmin = GTM_GlobalXmin;
+	GTM_RWLockRelease(&PGXCNodesLock);
+
+	*errcode = 0;
+	nodeinfo = pgxcnode_find_info(type, node_name);
+	if (nodeinfo == NULL)
+		*errcode = GTM_ERRCODE_NODE_NOT_REGISTERED;
+	else
+	{
+		GTM_RWLockAcquire(&nodeinfo->node_lock, GTM_LOCKMODE_READ);
+		if (nodeinfo->excluded)
+			*errcode = GTM_ERRCODE_NODE_EXCLUDED;
+		GTM_RWLockRelease(&nodeinfo->node_lock);
+	}
+
 	return global_xmin;
 }
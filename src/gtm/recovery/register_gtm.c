@@ -155,6 +155,8 @@ ProcessPGXCNodeRegister(Port *myport, StringInfo message, bool is_backup)
 		 * Cascade standby may be allowed.
 		 */
 		GTM_DoForAllOtherThreads(finishStandbyConn);
+		/* And drop the backup messages meant for the old one */
+		GTM_StandbyLogReset();
 	}
 
 	if (Recovery_PGXCNodeRegister(type, node_name, port,
@@ -551,8 +553,9 @@ ProcessPGXCRegisterSession(Port *myport, StringInfo message)
 
 		do
 		{
-			_rc = register_session(GetMyThreadInfo->thr_conn->standby,
-								   coord_name, coord_procid, coord_backendid);
+			_rc = bkup_register_session(GetMyThreadInfo->thr_conn->standby,
+										coord_name, coord_procid,
+										coord_backendid);
 
 			elog(DEBUG1, "register_session() returns rc %d.", _rc);
 		}
@@ -0,0 +1,211 @@
+/*
+ * Microbenchmark of nextval throughput on GTM
+ *
+ * Starts a number of threads, each with a connection of its own, which call
+ * get_next() on a set of sequences for a given time, and reports the number
+ * of values obtained per second.  Run it against a GTM started with
+ * start.sh, for example:
+ *
+ *	bench_seq -t 16 -s 1000 -d 10
+ *
+ * Copyright (c) 2012-2014, TransLattice, Inc.
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "gtm/libpq-fe.h"
+#include "gtm/gtm_c.h"
+#include "gtm/gtm_client.h"
+#include "gtm/register.h"
+
+pthread_key_t     threadinfo_key;
+
+static char *host = "localhost";
+static int port = 6666;
+static int nthreads = 4;
+static int nsequences = 1;
+static int duration = 5;
+static GTM_Sequence range = 1;
+
+static volatile bool stop = false;
+
+typedef struct BenchThread
+{
+	pthread_t	thread;
+	int			id;
+	uint64		count;
+	uint64		errors;
+} BenchThread;
+
+static GTM_Conn *
+bench_connect(int id)
+{
+	char		connect_string[200];
+	GTM_Conn   *conn;
+
+	snprintf(connect_string, sizeof(connect_string),
+			 "host=%s port=%d node_name=bench_seq_%d remote_type=%d",
+			 host, port, id, GTM_NODE_COORDINATOR);
+
+	conn = PQconnectGTM(connect_string);
+	if (conn == NULL || GTMPQstatus(conn) != CONNECTION_OK)
+	{
+		fprintf(stderr, "could not connect to GTM at %s:%d\n", host, port);
+		exit(1);
+	}
+	return conn;
+}
+
+static void
+bench_key(GTM_SequenceKey seqkey, char *buf, size_t len, int i)
+{
+	snprintf(buf, len, "bench_seq.public.seq%d", i);
+	seqkey->gsk_key = buf;
+	seqkey->gsk_keylen = strlen(buf) + 1;
+	seqkey->gsk_type = GTM_SEQ_FULL_NAME;
+}
+
+static void *
+bench_thread(void *arg)
+{
+	BenchThread *bt = (BenchThread *) arg;
+	GTM_Conn   *conn = bench_connect(bt->id);
+	int			i = bt->id % nsequences;
+
+	while (!stop)
+	{
+		GTM_SequenceKeyData seqkey;
+		char		key[64];
+		GTM_Sequence result;
+		GTM_Sequence rangemax;
+
+		bench_key(&seqkey, key, sizeof(key), i);
+		if (get_next(conn, &seqkey, "bench_seq", bt->id + 1, range,
+					 &result, &rangemax) == 0)
+			bt->count += rangemax - result + 1;
+		else
+			bt->errors++;
+
+		if (++i == nsequences)
+			i = 0;
+	}
+
+	GTMPQfinish(conn);
+	return NULL;
+}
+
+static void
+usage(const char *progname)
+{
+	fprintf(stderr,
+			"Usage: %s [-h host] [-p port] [-t threads] [-s sequences] "
+			"[-d seconds] [-r range]\n", progname);
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	GTM_Conn   *conn;
+	BenchThread *threads;
+	struct timeval start;
+	struct timeval end;
+	double		elapsed;
+	uint64		total = 0;
+	uint64		errors = 0;
+	int			c;
+	int			i;
+
+	while ((c = getopt(argc, argv, "h:p:t:s:d:r:")) != -1)
+	{
+		switch (c)
+		{
+			case 'h':
+				host = optarg;
+				break;
+			case 'p':
+				port = atoi(optarg);
+				break;
+			case 't':
+				nthreads = atoi(optarg);
+				break;
+			case 's':
+				nsequences = atoi(optarg);
+				break;
+			case 'd':
+				duration = atoi(optarg);
+				break;
+			case 'r':
+				range = atoll(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (nthreads < 1 || nsequences < 1 || duration < 1 || range < 1)
+		usage(argv[0]);
+
+	/* Create the sequences, dropping leftovers of an earlier run */
+	conn = bench_connect(0);
+	for (i = 0; i < nsequences; i++)
+	{
+		GTM_SequenceKeyData seqkey;
+		char		key[64];
+
+		bench_key(&seqkey, key, sizeof(key), i);
+		close_sequence(conn, &seqkey, InvalidGlobalTransactionId);
+		if (open_sequence(conn, &seqkey, 1, 1, INT64CONST(0x7ffffffffffffffe),
+						  1, false, InvalidGlobalTransactionId) < 0)
+		{
+			fprintf(stderr, "could not create sequence %s\n", key);
+			exit(1);
+		}
+	}
+
+	threads = (BenchThread *) calloc(nthreads, sizeof(BenchThread));
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < nthreads; i++)
+	{
+		threads[i].id = i;
+		if (pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]))
+		{
+			fprintf(stderr, "could not create thread\n");
+			exit(1);
+		}
+	}
+
+	sleep(duration);
+	stop = true;
+
+	for (i = 0; i < nthreads; i++)
+	{
+		pthread_join(threads[i].thread, NULL);
+		total += threads[i].count;
+		errors += threads[i].errors;
+	}
+	gettimeofday(&end, NULL);
+
+	elapsed = (end.tv_sec - start.tv_sec) +
+		(end.tv_usec - start.tv_usec) / 1000000.0;
+
+	printf("threads: %d, sequences: %d, range: " INT64_FORMAT "\n",
+		   nthreads, nsequences, range);
+	printf("values: " UINT64_FORMAT ", errors: " UINT64_FORMAT
+		   ", elapsed: %.2f s\n", total, errors, elapsed);
+	printf("throughput: %.0f values/s\n", total / elapsed);
+
+	for (i = 0; i < nsequences; i++)
+	{
+		GTM_SequenceKeyData seqkey;
+		char		key[64];
+
+		bench_key(&seqkey, key, sizeof(key), i);
+		close_sequence(conn, &seqkey, InvalidGlobalTransactionId);
+	}
+	GTMPQfinish(conn);
+
+	return errors > 0;
+}
@@ -0,0 +1,236 @@
+/*
+ * Microbenchmark of snapshot throughput on GTM
+ *
+ * Compares the GTM work behind the two kinds of global snapshots: "gtm"
+ * snapshots carry the list of open transactions, while "timestamp" ones
+ * (global_snapshot_source = timestamp) only need a timestamp from GTM, plus
+ * another one at commit. Each thread runs transactions on a connection of
+ * its own, a given percentage of them read-only, while a number of other
+ * transactions are kept open so that the snapshots are not empty. Run it
+ * against a GTM started with start.sh, for example:
+ *
+ *	bench_snapshot -m gtm -t 16 -o 200 -d 10
+ *	bench_snapshot -m timestamp -t 16 -o 200 -d 10
+ *
+ * Copyright (c) 2012-2014, TransLattice, Inc.
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "gtm/libpq-fe.h"
+#include "gtm/gtm_c.h"
+#include "gtm/gtm_client.h"
+#include "gtm/register.h"
+
+pthread_key_t     threadinfo_key;
+
+static char *host = "localhost";
+static int port = 6666;
+static int nthreads = 4;
+static int nopen = 100;
+static int readonly = 50;
+static int duration = 5;
+static bool use_timestamp = false;
+
+static volatile bool stop = false;
+
+typedef struct BenchThread
+{
+	pthread_t	thread;
+	int			id;
+	uint64		count;
+	uint64		errors;
+} BenchThread;
+
+static GTM_Conn *
+bench_connect(int id)
+{
+	char		connect_string[200];
+	GTM_Conn   *conn;
+
+	snprintf(connect_string, sizeof(connect_string),
+			 "host=%s port=%d node_name=bench_snapshot_%d remote_type=%d",
+			 host, port, id, GTM_NODE_COORDINATOR);
+
+	conn = PQconnectGTM(connect_string);
+	if (conn == NULL || GTMPQstatus(conn) != CONNECTION_OK)
+	{
+		fprintf(stderr, "could not connect to GTM at %s:%d\n", host, port);
+		exit(1);
+	}
+	return conn;
+}
+
+/*
+ * Run one transaction the way a Coordinator would, returns false on error
+ */
+static bool
+bench_transaction(GTM_Conn *conn, bool read_only)
+{
+	GlobalTransactionId gxid = InvalidGlobalTransactionId;
+	GTM_Timestamp timestamp;
+
+	if (!read_only)
+	{
+		gxid = begin_transaction(conn, GTM_ISOLATION_RC, NULL, &timestamp);
+		if (gxid == InvalidGlobalTransactionId)
+			return false;
+	}
+
+	if (use_timestamp)
+	{
+		if (get_timestamp(conn, &timestamp) != 0)
+			return false;
+	}
+	else if (get_snapshot(conn, gxid, true) == NULL)
+		return false;
+
+	if (read_only)
+		return true;
+
+	/* the commit timestamp */
+	if (use_timestamp && get_timestamp(conn, &timestamp) != 0)
+		return false;
+
+	return commit_transaction(conn, gxid, 0, NULL) == 0;
+}
+
+static void *
+bench_thread(void *arg)
+{
+	BenchThread *bt = (BenchThread *) arg;
+	GTM_Conn   *conn = bench_connect(bt->id + 1);
+	uint64		n = 0;
+
+	while (!stop)
+	{
+		if (bench_transaction(conn, (n++ % 100) < readonly))
+			bt->count++;
+		else
+			bt->errors++;
+	}
+
+	GTMPQfinish(conn);
+	return NULL;
+}
+
+static void
+usage(const char *progname)
+{
+	fprintf(stderr,
+			"Usage: %s [-h host] [-p port] [-m gtm|timestamp] [-t threads] "
+			"[-o open transactions] [-r read-only percent] [-d seconds]\n",
+			progname);
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	GTM_Conn   *conn;
+	GlobalTransactionId *open_gxids;
+	BenchThread *threads;
+	struct timeval start;
+	struct timeval end;
+	double		elapsed;
+	uint64		total = 0;
+	uint64		errors = 0;
+	int			c;
+	int			i;
+
+	while ((c = getopt(argc, argv, "h:p:m:t:o:r:d:")) != -1)
+	{
+		switch (c)
+		{
+			case 'h':
+				host = optarg;
+				break;
+			case 'p':
+				port = atoi(optarg);
+				break;
+			case 'm':
+				if (strcmp(optarg, "timestamp") == 0)
+					use_timestamp = true;
+				else if (strcmp(optarg, "gtm") == 0)
+					use_timestamp = false;
+				else
+					usage(argv[0]);
+				break;
+			case 't':
+				nthreads = atoi(optarg);
+				break;
+			case 'o':
+				nopen = atoi(optarg);
+				break;
+			case 'r':
+				readonly = atoi(optarg);
+				break;
+			case 'd':
+				duration = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (nthreads < 1 || nopen < 0 || readonly < 0 || readonly > 100 ||
+		duration < 1)
+		usage(argv[0]);
+
+	/* Keep some transactions open for the snapshots to list */
+	conn = bench_connect(0);
+	open_gxids = (GlobalTransactionId *)
+		calloc(nopen + 1, sizeof(GlobalTransactionId));
+	for (i = 0; i < nopen; i++)
+	{
+		GTM_Timestamp timestamp;
+
+		open_gxids[i] = begin_transaction(conn, GTM_ISOLATION_RC, NULL,
+										  &timestamp);
+		if (open_gxids[i] == InvalidGlobalTransactionId)
+		{
+			fprintf(stderr, "could not begin transaction\n");
+			exit(1);
+		}
+	}
+
+	threads = (BenchThread *) calloc(nthreads, sizeof(BenchThread));
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < nthreads; i++)
+	{
+		threads[i].id = i;
+		if (pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]))
+		{
+			fprintf(stderr, "could not create thread\n");
+			exit(1);
+		}
+	}
+
+	sleep(duration);
+	stop = true;
+
+	for (i = 0; i < nthreads; i++)
+	{
+		pthread_join(threads[i].thread, NULL);
+		total += threads[i].count;
+		errors += threads[i].errors;
+	}
+	gettimeofday(&end, NULL);
+
+	elapsed = (end.tv_sec - start.tv_sec) +
+		(end.tv_usec - start.tv_usec) / 1000000.0;
+
+	printf("mode: %s, threads: %d, open transactions: %d, read-only: %d%%\n",
+		   use_timestamp ? "timestamp" : "gtm", nthreads, nopen, readonly);
+	printf("transactions: " UINT64_FORMAT ", errors: " UINT64_FORMAT
+		   ", elapsed: %.2f s\n", total, errors, elapsed);
+	printf("throughput: %.0f transactions/s\n", total / elapsed);
+
+	for (i = 0; i < nopen; i++)
+		commit_transaction(conn, open_gxids[i], 0, NULL);
+	GTMPQfinish(conn);
+
+	return errors > 0;
+}
@@ -13,7 +13,7 @@ echo "cleaning standby..."
 export DATA=/tmp/pgxc/data/gtm_standby
 
 pushd $DATA
-rm -rf gtm.control gtm.opts gtm.pid register.node
+rm -rf gtm.control gtm_wal.* gtm.opts gtm.pid register.node
 cat /dev/null > gtm.log
 popd
 
@@ -24,6 +24,6 @@ echo "cleaning active..."
 export DATA=/tmp/pgxc/data/gtm
 
 pushd $DATA
-rm -rf gtm.control gtm.opts gtm.pid register.node
+rm -rf gtm.control gtm_wal.* gtm.opts gtm.pid register.node
 cat /dev/null > gtm.log
 popd
@@ -10,6 +10,7 @@ cat /dev/null>regress.log
 ./test_node 2>&1 | tee -a regress.log
 ./test_txn 2>&1 | tee -a regress.log
 ./test_seq 2>&1 | tee -a regress.log
+./test_wal 2>&1 | tee -a regress.log
 
 echo ""
 echo "=========== SUMMARY ============"
@@ -124,6 +124,36 @@ test_standby_04()
 	TEARDOWN();
 }
 
+void
+test_standby_05()
+{
+	GlobalTransactionId gxid;
+	int rc;
+
+	SETUP();
+	connect1();
+	_ASSERT( conn!=NULL );
+
+	/* The standby stops answering, but keeps its connections open */
+	system("killall -STOP gtm_standby");
+
+	gxid = begin_transaction(conn, GTM_ISOLATION_SERIALIZABLE, timestamp);
+	_ASSERT( gxid != InvalidGlobalTransactionId );
+	rc = commit_transaction(conn, gxid);
+	_ASSERT( rc>=0 );
+
+	/* The active GTM drops the standby once the timeout expires */
+	sleep(25);
+	_ASSERT( grep_count(LOG_ACTIVE, "the backup is discontinued")==1 );
+
+	gxid = begin_transaction(conn, GTM_ISOLATION_SERIALIZABLE, timestamp);
+	_ASSERT( gxid != InvalidGlobalTransactionId );
+
+	system("killall -CONT gtm_standby");
+
+	TEARDOWN();
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -134,5 +164,7 @@ main(int argc, char *argv[])
 
 	test_standby_04(); /* promote */
 
+	test_standby_05(); /* standby not answering */
+
 	return 0;
 }
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2010-2012 Postgres-XC Development Group
+ */
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "gtm/libpq-fe.h"
+#include "gtm/gtm_c.h"
+#include "gtm/gtm_client.h"
+
+#include "test_common.h"
+
+pthread_key_t     threadinfo_key;
+
+void
+setUp()
+{
+	system("./stop.sh > /dev/null");
+	system("./clean.sh > /dev/null");
+	system("./start_a.sh > /dev/null");
+	sleep(3);
+}
+
+void
+tearDown()
+{
+	GTMPQfinish(conn);
+}
+
+/*
+ * Kill GTM without letting it write a checkpoint, and start it again.  It
+ * can only get its state back from the WAL.
+ */
+void
+crash_restart()
+{
+	GTMPQfinish(conn);
+
+	system("killall -9 gtm");
+	system("./start_a.sh > /dev/null");
+	sleep(3);
+
+	connect1();
+}
+
+void
+test_wal_01()
+{
+	GlobalTransactionId gxid;
+	GlobalTransactionId next_gxid;
+	int i;
+	int rc;
+
+	SETUP();
+	connect1();
+	_ASSERT( conn!=NULL );
+
+	for (i = 0; i < 10; i++)
+	{
+		gxid = begin_transaction(conn, GTM_ISOLATION_RC, NULL, timestamp);
+		_ASSERT( gxid != InvalidGlobalTransactionId );
+		rc = commit_transaction(conn, gxid, 0, NULL);
+		_ASSERT( rc>=0 );
+	}
+	next_gxid = get_next_gxid(conn);
+	_ASSERT( next_gxid != InvalidGlobalTransactionId );
+
+	crash_restart();
+	_ASSERT( conn!=NULL );
+
+	/* GXIDs resume where they were, without any gap */
+	_ASSERT( get_next_gxid(conn)==next_gxid );
+
+	gxid = begin_transaction(conn, GTM_ISOLATION_RC, NULL, timestamp);
+	_ASSERT( gxid==next_gxid );
+
+	TEARDOWN();
+}
+
+void
+test_wal_02()
+{
+	GTM_SequenceKeyData seqkey;
+	GTM_Sequence result;
+	GTM_Sequence rangemax;
+	int i;
+	int rc;
+
+	SETUP();
+	connect1();
+	_ASSERT( conn!=NULL );
+
+	seqkey.gsk_key    = strdup("wal_seq");
+	seqkey.gsk_keylen = strlen(seqkey.gsk_key) + 1;
+	seqkey.gsk_type   = GTM_SEQ_FULL_NAME;
+
+	rc = open_sequence(conn, &seqkey, 1, 1, 10000, 1, false,
+					   InvalidGlobalTransactionId);
+	_ASSERT( rc>=0 );
+
+	for (i = 1; i <= 3; i++)
+	{
+		rc = get_next(conn, &seqkey, "coord1", 1, 1, &result, &rangemax);
+		_ASSERT( rc>=0 );
+		_ASSERT( result==i );
+	}
+
+	rc = set_val(conn, &seqkey, "coord1", 1, 100, true);
+	_ASSERT( rc>=0 );
+	rc = get_next(conn, &seqkey, "coord1", 1, 1, &result, &rangemax);
+	_ASSERT( rc>=0 );
+	_ASSERT( result==101 );
+
+	crash_restart();
+	_ASSERT( conn!=NULL );
+
+	/* The sequence is still there, and goes on from its last value */
+	rc = get_next(conn, &seqkey, "coord1", 1, 1, &result, &rangemax);
+	_ASSERT( rc>=0 );
+	_ASSERT( result==102 );
+
+	rc = close_sequence(conn, &seqkey, InvalidGlobalTransactionId);
+	_ASSERT( rc>=0 );
+
+	TEARDOWN();
+}
+
+void
+test_wal_03()
+{
+	GTM_SequenceKeyData seqkey;
+	GTM_Sequence result;
+	GTM_Sequence rangemax;
+	int rc;
+
+	SETUP();
+	connect1();
+	_ASSERT( conn!=NULL );
+
+	seqkey.gsk_key    = strdup("wal_seq");
+	seqkey.gsk_keylen = strlen(seqkey.gsk_key) + 1;
+	seqkey.gsk_type   = GTM_SEQ_FULL_NAME;
+
+	rc = open_sequence(conn, &seqkey, 1, 1, 10000, 1, false,
+					   InvalidGlobalTransactionId);
+	_ASSERT( rc>=0 );
+
+	/* A range handed out is never handed out again */
+	rc = get_next(conn, &seqkey, "coord1", 1, 50, &result, &rangemax);
+	_ASSERT( rc>=0 );
+	_ASSERT( result==1 );
+	_ASSERT( rangemax==50 );
+
+	/* Twice, the WAL replayed at the first restart has to be kept */
+	crash_restart();
+	_ASSERT( conn!=NULL );
+	crash_restart();
+	_ASSERT( conn!=NULL );
+
+	rc = get_next(conn, &seqkey, "coord1", 1, 1, &result, &rangemax);
+	_ASSERT( rc>=0 );
+	_ASSERT( result==51 );
+
+	TEARDOWN();
+}
+
+int
+main(int argc, char *argv[])
+{
+	test_wal_01();	/* GXIDs */
+	test_wal_02();	/* sequence values */
+	test_wal_03();	/* sequence ranges, restarted twice */
+
+	return 0;
+}
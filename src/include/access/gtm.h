@@ -16,6 +16,7 @@
 extern char *GtmHost;
 extern int GtmPort;
 extern bool gtm_backup_barrier;
+extern char *GtmSequenceServers;
 
 extern bool IsXidFromGTM;
 extern GlobalTransactionId currentGxid;
@@ -35,13 +36,19 @@ extern int PrepareTranGTM(GlobalTransactionId gxid);
 extern int GetGIDDataGTM(char *gid,
 						 GlobalTransactionId *gxid,
 						 GlobalTransactionId *prepared_gxid,
-						 char **nodestring);
+						 char **nodestring,
+						 bool *attached);
+extern int GetGIDDataGTMMulti(int count, char **gids,
+							  GlobalTransactionId *gxid,
+							  GlobalTransactionId *prepared_gxid,
+							  bool *attached);
 extern int CommitPreparedTranGTM(GlobalTransactionId gxid,
 								 GlobalTransactionId prepared_gxid,
 								 int waited_xid_count,
 								 GlobalTransactionId *waited_xids);
 
 extern GTM_Snapshot GetSnapshotGTM(GlobalTransactionId gxid, bool canbe_grouped);
+extern GTM_Timestamp GetTimestampGTM(void);
 
 /* Node registration APIs with GTM */
 extern int RegisterGTM(GTM_PGXCNodeType type);
@@ -60,9 +67,18 @@ extern int AlterSequenceGTM(char *seqname, GTM_Sequence increment,
 							GTM_Sequence lastval, bool cycle, bool is_restart);
 extern int DropSequenceGTM(char *name, GTM_SequenceKeyType type);
 extern int RenameSequenceGTM(char *seqname, const char *newseqname);
+extern void AtPrepare_SequenceActions(void);
+extern void sequence_twophase_postcommit(TransactionId xid, uint16 info,
+							 void *recdata, uint32 len);
+extern void sequence_twophase_postabort(TransactionId xid, uint16 info,
+							void *recdata, uint32 len);
 /* Barrier */
 extern int ReportBarrierGTM(const char *barrier_id);
 extern int ReportGlobalXmin(GlobalTransactionId gxid,
 		GlobalTransactionId *global_xmin,
 		GlobalTransactionId *latest_completed_xid);
+extern pgsocket SubscribeGlobalXminGTM(void);
+extern void UnsubscribeGlobalXminGTM(void);
+extern int ReceiveGlobalXminGTM(GlobalTransactionId *global_xmin,
+		GlobalTransactionId *latest_completed_xid);
 #endif /* ACCESS_GTM_H */
@@ -26,7 +26,12 @@ typedef uint8 TwoPhaseRmgrId;
 #define TWOPHASE_RM_PGSTAT_ID		2
 #define TWOPHASE_RM_MULTIXACT_ID	3
 #define TWOPHASE_RM_PREDICATELOCK_ID	4
+#ifdef XCP
+#define TWOPHASE_RM_SEQUENCE_ID		5
+#define TWOPHASE_RM_MAX_ID			TWOPHASE_RM_SEQUENCE_ID
+#else
 #define TWOPHASE_RM_MAX_ID			TWOPHASE_RM_PREDICATELOCK_ID
+#endif
 
 extern const TwoPhaseCallback twophase_recover_callbacks[];
 extern const TwoPhaseCallback twophase_postcommit_callbacks[];
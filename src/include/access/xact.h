@@ -373,6 +373,13 @@ extern void SetCurrentStatementStartTimestamp(void);
 extern TimestampTz GetCurrentGTMStartTimestamp(void);
 extern void SetCurrentGTMDeltaTimestamp(TimestampTz timestamp);
 #endif
+#ifdef XCP
+extern void SetXactSnapshotTimestamp(TimestampTz timestamp);
+extern void NextXactSnapshotTimestamp(void);
+extern TimestampTz AssignXactSnapshotTimestamp(void);
+extern void SetXactCommitTimestamp(TimestampTz timestamp);
+extern TimestampTz AssignXactCommitTimestamp(void);
+#endif
 extern int	GetCurrentTransactionNestLevel(void);
 extern bool TransactionIdIsCurrentTransactionId(TransactionId xid);
 extern void CommandCounterIncrement(void);
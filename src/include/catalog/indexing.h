@@ -303,6 +303,9 @@ DECLARE_UNIQUE_INDEX(pg_user_mapping_user_server_index, 175, on pg_user_mapping
 DECLARE_UNIQUE_INDEX(pgxc_class_pcrelid_index, 9002, on pgxc_class using btree(pcrelid oid_ops));
 #define PgxcClassPgxcRelIdIndexId 	9002
 
+DECLARE_UNIQUE_INDEX(pgxc_class_stats_relid_node_index, 9005, on pgxc_class_stats using btree(pcsrelid oid_ops, pcsnode oid_ops));
+#define PgxcClassStatsRelidNodeIndexId	9005
+
 DECLARE_UNIQUE_INDEX(pgxc_node_oid_index, 9010, on pgxc_node using btree(oid oid_ops));
 #define PgxcNodeOidIndexId			9010
 
@@ -5388,6 +5388,20 @@ DATA(insert OID = 7024 (  pgxc_is_inprogress	PGNSP PGUID 12 1 1 0 0 f f f f t t
 DESCR("is given GXID in progress?");
 DATA(insert OID = 7011 ( pgxc_lock_for_backup PGNSP PGUID 12 1 0 0 0 f f f f t f v u 0 0 16 "" _null_ _null_ _null_ _null_ _null_ pgxc_lock_for_backup _null_ _null_ _null_ ));
 DESCR("lock the cluster for taking backup");
+DATA(insert OID = 7012 ( pgxc_stat_get_remote_query_waits PGNSP PGUID 12 1 100 0 0 f f f f f t v r 0 0 2249 "" "{26,20,25,20,701,701,701,701,701,701,701}" "{o,o,o,o,o,o,o,o,o,o,o}" "{dbid,queryid,query,calls,gtm_time,receive_time,squeue_read_time,squeue_write_time,prepare_time,commit_time,pooler_time}" _null_ _null_ pgxc_stat_get_remote_query_waits _null_ _null_ _null_ ));
+DESCR("statistics: time statements waited on GTM, remote nodes, shared queues and the pooler");
+DATA(insert OID = 7013 ( pgxc_stat_get_remote_node_waits PGNSP PGUID 12 1 10 0 0 f f f f f t v r 0 0 2249 "" "{19,25,20,701}" "{o,o,o,o}" "{node_name,wait_class,waits,wait_time}" _null_ _null_ pgxc_stat_get_remote_node_waits _null_ _null_ _null_ ));
+DESCR("statistics: time spent waiting on each remote node");
+DATA(insert OID = 7014 ( pgxc_stat_reset_remote_waits PGNSP PGUID 12 1 0 0 0 f f f f f f v r 0 0 2278 "" _null_ _null_ _null_ _null_ _null_ pgxc_stat_reset_remote_waits _null_ _null_ _null_ ));
+DESCR("statistics: discard the statistics of remote waits");
+DATA(insert OID = 7017 ( pgxc_stat_get_cluster_query_waits PGNSP PGUID 12 1 1000 0 0 f f f f f t v u 0 0 2249 "" "{19,26,20,25,20,701,701,701,701,701,701,701}" "{o,o,o,o,o,o,o,o,o,o,o,o}" "{node_name,dbid,queryid,query,calls,gtm_time,receive_time,squeue_read_time,squeue_write_time,prepare_time,commit_time,pooler_time}" _null_ _null_ pgxc_stat_get_cluster_query_waits _null_ _null_ _null_ ));
+DESCR("statistics: time statements waited on every node of the cluster");
+DATA(insert OID = 7018 ( pgxc_stat_get_cluster_node_waits PGNSP PGUID 12 1 100 0 0 f f f f f t v u 0 0 2249 "" "{19,19,25,20,701}" "{o,o,o,o,o}" "{waiting_node,node_name,wait_class,waits,wait_time}" _null_ _null_ pgxc_stat_get_cluster_node_waits _null_ _null_ _null_ ));
+DESCR("statistics: time every node of the cluster spent waiting on each of the others");
+DATA(insert OID = 7015 ( pgxc_stat_get_pool_nodes PGNSP PGUID 12 1 10 0 0 f f f f f t v r 0 0 2249 "" "{19,18,16,1184,20,20,20,20,20,701}" "{o,o,o,o,o,o,o,o,o,o}" "{node_name,node_type,healthy,unhealthy_since,connect_failures,connect_timeouts,fast_failures,probes,failed_probes,wait_time}" _null_ _null_ pgxc_stat_get_pool_nodes _null_ _null_ _null_ ));
+DESCR("statistics: health of the nodes as seen by the pooler");
+DATA(insert OID = 7016 ( pgxc_in_doubt_xacts PGNSP PGUID 12 1 10 0 0 f f f f t t v r 1 0 2249 "23" "{23,25,25}" "{i,o,o}" "{min_age,gid,action}" _null_ _null_ pgxc_in_doubt_xacts _null_ _null_ _null_ ));
+DESCR("what the 2PC resolver would do with the in-doubt transactions of the database");
 #endif
 
 /* pg_upgrade support */
@@ -0,0 +1,58 @@
+/*-------------------------------------------------------------------------
+ *
+ * pgxc_class_stats.h
+ *	  definition of the system "per-node statistics of distributed tables"
+ *	  relation (pgxc_class_stats)
+ *
+ * One row per distributed table and Datanode, filled by ANALYZE on the
+ * Coordinator, to tell how evenly the rows of the table are spread.
+ *
+ * Portions Copyright (c) 2012-2014, TransLattice, Inc.
+ *
+ * src/include/catalog/pgxc_class_stats.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PGXC_CLASS_STATS_H
+#define PGXC_CLASS_STATS_H
+
+#include "catalog/genbki.h"
+
+#define PgxcClassStatsRelationId  9004
+
+CATALOG(pgxc_class_stats,9004) BKI_WITHOUT_OIDS
+{
+	Oid			pcsrelid;		/* Table Oid */
+	Oid			pcsnode;		/* Datanode Oid */
+	float4		pcsreltuples;	/* number of rows on the node */
+	int32		pcsrelpages;	/* number of pages on the node */
+
+#ifdef CATALOG_VARLEN			/* variable-length fields start here */
+	text		pcsmcvvalues[1];	/* most common values of the distribution
+									 * column on the node */
+	float4		pcsmcvfreqs[1];	/* their frequencies among the rows of the
+								 * node */
+#endif
+} FormData_pgxc_class_stats;
+
+typedef FormData_pgxc_class_stats *Form_pgxc_class_stats;
+
+#define Natts_pgxc_class_stats				6
+
+#define Anum_pgxc_class_stats_pcsrelid		1
+#define Anum_pgxc_class_stats_pcsnode		2
+#define Anum_pgxc_class_stats_pcsreltuples	3
+#define Anum_pgxc_class_stats_pcsrelpages	4
+#define Anum_pgxc_class_stats_pcsmcvvalues	5
+#define Anum_pgxc_class_stats_pcsmcvfreqs	6
+
+/* Most common values of the distribution column kept per node */
+#define PGXC_CLASS_STATS_MCV_COUNT			10
+
+extern void PgxcClassStatsStore(Oid pcsrelid, Oid pcsnode,
+					float4 reltuples, int32 relpages,
+					Datum mcvvalues, Datum mcvfreqs);
+extern void RemovePgxcClassStats(Oid pcsrelid);
+extern double GetPgxcClassSkew(Oid pcsrelid);
+
+#endif   /* PGXC_CLASS_STATS_H */
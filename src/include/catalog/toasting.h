@@ -55,6 +55,7 @@ DECLARE_TOAST(pg_seclabel, 3598, 3599);
 DECLARE_TOAST(pg_statistic, 2840, 2841);
 DECLARE_TOAST(pg_statistic_ext, 3439, 3440);
 DECLARE_TOAST(pg_trigger, 2336, 2337);
+DECLARE_TOAST(pgxc_class_stats, 9006, 9007);
 
 /* shared catalogs */
 DECLARE_TOAST(pg_shdescription, 2846, 2847);
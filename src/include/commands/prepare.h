@@ -74,6 +74,7 @@ extern void DropAllPreparedStatements(void);
 extern DatanodeStatement *FetchDatanodeStatement(const char *stmt_name, bool throwError);
 extern bool ActivateDatanodeStatementOnNode(const char *stmt_name, int noid);
 extern bool HaveActiveDatanodeStatements(void);
+extern void ForgetDatanodeStatements(void);
 extern void DropDatanodeStatement(const char *stmt_name);
 extern int SetRemoteStatementName(Plan *plan, const char *stmt_name, int num_params,
 						Oid *param_types, int n);
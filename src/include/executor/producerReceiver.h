@@ -29,5 +29,6 @@ extern DestReceiver *SetSelfConsumerDestReceiver(DestReceiver *self,
 							DestReceiver *consumer);
 extern void SetProducerTempMemory(DestReceiver *self, MemoryContext tmpcxt);
 extern bool ProducerReceiverPushBuffers(DestReceiver *self);
+extern int	ProducerGetSentRows(DestReceiver *self, int **nodes, long **rows);
 
 #endif   /* PRODUCER_RECEIVER_H */
@@ -59,6 +59,9 @@ typedef struct GTM_ThreadInfo
 	GTM_RWLock			thr_lock;
 	gtm_List			*thr_cached_txninfo;
 	GTM_SnapshotData    thr_snapshot;
+	uint64				thr_standby_lsn;	/* end of our last message in
+											 * the standby log */
+	uint64				thr_wal_lsn;		/* end of our last WAL record */
 
 	/*
 	 * Statically allocated XID array for the snapshot. Every thread will need
@@ -83,6 +86,7 @@ extern GTM_Threads *GTMThreads;
 
 typedef struct GTM_RestoreContext {
 	int	version;
+	uint64	wal_redo;	/* where to start the WAL replay, if saved */
 } GTM_RestoreContext;
 
 int GTM_ThreadAdd(GTM_ThreadInfo *thrinfo);
@@ -147,6 +151,6 @@ extern GTM_ThreadID						TopMostThreadID;
 	((((a) + 1) == UINT32_MAX) ? 1 : ((a) + 1))
 
 #define GTM_CONTROL_FILE		"gtm.control"
-#define GTM_CONTROL_VERSION		20160302
+#define GTM_CONTROL_VERSION		20261019
 
 #endif
@@ -18,13 +18,8 @@
 #include "gtm/gtm_lock.h"
 #include "gtm/gtm_seq.h"
 
-extern GTM_RWLock	gtm_bkup_lock;
-
 #define RestoreDuration	2000
 
-extern void GTM_WriteRestorePoint(void);
-extern void GTM_SetNeedBackup(void);
-extern bool GTM_NeedBackup(void);
 extern void GTM_WriteBarrierBackup(char *barrier_id);
 
 #endif /* GTM_BACKUP_H */
@@ -112,6 +112,8 @@ typedef struct GTM_SnapshotData
 	GlobalTransactionId		sn_xmax;
 	uint32				sn_xcnt;
 	GlobalTransactionId		*sn_xip;
+	uint64				sn_seqno;	/* transactions completed on GTM when the
+									 * snapshot was taken */
 } GTM_SnapshotData;
 
 typedef GTM_SnapshotData *GTM_Snapshot;
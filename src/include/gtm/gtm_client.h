@@ -22,6 +22,15 @@
 #include "gtm/register.h"
 #include "gtm/libpq-fe.h"
 
+/* What MSG_TXN_GET_GID_DATA_MULTI returns for each GID */
+typedef struct GTM_GIDData
+{
+	int				status;			/* STATUS_OK if GTM knows the GID */
+	GlobalTransactionId gxid;		/* to finish the transaction with */
+	GlobalTransactionId prepared_gxid;
+	bool			attached;		/* the preparing session is still there */
+} GTM_GIDData;
+
 typedef union GTM_ResultData
 {
 	GTM_TransactionHandle		grd_txnhandle;	/* TXN_BEGIN */
@@ -95,8 +104,15 @@ typedef union GTM_ResultData
 		GlobalTransactionId		prepared_gxid;
 		int				nodelen;
 		char			*nodestring;
+		bool			attached;
 	} grd_txn_get_gid_data;					/* TXN_GET_GID_DATA_RESULT */
 
+	struct
+	{
+		int				txn_count;
+		GTM_GIDData		*data;			/* malloc'd, txn_count entries */
+	} grd_txn_get_gid_data_multi;			/* TXN_GET_GID_DATA_MULTI_RESULT */
+
 	struct
 	{
 		char				*ptr;
@@ -124,6 +140,8 @@ typedef union GTM_ResultData
 		int						errcode;
 	} grd_report_xmin;						/* REPORT_XMIN */
 
+	GTM_Timestamp				grd_timestamp;	/* GET_TIMESTAMP */
+
 	/*
 	 * TODO
 	 * 	TXN_GET_STATUS
@@ -156,6 +174,9 @@ typedef struct GTM_Result
 	int					gr_xip_size;
 	GTM_SnapshotData	gr_snapshot;
 
+	/* GTM's count of completed transactions, sent with commit results */
+	uint64				gr_seqno;
+
 	/*
 	 * Similarly, keep the buffer for proxying data outside the union
 	 */
@@ -214,7 +235,10 @@ int bkup_prepare_transaction(GTM_Conn *conn, GlobalTransactionId gxid);
 int get_gid_data(GTM_Conn *conn, GTM_IsolationLevel isolevel, char *gid,
 				 GlobalTransactionId *gxid,
 				 GlobalTransactionId *prepared_gxid,
-				 char **nodestring);
+				 char **nodestring,
+				 bool *attached);
+int get_gid_data_multi(GTM_Conn *conn, GTM_IsolationLevel isolevel,
+					   int gid_count, char **gids, GTM_GIDData *data);
 /*
  * Multiple Transaction Management API
  */
@@ -274,11 +298,20 @@ int backend_disconnect(GTM_Conn *conn, bool is_postmaster, GTM_PGXCNodeType type
 char *node_get_local_addr(GTM_Conn *conn, char *buf, size_t buflen, int *rc);
 int register_session(GTM_Conn *conn, const char *coord_name, int coord_procid,
 				 int coord_backendid);
+int bkup_register_session(GTM_Conn *conn, const char *coord_name,
+				 int coord_procid, int coord_backendid);
 int report_global_xmin(GTM_Conn *conn, const char *node_name,
 		GTM_PGXCNodeType type, GlobalTransactionId gxid,
 		GlobalTransactionId *global_xmin,
 		GlobalTransactionId *latest_completed_xid,
 		int *errcode);
+int subscribe_global_xmin(GTM_Conn *conn, const char *node_name,
+		GTM_PGXCNodeType type);
+int receive_global_xmin(GTM_Conn *conn,
+		GlobalTransactionId *global_xmin,
+		GlobalTransactionId *latest_completed_xid,
+		int *errcode);
+int get_timestamp(GTM_Conn *conn, GTM_Timestamp *timestamp);
 
 /*
  * Sequence Management API
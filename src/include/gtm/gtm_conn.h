@@ -19,6 +19,7 @@
 #include "gtm/libpq-int.h"
 
 struct GTM_ThreadInfo;
+struct GTM_XminSubscriber;
 
 typedef struct GTM_ConnectionInfo
 {
@@ -29,6 +30,9 @@ typedef struct GTM_ConnectionInfo
 
 	/* a connection object to the standby */
 	GTM_Conn				*standby;
+
+	/* GlobalXmin subscription made on the connection, if any */
+	struct GTM_XminSubscriber *xmin_sub;
 } GTM_ConnectionInfo;
 
 typedef struct GTM_Connections
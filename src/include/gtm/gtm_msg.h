@@ -90,6 +90,9 @@ typedef enum GTM_MessageType
 	MSG_BACKEND_DISCONNECT,			/* tell GTM that the backend diconnected from the proxy */
 	MSG_BARRIER,				/* Tell the barrier was issued */
 	MSG_BKUP_BARRIER,			/* Backup barrier to standby */
+	MSG_SUBSCRIBE_XMIN,			/* Get notified when GlobalXmin advances */
+	MSG_GET_TIMESTAMP,			/* Get a snapshot or commit timestamp */
+	MSG_TXN_GET_GID_DATA_MULTI,	/* MSG_TXN_GET_GID_DATA for multiple GIDs */
 
 	/*
 	 * Must be at the end
@@ -144,6 +147,9 @@ typedef enum GTM_ResultType
 	TXN_GET_ALL_PREPARED_RESULT,
 	TXN_BEGIN_GETGXID_AUTOVACUUM_RESULT,
 	BARRIER_RESULT,
+	XMIN_NOTIFY_RESULT,
+	GET_TIMESTAMP_RESULT,
+	TXN_GET_GID_DATA_MULTI_RESULT,
 	RESULT_TYPE_COUNT
 } GTM_ResultType;
 
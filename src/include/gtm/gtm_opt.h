@@ -330,6 +330,9 @@ const char *const config_type_names[] =\
 
 #define GTM_OPTNAME_ACTIVE_HOST			"active_host"
 #define GTM_OPTNAME_ACTIVE_PORT 		"active_port"
+#define GTM_OPTNAME_BATCH_MAX_DELAY		"batch_max_delay"
+#define GTM_OPTNAME_BATCH_STATS_INTERVAL	"batch_stats_interval"
+#define GTM_OPTNAME_BATCH_TARGET_SIZE	"batch_target_size"
 #define GTM_OPTNAME_CONFIG_FILE			"config_file"
 #define GTM_OPTNAME_DATA_DIR			"data_dir"
 #define GTM_OPTNAME_ERROR_REPORTER		"error_reporter"
@@ -342,6 +345,7 @@ const char *const config_type_names[] =\
 #define GTM_OPTNAME_LISTEN_ADDRESSES	"listen_addresses"
 #define GTM_OPTNAME_LOG_FILE			"log_file"
 #define GTM_OPTNAME_LOG_MIN_MESSAGES	"log_min_messages"
+#define GTM_OPTNAME_MAX_SEQUENCE_RANGE	"max_sequence_range"
 #define GTM_OPTNAME_NODENAME			"nodename"
 #define GTM_OPTNAME_PORT				"port"
 #define GTM_OPTNAME_STARTUP				"startup"
@@ -27,6 +27,10 @@
 #include "gtm/gtm_msg.h"
 #include "gtm/libpq-fe.h"
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 extern char *GTMProxyLogFile;
 
 typedef enum GTMProxy_ThreadStatus
@@ -50,6 +54,20 @@ typedef struct GTMProxy_ConnectionInfo
 	GTM_MessageType			con_pending_msg;
 	GlobalTransactionId 		con_txid;
 	GTM_TransactionHandle		con_handle;
+
+	/* Command backup, replayed after a reconnect to GTM */
+	bool				con_any_backup;
+	int				con_qtype;
+	StringInfoData			con_inBufData;
+
+	/* Events reported for this connection by the last wait */
+	short				con_revents;
+
+	/* Last cycle of the worker thread this connection was served in */
+	uint32				con_cycle;
+
+	/* Link in the queue of connections not yet adopted by the worker */
+	struct GTMProxy_ConnectionInfo	*con_next;
 } GTMProxy_ConnectionInfo;
 
 typedef struct GTMProxy_Connections
@@ -61,7 +79,30 @@ typedef struct GTMProxy_Connections
 } GTMProxy_Connections;
 
 #define ERRORDATA_STACK_SIZE  20
-#define GTM_PROXY_MAX_CONNECTIONS	1024
+
+/*
+ * Per message type statistics of the worker threads. Both histograms use
+ * power of two buckets: bucket i counts values in [2^i, 2^(i+1)), the last
+ * bucket also counts everything larger.
+ */
+#define GTM_PROXY_BATCH_BUCKETS		12
+#define GTM_PROXY_LATENCY_BUCKETS	20
+
+typedef struct GTMProxy_CommandStats
+{
+	uint64		cs_commands;	/* commands forwarded to GTM */
+	uint64		cs_batches;		/* grouped messages they were sent in */
+	uint64		cs_batch_size[GTM_PROXY_BATCH_BUCKETS];
+	uint64		cs_latency[GTM_PROXY_LATENCY_BUCKETS];	/* in microseconds */
+} GTMProxy_CommandStats;
+
+/*
+ * The connection arrays of a worker thread start small and are doubled on
+ * demand. The slot id is sent to GTM as a GTMProxy_ConnID, which caps the
+ * number of connections a single worker can serve.
+ */
+#define GTM_PROXY_INIT_CONNECTIONS	64
+#define GTM_PROXY_MAX_CONNECTIONS	PG_INT16_MAX
 
 typedef struct GTMProxy_ThreadInfo
 {
@@ -81,6 +122,13 @@ typedef struct GTMProxy_ThreadInfo
 	GTM_MutexLock			thr_lock;
 	GTM_CV					thr_cv;
 
+	/*
+	 * New connections are queued here by the main thread and adopted by the
+	 * worker at the top of its next cycle. Protected by thr_lock.
+	 */
+	GTMProxy_ConnectionInfo	*thr_new_conns;
+	uint32					thr_new_conn_count;
+
 	/*
 	 * We use a sequence number to track the state of connection/fd array.
 	 * Whenever a new connection is added or an existing connection is deleted
@@ -89,15 +137,37 @@ typedef struct GTMProxy_ThreadInfo
 	 */
 	int32					thr_seqno;
 
-	/* connection array */
-	GTMProxy_ConnectionInfo	*thr_all_conns[GTM_PROXY_MAX_CONNECTIONS];
-	int						thr_conn_map[GTM_PROXY_MAX_CONNECTIONS];
-	struct pollfd			thr_poll_fds[GTM_PROXY_MAX_CONNECTIONS];
+	/*
+	 * Connection array, indexed by connection id. This and the arrays below
+	 * are only accessed by the worker thread itself and are enlarged as
+	 * connections are adopted.
+	 */
+	GTMProxy_ConnectionInfo	**thr_all_conns;
+	int						*thr_conn_map;
+	uint32					thr_conn_array_size;
+
+	/* Connections to be served in the current cycle */
+	GTMProxy_ConnectionInfo	**thr_ready_conns;
+	uint32					thr_ready_count;
+
+	/* Number of connections holding a command backup */
+	uint32					thr_backup_count;
+
+	/* Cycles of the worker main loop, and the batching window policy */
+	uint32					thr_cycle;
+	int						thr_batch_skip;		/* cycles to go without window */
+	int						thr_batch_backoff;
 
-	/* Command backup */
-	short					thr_any_backup[GTM_PROXY_MAX_CONNECTIONS];
-	int						thr_qtype[GTM_PROXY_MAX_CONNECTIONS];
-	StringInfoData			thr_inBufData[GTM_PROXY_MAX_CONNECTIONS];
+	/* Batch size and proxy-added latency since thr_stats_start */
+	GTM_Timestamp			thr_stats_start;
+	GTMProxy_CommandStats	thr_cmd_stats[MSG_TYPE_COUNT];
+
+#ifdef HAVE_SYS_EPOLL_H
+	int						thr_epoll_fd;
+	struct epoll_event		*thr_epoll_events;
+#else
+	struct pollfd			*thr_poll_fds;
+#endif
 
 	gtm_List 					*thr_processed_commands;
 	gtm_List 					*thr_pending_commands[MSG_TYPE_COUNT];
@@ -131,6 +201,7 @@ void GTMProxy_ThreadExit(void);
 extern GTMProxy_ThreadInfo *GTMProxy_ThreadCreate(void *(* startroutine)(void *), int idx);
 extern GTMProxy_ThreadInfo * GTMProxy_GetThreadInfo(GTM_ThreadID thrid);
 extern GTMProxy_ThreadInfo *GTMProxy_ThreadAddConnection(GTMProxy_ConnectionInfo *conninfo);
+extern void GTMProxy_ThreadAdoptConnections(GTMProxy_ThreadInfo *thrinfo);
 extern int GTMProxy_ThreadRemoveConnection(GTMProxy_ThreadInfo *thrinfo,
 		GTMProxy_ConnectionInfo *conninfo);
 
@@ -185,6 +256,7 @@ typedef struct GTMProxy_CommandInfo
 	int						ci_res_index;
 	GTMProxy_CommandData	ci_data;
 	GTMProxy_ConnectionInfo	*ci_conn;
+	GTM_Timestamp			ci_read_time;	/* when read from the client */
 } GTMProxy_CommandInfo;
 
 /*
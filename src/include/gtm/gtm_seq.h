@@ -28,16 +28,28 @@ typedef struct GTM_SeqLastVal
 	GTM_Sequence	gs_last_value;
 } GTM_SeqLastVal;
 
+/* Rate at which a Coordinator consumes the sequence, see seq_adaptive_range */
+typedef struct GTM_SeqCoordRange
+{
+	char			gs_coord_name[SP_NODE_NAME];
+	GTM_Timestamp	gs_last_grant;
+	GTM_Sequence	gs_range;
+} GTM_SeqCoordRange;
+
 typedef struct GTM_SeqInfo
 {
 	GTM_SequenceKey	gs_key;
 	GTM_SequenceKey	gs_oldkey;
-	GTM_Sequence	gs_value;
+	GTM_Sequence	gs_value;		/* advanced atomically by nextval fast path */
 	GTM_Sequence	gs_backedUpValue;
 	GTM_Sequence	gs_init_value;
 	int32			gs_max_lastvals;
 	int32			gs_lastval_count;
 	GTM_SeqLastVal *gs_last_values;
+	GTM_MutexLock	gs_lastval_lock;	/* protects the last values */
+	int32			gs_max_coordranges;
+	int32			gs_coordrange_count;
+	GTM_SeqCoordRange *gs_coord_ranges;
 	GTM_Sequence	gs_increment_by;
 	GTM_Sequence	gs_min_value;
 	GTM_Sequence	gs_max_value;
@@ -92,6 +104,8 @@ int GTM_SeqRestore(GTM_SequenceKey seqkey,
 			   bool cycle,
 			   bool called);
 
+void GTM_SeqRedoValue(GTM_SequenceKey seqkey, GTM_Sequence value, bool called);
+void GTM_SeqRedoAdvance(GTM_SequenceKey seqkey, GTM_Sequence value);
 void GTM_CleanupSeqSession(char *coord_name, int coord_procid);
 
 bool GTM_NeedSeqRestoreUpdate(GTM_SequenceKey seqkey);
@@ -46,6 +46,13 @@ int gtm_standby_end_backup(void);
 
 void gtm_standby_finishActiveConn(void);
 
+/*
+ * Log of the backup messages shipped to the standby, see gtm_standby_log.c
+ */
+void GTM_StandbyLogStart(void);
+GTM_Conn *GTM_StandbyLogOpen(void);
+void GTM_StandbyLogReset(void);
+
 /*
  * Startup mode
  */
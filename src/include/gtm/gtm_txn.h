@@ -34,7 +34,7 @@ struct GTM_RestoreContext;
 extern GlobalTransactionId GTM_GetGlobalTransactionId(GTM_TransactionHandle handle);
 extern GlobalTransactionId GTM_ReadNewGlobalTransactionId(void);
 extern void GTM_SetNextGlobalTransactionId(GlobalTransactionId gxid);
-extern void GTM_SetControlXid(GlobalTransactionId gxid);
+extern void GTM_RedoNextGlobalTransactionId(GlobalTransactionId gxid);
 extern void GTM_SetShuttingDown(void);
 
 /* for restoration point backup (gtm/main/gtm_backup.c) */
@@ -82,6 +82,7 @@ typedef struct GTM_TransactionInfo
 	GTM_IsolationLevel		gti_isolevel;
 	bool					gti_readonly;
 	GTMProxy_ConnID			gti_proxy_client_id;
+	bool					gti_detached;	/* client gone, prepared txn kept */
 	char					*nodestring; /* List of nodes prepared */
 	char					*gti_gid;
 
@@ -129,6 +130,13 @@ typedef struct GTM_Transactions
 
 	GlobalTransactionId	gt_recent_global_xmin;
 
+	/*
+	 * Number of transactions removed from the array, bumped on every commit
+	 * or abort. A snapshot with a seqno not older than the one returned by a
+	 * commit sees that commit.
+	 */
+	uint64				gt_completed_seqno;
+
 	int32				gt_lastslot;
 	GTM_TransactionInfo	gt_transactions_array[GTM_MAX_GLOBAL_TRANSACTIONS];
 	gtm_List			*gt_open_transactions;
@@ -166,10 +174,17 @@ void ProcessRollbackTransactionCommand(Port *myport, StringInfo message, bool is
 void ProcessStartPreparedTransactionCommand(Port *myport, StringInfo message, bool is_backup);
 void ProcessPrepareTransactionCommand(Port *myport, StringInfo message, bool is_backup);
 void ProcessGetGIDDataTransactionCommand(Port *myport, StringInfo message);
+void ProcessGetGIDDataTransactionCommandMulti(Port *myport, StringInfo message);
 void ProcessGetGXIDTransactionCommand(Port *myport, StringInfo message);
 void ProcessGXIDListCommand(Port *myport, StringInfo message);
 void ProcessGetNextGXIDTransactionCommand(Port *myport, StringInfo message);
 void ProcessReportXminCommand(Port *myport, StringInfo message, bool is_backup);
+void ProcessSubscribeXminCommand(Port *myport, StringInfo message);
+struct GTM_ConnectionInfo;
+void GTM_WaitCommandOrXmin(struct GTM_ConnectionInfo *conn);
+void GTM_UnsubscribeGlobalXmin(struct GTM_ConnectionInfo *conn);
+void ProcessGetTimestampCommand(Port *myport, StringInfo message);
+GTM_Timestamp GTM_GetTimestamp(void);
 
 void ProcessBeginTransactionGetGXIDAutovacuumCommand(Port *myport, StringInfo message);
 void ProcessBkupBeginTransactionGetGXIDAutovacuumCommand(Port *myport, StringInfo message);
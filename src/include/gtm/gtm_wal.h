@@ -0,0 +1,40 @@
+/*-------------------------------------------------------------------------
+ *
+ * gtm_wal.h
+ *		Write-ahead log of GTM state changes
+ *
+ *
+ * Portions Copyright (c) 2012-2014, TransLattice, Inc.
+ *
+ * src/include/gtm/gtm_wal.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef GTM_WAL_H
+#define GTM_WAL_H
+
+#include "gtm/gtm_c.h"
+
+/* Position in the WAL, byte offset in the stream of records */
+typedef uint64 GTM_WalLSN;
+
+#define InvalidGTMWalLSN		((GTM_WalLSN) -1)
+
+/* Amount of WAL written after which a checkpoint is requested */
+#define GTM_WAL_CHECKPOINT_SIZE	(16 * 1024 * 1024)
+
+extern void GTM_WalInit(void);
+extern GTM_WalLSN GTM_WalReplay(GTM_WalLSN redo_lsn);
+extern void GTM_WalStartup(GTM_WalLSN end_lsn);
+
+extern void GTM_WalLogNextXid(GlobalTransactionId next_xid);
+extern void GTM_WalLogSeqValue(GTM_SequenceKey seqkey, GTM_Sequence value,
+				   bool called);
+extern void GTM_WalLogSeqAdvance(GTM_SequenceKey seqkey, GTM_Sequence value);
+extern void GTM_WalSync(void);
+
+extern bool GTM_WalNeedCheckpoint(void);
+extern GTM_WalLSN GTM_WalStartCheckpoint(void);
+extern void GTM_WalEndCheckpoint(GTM_WalLSN redo_lsn);
+
+#endif /* GTM_WAL_H */
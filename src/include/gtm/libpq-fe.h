@@ -110,6 +110,10 @@ extern GTM_Conn *PQconnectGTM(const char *conninfo);
 /* close the current connection and free the GTM_Conn data structure */
 extern void GTMPQfinish(GTM_Conn *conn);
 
+/* make a connection handing its output over to the given routines */
+extern GTM_Conn *GTMPQmakeHookConn(int (*flush_hook) (GTM_Conn *conn),
+								   int (*sync_hook) (GTM_Conn *conn));
+
 /* parse connection options in same way as PQconnectGTM */
 extern GTMPQconninfoOption *GTMPQconninfoParse(const char *conninfo, char **errmsg);
 
@@ -122,6 +126,7 @@ extern ConnStatusType GTMPQstatus(const GTM_Conn *conn);
 extern int GTMPQispostmaster(const GTM_Conn *conn);
 extern char *GTMPQerrorMessage(const GTM_Conn *conn);
 extern int	GTMPQsocket(const GTM_Conn *conn);
+extern uint64 GTMPQlastSeqno(const GTM_Conn *conn);
 
 /* Enable/disable tracing */
 extern void GTMPQtrace(GTM_Conn *conn, FILE *debug_port);
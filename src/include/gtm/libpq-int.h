@@ -93,6 +93,17 @@ struct gtm_conn
 
 	/* Pointer to the result of last operation */
 	GTM_Result	*result;
+
+	/* Latest count of completed transactions reported by GTM */
+	uint64		last_seqno;
+
+	/*
+	 * Connection made by GTMPQmakeHookConn is not connected anywhere, data
+	 * flushed to it is handed over to flush_hook and gtm_sync_standby() on it
+	 * calls sync_hook.
+	 */
+	int			(*flush_hook) (GTM_Conn *conn);
+	int			(*sync_hook) (GTM_Conn *conn);
 };
 
 /* === in fe-misc.c === */
@@ -127,6 +138,7 @@ extern int	gtmpqWriteReady(GTM_Conn *conn);
  * In fe-protocol.c
  */
 GTM_Result * GTMPQgetResult(GTM_Conn *conn);
+GTM_Result * GTMPQgetResultTimed(GTM_Conn *conn, time_t finish_time);
 extern int gtmpqGetError(GTM_Conn *conn, GTM_Result *result);
 void gtmpqFreeResultData(GTM_Result *result, GTM_PGXCNodeType remote_type);
 
@@ -117,4 +117,6 @@ void ProcessGTMEndBackup(Port *myport, StringInfo message);
 void GTM_InitNodeManager(void);
 GlobalTransactionId GTM_HandleGlobalXmin(GTM_PGXCNodeType type, char *node_name,
 		GlobalTransactionId reported_xmin, int *errcode);
+GlobalTransactionId GTM_GetGlobalXmin(GTM_PGXCNodeType type, char *node_name,
+		int *errcode);
 #endif /* GTM_NODE_H */
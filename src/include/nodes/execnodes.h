@@ -855,6 +855,10 @@ typedef struct PlanState
 
 	Instrumentation *instrument;	/* Optional runtime stats for this node */
 	WorkerInstrumentation *worker_instrument;	/* per-worker instrumentation */
+#ifdef XCP
+	List	   *remote_instrument;	/* RemoteInstrumentation entries reported
+									 * by the nodes executing this plan node */
+#endif
 
 	/*
 	 * Common structural data for all Plan types.  These links to subsidiary
@@ -1961,6 +1965,10 @@ typedef struct HashState
 	HashJoinTable hashtable;	/* hash table for the hashjoin */
 	List	   *hashkeys;		/* list of ExprState nodes */
 	/* hashkeys is same as parent's hj_InnerHashKeys */
+#ifdef XCP
+	uint32	   *runtime_filter;	/* filter on the runtimeFilterKey, built
+								 * along with the hash table */
+#endif
 } HashState;
 
 /* ----------------
@@ -103,6 +103,9 @@ typedef struct PlannedStmt
 	AttrNumber  distributionKey;
 	List	   *distributionNodes;
 	List	   *distributionRestrict;
+
+	int			instrument_options;	/* instrumentation requested by the
+									 * master node, see RemoteStmt */
 #endif	
 
 	Node	   *utilityStmt;	/* non-null if this is utility stmt */
@@ -879,6 +882,11 @@ typedef struct Hash
 	Oid			skewTable;		/* outer join key's table OID, or InvalidOid */
 	AttrNumber	skewColumn;		/* outer join key's column #, or zero */
 	bool		skewInherit;	/* is outer join rel an inheritance tree? */
+#ifdef XCP
+	int			runtimeFilterKey;	/* hash key to build the runtime filter
+									 * on, -1 if none */
+	int			runtimeFilterSize;	/* size of the filter in bytes */
+#endif
 	/* all other info is in the parent HashJoin node */
 } Hash;
 
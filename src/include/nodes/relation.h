@@ -599,6 +599,10 @@ typedef struct RelOptInfo
 	PlannerInfo *subroot;		/* if subquery */
 	List	   *subplan_params; /* if subquery */
 	int			rel_parallel_workers;	/* wanted number of parallel workers */
+#ifdef XCP
+	double		distribution_skew;	/* rows of the busiest Datanode relative
+									 * to the average, 0 if not known */
+#endif
 
 	/* Information about foreign tables and foreign joins */
 	Oid			serverid;		/* identifies server for the table or join */
@@ -30,6 +30,7 @@
 #ifdef XCP
 #define DEFAULT_NETWORK_BYTE_COST  0.001
 #define DEFAULT_REMOTE_QUERY_COST  100.0
+#define DEFAULT_NETWORK_MESSAGE_COST  0.0
 #endif
 #define DEFAULT_PARALLEL_TUPLE_COST 0.1
 #define DEFAULT_PARALLEL_SETUP_COST  1000.0
@@ -58,6 +59,7 @@ extern PGDLLIMPORT double cpu_operator_cost;
 #ifdef XCP
 extern PGDLLIMPORT double network_byte_cost;
 extern PGDLLIMPORT double remote_query_cost;
+extern PGDLLIMPORT double network_message_cost;
 #endif
 extern PGDLLIMPORT double parallel_tuple_cost;
 extern PGDLLIMPORT double parallel_setup_cost;
@@ -76,6 +78,11 @@ extern bool enable_material;
 extern bool enable_mergejoin;
 extern bool enable_hashjoin;
 extern bool enable_fast_query_shipping;
+#ifdef XCP
+extern bool enable_broadcast_join;
+extern bool enable_redistributed_grouping;
+extern bool enable_runtime_filter;
+#endif
 extern bool enable_gathermerge;
 extern int	constraint_exclusion;
 
@@ -173,7 +180,9 @@ extern void cost_qual_eval_node(QualCost *cost, Node *qual, PlannerInfo *root);
 #ifdef XCP
 extern void cost_remote_subplan(Path *path,
 			  Cost input_startup_cost, Cost input_total_cost,
-			  double tuples, int width, int replication);
+			  double tuples, int width, int replication, double skew);
+extern Cost cost_network_transfer(double tuples, int width, int replication,
+			  double skew);
 #endif
 extern void compute_semi_anti_join_factors(PlannerInfo *root,
 							   RelOptInfo *outerrel,
@@ -25,5 +25,7 @@
 extern ExecNodes *pgxc_is_query_shippable(Query *query, int query_level);
 /* Determine if an expression is shippable */
 extern bool pgxc_is_expr_shippable(Expr *node, bool *has_aggs);
+/* Determine if an expression over groups residing on single nodes is shippable */
+extern bool pgxc_is_group_expr_shippable(Expr *node);
 
 #endif
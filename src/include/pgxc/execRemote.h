@@ -124,6 +124,14 @@ typedef struct ResponseCombiner
 	bool		extended_query;         /* running extended query protocol */
 	bool		probing_primary;		/* trying replicated on primary node */
 	void	   *tuplesortstate;			/* for merge sort */
+	/*
+	 * Number of rows the consumer is going to fetch at most, -1 if unknown.
+	 * Set by a Limit on top of a RemoteSubplan. If the first fetch request
+	 * was capped to that number (bounded_fetch), a suspended portal means
+	 * the node has sent everything we may need and it is not resumed.
+	 */
+	int64		tuples_needed;
+	bool		bounded_fetch;
 	/* COPY support */
 	RemoteCopyType remoteCopyType;
 	Tuplestorestate *tuplestorestate;
@@ -183,9 +191,30 @@ typedef struct RemoteSubplanState
 	bool 		execOnAll;
 	int			nParamRemote;	/* number of params sent from the master node */
 	RemoteParam *remoteparams;  /* parameter descriptors */
+	int64		tuples_returned;	/* rows returned since the last (re)bind */
+	uint32	   *runtime_filter;		/* filter to send to the producers along
+									 * with the portal binding, or NULL */
+	PlanState  *remote_planstate;	/* local copy of the subplan holding the
+									 * instrumentation reported by the remote
+									 * nodes, if collecting it */
 } RemoteSubplanState;
 
 
+/*
+ * Instrumentation of a plan node executed on a remote node, as reported back
+ * to the node which requested the execution. If consumer is set the entry is
+ * about the rows the producer of a RemoteSubplan has sent to that consumer,
+ * and only instrument.ntuples is meaningful.
+ */
+typedef struct RemoteInstrumentation
+{
+	NameData	nodename;		/* node where the plan node was executed */
+	NameData	consumer;		/* consumer of the rows sent, or empty */
+	int			plan_node_id;	/* plan node the entry is about */
+	Instrumentation instrument;
+} RemoteInstrumentation;
+
+
 /*
  * Data needed to set up a PreparedStatement on the remote node and other data
  * for the remote executor
@@ -222,6 +251,14 @@ typedef struct RemoteStmt
 	List	   *distributionNodes;
 
 	List	   *distributionRestrict;
+
+	int			instrument_options;	/* collect instrumentation and report it
+									 * back, like EXPLAIN ANALYZE does */
+
+	uint32		queryId;		/* query identifier of the master node */
+
+	int			runtimeFilterSize;	/* room to reserve in the shared queue for
+									 * runtime filters of the consumers */
 } RemoteStmt;
 
 extern int PGXLRemoteFetchSize;
@@ -252,6 +289,9 @@ extern void ExecFinishInitRemoteSubplan(RemoteSubplanState *node);
 extern TupleTableSlot* ExecRemoteSubplan(PlanState *pstate);
 extern void ExecEndRemoteSubplan(RemoteSubplanState *node);
 extern void ExecReScanRemoteSubplan(RemoteSubplanState *node);
+extern void SendRemoteInstrumentation(QueryDesc *queryDesc);
+extern void ExecRemoteSubplanSetFilter(RemoteSubplanState *node,
+						   const uint32 *filter);
 extern void ExecRemoteUtility(RemoteQuery *node);
 
 extern bool	is_data_node_ready(PGXCNodeHandle * conn);
@@ -285,6 +325,7 @@ extern void PostPrepare_Remote(char *prepareGID, bool implicit);
 extern void PreCommit_Remote(char *prepareGID, char *nodestring, bool preparedLocalNode);
 extern bool	PreAbort_Remote(void);
 extern void AtEOXact_Remote(void);
+extern void ReleaseIdleRemoteConnections(void);
 extern bool IsTwoPhaseCommitRequired(bool localWrite);
 extern bool FinishRemotePreparedTransaction(char *prepareGID, bool commit);
 extern char *GetImplicit2PCGID(const char *implicit2PC_head, bool localWrite);
@@ -88,6 +88,8 @@ typedef struct
 						 * can not determine execution nodes */
 	Oid		en_relid;		/* Relation to determine execution nodes */
 	RelationAccessType accesstype;		/* Access type to determine execution nodes */
+	List		*replicanodelist;	/* replicated read: nodes to choose the
+						 * execution node from, at execution time */
 } ExecNodes;
 
 
@@ -152,6 +154,9 @@ extern Oid primary_data_node;
 extern Oid preferred_data_node[MAX_PREFERRED_NODES];
 extern int num_preferred_data_nodes;
 
+/* GUC parameter */
+extern bool load_balance_replicated_reads;
+
 extern void InitRelationLocInfo(void);
 extern char GetLocatorType(Oid relid);
 extern char ConvertToLocatorType(int disttype);
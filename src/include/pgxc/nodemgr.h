@@ -14,7 +14,9 @@
 #ifndef NODEMGR_H
 #define NODEMGR_H
 
+#include "datatype/timestamp.h"
 #include "nodes/parsenodes.h"
+#include "port/atomics.h"
 
 #define PGXC_NODENAME_LENGTH	64
 
@@ -29,6 +31,22 @@ extern int 	MaxCoords;
 extern int 	NumDataNodes;
 extern int 	NumCoords;
 
+/*
+ * What the pool manager went through with an unhealthy node, see the circuit
+ * breaker in poolmgr.c
+ */
+typedef struct
+{
+	int64		connect_failures;	/* failed connection attempts */
+	int64		connect_timeouts;	/* of which ran into pool_connect_timeout */
+	int64		fast_failures;		/* requests refused as the node was down */
+	int64		probes;				/* background probes of the node */
+	int64		failed_probes;
+	int64		wait_time;			/* microseconds spent on failed connection
+									 * attempts and probes */
+	TimestampTz unhealthy_since;	/* 0 if the node is healthy */
+} NodeHealthStats;
+
 /* Node definition */
 typedef struct
 {
@@ -39,6 +57,12 @@ typedef struct
 	bool		nodeisprimary;
 	bool 		nodeispreferred;
 	bool		nodeishealthy;
+	/*
+	 * Number of requests currently in flight to the node from backends of
+	 * this node. Used to balance reads of replicated tables.
+	 */
+	pg_atomic_uint32 nodeload;
+	NodeHealthStats nodehealthstats;
 } NodeDefinition;
 
 extern void NodeTablesShmemInit(void);
@@ -57,5 +81,9 @@ extern void PgxcNodeCreate(CreateNodeStmt *stmt);
 extern void PgxcNodeRemove(DropNodeStmt *stmt);
 extern void PgxcNodeDnListHealth(List *nodeList, bool *dnhealth);
 extern bool PgxcNodeUpdateHealth(Oid node, bool status);
+extern void PgxcNodeAddHealthStats(Oid node, NodeHealthStats *stats);
+extern void PgxcNodeUpdateLoad(int nodeidx, Oid node, bool busy);
+extern void PgxcNodeGetLoadMap(int *num_dns, bool *dnHealthMap,
+				uint32 *dnLoadMap);
 
 #endif	/* NODEMGR_H */
@@ -24,6 +24,7 @@ extern char *parentPGXCNode;
 extern int parentPGXCPid;
 extern int	parentPGXCNodeId;
 extern char	parentPGXCNodeType;
+extern uint32 parentPGXCQueryId;
 
 typedef enum
 {
@@ -56,6 +57,7 @@ extern Datum xc_lockForBackupKey2;
 #define PGXC_PARENT_NODE parentPGXCNode
 #define PGXC_PARENT_NODE_ID	parentPGXCNodeId
 #define PGXC_PARENT_NODE_TYPE	parentPGXCNodeType
+#define PGXC_PARENT_QUERY_ID	parentPGXCQueryId
 #define REMOTE_CONN_TYPE remoteConnType
 
 #define IsConnFromApp() (remoteConnType == REMOTE_CONN_APP)
@@ -93,6 +93,8 @@ struct pgxc_node_handle
 
 	bool		in_extended_query;
 	bool		needSync;
+	/* Is the request counted in the node load? */
+	bool		inflight;
 };
 typedef struct pgxc_node_handle PGXCNodeHandle;
 
@@ -110,11 +112,13 @@ extern void InitMultinodeExecutor(bool is_force);
 
 /* Open/close connection routines (invoked from Pool Manager) */
 extern void PGXCNodeCleanAndRelease(int code, Datum arg);
+extern void PGXCNodeReleaseLoad(void);
 
 extern PGXCNodeHandle *get_any_handle(List *datanodelist);
 /* Look at information cached in node handles */
 extern int PGXCNodeGetNodeId(Oid nodeoid, char *node_type);
 extern int PGXCNodeGetNodeIdFromName(char *node_name, char *node_type);
+extern bool PGXCNodeIsConnected(int nodeid);
 extern Oid PGXCNodeGetNodeOid(int nodeid, char node_type);
 
 extern PGXCNodeAllHandles *get_handles(List *datanodelist, List *coordlist, bool is_query_coord_only, bool is_global_session);
@@ -157,8 +161,12 @@ extern int  pgxc_node_send_plan(PGXCNodeHandle * handle, const char *statement,
 					short num_params, Oid *param_types);
 extern int	pgxc_node_send_gxid(PGXCNodeHandle * handle, GlobalTransactionId gxid);
 extern int	pgxc_node_send_cmd_id(PGXCNodeHandle *handle, CommandId cid);
+extern int	pgxc_node_send_query_id(PGXCNodeHandle *handle, uint32 queryId);
 extern int	pgxc_node_send_snapshot(PGXCNodeHandle * handle, Snapshot snapshot);
 extern int	pgxc_node_send_timestamp(PGXCNodeHandle * handle, TimestampTz timestamp);
+extern int	pgxc_node_send_commit_timestamp(PGXCNodeHandle * handle, TimestampTz timestamp);
+extern int	pgxc_node_send_runtime_filter(PGXCNodeHandle *handle,
+							  const char *portal, const uint32 *filter, int size);
 
 extern bool	pgxc_node_receive(const int conn_count,
 				  PGXCNodeHandle ** connections, struct timeval * timeout);
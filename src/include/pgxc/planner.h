@@ -150,6 +150,14 @@ typedef struct
 	SimpleSort *sort;
 	char	   *cursor;
 	int			unique;
+	/*
+	 * Nodes holding the replicated input, if the execution node is to be
+	 * chosen among them at executor startup rather than taken from nodeList.
+	 */
+	List	   *replicaNodes;
+	double		distributionSkew;	/* skew of the input, see cost_network_transfer */
+	int			runtimeFilterSize;	/* size of the runtime filter the parent
+									 * hash join sends to the producers, or 0 */
 } RemoteSubplan;
 
 /*
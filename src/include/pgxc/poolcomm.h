@@ -20,6 +20,11 @@
 #define POOL_BUFFER_SIZE 1024
 #define Socket(port) (port).fdsock
 
+/* State of a connection handed to a session, see pool_sendconns() */
+#define POOL_CONN_NEW		'n'		/* just opened by the pooler */
+#define POOL_CONN_POOLED	'p'		/* reused, reset by its previous session */
+#define POOL_CONN_KEPT		'k'		/* already held by the same session */
+
 typedef struct
 {
 	/* file descriptors */
@@ -42,8 +47,10 @@ extern int	pool_getbytes(PoolPort *port, char *s, size_t len);
 extern int	pool_putmessage(PoolPort *port, char msgtype, const char *s, size_t len);
 extern int	pool_putbytes(PoolPort *port, const char *s, size_t len);
 extern int	pool_flush(PoolPort *port);
-extern int	pool_sendfds(PoolPort *port, int *fds, int count);
-extern int	pool_recvfds(PoolPort *port, int *fds, int count);
+extern int	pool_sendconns(PoolPort *port, int *fds, int *pids, char *states,
+			   int count);
+extern int	pool_recvconns(PoolPort *port, int *fds, int *pids, char *states,
+			   int count);
 extern int	pool_sendres(PoolPort *port, int res);
 extern int	pool_recvres(PoolPort *port);
 extern int	pool_sendpids(PoolPort *port, int *pids, int count);
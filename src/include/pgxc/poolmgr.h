@@ -50,6 +50,7 @@ typedef struct PGcancel NODE_CANCEL;
 typedef struct
 {
 	time_t		released;
+	bool		used;			/* handed to a session before? */
 	NODE_CONNECTION *conn;
 	NODE_CANCEL	*xc_cancelConn;
 } PGXCNodePoolSlot;
@@ -71,6 +72,8 @@ typedef struct
 	char	   *connstr;	/* connection string for all the connections */
 	int			freeSize;	/* available connections */
 	int			size;  		/* total pool size (available slots) */
+	bool		pressure;	/* short of connections? */
+	TimestampTz	pressure_time;	/* when it last ran short */
 
 	/* array of open connections (with freeSize available connections) */
 	PGXCNodePoolSlot **slot;
@@ -118,6 +121,7 @@ typedef struct
 	Oid		   	   *coord_conn_oids;	/* one for each Coordinator */
 	PGXCNodePoolSlot **dn_connections;	/* one for each Datanode */
 	PGXCNodePoolSlot **coord_connections; /* one for each Coordinator */
+	bool			reclaim_sent;		/* asked to return its connections */
 } PoolAgent;
 
 /*
@@ -128,6 +132,11 @@ extern int	PoolMaintenanceTimeout;
 extern int	MaxPoolSize;
 extern int	PoolerPort;
 extern bool PersistentConnections;
+extern bool PoolStickyConnections;
+extern bool PoolMultiplexing;
+extern int	PoolWaitTimeout;
+extern int	PoolConnectTimeout;
+extern int	PoolNodeProbeInterval;
 
 /* Status inquiry functions */
 extern void PGXCPoolerProcessIam(void);
@@ -148,7 +157,7 @@ extern char *session_options(void);
 
 /* Get pooled connections to specified nodes */
 extern int *PoolManagerGetConnections(List *datanodelist, List *coordlist,
-		int **pids);
+		int **pids, char **states);
 
 /* Clean connections for the specified nodes (for dbname/user). */
 extern void PoolManagerCleanConnection(List *datanodelist, List *coordlist,
@@ -177,6 +186,11 @@ extern void PoolManagerCancelQuery(int dn_count, int* dn_list,
 /* Check health of nodes in the connection pool. */
 extern void PoolPingNodes(void);
 
+/* Connections kept by the session between transactions */
+extern bool PoolManagerKeepConnections(void);
+extern void PoolManagerRequestReclaim(void);
+extern bool PoolManagerReclaimPending(void);
+
 extern bool check_persistent_connections(bool *newval, void **extra,
 		GucSource source);
 
@@ -42,5 +42,6 @@ void DropDBCleanConnection(char *dbname);
 /* Handle pooler connection reload/refresh when signaled by SIGUSR1 */
 void HandlePoolerReload(void);
 void HandlePoolerRefresh(void);
+void HandlePoolerReclaim(void);
 bool PgxcNodeRefresh(void);
 #endif
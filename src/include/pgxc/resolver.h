@@ -0,0 +1,24 @@
+/*-------------------------------------------------------------------------
+ *
+ * resolver.h
+ *
+ *	  Resolution of in-doubt two-phase transactions by the Coordinators
+ *
+ *
+ * Portions Copyright (c) 2012-2014, TransLattice, Inc.
+ *
+ * src/include/pgxc/resolver.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+extern int	twophase_resolver_naptime;
+extern int	twophase_resolver_min_age;
+
+extern void TwoPhaseResolverRegister(void);
+extern void TwoPhaseResolverLauncherMain(Datum main_arg);
+extern void TwoPhaseResolverMain(Datum main_arg);
+
+#endif   /* RESOLVER_H */
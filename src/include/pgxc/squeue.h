@@ -34,11 +34,44 @@ extern PGDLLIMPORT int SQueueSize;
 #define SQ_CONS_SELF -1
 #define SQ_CONS_NONE -2
 
+/*
+ * Runtime filter is a bloom filter over the distribution key a consumer may
+ * install on the shared queue to let the producer discard rows the consumer
+ * won't join with. Keys are hashed with compute_hash() and set two bits of
+ * the filter. The size of the filter in bytes is a power of 2, chosen by the
+ * planner from the expected number of keys, see SharedQueueFilterSize().
+ * Space for the filters is reserved in the shared queue only if the plan
+ * uses them.
+ */
+#define SQUEUE_FILTER_MIN_SIZE	64
+#define SQUEUE_FILTER_MAX_SIZE	(64 * 1024)
+
+#define SQUEUE_FILTER_BIT1(hashvalue, size) \
+	((hashvalue) & ((size) * BITS_PER_BYTE - 1))
+#define SQUEUE_FILTER_BIT2(hashvalue, size) \
+	(((((uint32) (hashvalue)) * 0x9E3779B1) >> 16 | \
+	  (((uint32) (hashvalue)) * 0x9E3779B1) << 16) & \
+	 ((size) * BITS_PER_BYTE - 1))
+
+#define SQueueFilterAdd(filter, size, hashvalue) \
+	do { \
+		uint32	_b1 = SQUEUE_FILTER_BIT1(hashvalue, size); \
+		uint32	_b2 = SQUEUE_FILTER_BIT2(hashvalue, size); \
+		(filter)[_b1 / 32] |= ((uint32) 1) << (_b1 % 32); \
+		(filter)[_b2 / 32] |= ((uint32) 1) << (_b2 % 32); \
+	} while (0)
+
+#define SQueueFilterMatch(filter, size, hashvalue) \
+	(((filter)[SQUEUE_FILTER_BIT1(hashvalue, size) / 32] & \
+	  (((uint32) 1) << (SQUEUE_FILTER_BIT1(hashvalue, size) % 32))) != 0 && \
+	 ((filter)[SQUEUE_FILTER_BIT2(hashvalue, size) / 32] & \
+	  (((uint32) 1) << (SQUEUE_FILTER_BIT2(hashvalue, size) % 32))) != 0)
+
 typedef struct SQueueHeader *SharedQueue;
 
 extern Size SharedQueueShmemSize(void);
 extern void SharedQueuesInit(void);
-extern void SharedQueueAcquire(const char *sqname, int ncons);
+extern void SharedQueueAcquire(const char *sqname, int ncons, int filtersize);
 extern SharedQueue SharedQueueBind(const char *sqname, List *consNodes,
 				List *distNodes, int *myindex, int *consMap);
 extern void SharedQueueUnBind(SharedQueue squeue, bool failed);
@@ -58,5 +91,11 @@ extern void SharedQueueReset(SharedQueue squeue, int consumerIdx);
 extern void SharedQueueResetNotConnected(SharedQueue squeue);
 extern bool SharedQueueCanPause(SharedQueue squeue);
 extern bool SharedQueueWaitOnProducerLatch(SharedQueue squeue, long timeout);
+extern int	SharedQueueFilterSize(double nkeys, int ncons);
+extern void SharedQueueSetFilter(const char *sqname, const uint32 *filter,
+					 int size);
+extern const uint32 *SharedQueueGetFilter(SharedQueue squeue, int consumerIdx,
+					 int *size);
+extern int	SharedQueueGetConsumerNode(SharedQueue squeue, int consumerIdx);
 
 #endif
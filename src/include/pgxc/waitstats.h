@@ -0,0 +1,58 @@
+/*-------------------------------------------------------------------------
+ *
+ * waitstats.h
+ *
+ *	  Time spent waiting on the other components of the cluster
+ *
+ *
+ * Portions Copyright (c) 2012-2014, TransLattice, Inc.
+ *
+ * src/include/pgxc/waitstats.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef WAITSTATS_H
+#define WAITSTATS_H
+
+#include "portability/instr_time.h"
+
+struct pgxc_node_handle;
+
+/*
+ * What a backend waits for. The 2PC phases are the waits for the responses
+ * of the remote nodes, also counted as REMOTE_WAIT_RECEIVE.
+ */
+typedef enum RemoteWaitClass
+{
+	REMOTE_WAIT_GTM,			/* response of GTM */
+	REMOTE_WAIT_RECEIVE,		/* data from remote nodes */
+	REMOTE_WAIT_SQUEUE_READ,	/* consumer waiting for tuples */
+	REMOTE_WAIT_SQUEUE_WRITE,	/* producer waiting for room or consumers */
+	REMOTE_WAIT_PREPARE,		/* PREPARE TRANSACTION on remote nodes */
+	REMOTE_WAIT_COMMIT,			/* COMMIT [PREPARED] on remote nodes */
+	REMOTE_WAIT_POOLER,			/* connections from the pooler */
+	NUM_REMOTE_WAIT_CLASSES
+} RemoteWaitClass;
+
+extern bool track_remote_waits;
+extern int	remote_wait_stats_max;
+
+/* Start timing a wait, the wait is not timed if tracking is off */
+#define RemoteWaitStart(start) \
+	do { \
+		if (track_remote_waits) \
+			INSTR_TIME_SET_CURRENT(start); \
+		else \
+			INSTR_TIME_SET_ZERO(start); \
+	} while (0)
+
+extern double RemoteWaitEnd(RemoteWaitClass waitclass, instr_time start);
+extern void RemoteWaitEndNodes(RemoteWaitClass waitclass, instr_time start,
+				   struct pgxc_node_handle **answered, int nanswered);
+extern void RemoteWaitEndLastNode(RemoteWaitClass waitclass, instr_time start);
+extern void FlushRemoteWaits(void);
+
+extern Size RemoteWaitStatsShmemSize(void);
+extern void RemoteWaitStatsShmemInit(void);
+
+#endif   /* WAITSTATS_H */
@@ -16,8 +16,26 @@
 #ifndef CLUSTERMON_H
 #define CLUSTERMON_H
 
+#include "port/atomics.h"
 #include "storage/s_lock.h"
 #include "gtm/gtm_c.h"
+#include "utils/timestamp.h"
+
+/*
+ * Global snapshot obtained from GTM by the cluster monitor, which the
+ * Coordinator's backends may use instead of asking GTM themselves. Protected
+ * by SnapshotCacheLock.
+ */
+typedef struct
+{
+	bool				valid;
+	uint64				seqno;			/* GTM's completed transaction count */
+	TimestampTz			requested_at;
+	GlobalTransactionId	xmin;
+	GlobalTransactionId	xmax;
+	int					xcnt;
+	GlobalTransactionId	xip[GTM_MAX_GLOBAL_TRANSACTIONS];
+} ClusterMonitorSnapshotCache;
 
 typedef struct
 {
@@ -25,8 +43,17 @@ typedef struct
 	GlobalTransactionId	reported_recent_global_xmin;
 	GlobalTransactionId	reporting_recent_global_xmin;
 	GlobalTransactionId	gtm_recent_global_xmin;
+
+	/*
+	 * Highest completed transaction count GTM has reported to this node,
+	 * with a commit or a snapshot
+	 */
+	pg_atomic_uint64	gtm_seqno;
+	ClusterMonitorSnapshotCache snapshot_cache;
 } ClusterMonitorCtlData;
 
+extern int	gtm_snapshot_cache_max_age;
+
 extern void ClusterMonitorShmemInit(void);
 extern Size ClusterMonitorShmemSize(void);
 
@@ -39,6 +66,8 @@ extern int	StartClusterMonitor(void);
 extern GlobalTransactionId ClusterMonitorGetGlobalXmin(void);
 extern void ClusterMonitorSetGlobalXmin(GlobalTransactionId xmin);
 extern GlobalTransactionId ClusterMonitorGetReportingGlobalXmin(void);
+extern void ClusterMonitorNoteSeqno(uint64 seqno);
+extern bool ClusterMonitorGetCachedSnapshot(TimestampTz now);
 
 #ifdef EXEC_BACKEND
 extern void ClusterMonitorIAm(void);
@@ -118,6 +118,10 @@ struct PGPROC
 	int			coordPid;		/* Pid of the originating session */
 	BackendId	firstBackendId;	/* Backend ID of the first backend of
 								 * the distributed session */
+	bool		tsCommitting;	/* getting a commit timestamp from GTM, see
+								 * AssignXactCommitTimestamp */
+	TimestampTz	snapshotTs;		/* timestamp of the snapshot our xmin comes
+								 * from, see TsCommitLogSnapshotXmin */
 #endif
 
 	bool		isBackgroundWorker; /* true if background worker. */
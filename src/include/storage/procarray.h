@@ -27,7 +27,8 @@ extern int GlobalSnapshotSource;
 typedef enum GlobalSnapshotSourceType
 {
 	GLOBAL_SNAPSHOT_SOURCE_GTM,
-	GLOBAL_SNAPSHOT_SOURCE_COORDINATOR
+	GLOBAL_SNAPSHOT_SOURCE_COORDINATOR,
+	GLOBAL_SNAPSHOT_SOURCE_TIMESTAMP
 } GlobalSnapshotSourceType;
 #endif
 
@@ -87,6 +88,10 @@ extern void SetGlobalSnapshotData(TransactionId xmin, TransactionId xmax, int xc
 		TransactionId *xip,
 		SnapshotSource source);
 extern void UnsetGlobalSnapshotData(void);
+#ifdef XCP
+extern void SetGlobalSnapshotTimestamp(TimestampTz snapshot_ts);
+extern void ProcArrayNoteTimestampCommit(TransactionId xid, TimestampTz commit_ts);
+#endif
 extern void ReloadConnInfoOnBackends(bool refresh_only);
 #endif /* PGXC */
 extern void ProcArrayInitRecovery(TransactionId initializedUptoXID);
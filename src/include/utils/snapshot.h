@@ -114,6 +114,13 @@ typedef struct SnapshotData
 
 	TimestampTz whenTaken;		/* timestamp when snapshot was taken */
 	XLogRecPtr	lsn;			/* position in the WAL stream when taken */
+#ifdef XCP
+	/*
+	 * GTM timestamp of a timestamp based snapshot, or 0. Transactions that
+	 * committed with a later commit timestamp are treated as in progress.
+	 */
+	TimestampTz snapshot_ts;
+#endif
 } SnapshotData;
 
 /*
@@ -75,6 +75,7 @@ enum SysCacheIdentifier
 	OPFAMILYOID,
 #ifdef PGXC
 	PGXCCLASSRELID,
+	PGXCCLASSSTATS,
 	PGXCGROUPNAME,
 	PGXCGROUPOID,
 	PGXCNODENAME,
@@ -857,6 +857,15 @@ set_node_config_file(PGXCNodeTypeNum node)
 	snprintf(buf, sizeof(buf), "gtm_port = %d\n", get_port_number(PGXC_GTM));
 	fputs(buf, pg_conf);
 
+	/*
+	 * Serve sequences through gtm_sequence_servers, with the same GTM as
+	 * the only sequence server, so the tests go through the routing of
+	 * sequence commands and their handling at commit and abort.
+	 */
+	snprintf(buf, sizeof(buf), "gtm_sequence_servers = 'localhost:%d'\n",
+			 get_port_number(PGXC_GTM));
+	fputs(buf, pg_conf);
+
 	snprintf(buf, sizeof(buf), "pooler_port = %d\n", get_pooler_port(node));
 	fputs(buf, pg_conf);
 
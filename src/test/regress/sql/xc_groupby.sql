@@ -845,3 +845,28 @@ drop table xc_groupby_g;
 
 reset enable_hashagg;
 reset enable_fast_query_shipping;
+
+-- Aggregation on Datanodes after redistributing by a grouping key
+set enable_fast_query_shipping to off;
+set enable_redistributed_grouping to on;
+create table xc_groupby_rd (a int, b int, c int) distribute by hash(a);
+insert into xc_groupby_rd select i, i % 100, i % 7 from generate_series(1, 10000) i;
+analyze xc_groupby_rd;
+-- the key with more distinct values is used for redistribution
+explain (costs false, nodes false) select b, c, count(distinct a) from xc_groupby_rd group by c, b;
+select count(*), sum(cnt) from (select b, c, count(distinct a) cnt from xc_groupby_rd group by c, b) q;
+-- DISTINCT aggregates without GROUP BY are deduplicated on the Datanodes
+explain (costs false, nodes false) select count(distinct b) from xc_groupby_rd;
+select count(distinct b) from xc_groupby_rd;
+explain (costs false, nodes false) select count(distinct b), sum(distinct b) from xc_groupby_rd;
+select count(distinct b), sum(distinct b) from xc_groupby_rd;
+-- but not when mixed with other aggregates
+explain (costs false, nodes false) select count(distinct b), count(*) from xc_groupby_rd;
+-- expressions which can't be evaluated on Datanodes stay on the Coordinator
+explain (costs false, nodes false) select b, count(distinct a), random() from xc_groupby_rd group by b;
+set enable_redistributed_grouping to off;
+explain (costs false, nodes false) select count(distinct b) from xc_groupby_rd;
+select count(distinct b) from xc_groupby_rd;
+drop table xc_groupby_rd;
+reset enable_redistributed_grouping;
+reset enable_fast_query_shipping;
@@ -39,3 +39,18 @@ ALTER NODE dummy_node WITH (PREFERRED);
 ALTER NODE dummy_node WITH (PRIMARY);
 ALTER NODE dummy_node WITH (TYPE = 'datanode');
 DROP NODE dummy_node;
+
+-- The pooler stops connecting to a node which refused a connection
+CREATE NODE dummy_node_down WITH (TYPE = 'datanode', HOST = 'localhost', PORT = 1);
+SELECT pgxc_pool_reload();
+\set VERBOSITY terse
+EXECUTE DIRECT ON (dummy_node_down) 'SELECT 1'; -- refused
+EXECUTE DIRECT ON (dummy_node_down) 'SELECT 1'; -- fails at once
+\set VERBOSITY default
+-- The statistics reach the view at the next check of the nodes
+SELECT pg_sleep(2);
+SELECT node_type, healthy, unhealthy_since IS NOT NULL AS down,
+       connect_failures, connect_timeouts, fast_failures
+FROM pgxc_stat_pool_nodes WHERE node_name = 'dummy_node_down';
+DROP NODE dummy_node_down;
+SELECT pgxc_pool_reload();
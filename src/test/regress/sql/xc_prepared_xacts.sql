@@ -209,6 +209,76 @@ commit prepared 'pt_1';
 
 -- ****  
 
+-- sequences created or dropped by a prepared transaction
+begin;
+create sequence xc_pt_seq;
+prepare transaction 'pt_seq';
+rollback prepared 'pt_seq';
+select nextval('xc_pt_seq'); -- fail
+create sequence xc_pt_seq;
+select nextval('xc_pt_seq');
+begin;
+drop sequence xc_pt_seq;
+prepare transaction 'pt_seq';
+rollback prepared 'pt_seq';
+select nextval('xc_pt_seq');
+begin;
+drop sequence xc_pt_seq;
+prepare transaction 'pt_seq';
+commit prepared 'pt_seq';
+select nextval('xc_pt_seq'); -- fail
+
+-- nextval in a prepared transaction; values are never given back
+create sequence xc_pt_seq2;
+begin;
+select nextval('xc_pt_seq2');
+prepare transaction 'pt_seq';
+commit prepared 'pt_seq';
+select nextval('xc_pt_seq2');
+begin;
+select nextval('xc_pt_seq2');
+prepare transaction 'pt_seq';
+rollback prepared 'pt_seq';
+select nextval('xc_pt_seq2');
+-- and in the transaction creating or dropping the sequence
+begin;
+create sequence xc_pt_seq3;
+select nextval('xc_pt_seq3');
+prepare transaction 'pt_seq';
+commit prepared 'pt_seq';
+select nextval('xc_pt_seq3');
+begin;
+select nextval('xc_pt_seq3');
+drop sequence xc_pt_seq3;
+prepare transaction 'pt_seq';
+rollback prepared 'pt_seq';
+select nextval('xc_pt_seq3');
+drop sequence xc_pt_seq2;
+drop sequence xc_pt_seq3;
+
+-- ****  
+
+-- in-doubt transactions as seen by the 2PC resolver, with an explicitly
+-- prepared transaction having the GID of an implicit one
+create table xc_in_doubt (a int) distribute by replication;
+begin;
+insert into xc_in_doubt values (1);
+select '_$XC$' || (txid_current() % 4294967296) || ':' || pgxc_node_str() ||
+       ':T:' || (select count(*) from pgxc_node where node_type = 'D') || ':1:' ||
+       (select string_agg(node_id::text, ':' order by node_name)
+          from pgxc_node where node_type = 'D') || ':' ||
+       (select node_id from pgxc_node where node_name = pgxc_node_str())
+       as in_doubt_gid \gset
+prepare transaction :'in_doubt_gid';
+select action from pgxc_in_doubt_xacts(3600) where gid = :'in_doubt_gid';
+-- prepared everywhere, but this session is still connected to GTM
+select action from pgxc_in_doubt_xacts(0) where gid = :'in_doubt_gid';
+commit prepared :'in_doubt_gid';
+select action from pgxc_in_doubt_xacts(0) where gid = :'in_doubt_gid';
+select * from xc_in_doubt;
+drop table xc_in_doubt;
+-- ****  
+
 -- drop objects created
 drop table c1;
 drop table p1;
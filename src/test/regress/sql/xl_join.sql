@@ -19,3 +19,47 @@ SELECT * FROM xl_join_t1
 DROP TABLE xl_join_t1;
 DROP TABLE xl_join_t2;
 DROP TABLE xl_join_t3;
+
+-- Choice between redistributing and broadcasting the inputs of a join
+CREATE TABLE xl_join_fact (a int, b int) DISTRIBUTE BY HASH (a);
+CREATE TABLE xl_join_dim (c int, b int, name text) DISTRIBUTE BY HASH (c);
+INSERT INTO xl_join_fact SELECT i, i % 10 FROM generate_series(1, 10000) i;
+INSERT INTO xl_join_dim SELECT i, i, 'dim ' || i FROM generate_series(0, 9) i;
+ANALYZE xl_join_fact;
+ANALYZE xl_join_dim;
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+
+-- without broadcasting both inputs are redistributed by the join key
+EXPLAIN (COSTS OFF)
+SELECT * FROM xl_join_fact f JOIN xl_join_dim d ON f.b = d.b;
+SELECT count(*) FROM xl_join_fact f JOIN xl_join_dim d ON f.b = d.b;
+
+-- the small input is cheaper to send to the nodes of the large one
+SET enable_broadcast_join = on;
+EXPLAIN (COSTS OFF)
+SELECT * FROM xl_join_fact f JOIN xl_join_dim d ON f.b = d.b;
+SELECT count(*) FROM xl_join_fact f JOIN xl_join_dim d ON f.b = d.b;
+
+-- but a large input is still redistributed rather than broadcast
+EXPLAIN (COSTS OFF)
+SELECT * FROM xl_join_fact f1 JOIN xl_join_fact f2 ON f1.b = f2.a;
+SELECT count(*) FROM xl_join_fact f1 JOIN xl_join_fact f2 ON f1.b = f2.a;
+
+-- runtime filter sent to the producers of the redistributed outer side;
+-- broadcasting is off, the filtered inner side would be replicated otherwise
+RESET enable_broadcast_join;
+SET enable_runtime_filter = on;
+EXPLAIN (COSTS OFF)
+SELECT * FROM xl_join_fact f1 JOIN xl_join_fact f2 ON f1.b = f2.a WHERE f2.a <= 5;
+SELECT count(*) FROM xl_join_fact f1 JOIN xl_join_fact f2 ON f1.b = f2.a WHERE f2.a <= 5;
+SET enable_runtime_filter = off;
+EXPLAIN (COSTS OFF)
+SELECT * FROM xl_join_fact f1 JOIN xl_join_fact f2 ON f1.b = f2.a WHERE f2.a <= 5;
+SELECT count(*) FROM xl_join_fact f1 JOIN xl_join_fact f2 ON f1.b = f2.a WHERE f2.a <= 5;
+RESET enable_runtime_filter;
+
+RESET enable_mergejoin;
+RESET enable_nestloop;
+DROP TABLE xl_join_fact;
+DROP TABLE xl_join_dim;
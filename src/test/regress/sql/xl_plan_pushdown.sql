@@ -56,3 +56,31 @@ EXPLAIN VERBOSE DELETE FROM xl_ppm where a=200::INT2;
 
 DROP TABLE xl_pp;
 DROP TABLE xl_ppm;
+
+-- Top-N queries: every node returns at most LIMIT + OFFSET sorted rows and the
+-- Coordinator merges the sorted streams
+CREATE TABLE xl_topn (a int, b int) DISTRIBUTE BY HASH(a);
+INSERT INTO xl_topn SELECT i, i % 50 FROM generate_series(1, 1000) i;
+ANALYZE xl_topn;
+
+EXPLAIN (COSTS OFF, VERBOSE ON, NODES OFF)
+SELECT a, b FROM xl_topn ORDER BY b, a LIMIT 5 OFFSET 10;
+SELECT a, b FROM xl_topn ORDER BY b, a LIMIT 5 OFFSET 10;
+SELECT a FROM xl_topn ORDER BY a DESC LIMIT 3 OFFSET 998;
+SELECT a FROM xl_topn ORDER BY a LIMIT 5 OFFSET 1000;
+
+-- bound of the outer LIMIT does not leak into the subquery
+SELECT * FROM (SELECT a, b FROM xl_topn ORDER BY a LIMIT 20) s
+	ORDER BY b DESC LIMIT 3 OFFSET 2;
+
+DROP TABLE xl_topn;
+
+-- EXPLAIN ANALYZE shows the totals of the plan nodes run on the Datanodes
+CREATE TABLE xl_explain_analyze (a int, b int) DISTRIBUTE BY HASH(a);
+INSERT INTO xl_explain_analyze SELECT i, i % 10 FROM generate_series(1, 100) i;
+ANALYZE xl_explain_analyze;
+
+EXPLAIN (ANALYZE ON, COSTS OFF, TIMING OFF, SUMMARY OFF, NODES OFF)
+SELECT count(*) FROM xl_explain_analyze WHERE a <= 10;
+
+DROP TABLE xl_explain_analyze;
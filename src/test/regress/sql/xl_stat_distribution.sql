@@ -0,0 +1,47 @@
+--
+-- Per-Datanode distribution of tables (pgxc_class_stats)
+--
+CREATE TABLE xl_skew (a int, b int) DISTRIBUTE BY HASH (a);
+CREATE TABLE xl_skew_even (a int, b int) DISTRIBUTE BY HASH (a);
+-- all the rows of xl_skew go to the same node
+INSERT INTO xl_skew SELECT 1, i FROM generate_series(1, 1000) i;
+INSERT INTO xl_skew_even SELECT i, i FROM generate_series(1, 1000) i;
+
+-- with two Datanodes a node holds at most twice its share of the rows
+SET distribution_skew_threshold = 1.5;
+-- the detail names the node
+\set VERBOSITY terse
+ANALYZE xl_skew;
+ANALYZE xl_skew_even;
+\set VERBOSITY default
+RESET distribution_skew_threshold;
+
+SELECT tablename, count(*) AS nodes, sum(n_tuples) AS n_tuples,
+       max(skew) > 1.5 AS uneven
+FROM pgxc_stat_distribution
+WHERE tablename IN ('xl_skew', 'xl_skew_even')
+GROUP BY tablename ORDER BY tablename;
+
+SELECT most_common_vals, most_common_freqs FROM pgxc_stat_distribution
+WHERE tablename = 'xl_skew' AND n_tuples > 0;
+
+-- moving the rows of a skewed table costs more than of an even one
+CREATE FUNCTION xl_skew_cost(query text) RETURNS float8 AS $$
+DECLARE
+	plan json;
+BEGIN
+	EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+	RETURN (plan->0->'Plan'->>'Total Cost')::float8;
+END;
+$$ LANGUAGE plpgsql;
+SET enable_fast_query_shipping = off;
+SELECT xl_skew_cost('SELECT * FROM xl_skew') >
+       xl_skew_cost('SELECT * FROM xl_skew_even') AS skew_costs_more;
+RESET enable_fast_query_shipping;
+
+DROP FUNCTION xl_skew_cost(text);
+DROP TABLE xl_skew;
+DROP TABLE xl_skew_even;
+-- the entries go away with the table
+SELECT count(*) FROM pgxc_class_stats
+WHERE pcsrelid NOT IN (SELECT oid FROM pg_class);
@@ -0,0 +1,296 @@
+#!/bin/sh
+#
+# Benchmark of the Postgres-XL specific paths
+#
+# Sets up GTM, a GTM proxy, one Coordinator and a number of Datanodes on
+# localhost, measures GTM throughput, redistribution bandwidth, pooler
+# connection latency, 2PC commit latency and how long barriers block commits,
+# and writes the results as lines of JSON.  See README.
+#
+# Portions Copyright (c) 2012-2014, TransLattice, Inc.
+#
+# src/test/xlbench/xlbench.sh
+
+bindir=
+gtm_bench=
+datanodes=2
+clients=4
+duration=10
+rows=100000
+port=25432
+output=results/xlbench.json
+
+for arg
+do
+	case "$arg" in
+		--bindir=*)		bindir="${arg#*=}" ;;
+		--gtm-bench=*)	gtm_bench="${arg#*=}" ;;
+		--datanodes=*)	datanodes="${arg#*=}" ;;
+		--clients=*)	clients="${arg#*=}" ;;
+		--duration=*)	duration="${arg#*=}" ;;
+		--rows=*)		rows="${arg#*=}" ;;
+		--port=*)		port="${arg#*=}" ;;
+		--output=*)		output="${arg#*=}" ;;
+		*)
+			echo "usage: $0 [--bindir=DIR] [--gtm-bench=PROGRAM] [--datanodes=N] [--clients=N]" >&2
+			echo "          [--duration=SECS] [--rows=N] [--port=PORT] [--output=FILE]" >&2
+			exit 1 ;;
+	esac
+done
+
+if [ -n "$bindir" ]; then
+	bindir="$bindir/"
+fi
+
+datadir=`pwd`/tmp_bench
+logdir=$datadir/log
+
+# Ports: GTM, proxy, then a port and a pooler port for every node
+gtm_port=$port
+proxy_port=`expr $port + 1`
+coord_port=`expr $port + 2`
+
+dn_port()
+{
+	expr $port + 4 + 2 \* \( $1 - 1 \)
+}
+
+log()
+{
+	echo "xlbench: $*"
+}
+
+fail()
+{
+	echo "xlbench: $*" >&2
+	exit 1
+}
+
+psql_coord()
+{
+	"${bindir}psql" -X -q -A -t -v ON_ERROR_STOP=1 -h localhost \
+		-p $coord_port -d postgres -c "$1" || fail "query failed: $1"
+}
+
+emit()
+{
+	printf '{"benchmark": "%s", "metric": "%s", "value": %s, "unit": "%s"}\n' \
+		"$1" "$2" "${3:-null}" "$4" >> "$output"
+	log "$1 $2: $3 $4"
+}
+
+# Extract a value from pgbench output
+pgbench_value()
+{
+	sed -n "s/^$1 = \([0-9.]*\).*/\1/p" "$2" | head -1
+}
+
+run_pgbench()
+{
+	"${bindir}pgbench" -n -h localhost -p $coord_port "$@" postgres \
+		> "$logdir/pgbench.out" 2>> "$logdir/pgbench.log" ||
+		fail "pgbench failed, see $logdir/pgbench.log"
+}
+
+write_node_conf()
+{
+	cat >> "$1/postgresql.conf" <<EOF
+port = $2
+pooler_port = `expr $2 + 1`
+listen_addresses = 'localhost'
+gtm_host = 'localhost'
+gtm_port = $proxy_port
+max_connections = 100
+max_prepared_transactions = 100
+track_remote_waits = on
+EOF
+}
+
+stop_cluster()
+{
+	for dir in "$datadir"/coord1 "$datadir"/dn*
+	do
+		[ -f "$dir/postmaster.pid" ] &&
+			"${bindir}pg_ctl" stop -D "$dir" -m fast -w > /dev/null 2>&1
+	done
+	[ -f "$datadir/gtm_proxy/gtm_proxy.pid" ] &&
+		"${bindir}gtm_ctl" stop -Z gtm_proxy -D "$datadir/gtm_proxy" -m fast > /dev/null 2>&1
+	[ -f "$datadir/gtm/gtm.pid" ] &&
+		"${bindir}gtm_ctl" stop -Z gtm -D "$datadir/gtm" -m fast > /dev/null 2>&1
+}
+
+#
+# Set up the cluster
+#
+rm -rf "$datadir"
+mkdir -p "$logdir" `dirname "$output"` || exit 1
+: > "$output"
+trap stop_cluster EXIT INT TERM
+
+log "initializing GTM and GTM proxy"
+"${bindir}initgtm" -Z gtm -D "$datadir/gtm" > "$logdir/initgtm.log" 2>&1 ||
+	fail "initgtm failed, see $logdir/initgtm.log"
+cat >> "$datadir/gtm/gtm.conf" <<EOF
+nodename = 'gtm'
+listen_addresses = 'localhost'
+port = $gtm_port
+EOF
+"${bindir}gtm_ctl" start -Z gtm -D "$datadir/gtm" -l "$logdir/gtm.log" > /dev/null ||
+	fail "could not start GTM"
+
+"${bindir}initgtm" -Z gtm_proxy -D "$datadir/gtm_proxy" >> "$logdir/initgtm.log" 2>&1 ||
+	fail "initgtm failed, see $logdir/initgtm.log"
+cat >> "$datadir/gtm_proxy/gtm_proxy.conf" <<EOF
+nodename = 'gtm_proxy'
+listen_addresses = 'localhost'
+port = $proxy_port
+gtm_host = 'localhost'
+gtm_port = $gtm_port
+worker_threads = 2
+EOF
+"${bindir}gtm_ctl" start -Z gtm_proxy -D "$datadir/gtm_proxy" -l "$logdir/gtm_proxy.log" > /dev/null ||
+	fail "could not start GTM proxy"
+sleep 1
+
+log "initializing Coordinator and $datanodes Datanodes"
+"${bindir}initdb" --nodename coord1 -D "$datadir/coord1" -A trust > "$logdir/initdb.log" 2>&1 ||
+	fail "initdb failed, see $logdir/initdb.log"
+write_node_conf "$datadir/coord1" $coord_port
+"${bindir}pg_ctl" start -Z coordinator -D "$datadir/coord1" -l "$logdir/coord1.log" -w > /dev/null ||
+	fail "could not start Coordinator"
+
+i=1
+while [ $i -le $datanodes ]
+do
+	"${bindir}initdb" --nodename dn$i -D "$datadir/dn$i" -A trust >> "$logdir/initdb.log" 2>&1 ||
+		fail "initdb failed, see $logdir/initdb.log"
+	write_node_conf "$datadir/dn$i" `dn_port $i`
+	"${bindir}pg_ctl" start -Z datanode -D "$datadir/dn$i" -l "$logdir/dn$i.log" -w > /dev/null ||
+		fail "could not start Datanode dn$i"
+	i=`expr $i + 1`
+done
+
+# Every node has to know about the others
+psql_coord "ALTER NODE coord1 WITH (HOST = 'localhost', PORT = $coord_port)"
+i=1
+while [ $i -le $datanodes ]
+do
+	psql_coord "CREATE NODE dn$i WITH (TYPE = 'datanode', HOST = 'localhost', PORT = `dn_port $i`)"
+	i=`expr $i + 1`
+done
+psql_coord "SELECT pgxc_pool_reload()" > /dev/null
+
+i=1
+while [ $i -le $datanodes ]
+do
+	psql_coord "EXECUTE DIRECT ON (dn$i) \$\$CREATE NODE coord1 WITH (TYPE = 'coordinator', HOST = 'localhost', PORT = $coord_port)\$\$"
+	j=1
+	while [ $j -le $datanodes ]
+	do
+		if [ $j -eq $i ]; then
+			psql_coord "EXECUTE DIRECT ON (dn$i) \$\$ALTER NODE dn$j WITH (HOST = 'localhost', PORT = `dn_port $j`)\$\$"
+		else
+			psql_coord "EXECUTE DIRECT ON (dn$i) \$\$CREATE NODE dn$j WITH (TYPE = 'datanode', HOST = 'localhost', PORT = `dn_port $j`)\$\$"
+		fi
+		j=`expr $j + 1`
+	done
+	psql_coord "EXECUTE DIRECT ON (dn$i) \$\$SELECT pgxc_pool_reload()\$\$" > /dev/null
+	i=`expr $i + 1`
+done
+
+emit setup datanodes $datanodes nodes
+emit setup clients $clients clients
+
+#
+# GTM: GXIDs and snapshots, directly and through the proxy
+#
+if [ -n "$gtm_bench" ] && [ -x "$gtm_bench" ]; then
+	for target in gtm:$gtm_port proxy:$proxy_port
+	do
+		name=${target%%:*}
+		tport=${target#*:}
+		for mode in gxid:0 snapshot:100
+		do
+			metric=${mode%%:*}
+			readonly_pct=${mode#*:}
+			"$gtm_bench" -h localhost -p $tport -m gtm -t $clients -o 100 \
+				-r $readonly_pct -d $duration > "$logdir/gtm_bench.out" 2>&1 ||
+				fail "bench_snapshot failed, see $logdir/gtm_bench.out"
+			value=`sed -n 's/^throughput: \([0-9.]*\).*/\1/p' "$logdir/gtm_bench.out"`
+			emit gtm "${metric}_throughput_$name" "$value" "transactions/s"
+		done
+	done
+else
+	log "bench_snapshot not found, skipping GTM throughput"
+fi
+
+#
+# Redistribution: the rows of one side of the join go through the shared
+# queues to the Datanodes holding the matching rows of the other side
+#
+log "loading $rows rows"
+psql_coord "CREATE TABLE xlbench_redist (a int, b int, filler text) DISTRIBUTE BY HASH (a)"
+psql_coord "INSERT INTO xlbench_redist SELECT i, (i * 7919) % $rows + 1, repeat('x', 100) FROM generate_series(1, $rows) i"
+psql_coord "ANALYZE xlbench_redist"
+width=`psql_coord "SELECT round(avg(pg_column_size(b) + pg_column_size(filler))) FROM xlbench_redist"`
+
+cat > "$datadir/redist.sql" <<EOF
+SELECT sum(length(x.filler)) FROM xlbench_redist x JOIN xlbench_redist y ON x.b = y.a;
+EOF
+run_pgbench -f "$datadir/redist.sql" -c 1 -T $duration
+latency=`pgbench_value "latency average" "$logdir/pgbench.out"`
+emit redistribution latency "$latency" ms
+emit redistribution rows_per_second \
+	`awk "BEGIN { printf \"%.0f\", $rows * 1000 / $latency }"` rows/s
+emit redistribution bandwidth \
+	`awk "BEGIN { printf \"%.2f\", $rows * $width * 1000 / $latency / 1048576 }"` MB/s
+
+#
+# Pooler: every session asks the pooler for connections to the Datanodes
+#
+psql_coord "CREATE TABLE xlbench_small (a int) DISTRIBUTE BY HASH (a)"
+psql_coord "INSERT INTO xlbench_small SELECT generate_series(1, 1000)"
+cat > "$datadir/pooler.sql" <<EOF
+SELECT count(*) FROM xlbench_small;
+EOF
+psql_coord "SELECT pgxc_stat_reset_remote_waits()" > /dev/null
+run_pgbench -f "$datadir/pooler.sql" -C -c $clients -j $clients -T $duration
+emit pooler tps `pgbench_value "tps" "$logdir/pgbench.out"` transactions/s
+emit pooler acquire_latency `psql_coord "SELECT round((sum(pooler_time) / nullif(sum(calls), 0))::numeric, 3) FROM pgxc_stat_remote_query_waits WHERE query LIKE 'SELECT count(*) FROM xlbench_small%'"` ms
+
+#
+# 2PC: updates of a replicated table are committed on all the Datanodes
+#
+psql_coord "CREATE TABLE xlbench_2pc (k int, v int) DISTRIBUTE BY REPLICATION"
+psql_coord "INSERT INTO xlbench_2pc SELECT i, 0 FROM generate_series(0, $clients - 1) i"
+cat > "$datadir/2pc.sql" <<EOF
+UPDATE xlbench_2pc SET v = v + 1 WHERE k = :client_id;
+EOF
+psql_coord "SELECT pgxc_stat_reset_remote_waits()" > /dev/null
+run_pgbench -f "$datadir/2pc.sql" -c $clients -j $clients -T $duration
+emit 2pc tps `pgbench_value "tps" "$logdir/pgbench.out"` transactions/s
+emit 2pc latency `pgbench_value "latency average" "$logdir/pgbench.out"` ms
+emit 2pc prepare_latency `psql_coord "SELECT round((sum(prepare_time) / nullif(sum(calls), 0))::numeric, 3) FROM pgxc_stat_remote_query_waits WHERE query LIKE 'UPDATE xlbench_2pc%'"` ms
+emit 2pc commit_latency `psql_coord "SELECT round((sum(commit_time) / nullif(sum(calls), 0))::numeric, 3) FROM pgxc_stat_remote_query_waits WHERE query LIKE 'UPDATE xlbench_2pc%'"` ms
+
+#
+# Barriers: CREATE BARRIER while the 2PC workload runs, the Coordinator logs
+# for how long every barrier held back the commits
+#
+cat > "$datadir/barrier.sql" <<EOF
+CREATE BARRIER;
+EOF
+"${bindir}pgbench" -n -h localhost -p $coord_port -f "$datadir/2pc.sql" \
+	-c $clients -j $clients -T $duration postgres \
+	> "$logdir/pgbench_2pc.out" 2>> "$logdir/pgbench.log" &
+workload=$!
+run_pgbench -f "$datadir/barrier.sql" -c 1 -R 2 -T $duration
+wait $workload || fail "pgbench failed, see $logdir/pgbench.log"
+emit barrier latency `pgbench_value "latency average" "$logdir/pgbench.out"` ms
+emit barrier 2pc_tps `pgbench_value "tps" "$logdir/pgbench_2pc.out"` transactions/s
+stalls=`sed -n 's/.*Commits were blocked for \([0-9.]*\) ms.*/\1/p' "$logdir/coord1.log"`
+emit barrier stall_average `echo "$stalls" | awk 'NF { s += $1; n++ } END { if (n) printf "%.3f", s / n }'` ms
+emit barrier stall_max `echo "$stalls" | awk 'NF && $1 > m { m = $1 } END { if (NR) printf "%.3f", m }'` ms
+
+log "results written to $output"
+exit 0